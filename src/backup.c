@@ -0,0 +1,592 @@
+/*
+ *    backup.c    --    Source file for the world backup store
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Defines the content-addressed backup store. The store is a directory
+ *    with two files: "pack", holding every chunk ever stored back to back,
+ *    and "index", holding a (hash, length, offset) entry per chunk. The
+ *    index is appended to only after the chunk is in the pack, so a crash
+ *    can at worst leave unreferenced bytes at the end of the pack. Chunks
+ *    with the same hash are only deduplicated once their bytes are found
+ *    to be equal, and manifests name each chunk by its offset, so chunks
+ *    whose hashes collide are stored and restored apart.
+ */
+#include "backup.h"
+
+#include "hash.h"
+#include "log.h"
+#include "parseutil.h"
+#include "tilefuncs.h"
+#include "wldheaderfuncs.h"
+#include "wldsave.h"
+
+#include <malloc.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BACKUP_MANIFEST_VERSION 2
+#define BACKUP_COMPARE_BLOCK    0x10000
+
+/*
+ *    Returns whether a stored chunk holds exactly the given bytes.
+ *
+ *    @param backup_store_t       *store    The store.
+ *    @param const backup_entry_t *entry    The stored chunk.
+ *    @param const unsigned char  *chunk    The bytes to compare, entry->len long.
+ *
+ *    @return unsigned int    1 if the bytes are equal, 0 if not or if the pack can not be read.
+ */
+static unsigned int backup_matches(backup_store_t *store, const backup_entry_t *entry, const unsigned char *chunk) {
+    unsigned char block[BACKUP_COMPARE_BLOCK];
+    unsigned long done = 0;
+
+    while (done < entry->len) {
+        unsigned long n = entry->len - done;
+
+        if (n > sizeof(block))
+            n = sizeof(block);
+
+        if (pread(fileno(store->pack), block, n, entry->offset + done) != (ssize_t)n || memcmp(block, chunk + done, n) != 0)
+            return 0;
+
+        done += n;
+    }
+
+    return 1;
+}
+
+/*
+ *    Finds a chunk in the store's table. Entries with the same hash and
+ *    length are checked against the bytes of the chunk when given.
+ *
+ *    @param backup_store_t      *store    The store.
+ *    @param unsigned long long   hash     The hash of the chunk.
+ *    @param unsigned long        len      The length of the chunk.
+ *    @param const unsigned char *chunk    The bytes of the chunk, NULL to take the first entry that matches the hash.
+ *
+ *    @return backup_entry_t *    The entry, which is empty if the chunk is not stored.
+ */
+static backup_entry_t *backup_find(backup_store_t *store, unsigned long long hash, unsigned long len, const unsigned char *chunk) {
+    unsigned long i = (unsigned long)hash & (store->cap - 1);
+
+    while (store->entries[i].len != 0) {
+        backup_entry_t *entry = &store->entries[i];
+
+        if (entry->hash == hash && entry->len == len && (chunk == (const unsigned char *)0x0 || backup_matches(store, entry, chunk)))
+            break;
+
+        i = (i + 1) & (store->cap - 1);
+    }
+
+    return &store->entries[i];
+}
+
+/*
+ *    Finds the first empty slot for a hash in the store's table.
+ *
+ *    @param backup_store_t     *store    The store.
+ *    @param unsigned long long  hash     The hash of the chunk.
+ *
+ *    @return backup_entry_t *    The empty slot.
+ */
+static backup_entry_t *backup_slot(backup_store_t *store, unsigned long long hash) {
+    unsigned long i = (unsigned long)hash & (store->cap - 1);
+
+    while (store->entries[i].len != 0)
+        i = (i + 1) & (store->cap - 1);
+
+    return &store->entries[i];
+}
+
+/*
+ *    Adds a chunk to the store's table, growing it when it fills up.
+ *
+ *    @param backup_store_t *store    The store.
+ *    @param backup_entry_t  entry    The chunk to add.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int backup_insert(backup_store_t *store, backup_entry_t entry) {
+    if ((store->count + 1) * 4 > store->cap * 3) {
+        backup_entry_t *old     = store->entries;
+        unsigned long   old_cap = store->cap;
+
+        store->cap     = old_cap * 2;
+        store->entries = (backup_entry_t *)calloc(store->cap, sizeof(backup_entry_t));
+
+        if (store->entries == (backup_entry_t *)0x0) {
+            LOGF_ERR("Failed to allocate memory for backup index.\n");
+            store->entries = old;
+            store->cap     = old_cap;
+            return 0;
+        }
+
+        unsigned long i;
+        for (i = 0; i < old_cap; ++i) {
+            if (old[i].len != 0)
+                *backup_slot(store, old[i].hash) = old[i];
+        }
+
+        free(old);
+    }
+
+    *backup_slot(store, entry.hash) = entry;
+    ++store->count;
+
+    return 1;
+}
+
+/*
+ *    Opens a file in a directory.
+ *
+ *    @param const char *dir     The directory.
+ *    @param const char *name    The file name.
+ *
+ *    @return FILE *    The file, opened for reading and appending.
+ */
+static FILE *backup_open_file(const char *dir, const char *name) {
+    char path[4096];
+
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+
+    return fopen(path, "a+b");
+}
+
+/*
+ *    Opens a backup store, creating it if it does not exist.
+ *
+ *    @param const char *dir    The directory holding the pack and index files.
+ *
+ *    @return backup_store_t *    The store, NULL on failure.
+ */
+backup_store_t *backup_open(const char *dir) {
+    if (dir == (const char *)0x0) {
+        LOGF_ERR("Directory is NULL.\n");
+        return (backup_store_t *)0x0;
+    }
+
+    backup_store_t *store = (backup_store_t *)calloc(1, sizeof(backup_store_t));
+
+    if (store == (backup_store_t *)0x0) {
+        LOGF_ERR("Failed to allocate memory for backup store.\n");
+        return (backup_store_t *)0x0;
+    }
+
+    store->cap     = 1024;
+    store->entries = (backup_entry_t *)calloc(store->cap, sizeof(backup_entry_t));
+    store->pack    = backup_open_file(dir, "pack");
+    store->index   = backup_open_file(dir, "index");
+
+    if (store->entries == (backup_entry_t *)0x0 || store->pack == (FILE *)0x0 || store->index == (FILE *)0x0) {
+        VLOGF_ERR("Failed to open backup store in %s.\n", dir);
+        backup_close(store);
+        return (backup_store_t *)0x0;
+    }
+
+    fseek(store->pack, 0, SEEK_END);
+    store->pack_len = ftell(store->pack);
+
+    backup_entry_t entry;
+
+    fseek(store->index, 0, SEEK_SET);
+    while (fread(&entry, sizeof(entry), 1, store->index) == 1) {
+        /* Skip entries whose chunk never made it into the pack.  */
+        if (entry.len == 0 || entry.offset + entry.len > store->pack_len)
+            continue;
+
+        if (!backup_insert(store, entry)) {
+            backup_close(store);
+            return (backup_store_t *)0x0;
+        }
+    }
+
+    /* The index may have been cut mid-entry, start appending on a boundary.  */
+    fseek(store->index, 0, SEEK_END);
+
+    long index_len = ftell(store->index);
+
+    if (index_len % sizeof(backup_entry_t) != 0 && ftruncate(fileno(store->index), index_len - index_len % sizeof(backup_entry_t)) != 0) {
+        LOGF_ERR("Failed to repair backup index.\n");
+        backup_close(store);
+        return (backup_store_t *)0x0;
+    }
+
+    return store;
+}
+
+static int backup_bound_cmp(const void *p0, const void *p1) {
+    unsigned long b0 = *(const unsigned long *)p0;
+    unsigned long b1 = *(const unsigned long *)p1;
+
+    return b0 < b1 ? -1 : b0 > b1;
+}
+
+/*
+ *    Splits a world file into chunks: the info header, the world header,
+ *    every compressed tile column, and every remaining section.
+ *
+ *    @param filestream_t  *stream    The world file.
+ *    @param unsigned long *count     The number of chunk boundaries.
+ *
+ *    @return unsigned long *    The sorted chunk boundaries, from 0 to the file length.
+ */
+static unsigned long *backup_chunk_bounds(filestream_t *stream, unsigned long *count) {
+    wld_t          wld    = {0};
+    unsigned long *bounds = (unsigned long *)0x0;
+
+    wld.file = stream;
+
+    if (wld_decude_parsing_type(&wld) != 0 && tile_scan_columns(&wld) != (unsigned long *)0x0)
+        bounds = (unsigned long *)malloc(sizeof(unsigned long) * (wld.info.numsections + wld.header.width + 3));
+    else
+        LOGF_ERR("Failed to parse world.\n");
+
+    if (bounds != (unsigned long *)0x0) {
+        unsigned long n = 0;
+        bounds[n++]     = 0;
+        bounds[n++]     = stream->len;
+
+        int i;
+        for (i = 0; i < wld.info.numsections; ++i)
+            bounds[n++] = wld.info.sections[i];
+
+        for (i = 1; i <= wld.header.width; ++i)
+            bounds[n++] = wld.column_offsets[i];
+
+        qsort(bounds, n, sizeof(unsigned long), backup_bound_cmp);
+
+        /* Drop duplicates, and anything a broken header points past the end.  */
+        unsigned long j = 1;
+        unsigned long k;
+        for (k = 1; k < n && bounds[k] <= stream->len; ++k) {
+            if (bounds[k] != bounds[j - 1])
+                bounds[j++] = bounds[k];
+        }
+
+        *count = j;
+    }
+
+    free(wld.column_offsets);
+    wld_header_free(wld.header);
+    wld_info_header_free(wld.info);
+
+    return bounds;
+}
+
+/*
+ *    Stores the chunks of a world file and writes them to a manifest.
+ *    New chunks are synced to the pack before the index records pointing
+ *    at them are appended.
+ *
+ *    @param backup_store_t *store     The store to snapshot into.
+ *    @param filestream_t   *stream    The world file.
+ *    @param unsigned long  *bounds    The chunk boundaries.
+ *    @param unsigned long   count     The number of chunk boundaries.
+ *    @param FILE           *fp        The manifest file.
+ *    @param backup_stats_t *stats     Filled with what was stored.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int backup_store_chunks(backup_store_t *store, filestream_t *stream, unsigned long *bounds, unsigned long count, FILE *fp, backup_stats_t *stats) {
+    int           ver    = BACKUP_MANIFEST_VERSION;
+    unsigned long len    = stream->len;
+    unsigned long chunks = count - 1;
+
+    fwrite("wldsnap", 1, 7, fp);
+    fwrite(&ver, sizeof(ver), 1, fp);
+    fwrite(&len, sizeof(len), 1, fp);
+    fwrite(&chunks, sizeof(chunks), 1, fp);
+
+    /* Index records are held back until the pack they point into is on disk.  */
+    backup_entry_t *fresh = (backup_entry_t *)malloc(sizeof(backup_entry_t) * (chunks > 0 ? chunks : 1));
+    unsigned long   added = 0;
+
+    if (fresh == (backup_entry_t *)0x0) {
+        LOGF_ERR("Failed to allocate memory for index records.\n");
+        return 0;
+    }
+
+    unsigned long i;
+    for (i = 0; i < chunks; ++i) {
+        unsigned char *chunk = stream->buf + bounds[i];
+        backup_entry_t entry = {0};
+
+        entry.len  = bounds[i + 1] - bounds[i];
+        entry.hash = hash_fnv1a(chunk, entry.len);
+
+        ++stats->chunks;
+        stats->bytes += entry.len;
+
+        backup_entry_t *found = backup_find(store, entry.hash, entry.len, chunk);
+
+        if (found->len != 0) {
+            entry.offset = found->offset;
+        } else {
+            entry.offset = store->pack_len;
+
+            if (fwrite(chunk, 1, entry.len, store->pack) != entry.len) {
+                LOGF_ERR("Failed to write to backup pack.\n");
+                free(fresh);
+                return 0;
+            }
+
+            store->pack_len += entry.len;
+
+            if (!backup_insert(store, entry)) {
+                LOGF_ERR("Failed to insert into backup index.\n");
+                free(fresh);
+                return 0;
+            }
+
+            fresh[added++] = entry;
+
+            ++stats->new_chunks;
+            stats->new_bytes += entry.len;
+        }
+
+        fwrite(&entry.hash, sizeof(entry.hash), 1, fp);
+        fwrite(&entry.len, sizeof(entry.len), 1, fp);
+        fwrite(&entry.offset, sizeof(entry.offset), 1, fp);
+    }
+
+    if (added > 0 && (fflush(store->pack) != 0 || fsync(fileno(store->pack)) != 0)) {
+        LOGF_ERR("Failed to write to backup pack.\n");
+        free(fresh);
+        return 0;
+    }
+
+    if (fwrite(fresh, sizeof(backup_entry_t), added, store->index) != added) {
+        LOGF_ERR("Failed to write to backup index.\n");
+        free(fresh);
+        return 0;
+    }
+
+    free(fresh);
+
+    return fflush(store->index) == 0 && ferror(fp) == 0;
+}
+
+/*
+ *    Snapshots a world file into a store. Only chunks the store has not
+ *    seen before are written to the pack.
+ *
+ *    @param backup_store_t *store       The store to snapshot into.
+ *    @param const char     *path        The world file to snapshot.
+ *    @param const char     *manifest    The manifest file to write.
+ *    @param backup_stats_t *stats       Filled with what was stored, may be NULL.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int backup_snapshot(backup_store_t *store, const char *path, const char *manifest, backup_stats_t *stats) {
+    if (store == (backup_store_t *)0x0) {
+        LOGF_ERR("Store is NULL.\n");
+        return 0;
+    }
+
+    filestream_t *stream = filestream_open(path);
+
+    if (stream == (filestream_t *)0x0) {
+        VLOGF_ERR("Failed to open %s.\n", path);
+        return 0;
+    }
+
+    unsigned long  count  = 0;
+    unsigned long *bounds = backup_chunk_bounds(stream, &count);
+
+    if (bounds == (unsigned long *)0x0) {
+        filestream_free(stream);
+        return 0;
+    }
+
+    FILE *fp = fopen(manifest, "wb");
+
+    if (fp == (FILE *)0x0) {
+        VLOGF_ERR("Failed to open %s.\n", manifest);
+        free(bounds);
+        filestream_free(stream);
+        return 0;
+    }
+
+    backup_stats_t local = {0};
+    unsigned int   ret   = backup_store_chunks(store, stream, bounds, count, fp, &local);
+
+    if (fclose(fp) != 0)
+        ret = 0;
+
+    if (stats != (backup_stats_t *)0x0)
+        *stats = local;
+
+    free(bounds);
+    filestream_free(stream);
+
+    return ret;
+}
+
+/*
+ *    Copies the chunks listed in a manifest from the pack to a file.
+ *
+ *    @param backup_store_t *store     The store the snapshot is in.
+ *    @param unsigned char  *buf       The manifest.
+ *    @param unsigned long   pos       The position of the first chunk in the manifest.
+ *    @param unsigned long   chunks    The number of chunks.
+ *    @param int             ver       The version of the manifest; version 1 has no chunk offsets.
+ *    @param unsigned long   len       The length of the world file.
+ *    @param FILE           *fp        The world file to write.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int backup_copy_chunks(backup_store_t *store, unsigned char *buf, unsigned long pos, unsigned long chunks, int ver, unsigned long len, FILE *fp) {
+    unsigned char *chunk   = (unsigned char *)0x0;
+    unsigned long  cap     = 0;
+    unsigned long  written = 0;
+
+    unsigned long i;
+    for (i = 0; i < chunks; ++i) {
+        backup_entry_t     entry = {0};
+        unsigned long long hash;
+        unsigned long      clen;
+
+        PARSE(buf, pos, unsigned long long, hash);
+        PARSE(buf, pos, unsigned long, clen);
+
+        if (ver > 1) {
+            PARSE(buf, pos, unsigned long, entry.offset);
+            entry.len = entry.offset + clen <= store->pack_len ? clen : 0;
+        } else {
+            entry = *backup_find(store, hash, clen, (const unsigned char *)0x0);
+        }
+
+        if (entry.len == 0 || written + clen > len) {
+            VLOGF_ERR("Chunk %lu is missing from the store.\n", i);
+            free(chunk);
+            return 0;
+        }
+
+        if (clen > cap) {
+            free(chunk);
+            cap   = clen;
+            chunk = (unsigned char *)malloc(cap);
+
+            if (chunk == (unsigned char *)0x0) {
+                LOGF_ERR("Failed to allocate memory for chunk.\n");
+                return 0;
+            }
+        }
+
+        fseek(store->pack, entry.offset, SEEK_SET);
+
+        if (fread(chunk, 1, clen, store->pack) != clen || hash_fnv1a(chunk, clen) != hash) {
+            VLOGF_ERR("Chunk %lu is corrupt in the store.\n", i);
+            free(chunk);
+            return 0;
+        }
+
+        fwrite(chunk, 1, clen, fp);
+        written += clen;
+    }
+
+    free(chunk);
+
+    return written == len && ferror(fp) == 0;
+}
+
+/*
+ *    Rebuilds a world file from a snapshot manifest, byte for byte. The
+ *    file is rebuilt in a temp file and committed like a save, so a failed
+ *    restore leaves the old file as it was.
+ *
+ *    @param backup_store_t *store       The store the snapshot is in.
+ *    @param const char     *manifest    The manifest of the snapshot.
+ *    @param const char     *path        The world file to write.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int backup_restore(backup_store_t *store, const char *manifest, const char *path) {
+    if (store == (backup_store_t *)0x0) {
+        LOGF_ERR("Store is NULL.\n");
+        return 0;
+    }
+
+    filestream_t *stream = filestream_open(manifest);
+
+    if (stream == (filestream_t *)0x0) {
+        VLOGF_ERR("Failed to open %s.\n", manifest);
+        return 0;
+    }
+
+    unsigned char *buf    = stream->buf;
+    unsigned long  pos    = 7;
+    int            ver    = 0;
+    unsigned long  len    = 0;
+    unsigned long  chunks = 0;
+
+    if (stream->len < 7 + sizeof(int) + sizeof(unsigned long) * 2 || memcmp(buf, "wldsnap", 7) != 0) {
+        VLOGF_ERR("%s is not a snapshot manifest.\n", manifest);
+        filestream_free(stream);
+        return 0;
+    }
+
+    PARSE(buf, pos, int, ver);
+    PARSE(buf, pos, unsigned long, len);
+    PARSE(buf, pos, unsigned long, chunks);
+
+    unsigned long entry_len = sizeof(unsigned long long) + sizeof(unsigned long) * (ver > 1 ? 2 : 1);
+
+    if (ver < 1 || ver > BACKUP_MANIFEST_VERSION || chunks > (stream->len - pos) / entry_len) {
+        VLOGF_ERR("%s is not a supported snapshot manifest.\n", manifest);
+        filestream_free(stream);
+        return 0;
+    }
+
+    /* The world is rebuilt in a temp file, so a failed restore leaves it be.  */
+    int   fd;
+    char *tmp = wld_save_begin(path, &fd);
+
+    if (tmp == (char *)0x0) {
+        filestream_free(stream);
+        return 0;
+    }
+
+    /* The stream gets its own descriptor, since wld_save_finish closes fd.  */
+    FILE *fp = fdopen(dup(fd), "wb");
+
+    if (fp == (FILE *)0x0) {
+        VLOGF_ERR("Failed to open %s.\n", tmp);
+        filestream_free(stream);
+        return wld_save_finish((wld_encoded_t *)0x0, fd, tmp, path, 0);
+    }
+
+    unsigned int ret = backup_copy_chunks(store, buf, pos, chunks, ver, len, fp);
+
+    if (fclose(fp) != 0)
+        ret = 0;
+
+    /* The world has to be on disk before the rename can point at it.  */
+    ret = ret && fsync(fd) == 0;
+
+    filestream_free(stream);
+
+    return wld_save_finish((wld_encoded_t *)0x0, fd, tmp, path, ret);
+}
+
+/*
+ *    Closes a backup store.
+ *
+ *    @param backup_store_t *store    The store to close.
+ */
+void backup_close(backup_store_t *store) {
+    if (store == (backup_store_t *)0x0) {
+        LOGF_WARN("Store is NULL.\n");
+        return;
+    }
+
+    if (store->pack != (FILE *)0x0)
+        fclose(store->pack);
+
+    if (store->index != (FILE *)0x0)
+        fclose(store->index);
+
+    free(store->entries);
+    free(store);
+}
@@ -0,0 +1,80 @@
+/*
+ *    backup.h    --    Header file for the world backup store
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Declares the content-addressed backup store. A world file is split
+ *    into its sections and its compressed tile columns, each chunk is
+ *    stored once in a pack file, and a snapshot is just the list of the
+ *    hashes that make up the file.
+ */
+#ifndef WLD_BACKUP_H
+#define WLD_BACKUP_H
+
+#include <stdio.h>
+
+typedef struct {
+    unsigned long long hash;
+    unsigned long      len;
+    unsigned long      offset;
+} backup_entry_t;
+
+typedef struct {
+    FILE           *pack;
+    FILE           *index;
+    unsigned long   pack_len;
+    unsigned long   count;
+    unsigned long   cap;
+    backup_entry_t *entries;
+} backup_store_t;
+
+typedef struct {
+    unsigned long chunks;
+    unsigned long new_chunks;
+    unsigned long bytes;
+    unsigned long new_bytes;
+} backup_stats_t;
+
+/*
+ *    Opens a backup store, creating it if it does not exist.
+ *
+ *    @param const char *dir    The directory holding the pack and index files.
+ *
+ *    @return backup_store_t *    The store, NULL on failure.
+ */
+backup_store_t *backup_open(const char *dir);
+
+/*
+ *    Snapshots a world file into a store. Only chunks the store has not
+ *    seen before are written to the pack.
+ *
+ *    @param backup_store_t *store       The store to snapshot into.
+ *    @param const char     *path        The world file to snapshot.
+ *    @param const char     *manifest    The manifest file to write.
+ *    @param backup_stats_t *stats       Filled with what was stored, may be NULL.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int backup_snapshot(backup_store_t *store, const char *path, const char *manifest, backup_stats_t *stats);
+
+/*
+ *    Rebuilds a world file from a snapshot manifest, byte for byte. The
+ *    file is rebuilt in a temp file and committed like a save, so a failed
+ *    restore leaves the old file as it was.
+ *
+ *    @param backup_store_t *store       The store the snapshot is in.
+ *    @param const char     *manifest    The manifest of the snapshot.
+ *    @param const char     *path        The world file to write.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int backup_restore(backup_store_t *store, const char *manifest, const char *path);
+
+/*
+ *    Closes a backup store.
+ *
+ *    @param backup_store_t *store    The store to close.
+ */
+void backup_close(backup_store_t *store);
+
+#endif /* WLD_BACKUP_H  */
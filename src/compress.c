@@ -0,0 +1,574 @@
+/*
+ *    compress.c    --    Source file for compressed world files
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Defines the functions used to read compressed world files. gzip
+ *    files may hold several members one after another, which are read as
+ *    one. A zstd file holds one or more frames, and when every frame
+ *    records its decompressed size, where each one lands is known up
+ *    front and the frames are decompressed on the thread pool.
+ */
+#include "compress.h"
+
+#include "log.h"
+#include "threadpool.h"
+
+#include <malloc.h>
+#include <string.h>
+
+#ifdef WLD_HAVE_ZLIB
+#include <zlib.h>
+#endif /* WLD_HAVE_ZLIB  */
+
+#ifdef WLD_HAVE_ZSTD
+#include <zstd.h>
+#endif /* WLD_HAVE_ZSTD  */
+
+/*
+ *    Finds out how a buffer is compressed from its magic number.
+ *
+ *    @param const unsigned char *buf    The start of the buffer.
+ *    @param unsigned long        len    The length of the buffer.
+ *
+ *    @return unsigned int    COMPRESS_NONE, COMPRESS_GZIP or COMPRESS_ZSTD.
+ */
+unsigned int compress_detect(const unsigned char *buf, unsigned long len) {
+    if (len >= 2 && buf[0] == 0x1F && buf[1] == 0x8B)
+        return COMPRESS_GZIP;
+
+    if (len >= 4 && buf[0] == 0x28 && buf[1] == 0xB5 && buf[2] == 0x2F && buf[3] == 0xFD)
+        return COMPRESS_ZSTD;
+
+    return COMPRESS_NONE;
+}
+
+#ifdef WLD_HAVE_ZLIB
+/*
+ *    Decompresses a whole gzip buffer, growing the output as needed.
+ *
+ *    @param const unsigned char *buf        The compressed buffer.
+ *    @param unsigned long        len        The length of the compressed buffer.
+ *    @param unsigned long       *out_len    The length of the decompressed buffer.
+ *
+ *    @return unsigned char *    The decompressed buffer, NULL on failure.
+ */
+static unsigned char *compress_inflate_gzip(const unsigned char *buf, unsigned long len, unsigned long *out_len) {
+    z_stream strm;
+
+    memset(&strm, 0, sizeof(strm));
+
+    if (inflateInit2(&strm, 15 + 32) != Z_OK) {
+        LOGF_ERR("Failed to start inflating.\n");
+        return (unsigned char *)0x0;
+    }
+
+    /* The last member ends with its size, which is right for one member.  */
+    unsigned long  cap = len >= 4 ? (unsigned long)buf[len - 4] | buf[len - 3] << 8 | buf[len - 2] << 16 | (unsigned long)buf[len - 1] << 24 : 0;
+    unsigned long  pos = 0;
+    unsigned char *out;
+    int            ret = Z_OK;
+
+    if (cap < len)
+        cap = len * 4;
+
+    out = (unsigned char *)malloc(cap);
+
+    strm.next_in  = (unsigned char *)buf;
+    strm.avail_in = len;
+
+    while (out != (unsigned char *)0x0) {
+        if (pos == cap) {
+            unsigned char *grown = (unsigned char *)realloc(out, cap * 2);
+
+            if (grown == (unsigned char *)0x0) {
+                free(out);
+                out = (unsigned char *)0x0;
+                break;
+            }
+
+            out  = grown;
+            cap *= 2;
+        }
+
+        unsigned long room = cap - pos > 0x40000000 ? 0x40000000 : cap - pos;
+
+        strm.next_out  = out + pos;
+        strm.avail_out = room;
+
+        ret  = inflate(&strm, Z_NO_FLUSH);
+        pos += room - strm.avail_out;
+
+        if (ret == Z_STREAM_END) {
+            if (strm.avail_in == 0)
+                break;
+
+            inflateReset(&strm);
+        } else if (ret != Z_OK && !(ret == Z_BUF_ERROR && strm.avail_out == 0)) {
+            VLOGF_ERR("Failed to inflate: %s.\n", strm.msg != (char *)0x0 ? strm.msg : "truncated");
+            free(out);
+            out = (unsigned char *)0x0;
+        }
+    }
+
+    inflateEnd(&strm);
+
+    if (out == (unsigned char *)0x0) {
+        LOGF_ERR("Failed to decompress gzip buffer.\n");
+        return (unsigned char *)0x0;
+    }
+
+    *out_len = pos;
+
+    return out;
+}
+#endif /* WLD_HAVE_ZLIB  */
+
+#ifdef WLD_HAVE_ZSTD
+typedef struct {
+    const unsigned char *src;
+    unsigned char       *dst;
+    unsigned long       *src_offs;
+    unsigned long       *dst_offs;
+    ZSTD_DCtx           *dctxs[THREADPOOL_MAX_THREADS];
+    unsigned int         failed;
+} compress_frames_t;
+
+/*
+ *    Decompresses a range of zstd frames on the thread pool.
+ *
+ *    @param unsigned long  begin     The first frame.
+ *    @param unsigned long  end       The end frame, exclusive.
+ *    @param unsigned int   worker    The worker running the frames.
+ *    @param void          *ctx       The frames.
+ */
+static void compress_frames_fn(unsigned long begin, unsigned long end, unsigned int worker, void *ctx) {
+    compress_frames_t *job = (compress_frames_t *)ctx;
+
+    if (job->dctxs[worker] == (ZSTD_DCtx *)0x0)
+        job->dctxs[worker] = ZSTD_createDCtx();
+
+    if (job->dctxs[worker] == (ZSTD_DCtx *)0x0) {
+        __atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    unsigned long i;
+    for (i = begin; i < end; ++i) {
+        unsigned long dst_len = job->dst_offs[i + 1] - job->dst_offs[i];
+        size_t        ret     = ZSTD_decompressDCtx(job->dctxs[worker], job->dst + job->dst_offs[i], dst_len,
+                                                    job->src + job->src_offs[i], job->src_offs[i + 1] - job->src_offs[i]);
+
+        if (ZSTD_isError(ret) || ret != dst_len)
+            __atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/*
+ *    Decompresses a zstd buffer as a stream, for frames that do not record
+ *    their size.
+ *
+ *    @param const unsigned char *buf        The compressed buffer.
+ *    @param unsigned long        len        The length of the compressed buffer.
+ *    @param unsigned long       *out_len    The length of the decompressed buffer.
+ *
+ *    @return unsigned char *    The decompressed buffer, NULL on failure.
+ */
+static unsigned char *compress_inflate_zstd_stream(const unsigned char *buf, unsigned long len, unsigned long *out_len) {
+    ZSTD_DStream  *dstream = ZSTD_createDStream();
+    unsigned long  cap     = len * 4;
+    unsigned char *out     = (unsigned char *)malloc(cap);
+
+    if (dstream == (ZSTD_DStream *)0x0 || out == (unsigned char *)0x0) {
+        LOGF_ERR("Failed to allocate memory for zstd stream.\n");
+        ZSTD_freeDStream(dstream);
+        free(out);
+        return (unsigned char *)0x0;
+    }
+
+    ZSTD_initDStream(dstream);
+
+    ZSTD_inBuffer  in   = {buf, len, 0};
+    ZSTD_outBuffer dst  = {out, cap, 0};
+    size_t         left = 1;
+
+    /* Output held back by a full buffer comes out after the input runs out.  */
+    while (in.pos < in.size || dst.pos == dst.size) {
+        if (dst.pos == dst.size) {
+            unsigned char *grown = (unsigned char *)realloc(out, cap * 2);
+
+            if (grown == (unsigned char *)0x0) {
+                free(out);
+                out = (unsigned char *)0x0;
+                break;
+            }
+
+            out      = grown;
+            cap     *= 2;
+            dst.dst  = out;
+            dst.size = cap;
+        }
+
+        left = ZSTD_decompressStream(dstream, &dst, &in);
+
+        if (ZSTD_isError(left)) {
+            VLOGF_ERR("Failed to decompress zstd buffer: %s.\n", ZSTD_getErrorName(left));
+            free(out);
+            out = (unsigned char *)0x0;
+            break;
+        }
+    }
+
+    /* Anything but 0 means the last frame was cut short.  */
+    if (out != (unsigned char *)0x0 && left != 0) {
+        LOGF_ERR("Zstd buffer ends in the middle of a frame.\n");
+        free(out);
+        out = (unsigned char *)0x0;
+    }
+
+    ZSTD_freeDStream(dstream);
+
+    if (out != (unsigned char *)0x0)
+        *out_len = dst.pos;
+
+    return out;
+}
+
+/*
+ *    Decompresses a whole zstd buffer, in parallel if every frame records
+ *    its size.
+ *
+ *    @param const unsigned char *buf        The compressed buffer.
+ *    @param unsigned long        len        The length of the compressed buffer.
+ *    @param unsigned long       *out_len    The length of the decompressed buffer.
+ *
+ *    @return unsigned char *    The decompressed buffer, NULL on failure.
+ */
+static unsigned char *compress_inflate_zstd(const unsigned char *buf, unsigned long len, unsigned long *out_len) {
+    compress_frames_t job;
+    unsigned long     count = 0;
+    unsigned long     cap   = 16;
+    unsigned long     pos   = 0;
+
+    memset(&job, 0, sizeof(job));
+
+    job.src      = buf;
+    job.src_offs = (unsigned long *)malloc(sizeof(unsigned long) * (cap + 1));
+    job.dst_offs = (unsigned long *)malloc(sizeof(unsigned long) * (cap + 1));
+
+    unsigned int sized = job.src_offs != (unsigned long *)0x0 && job.dst_offs != (unsigned long *)0x0;
+
+    if (sized) {
+        job.src_offs[0] = 0;
+        job.dst_offs[0] = 0;
+    }
+
+    /* Walk the frames to find where each one starts and lands.  */
+    while (sized && pos < len) {
+        size_t             size    = ZSTD_findFrameCompressedSize(buf + pos, len - pos);
+        unsigned long long content = ZSTD_getFrameContentSize(buf + pos, len - pos);
+
+        if (ZSTD_isError(size) || content == ZSTD_CONTENTSIZE_UNKNOWN || content == ZSTD_CONTENTSIZE_ERROR) {
+            sized = 0;
+            break;
+        }
+
+        if (count == cap) {
+            unsigned long *src_offs = (unsigned long *)realloc(job.src_offs, sizeof(unsigned long) * (cap * 2 + 1));
+            unsigned long *dst_offs = (unsigned long *)realloc(job.dst_offs, sizeof(unsigned long) * (cap * 2 + 1));
+
+            if (src_offs != (unsigned long *)0x0)
+                job.src_offs = src_offs;
+            if (dst_offs != (unsigned long *)0x0)
+                job.dst_offs = dst_offs;
+
+            if (src_offs == (unsigned long *)0x0 || dst_offs == (unsigned long *)0x0) {
+                sized = 0;
+                break;
+            }
+
+            cap *= 2;
+        }
+
+        pos += size;
+        ++count;
+
+        job.src_offs[count] = pos;
+        job.dst_offs[count] = job.dst_offs[count - 1] + content;
+    }
+
+    unsigned char *out = (unsigned char *)0x0;
+
+    if (sized) {
+        out = (unsigned char *)malloc(job.dst_offs[count] > 0 ? job.dst_offs[count] : 1);
+        job.dst = out;
+
+        if (out != (unsigned char *)0x0 && (!threadpool_for(0, count, 1, compress_frames_fn, &job, 0) || job.failed)) {
+            LOGF_ERR("Failed to decompress zstd frames.\n");
+            free(out);
+            out = (unsigned char *)0x0;
+        }
+
+        if (out != (unsigned char *)0x0)
+            *out_len = job.dst_offs[count];
+    }
+
+    unsigned int i;
+    for (i = 0; i < THREADPOOL_MAX_THREADS; ++i)
+        ZSTD_freeDCtx(job.dctxs[i]);
+
+    free(job.src_offs);
+    free(job.dst_offs);
+
+    if (!sized)
+        return compress_inflate_zstd_stream(buf, len, out_len);
+
+    return out;
+}
+#endif /* WLD_HAVE_ZSTD  */
+
+/*
+ *    Decompresses a whole buffer. The frames of a zstd buffer that all
+ *    record their size are decompressed in parallel.
+ *
+ *    @param const unsigned char *buf        The compressed buffer.
+ *    @param unsigned long        len        The length of the compressed buffer.
+ *    @param unsigned long       *out_len    The length of the decompressed buffer.
+ *
+ *    @return unsigned char *    The decompressed buffer, NULL on failure.
+ */
+unsigned char *compress_inflate(const unsigned char *buf, unsigned long len, unsigned long *out_len) {
+#if !defined(WLD_HAVE_ZLIB) && !defined(WLD_HAVE_ZSTD)
+    (void)out_len;
+#endif /* !WLD_HAVE_ZLIB && !WLD_HAVE_ZSTD  */
+
+    switch (compress_detect(buf, len)) {
+    case COMPRESS_GZIP:
+#ifdef WLD_HAVE_ZLIB
+        return compress_inflate_gzip(buf, len, out_len);
+#else
+        LOGF_ERR("Built without zlib, cannot read gzip files.\n");
+        return (unsigned char *)0x0;
+#endif /* WLD_HAVE_ZLIB  */
+    case COMPRESS_ZSTD:
+#ifdef WLD_HAVE_ZSTD
+        return compress_inflate_zstd(buf, len, out_len);
+#else
+        LOGF_ERR("Built without libzstd, cannot read zstd files.\n");
+        return (unsigned char *)0x0;
+#endif /* WLD_HAVE_ZSTD  */
+    default:
+        LOGF_ERR("Buffer is not compressed.\n");
+        return (unsigned char *)0x0;
+    }
+}
+
+/*
+ *    Opens a file for reading, compressed or not.
+ *
+ *    @param compress_reader_t *reader    The reader to open.
+ *    @param const char        *path      The file.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int compress_open(compress_reader_t *reader, const char *path) {
+    memset(reader, 0, sizeof(*reader));
+
+    reader->fp = fopen(path, "rb");
+
+    if (reader->fp == (FILE *)0x0) {
+        VLOGF_ERR("Failed to open %s.\n", path);
+        return 0;
+    }
+
+    unsigned char magic[4];
+    unsigned long len = fread(magic, 1, sizeof(magic), reader->fp);
+
+    reader->type = compress_detect(magic, len);
+
+    if (reader->type == COMPRESS_NONE) {
+        fseek(reader->fp, 0, SEEK_SET);
+        return 1;
+    }
+
+    /* The magic number is fed to the decompressor with the rest.  */
+    reader->in = (unsigned char *)malloc(COMPRESS_CHUNK);
+
+    if (reader->in == (unsigned char *)0x0) {
+        LOGF_ERR("Failed to allocate memory for reader.\n");
+        compress_close(reader);
+        return 0;
+    }
+
+    memcpy(reader->in, magic, len);
+    reader->in_len  = len;
+    reader->partial = 1;
+
+    switch (reader->type) {
+#ifdef WLD_HAVE_ZLIB
+    case COMPRESS_GZIP: {
+        z_stream *strm = (z_stream *)calloc(1, sizeof(z_stream));
+
+        if (strm == (z_stream *)0x0 || inflateInit2(strm, 15 + 32) != Z_OK) {
+            free(strm);
+            break;
+        }
+
+        reader->state = strm;
+        return 1;
+    }
+#endif /* WLD_HAVE_ZLIB  */
+#ifdef WLD_HAVE_ZSTD
+    case COMPRESS_ZSTD:
+        reader->state = ZSTD_createDStream();
+
+        if (reader->state == (void *)0x0)
+            break;
+
+        ZSTD_initDStream((ZSTD_DStream *)reader->state);
+        return 1;
+#endif /* WLD_HAVE_ZSTD  */
+    default:
+        break;
+    }
+
+    VLOGF_ERR("Cannot decompress %s, its compression was not built in.\n", path);
+    compress_close(reader);
+
+    return 0;
+}
+
+/*
+ *    Reads decompressed bytes from a reader.
+ *
+ *    @param compress_reader_t *reader    The reader.
+ *    @param void              *buf       The buffer to read into.
+ *    @param unsigned long      len       The most bytes to read.
+ *
+ *    @return unsigned long    The number of bytes read, less than len at the end or on failure.
+ */
+unsigned long compress_read(compress_reader_t *reader, void *buf, unsigned long len) {
+    if (reader->type == COMPRESS_NONE)
+        return fread(buf, 1, len, reader->fp);
+
+    unsigned long done = 0;
+
+    while (done < len && !reader->failed) {
+        unsigned long before = done;
+
+        if (reader->in_pos == reader->in_len) {
+            reader->in_len = fread(reader->in, 1, COMPRESS_CHUNK, reader->fp);
+            reader->in_pos = 0;
+
+            if (reader->in_len == 0 && ferror(reader->fp)) {
+                reader->failed = 1;
+                break;
+            }
+        }
+
+#ifdef WLD_HAVE_ZLIB
+        if (reader->type == COMPRESS_GZIP) {
+            z_stream     *strm      = (z_stream *)reader->state;
+            unsigned long room      = len - done > 0x40000000 ? 0x40000000 : len - done;
+            unsigned long in_before = reader->in_pos;
+
+            strm->next_in   = reader->in + reader->in_pos;
+            strm->avail_in  = reader->in_len - reader->in_pos;
+            strm->next_out  = (unsigned char *)buf + done;
+            strm->avail_out = room;
+
+            int ret = inflate(strm, Z_NO_FLUSH);
+
+            done           += room - strm->avail_out;
+            reader->in_pos  = reader->in_len - strm->avail_in;
+
+            /* Another member may follow.  */
+            if (ret == Z_STREAM_END) {
+                inflateReset(strm);
+                reader->partial = 0;
+            } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                reader->failed = 1;
+            } else if (done != before || reader->in_pos != in_before) {
+                reader->partial = 1;
+            }
+        }
+#endif /* WLD_HAVE_ZLIB  */
+#ifdef WLD_HAVE_ZSTD
+        if (reader->type == COMPRESS_ZSTD) {
+            ZSTD_inBuffer  in  = {reader->in, reader->in_len, reader->in_pos};
+            ZSTD_outBuffer out = {buf, len, done};
+            size_t         ret = ZSTD_decompressStream((ZSTD_DStream *)reader->state, &out, &in);
+
+            /* 0 once a frame is decoded and flushed, the size of the next read otherwise.  */
+            if (ZSTD_isError(ret))
+                reader->failed = 1;
+            else if (out.pos != done || in.pos != reader->in_pos)
+                reader->partial = ret != 0;
+
+            done           = out.pos;
+            reader->in_pos = in.pos;
+        }
+#endif /* WLD_HAVE_ZSTD  */
+
+        /* At the end of the file, run until nothing held back is left.  */
+        if (reader->in_len == 0 && done == before) {
+            reader->failed = reader->partial;
+            break;
+        }
+    }
+
+    if (reader->failed)
+        LOGF_ERR("Failed to decompress file.\n");
+
+    return done;
+}
+
+/*
+ *    Skips decompressed bytes of a reader.
+ *
+ *    @param compress_reader_t *reader    The reader.
+ *    @param unsigned long      len       The number of bytes to skip.
+ *
+ *    @return unsigned int    1 on success, 0 if the file ends first.
+ */
+unsigned int compress_skip(compress_reader_t *reader, unsigned long len) {
+    if (reader->type == COMPRESS_NONE)
+        return fseek(reader->fp, len, SEEK_CUR) == 0;
+
+    unsigned char scratch[0x1000];
+
+    while (len > 0) {
+        unsigned long want = len < sizeof(scratch) ? len : sizeof(scratch);
+
+        if (compress_read(reader, scratch, want) != want)
+            return 0;
+
+        len -= want;
+    }
+
+    return 1;
+}
+
+/*
+ *    Closes a reader.
+ *
+ *    @param compress_reader_t *reader    The reader.
+ */
+void compress_close(compress_reader_t *reader) {
+#ifdef WLD_HAVE_ZLIB
+    if (reader->type == COMPRESS_GZIP && reader->state != (void *)0x0) {
+        inflateEnd((z_stream *)reader->state);
+        free(reader->state);
+    }
+#endif /* WLD_HAVE_ZLIB  */
+#ifdef WLD_HAVE_ZSTD
+    if (reader->type == COMPRESS_ZSTD)
+        ZSTD_freeDStream((ZSTD_DStream *)reader->state);
+#endif /* WLD_HAVE_ZSTD  */
+
+    if (reader->fp != (FILE *)0x0)
+        fclose(reader->fp);
+
+    free(reader->in);
+    memset(reader, 0, sizeof(*reader));
+}
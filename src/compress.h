@@ -0,0 +1,102 @@
+/*
+ *    compress.h    --    Header file for compressed world files
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Declares the functions used to read world files compressed with
+ *    gzip or zstd, either whole into memory or a window at a time, so
+ *    backups can be opened without unpacking them to disk first. gzip
+ *    needs zlib and zstd needs libzstd, which are built in by defining
+ *    WLD_HAVE_ZLIB and WLD_HAVE_ZSTD.
+ */
+#ifndef WLD_COMPRESS_H
+#define WLD_COMPRESS_H
+
+#include <stdio.h>
+
+#define COMPRESS_NONE 0
+#define COMPRESS_GZIP 1
+#define COMPRESS_ZSTD 2
+
+/*
+ *    The size of the compressed reads a reader makes.
+ */
+#define COMPRESS_CHUNK 0x10000
+
+/*
+ *    A file being read and decompressed as it goes. Plain files are read
+ *    straight through. Partial is set while a gzip member or zstd frame
+ *    has been started but not finished, so a file that ends there fails.
+ */
+typedef struct {
+    FILE          *fp;
+    unsigned int   type;
+    void          *state;
+    unsigned char *in;
+    unsigned long  in_len;
+    unsigned long  in_pos;
+    unsigned int   partial;
+    unsigned int   failed;
+} compress_reader_t;
+
+/*
+ *    Finds out how a buffer is compressed from its magic number.
+ *
+ *    @param const unsigned char *buf    The start of the buffer.
+ *    @param unsigned long        len    The length of the buffer.
+ *
+ *    @return unsigned int    COMPRESS_NONE, COMPRESS_GZIP or COMPRESS_ZSTD.
+ */
+unsigned int compress_detect(const unsigned char *buf, unsigned long len);
+
+/*
+ *    Decompresses a whole buffer. The frames of a zstd buffer that all
+ *    record their size are decompressed in parallel.
+ *
+ *    @param const unsigned char *buf        The compressed buffer.
+ *    @param unsigned long        len        The length of the compressed buffer.
+ *    @param unsigned long       *out_len    The length of the decompressed buffer.
+ *
+ *    @return unsigned char *    The decompressed buffer, NULL on failure.
+ */
+unsigned char *compress_inflate(const unsigned char *buf, unsigned long len, unsigned long *out_len);
+
+/*
+ *    Opens a file for reading, compressed or not.
+ *
+ *    @param compress_reader_t *reader    The reader to open.
+ *    @param const char        *path      The file.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int compress_open(compress_reader_t *reader, const char *path);
+
+/*
+ *    Reads decompressed bytes from a reader.
+ *
+ *    @param compress_reader_t *reader    The reader.
+ *    @param void              *buf       The buffer to read into.
+ *    @param unsigned long      len       The most bytes to read.
+ *
+ *    @return unsigned long    The number of bytes read, less than len at the end or on failure.
+ */
+unsigned long compress_read(compress_reader_t *reader, void *buf, unsigned long len);
+
+/*
+ *    Skips decompressed bytes of a reader.
+ *
+ *    @param compress_reader_t *reader    The reader.
+ *    @param unsigned long      len       The number of bytes to skip.
+ *
+ *    @return unsigned int    1 on success, 0 if the file ends first.
+ */
+unsigned int compress_skip(compress_reader_t *reader, unsigned long len);
+
+/*
+ *    Closes a reader.
+ *
+ *    @param compress_reader_t *reader    The reader.
+ */
+void compress_close(compress_reader_t *reader);
+
+#endif /* WLD_COMPRESS_H  */
@@ -6,6 +6,7 @@
  *
  *    An example of using the wldlib library.
  */
+#include "tilepalette.h"
 #include "wldlib.h"
 
 #include <stdio.h>
@@ -30,7 +31,9 @@ int main(void) {
     for (x = 0; x < wld->header.width; ++x) {
         for (y = 0; y < wld->header.height; ++y) { 
             /*if (fabs(200*tan(pow(x-2100,2)/200000.)+600 - y) < 100) {
-                wld->tiles[x][y].tile = 327;
+                tile_t tile = tile_get(wld, x, y);
+                tile.tile   = 327;
+                tile_set(wld, x, y, tile);
             }*/
         }
     }
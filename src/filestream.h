@@ -13,6 +13,6 @@
 
 typedef struct {
     unsigned char *buf;
-    unsigned int   len;
-    unsigned int   pos;
+    unsigned long  len;
+    unsigned long  pos;
 } filestream_t;
\ No newline at end of file
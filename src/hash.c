@@ -0,0 +1,246 @@
+/*
+ *    hash.c    --    Source file for hashing functions
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Defines the functions used to hash raw world data, such as
+ *    compressed tile columns and section buffers.
+ *
+ *    CRC32 runs on slice-by-8 tables, eight bytes per step. On CPUs with
+ *    carry-less multiplication, runs of 64 bytes or more are folded 512
+ *    bits at a time instead, and the tables only finish the tail.
+ */
+#include "hash.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HASH_CRC32_CLMUL
+#endif /* __x86_64__ || __i386__  */
+
+#define HASH_CRC32_POLY 0xEDB88320
+
+static unsigned int   _crc32_table[8][256];
+static pthread_once_t _crc32_once = PTHREAD_ONCE_INIT;
+
+/*
+ *    Hashes a buffer with 64 bit FNV-1a.
+ *
+ *    @param const void    *buf    The buffer to hash.
+ *    @param unsigned long  len    The length of the buffer.
+ *
+ *    @return unsigned long long    The hash of the buffer.
+ */
+unsigned long long hash_fnv1a(const void *buf, unsigned long len) {
+    return hash_fnv1a_update(HASH_FNV_OFFSET, buf, len);
+}
+
+/*
+ *    Continues a 64 bit FNV-1a hash with another buffer.
+ *
+ *    @param unsigned long long  hash    The hash so far.
+ *    @param const void         *buf     The buffer to hash.
+ *    @param unsigned long       len     The length of the buffer.
+ *
+ *    @return unsigned long long    The updated hash.
+ */
+unsigned long long hash_fnv1a_update(unsigned long long hash, const void *buf, unsigned long len) {
+    const unsigned char *p = (const unsigned char *)buf;
+
+    unsigned long i;
+    for (i = 0; i < len; ++i) {
+        hash ^= p[i];
+        hash *= HASH_FNV_PRIME;
+    }
+
+    return hash;
+}
+
+/*
+ *    Fills the slice-by-8 tables. Table 0 is the usual byte table, and
+ *    table k advances a byte through k more zero bytes.
+ */
+static void hash_crc32_init(void) {
+    unsigned int i;
+    for (i = 0; i < 256; ++i) {
+        unsigned int crc = i;
+
+        int j;
+        for (j = 0; j < 8; ++j)
+            crc = (crc & 1) ? (crc >> 1) ^ HASH_CRC32_POLY : crc >> 1;
+
+        _crc32_table[0][i] = crc;
+    }
+
+    for (i = 0; i < 256; ++i) {
+        int k;
+        for (k = 1; k < 8; ++k)
+            _crc32_table[k][i] = (_crc32_table[k - 1][i] >> 8) ^ _crc32_table[0][_crc32_table[k - 1][i] & 0xFF];
+    }
+}
+
+/*
+ *    Runs the CRC32 register over a buffer with the slice-by-8 tables.
+ *
+ *    @param unsigned int          crc    The register, not inverted.
+ *    @param const unsigned char  *p      The buffer.
+ *    @param unsigned long         len    The length of the buffer.
+ *
+ *    @return unsigned int    The register.
+ */
+static unsigned int hash_crc32_tables(unsigned int crc, const unsigned char *p, unsigned long len) {
+    while (len >= 8) {
+        unsigned int one;
+        unsigned int two;
+
+        memcpy(&one, p, sizeof(one));
+        memcpy(&two, p + 4, sizeof(two));
+
+        one ^= crc;
+        crc  = _crc32_table[7][one & 0xFF] ^ _crc32_table[6][(one >> 8) & 0xFF] ^
+               _crc32_table[5][(one >> 16) & 0xFF] ^ _crc32_table[4][one >> 24] ^
+               _crc32_table[3][two & 0xFF] ^ _crc32_table[2][(two >> 8) & 0xFF] ^
+               _crc32_table[1][(two >> 16) & 0xFF] ^ _crc32_table[0][two >> 24];
+
+        p   += 8;
+        len -= 8;
+    }
+
+    while (len-- > 0)
+        crc = (crc >> 8) ^ _crc32_table[0][(crc ^ *p++) & 0xFF];
+
+    return crc;
+}
+
+#ifdef HASH_CRC32_CLMUL
+/*
+ *    Runs the CRC32 register over a buffer by folding it with carry-less
+ *    multiplication, four 128 bit lanes at a time, then reducing to 32
+ *    bits. The constants are powers of x modulo the polynomial, bit
+ *    reflected, as in Intel's "Fast CRC Computation for Generic
+ *    Polynomials Using PCLMULQDQ".
+ *
+ *    @param unsigned int          crc    The register, not inverted.
+ *    @param const unsigned char  *p      The buffer.
+ *    @param unsigned long         len    The length, at least 64 and a multiple of 16.
+ *
+ *    @return unsigned int    The register.
+ */
+__attribute__((target("pclmul,sse4.1")))
+static unsigned int hash_crc32_clmul(unsigned int crc, const unsigned char *p, unsigned long len) {
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+    const __m128i k5k0 = _mm_set_epi64x(0x0000000000, 0x0163cd6124);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+    const __m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+
+    __m128i x1 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)p), _mm_cvtsi32_si128(crc));
+    __m128i x2 = _mm_loadu_si128((const __m128i *)(p + 16));
+    __m128i x3 = _mm_loadu_si128((const __m128i *)(p + 32));
+    __m128i x4 = _mm_loadu_si128((const __m128i *)(p + 48));
+    __m128i x5;
+
+    p   += 64;
+    len -= 64;
+
+    while (len >= 64) {
+        x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k1k2, 0x00), _mm_clmulepi64_si128(x1, k1k2, 0x11)), _mm_loadu_si128((const __m128i *)p));
+        x2 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x2, k1k2, 0x00), _mm_clmulepi64_si128(x2, k1k2, 0x11)), _mm_loadu_si128((const __m128i *)(p + 16)));
+        x3 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x3, k1k2, 0x00), _mm_clmulepi64_si128(x3, k1k2, 0x11)), _mm_loadu_si128((const __m128i *)(p + 32)));
+        x4 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x4, k1k2, 0x00), _mm_clmulepi64_si128(x4, k1k2, 0x11)), _mm_loadu_si128((const __m128i *)(p + 48)));
+
+        p   += 64;
+        len -= 64;
+    }
+
+    /* Four lanes into one.  */
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x00), _mm_clmulepi64_si128(x1, k3k4, 0x11)), x2);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x00), _mm_clmulepi64_si128(x1, k3k4, 0x11)), x3);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x00), _mm_clmulepi64_si128(x1, k3k4, 0x11)), x4);
+
+    while (len >= 16) {
+        x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x00), _mm_clmulepi64_si128(x1, k3k4, 0x11)), _mm_loadu_si128((const __m128i *)p));
+
+        p   += 16;
+        len -= 16;
+    }
+
+    /* 128 bits to 64.  */
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x5);
+    x5 = _mm_srli_si128(x1, 4);
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, mask), k5k0, 0x00), x5);
+
+    /* Barrett reduction to 32 bits.  */
+    x5 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), poly, 0x10);
+    x5 = _mm_clmulepi64_si128(_mm_and_si128(x5, mask), poly, 0x00);
+    x1 = _mm_xor_si128(x1, x5);
+
+    return _mm_extract_epi32(x1, 1);
+}
+#endif /* HASH_CRC32_CLMUL  */
+
+/*
+ *    Returns whether carry-less multiplication can be used, which is
+ *    checked once.
+ *
+ *    @return unsigned int    1 if it is supported, 0 if not.
+ */
+static unsigned int hash_crc32_has_clmul(void) {
+#ifdef HASH_CRC32_CLMUL
+    static int clmul = -1;
+    int        has   = __atomic_load_n(&clmul, __ATOMIC_RELAXED);
+
+    if (has < 0) {
+        has = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+        __atomic_store_n(&clmul, has, __ATOMIC_RELAXED);
+    }
+
+    return has;
+#else
+    return 0;
+#endif /* HASH_CRC32_CLMUL  */
+}
+
+/*
+ *    Computes the CRC32 of a buffer, as zlib and gzip do.
+ *
+ *    @param const void    *buf    The buffer to checksum.
+ *    @param unsigned long  len    The length of the buffer.
+ *
+ *    @return unsigned int    The CRC32 of the buffer.
+ */
+unsigned int hash_crc32(const void *buf, unsigned long len) {
+    return hash_crc32_update(0, buf, len);
+}
+
+/*
+ *    Continues a CRC32 with another buffer. A CRC of 0 starts a new one.
+ *
+ *    @param unsigned int   crc    The CRC so far.
+ *    @param const void    *buf    The buffer to checksum.
+ *    @param unsigned long  len    The length of the buffer.
+ *
+ *    @return unsigned int    The updated CRC32.
+ */
+unsigned int hash_crc32_update(unsigned int crc, const void *buf, unsigned long len) {
+    const unsigned char *p = (const unsigned char *)buf;
+
+    pthread_once(&_crc32_once, hash_crc32_init);
+
+    crc = ~crc;
+
+#ifdef HASH_CRC32_CLMUL
+    if (len >= 64 && hash_crc32_has_clmul()) {
+        unsigned long fold = len & ~15UL;
+
+        crc  = hash_crc32_clmul(crc, p, fold);
+        p   += fold;
+        len -= fold;
+    }
+#endif /* HASH_CRC32_CLMUL  */
+
+    return ~hash_crc32_tables(crc, p, len);
+}
@@ -0,0 +1,57 @@
+/*
+ *    hash.h    --    Header file for hashing functions
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Declares the functions used to hash raw world data, such as
+ *    compressed tile columns and section buffers.
+ */
+#ifndef WLD_HASH_H
+#define WLD_HASH_H
+
+#define HASH_FNV_OFFSET 0xcbf29ce484222325ULL
+#define HASH_FNV_PRIME  0x100000001b3ULL
+
+/*
+ *    Hashes a buffer with 64 bit FNV-1a.
+ *
+ *    @param const void    *buf    The buffer to hash.
+ *    @param unsigned long  len    The length of the buffer.
+ *
+ *    @return unsigned long long    The hash of the buffer.
+ */
+unsigned long long hash_fnv1a(const void *buf, unsigned long len);
+
+/*
+ *    Continues a 64 bit FNV-1a hash with another buffer.
+ *
+ *    @param unsigned long long  hash    The hash so far.
+ *    @param const void         *buf     The buffer to hash.
+ *    @param unsigned long       len     The length of the buffer.
+ *
+ *    @return unsigned long long    The updated hash.
+ */
+unsigned long long hash_fnv1a_update(unsigned long long hash, const void *buf, unsigned long len);
+
+/*
+ *    Computes the CRC32 of a buffer, as zlib and gzip do.
+ *
+ *    @param const void    *buf    The buffer to checksum.
+ *    @param unsigned long  len    The length of the buffer.
+ *
+ *    @return unsigned int    The CRC32 of the buffer.
+ */
+unsigned int hash_crc32(const void *buf, unsigned long len);
+
+/*
+ *    Continues a CRC32 with another buffer. A CRC of 0 starts a new one.
+ *
+ *    @param unsigned int   crc    The CRC so far.
+ *    @param const void    *buf    The buffer to checksum.
+ *    @param unsigned long  len    The length of the buffer.
+ *
+ *    @return unsigned int    The updated CRC32.
+ */
+unsigned int hash_crc32_update(unsigned int crc, const void *buf, unsigned long len);
+
+#endif /* WLD_HASH_H  */
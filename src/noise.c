@@ -0,0 +1,384 @@
+/*
+ *    noise.c    --    Source file for gradient noise
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Defines the gradient noise used by world generation. The AVX2
+ *    versions do the same float operations in the same order as the
+ *    scalar ones, without fused multiplies, so their results match.
+ */
+#include "noise.h"
+
+#include "rand.h"
+
+/* Build with NOISE_SCALAR to always use the plain loops, as noisebench.c does to compare them.  */
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(NOISE_SCALAR)
+#include <immintrin.h>
+#define NOISE_AVX2
+#endif /* (__x86_64__ || __i386__) && !NOISE_SCALAR  */
+
+/* Fused multiplies would round differently in the scalar versions on CPUs that have them.  */
+#pragma GCC optimize("fp-contract=off")
+
+#define NOISE_MASK  (NOISE_SIZE - 1)
+#define NOISE_CHUNK 256
+
+static const float _noise_gx[8] = {1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 0.0f, 0.0f};
+static const float _noise_gy[8] = {1.0f, 1.0f, -1.0f, -1.0f, 0.0f, 0.0f, 1.0f, -1.0f};
+
+/*
+ *    Seeds a noise field from the game's random number generator.
+ *
+ *    @param noise_t *noise    The noise field.
+ *    @param int      seed     The seed to use.
+ */
+void noise_seed(noise_t *noise, int seed) {
+    rng_t rng;
+
+    rng_seed(&rng, seed);
+
+    int i;
+    for (i = 0; i < NOISE_SIZE; ++i) {
+        noise->grad[i] = (float)(rng_sample(&rng) * 2.0 - 1.0);
+        noise->perm[i] = i;
+    }
+
+    for (i = NOISE_SIZE - 1; i > 0; --i) {
+        int j    = rng_next_max(&rng, i + 1);
+        int temp = noise->perm[i];
+
+        noise->perm[i] = noise->perm[j];
+        noise->perm[j] = temp;
+    }
+
+    for (i = 0; i < NOISE_SIZE; ++i)
+        noise->perm[NOISE_SIZE + i] = noise->perm[i];
+}
+
+/*
+ *    Rounds down, without needing libm.
+ *
+ *    @param float x    The number.
+ *
+ *    @return int    The largest integer not above x.
+ */
+static int noise_floor(float x) {
+    int i = (int)x;
+
+    return x < (float)i ? i - 1 : i;
+}
+
+/*
+ *    Eases the position in a cell, so the noise is smooth across cells.
+ *
+ *    @param float f    The position, between 0 and 1.
+ *
+ *    @return float    The eased position.
+ */
+static float noise_fade(float f) {
+    return f * f * f * (f * (f * 6.0f - 15.0f) + 10.0f);
+}
+
+/*
+ *    Dots the gradient of a 2D lattice point with the offset from it.
+ *
+ *    @param const noise_t *noise    The noise field.
+ *    @param int            px       The permutation of the x coordinate of the point.
+ *    @param int            iy       The y coordinate of the point.
+ *    @param float          dx       The x offset.
+ *    @param float          dy       The y offset.
+ *
+ *    @return float    The dot product.
+ */
+static float noise_grad_2d(const noise_t *noise, int px, int iy, float dx, float dy) {
+    int h = noise->perm[px + (iy & NOISE_MASK)] & 7;
+
+    return _noise_gx[h] * dx + _noise_gy[h] * dy;
+}
+
+/*
+ *    Samples 1D noise.
+ *
+ *    @param const noise_t *noise    The noise field.
+ *    @param float          x        The coordinate.
+ *
+ *    @return float    The noise, between -1 and 1.
+ */
+float noise_1d(const noise_t *noise, float x) {
+    int   i  = noise_floor(x);
+    float f  = x - (float)i;
+    float g0 = noise->grad[i & NOISE_MASK] * f;
+    float g1 = noise->grad[(i + 1) & NOISE_MASK] * (f - 1.0f);
+
+    return (g0 + noise_fade(f) * (g1 - g0)) * 2.0f;
+}
+
+/*
+ *    Samples 2D noise.
+ *
+ *    @param const noise_t *noise    The noise field.
+ *    @param float          x        The x coordinate.
+ *    @param float          y        The y coordinate.
+ *
+ *    @return float    The noise, roughly between -1 and 1.
+ */
+float noise_2d(const noise_t *noise, float x, float y) {
+    int   ix  = noise_floor(x);
+    int   iy  = noise_floor(y);
+    float fx  = x - (float)ix;
+    float fy  = y - (float)iy;
+    int   px0 = noise->perm[ix & NOISE_MASK];
+    int   px1 = noise->perm[(ix + 1) & NOISE_MASK];
+
+    float n00 = noise_grad_2d(noise, px0, iy, fx, fy);
+    float n10 = noise_grad_2d(noise, px1, iy, fx - 1.0f, fy);
+    float n01 = noise_grad_2d(noise, px0, iy + 1, fx, fy - 1.0f);
+    float n11 = noise_grad_2d(noise, px1, iy + 1, fx - 1.0f, fy - 1.0f);
+
+    float u = noise_fade(fx);
+    float v = noise_fade(fy);
+    float a = n00 + u * (n10 - n00);
+    float b = n01 + u * (n11 - n01);
+
+    return a + v * (b - a);
+}
+
+#ifdef NOISE_AVX2
+/*
+ *    Eases 8 positions in their cells with AVX2.
+ *
+ *    @param __m256 f    The positions, between 0 and 1.
+ *
+ *    @return __m256    The eased positions.
+ */
+__attribute__((target("avx2")))
+static __m256 noise_fade_avx2(__m256 f) {
+    __m256 inner = _mm256_sub_ps(_mm256_mul_ps(f, _mm256_set1_ps(6.0f)), _mm256_set1_ps(15.0f));
+
+    inner = _mm256_add_ps(_mm256_mul_ps(f, inner), _mm256_set1_ps(10.0f));
+
+    return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(f, f), f), inner);
+}
+
+/*
+ *    Samples a row of 1D noise with AVX2, 8 samples at a time.
+ *
+ *    @param const noise_t *noise    The noise field.
+ *    @param float          x        The first coordinate.
+ *    @param float          step     The distance between samples.
+ *    @param float         *out      The samples.
+ *    @param int            count    The number of samples.
+ *
+ *    @return int    The number of samples taken, a multiple of 8.
+ */
+__attribute__((target("avx2")))
+static int noise_row_avx2(const noise_t *noise, float x, float step, float *out, int count) {
+    __m256i mask  = _mm256_set1_epi32(NOISE_MASK);
+    __m256i one   = _mm256_set1_epi32(1);
+    __m256  onef  = _mm256_set1_ps(1.0f);
+    __m256  start = _mm256_set1_ps(x);
+    __m256  size  = _mm256_set1_ps(step);
+    __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    int i;
+    for (i = 0; i + 8 <= count; i += 8) {
+        __m256  xs = _mm256_add_ps(start, _mm256_mul_ps(_mm256_cvtepi32_ps(index), size));
+        __m256  fl = _mm256_floor_ps(xs);
+        __m256i ix = _mm256_cvttps_epi32(fl);
+        __m256  f  = _mm256_sub_ps(xs, fl);
+
+        __m256 g0 = _mm256_i32gather_ps(noise->grad, _mm256_and_si256(ix, mask), 4);
+        __m256 g1 = _mm256_i32gather_ps(noise->grad, _mm256_and_si256(_mm256_add_epi32(ix, one), mask), 4);
+
+        g0 = _mm256_mul_ps(g0, f);
+        g1 = _mm256_mul_ps(g1, _mm256_sub_ps(f, onef));
+
+        __m256 n = _mm256_add_ps(g0, _mm256_mul_ps(noise_fade_avx2(f), _mm256_sub_ps(g1, g0)));
+
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(n, _mm256_set1_ps(2.0f)));
+
+        index = _mm256_add_epi32(index, _mm256_set1_epi32(8));
+    }
+
+    return i;
+}
+
+/*
+ *    Dots the gradients of 8 2D lattice points with the offsets from them
+ *    with AVX2.
+ *
+ *    @param const noise_t *noise    The noise field.
+ *    @param int            px       The permutation of the x coordinate of the points.
+ *    @param __m256i        iy       The y coordinates of the points.
+ *    @param __m256         dx       The x offset, the same for every point.
+ *    @param __m256         dy       The y offsets.
+ *
+ *    @return __m256    The dot products.
+ */
+__attribute__((target("avx2")))
+static __m256 noise_grad_2d_avx2(const noise_t *noise, int px, __m256i iy, __m256 dx, __m256 dy) {
+    __m256i at = _mm256_add_epi32(_mm256_set1_epi32(px), _mm256_and_si256(iy, _mm256_set1_epi32(NOISE_MASK)));
+    __m256i h  = _mm256_and_si256(_mm256_i32gather_epi32(noise->perm, at, 4), _mm256_set1_epi32(7));
+    __m256  gx = _mm256_permutevar8x32_ps(_mm256_loadu_ps(_noise_gx), h);
+    __m256  gy = _mm256_permutevar8x32_ps(_mm256_loadu_ps(_noise_gy), h);
+
+    return _mm256_add_ps(_mm256_mul_ps(gx, dx), _mm256_mul_ps(gy, dy));
+}
+
+/*
+ *    Samples a column of 2D noise with AVX2, 8 samples at a time. The
+ *    lattice column and its easing are shared by every sample.
+ *
+ *    @param const noise_t *noise    The noise field.
+ *    @param float          x        The x coordinate.
+ *    @param float          y        The first y coordinate.
+ *    @param float          step     The distance between samples.
+ *    @param float         *out      The samples.
+ *    @param int            count    The number of samples.
+ *
+ *    @return int    The number of samples taken, a multiple of 8.
+ */
+__attribute__((target("avx2")))
+static int noise_column_avx2(const noise_t *noise, float x, float y, float step, float *out, int count) {
+    int   ix  = noise_floor(x);
+    float fx  = x - (float)ix;
+    int   px0 = noise->perm[ix & NOISE_MASK];
+    int   px1 = noise->perm[(ix + 1) & NOISE_MASK];
+
+    __m256  dx0   = _mm256_set1_ps(fx);
+    __m256  dx1   = _mm256_set1_ps(fx - 1.0f);
+    __m256  u     = _mm256_set1_ps(noise_fade(fx));
+    __m256  onef  = _mm256_set1_ps(1.0f);
+    __m256i one   = _mm256_set1_epi32(1);
+    __m256  start = _mm256_set1_ps(y);
+    __m256  size  = _mm256_set1_ps(step);
+    __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    int i;
+    for (i = 0; i + 8 <= count; i += 8) {
+        __m256  ys  = _mm256_add_ps(start, _mm256_mul_ps(_mm256_cvtepi32_ps(index), size));
+        __m256  fl  = _mm256_floor_ps(ys);
+        __m256i iy  = _mm256_cvttps_epi32(fl);
+        __m256i iy1 = _mm256_add_epi32(iy, one);
+        __m256  fy  = _mm256_sub_ps(ys, fl);
+        __m256  fy1 = _mm256_sub_ps(fy, onef);
+
+        __m256 n00 = noise_grad_2d_avx2(noise, px0, iy, dx0, fy);
+        __m256 n10 = noise_grad_2d_avx2(noise, px1, iy, dx1, fy);
+        __m256 n01 = noise_grad_2d_avx2(noise, px0, iy1, dx0, fy1);
+        __m256 n11 = noise_grad_2d_avx2(noise, px1, iy1, dx1, fy1);
+
+        __m256 v = noise_fade_avx2(fy);
+        __m256 a = _mm256_add_ps(n00, _mm256_mul_ps(u, _mm256_sub_ps(n10, n00)));
+        __m256 b = _mm256_add_ps(n01, _mm256_mul_ps(u, _mm256_sub_ps(n11, n01)));
+
+        _mm256_storeu_ps(out + i, _mm256_add_ps(a, _mm256_mul_ps(v, _mm256_sub_ps(b, a))));
+
+        index = _mm256_add_epi32(index, _mm256_set1_epi32(8));
+    }
+
+    return i;
+}
+
+/*
+ *    Returns whether the AVX2 versions can be used, which is checked once.
+ *
+ *    @return unsigned int    1 if AVX2 is supported, 0 if not.
+ */
+static unsigned int noise_avx2(void) {
+    static int avx2 = -1;
+    int        has  = __atomic_load_n(&avx2, __ATOMIC_RELAXED);
+
+    if (has < 0) {
+        has = __builtin_cpu_supports("avx2") != 0;
+        __atomic_store_n(&avx2, has, __ATOMIC_RELAXED);
+    }
+
+    return has;
+}
+#endif /* NOISE_AVX2  */
+
+/*
+ *    Samples a row of 1D noise, at x, x + step, x + 2 * step and so on.
+ *
+ *    @param const noise_t *noise    The noise field.
+ *    @param float          x        The first coordinate.
+ *    @param float          step     The distance between samples.
+ *    @param float         *out      The samples.
+ *    @param int            count    The number of samples.
+ */
+void noise_row(const noise_t *noise, float x, float step, float *out, int count) {
+    int i = 0;
+
+#ifdef NOISE_AVX2
+    if (noise_avx2())
+        i = noise_row_avx2(noise, x, step, out, count);
+#endif /* NOISE_AVX2  */
+
+    for (; i < count; ++i)
+        out[i] = noise_1d(noise, x + (float)i * step);
+}
+
+/*
+ *    Samples a column of 2D noise, at (x, y), (x, y + step) and so on.
+ *
+ *    @param const noise_t *noise    The noise field.
+ *    @param float          x        The x coordinate.
+ *    @param float          y        The first y coordinate.
+ *    @param float          step     The distance between samples.
+ *    @param float         *out      The samples.
+ *    @param int            count    The number of samples.
+ */
+void noise_column(const noise_t *noise, float x, float y, float step, float *out, int count) {
+    int i = 0;
+
+#ifdef NOISE_AVX2
+    if (noise_avx2())
+        i = noise_column_avx2(noise, x, y, step, out, count);
+#endif /* NOISE_AVX2  */
+
+    for (; i < count; ++i)
+        out[i] = noise_2d(noise, x, y + (float)i * step);
+}
+
+/*
+ *    Samples a row of fractal 1D noise, summing octaves that each have
+ *    twice the frequency and half the amplitude of the last.
+ *
+ *    @param const noise_t *noise      The noise field.
+ *    @param float          x          The first coordinate.
+ *    @param float          step       The distance between samples.
+ *    @param int            octaves    The number of octaves.
+ *    @param float         *out        The samples, between -1 and 1.
+ *    @param int            count      The number of samples.
+ */
+void noise_fbm_row(const noise_t *noise, float x, float step, int octaves, float *out, int count) {
+    float octave[NOISE_CHUNK];
+    float total = 0.0f;
+    float amp   = 1.0f;
+    float freq  = 1.0f;
+
+    int i;
+    for (i = 0; i < count; ++i)
+        out[i] = 0.0f;
+
+    int o;
+    for (o = 0; o < octaves; ++o) {
+        int start;
+        for (start = 0; start < count; start += NOISE_CHUNK) {
+            int n = count - start < NOISE_CHUNK ? count - start : NOISE_CHUNK;
+
+            noise_row(noise, (x + (float)start * step) * freq, step * freq, octave, n);
+
+            for (i = 0; i < n; ++i)
+                out[start + i] += octave[i] * amp;
+        }
+
+        total += amp;
+        amp   *= 0.5f;
+        freq  *= 2.0f;
+    }
+
+    for (i = 0; i < count && total > 0.0f; ++i)
+        out[i] /= total;
+}
@@ -0,0 +1,89 @@
+/*
+ *    noise.h    --    Header file for gradient noise
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Declares the gradient noise used by world generation for the surface
+ *    height line and cave density. Whole rows of 1D noise and columns of
+ *    2D noise are evaluated at once, and every CPU gets the same values
+ *    bit for bit, so a seed always makes the same world.
+ */
+#ifndef WLD_NOISE_H
+#define WLD_NOISE_H
+
+#define NOISE_SIZE 256
+
+/*
+ *    A seeded noise field. The lattice repeats every NOISE_SIZE units.
+ */
+typedef struct {
+    float grad[NOISE_SIZE];
+    int   perm[NOISE_SIZE * 2];
+} noise_t;
+
+/*
+ *    Seeds a noise field from the game's random number generator.
+ *
+ *    @param noise_t *noise    The noise field.
+ *    @param int      seed     The seed to use.
+ */
+void noise_seed(noise_t *noise, int seed);
+
+/*
+ *    Samples 1D noise.
+ *
+ *    @param const noise_t *noise    The noise field.
+ *    @param float          x        The coordinate.
+ *
+ *    @return float    The noise, between -1 and 1.
+ */
+float noise_1d(const noise_t *noise, float x);
+
+/*
+ *    Samples 2D noise.
+ *
+ *    @param const noise_t *noise    The noise field.
+ *    @param float          x        The x coordinate.
+ *    @param float          y        The y coordinate.
+ *
+ *    @return float    The noise, roughly between -1 and 1.
+ */
+float noise_2d(const noise_t *noise, float x, float y);
+
+/*
+ *    Samples a row of 1D noise, at x, x + step, x + 2 * step and so on.
+ *
+ *    @param const noise_t *noise    The noise field.
+ *    @param float          x        The first coordinate.
+ *    @param float          step     The distance between samples.
+ *    @param float         *out      The samples.
+ *    @param int            count    The number of samples.
+ */
+void noise_row(const noise_t *noise, float x, float step, float *out, int count);
+
+/*
+ *    Samples a column of 2D noise, at (x, y), (x, y + step) and so on.
+ *
+ *    @param const noise_t *noise    The noise field.
+ *    @param float          x        The x coordinate.
+ *    @param float          y        The first y coordinate.
+ *    @param float          step     The distance between samples.
+ *    @param float         *out      The samples.
+ *    @param int            count    The number of samples.
+ */
+void noise_column(const noise_t *noise, float x, float y, float step, float *out, int count);
+
+/*
+ *    Samples a row of fractal 1D noise, summing octaves that each have
+ *    twice the frequency and half the amplitude of the last.
+ *
+ *    @param const noise_t *noise      The noise field.
+ *    @param float          x          The first coordinate.
+ *    @param float          step       The distance between samples.
+ *    @param int            octaves    The number of octaves.
+ *    @param float         *out        The samples, between -1 and 1.
+ *    @param int            count      The number of samples.
+ */
+void noise_fbm_row(const noise_t *noise, float x, float step, int octaves, float *out, int count);
+
+#endif /* WLD_NOISE_H  */
@@ -0,0 +1,155 @@
+/*
+ *    noisebench.c    --    benchmark of the gradient noise kernels
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 19, 2026
+ *
+ *    Times the noise world generation needs at the three world sizes: a
+ *    heightmap, one 5 octave row of fractal noise as wide as the world,
+ *    and cave density, a column of 2D noise for every column of the
+ *    world. The rows and columns are checked against noise_1d and
+ *    noise_2d first, so a fast but wrong build fails instead of
+ *    reporting.
+ *
+ *        noisebench [-r repeats]
+ *
+ *    The kernels use AVX2 where the CPU has it. To time the plain loops
+ *    the other CPUs use, build noise.c with -DNOISE_SCALAR:
+ *
+ *        cc -O2 -o noisebench noisebench.c noise.c rand.c -lm
+ *        cc -O2 -DNOISE_SCALAR -o noisebench_scalar noisebench.c noise.c rand.c -lm
+ */
+#include "noise.h"
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NOISEBENCH_CHECK 4096
+
+/*
+ *    Returns the time on the monotonic clock.
+ *
+ *    @return double    The time in seconds.
+ */
+static double noisebench_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ *    Checks that rows and columns match noise_1d and noise_2d bit for bit,
+ *    over a spread of starts, steps and lengths.
+ *
+ *    @param const noise_t *noise    The noise field.
+ *
+ *    @return unsigned int    1 if they match, 0 if not.
+ */
+static unsigned int noisebench_check(const noise_t *noise) {
+    static float out[NOISEBENCH_CHECK];
+
+    int t;
+    int i;
+    for (t = 0; t < 200; ++t) {
+        float x     = (t - 100) * 3.7f;
+        float step  = 0.013f * (t % 7 + 1);
+        int   count = 1000 + t;
+
+        noise_row(noise, x, step, out, count);
+        for (i = 0; i < count; ++i) {
+            float expected = noise_1d(noise, x + (float)i * step);
+
+            if (memcmp(&expected, &out[i], sizeof(float)) != 0)
+                return 0;
+        }
+
+        noise_column(noise, x * 0.7f, x, step, out, count);
+        for (i = 0; i < count; ++i) {
+            float expected = noise_2d(noise, x * 0.7f, x + (float)i * step);
+
+            if (memcmp(&expected, &out[i], sizeof(float)) != 0)
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ *    Entry.
+ *
+ *    @return int
+ *        0 on success, -1 on failure.
+ */
+int main(int argc, char **argv) {
+    static const int sizes[][2] = {{4200, 1200}, {6400, 1800}, {8400, 2400}};
+
+    noise_t noise;
+    int     repeats = 2000;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "r:")) != -1) {
+        switch (opt) {
+        case 'r':
+            repeats = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-r repeats]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    if (repeats <= 0) {
+        fprintf(stderr, "usage: %s [-r repeats]\n", argv[0]);
+        return -1;
+    }
+
+    noise_seed(&noise, 12345);
+
+    if (!noisebench_check(&noise)) {
+        fprintf(stderr, "Noise rows or columns do not match single samples\n");
+        return -1;
+    }
+
+    printf("heightmap averaged over %d rows\n", repeats);
+
+    unsigned int i;
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        int    width  = sizes[i][0];
+        int    height = sizes[i][1];
+        float *row    = (float *)malloc(sizeof(float) * width);
+        float *column = (float *)malloc(sizeof(float) * height);
+
+        if (row == (float *)0x0 || column == (float *)0x0) {
+            fprintf(stderr, "Failed to allocate memory\n");
+            free(row);
+            free(column);
+            return -1;
+        }
+
+        int    r;
+        double start = noisebench_now();
+        for (r = 0; r < repeats; ++r)
+            noise_fbm_row(&noise, (float)r, 1.0f / 300.0f, 5, row, width);
+        double heightmap = (noisebench_now() - start) / repeats;
+
+        int x;
+        start = noisebench_now();
+        for (x = 0; x < width; ++x)
+            noise_column(&noise, x / 40.0f, 0.0f, 1.0f / 40.0f, column, height);
+        double caves = noisebench_now() - start;
+
+        printf("  %dx%d  heightmap %.0fus, caves %.1fms (%.0fM samples/s)\n", width, height, heightmap * 1e6, caves * 1e3,
+               (double)width * height / caves / 1e6);
+
+        free(row);
+        free(column);
+    }
+
+    return 0;
+}
@@ -7,6 +7,7 @@
  *    Source file for the parsing utility functions.
  */
 #include "parseutil.h"
+#include "compress.h"
 #include "log.h"
 #include "wldfuncs.h"
 #include "wldheaderfuncs.h"
@@ -15,53 +16,85 @@
 #include <stdio.h>
 
 /*
- *    Reads a file into a buffer.
+ *    Wraps a file already read into memory in a file stream, taking over
+ *    the buffer. Buffers compressed with gzip or zstd are decompressed.
  *
- *    @param const char *path    The file to read.
+ *    @param unsigned char *buf    The file's contents, allocated with malloc.
+ *    @param unsigned long  len    The length of the contents.
  *
- *    @return filestream_t *   The file stream.
+ *    @return filestream_t *   The file stream, NULL on failure, in which case the buffer is freed.
  */
-filestream_t *filestream_open(const char *path) {
+filestream_t *filestream_from_buffer(unsigned char *buf, unsigned long len) {
     filestream_t *stream = (filestream_t *)malloc(sizeof(filestream_t));
 
     if (stream == (filestream_t *)0x0) {
         LOGF_ERR("Failed to allocate memory for stream.\n");
+        free(buf);
         return (filestream_t *)0x0;
     }
 
+    /* Compressed backups are unpacked in memory, never to disk.  */
+    if (compress_detect(buf, len) != COMPRESS_NONE) {
+        unsigned char *raw = compress_inflate(buf, len, &len);
+
+        free(buf);
+        buf = raw;
+
+        if (buf == (unsigned char *)0x0) {
+            LOGF_ERR("Failed to decompress file.\n");
+            free(stream);
+            return (filestream_t *)0x0;
+        }
+    }
+
+    stream->buf = buf;
+    stream->len = len;
+    stream->pos = 0;
+
+    return stream;
+}
+
+/*
+ *    Reads a file into a buffer. Files compressed with gzip or zstd are
+ *    decompressed into it.
+ *
+ *    @param const char *path    The file to read.
+ *
+ *    @return filestream_t *   The file stream.
+ */
+filestream_t *filestream_open(const char *path) {
     FILE *fp = fopen(path, "rb");
 
     if (fp == (FILE *)0x0) {
         LOGF_ERR("Failed to open file.\n");
-        free(stream);
         return (filestream_t *)0x0;
     }
 
     fseek(fp, 0, SEEK_END);
-    stream->len = ftell(fp);
+    unsigned long len = ftell(fp);
     fseek(fp, 0, SEEK_SET);
-    stream->buf = (unsigned char *)malloc(stream->len);
 
-    if (stream->buf == (unsigned char *)0x0) {
+    unsigned char *buf = (unsigned char *)malloc(len > 0 ? len : 1);
+
+    if (buf == (unsigned char *)0x0) {
         LOGF_ERR("Failed to allocate memory for buffer.\n");
-        free(stream);
+        fclose(fp);
         return (filestream_t *)0x0;
     }
 
-    fread(stream->buf, 1, stream->len, fp);
+    fread(buf, 1, len, fp);
     fclose(fp);
-    stream->pos = 0;
 
-    return stream;
+    return filestream_from_buffer(buf, len);
 }
 
 /*
  *    Seeks into a file stream.
  *
  *    @param filestream_t *stream    The file stream to seek into.
- *    @param int                     The position to seek to.
+ *    @param unsigned long pos       The position to seek to.
  */
-void filestream_seek(filestream_t *stream, int pos) {
+void filestream_seek(filestream_t *stream, unsigned long pos) {
     stream->pos = pos;
 }
 
@@ -89,11 +122,11 @@ void filestream_free(filestream_t *stream) {
  *    Parses a string.
  *
  *    @param unsigned char *buf    The buffer to parse.
- *    @param unsigned int pos    The position to start parsing at.
+ *    @param unsigned long *pos    The position to start parsing at.
  *
  *    @return unsigned char *      The parsed string, NULL on failure.
  */
-char *parse_string(unsigned char *buf, unsigned int *pos) {
+char *parse_string(unsigned char *buf, unsigned long *pos) {
     unsigned char len = 0;
 
     PARSE(buf, *pos, unsigned char, len);
@@ -116,14 +149,14 @@ char *parse_string(unsigned char *buf, unsigned int *pos) {
 /*
  *    Pushes a new byte into a buffer.
  *
- *    @param char **    The buffer to push into.
- *    @param unsigned char       The byte to push.
- *    @param unsigned int      The size of the buffer.
+ *    @param char          **buf     The buffer to push into.
+ *    @param unsigned char   byte    The byte to push.
+ *    @param unsigned long   len     The size of the buffer.
  *
- *    @return unsigned int     The new size of the buffer, 0 on failure.
+ *    @return unsigned long    The new size of the buffer, 0 on failure.
  */
-unsigned int push_byte(char **buf, unsigned char byte, unsigned int len) {
-    if (len >= 0xFFFFFFFF) {
+unsigned long push_byte(char **buf, unsigned char byte, unsigned long len) {
+    if (len == ~0UL) {
         LOGF_FAT("Buffer size is too large.\n");
         return 0;
     }
@@ -132,15 +165,17 @@ unsigned int push_byte(char **buf, unsigned char byte, unsigned int len) {
         return 0;
     }
 
-    VLOGF_MSG("Pushing byte %d into buffer of size %d.\n", byte, len);
+    VLOGF_MSG("Pushing byte %d into buffer of size %lu.\n", byte, len);
 
-    *buf = (char *)realloc(*buf, len + 1);
-    if (*buf == (char *)0x0) {
+    /* The old buffer is kept on failure, so the caller can still free it.  */
+    char *grown = (char *)realloc(*buf, len + 1);
+    if (grown == (char *)0x0) {
         LOGF_FAT("Failed to reallocate buffer.\n");
         return 0;
     }
 
-    (*buf)[len + 1] = byte;
+    *buf        = grown;
+    (*buf)[len] = byte;
     return len + 1;
 }
 
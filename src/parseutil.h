@@ -32,7 +32,19 @@
 #include "wld.h"
 
 /*
- *    Reads a file into a buffer.
+ *    Wraps a file already read into memory in a file stream, taking over
+ *    the buffer. Buffers compressed with gzip or zstd are decompressed.
+ *
+ *    @param unsigned char *buf    The file's contents, allocated with malloc.
+ *    @param unsigned long  len    The length of the contents.
+ *
+ *    @return filestream_t *   The file stream, NULL on failure, in which case the buffer is freed.
+ */
+filestream_t *filestream_from_buffer(unsigned char *buf, unsigned long len);
+
+/*
+ *    Reads a file into a buffer. Files compressed with gzip or zstd are
+ *    decompressed into it.
  *
  *    @param const char *path    The file to read.
  *
@@ -44,9 +56,9 @@ filestream_t *filestream_open(const char *path);
  *    Seeks into a file stream.
  *
  *    @param filestream_t *stream    The file stream to seek into.
- *    @param int                     The position to seek to.
+ *    @param unsigned long pos       The position to seek to.
  */
-void filestream_seek(filestream_t *stream, int pos);
+void filestream_seek(filestream_t *stream, unsigned long pos);
 
 /*
  *    Frees a file stream.
@@ -59,22 +71,22 @@ void filestream_free(filestream_t *stream);
  *    Parses a string.
  *
  *    @param unsigned char *buf    The buffer to parse.
- *    @param unsigned int pos    The position to start parsing at.
+ *    @param unsigned long *pos    The position to start parsing at.
  *
  *    @return unsigned char *      The parsed string, NULL on failure.
  */
-char *parse_string(unsigned char *buf, unsigned int *pos);
+char *parse_string(unsigned char *buf, unsigned long *pos);
 
 /*
  *    Pushes a new byte into a buffer.
  *
- *    @param char **    The buffer to push into.
- *    @param unsigned char       The byte to push.
- *    @param unsigned int      The size of the buffer.
+ *    @param char          **buf     The buffer to push into.
+ *    @param unsigned char   byte    The byte to push.
+ *    @param unsigned long   len     The size of the buffer.
  *
- *    @return unsigned int     The new size of the buffer, 0 on failure.
+ *    @return unsigned long    The new size of the buffer, 0 on failure.
  */
-unsigned int push_byte(char **buf, unsigned char byte, unsigned int len);
+unsigned long push_byte(char **buf, unsigned char byte, unsigned long len);
 
 /*
  *    Determines the the file version and
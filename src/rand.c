@@ -9,23 +9,32 @@
  */
 #include "rand.h"
 
+#include <stdlib.h>
+#include <string.h>
+
+/* Build with RNG_LANES_SCALAR to always use the plain loops, as randbench.c does to compare them.  */
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(RNG_LANES_SCALAR)
+#include <immintrin.h>
+#define RNG_LANES_AVX2
+#endif /* (__x86_64__ || __i386__) && !RNG_LANES_SCALAR  */
+
 #define ARR_LEN(x) (sizeof(x) / sizeof(x[0]))
 
 const int _rand_max = 2147483647;
 const int _seed     = 161803398;
-int       _i_next;
-int       _i_next_p;
-int       _seed_array[56];
+
+static rng_t _rng;
 
 /*
- *    Sets the seed for the random number generator.
+ *    Sets the seed of a random number stream.
  *
- *    @param int seed    The seed to use.
+ *    @param rng_t *rng     The stream.
+ *    @param int    seed    The seed to use.
  */
-void set_seed(int seed) {
+void rng_seed(rng_t *rng, int seed) {
     unsigned long i;
-    for (i = 0; i < ARR_LEN(_seed_array); ++i)
-        _seed_array[i] = 0;
+    for (i = 0; i < ARR_LEN(rng->seed_array); ++i)
+        rng->seed_array[i] = 0;
 
     /*
      *    No idea what these num variables are, 
@@ -33,49 +42,54 @@ void set_seed(int seed) {
      */
     int num = (seed == -2147483648) ? 2147483647 : abs(seed);
     int num2 = 161803398 - num;
-    _seed_array[55] = num2;
+    rng->seed_array[55] = num2;
     int num3 = 1;
 
     for (i = 1; i < 55; ++i) {
         unsigned long num4 = (21 * i) % 55;
-        _seed_array[num4] = num3;
-        num3 = num2 - num3;
+        rng->seed_array[num4] = num3;
+        num3 = (int)((unsigned int)num2 - (unsigned int)num3);
         if (num3 < 0)
             num3 += 2147483647;
 
-        num2 = _seed_array[num4];
+        num2 = rng->seed_array[num4];
     }
 
     for (i = 1; i < 5; ++i) {
         unsigned long j;
         for (j = 1; j < 56; ++j) {
-            _seed_array[j] -= _seed_array[1 + (j + 30) % 55];
-            if (_seed_array[j] < 0)
-                _seed_array[j] += 2147483647;
+            /* Wraps like the game's unchecked arithmetic when num2 started out negative.  */
+            rng->seed_array[j] = (int)((unsigned int)rng->seed_array[j] - (unsigned int)rng->seed_array[1 + (j + 30) % 55]);
+            if (rng->seed_array[j] < 0)
+                rng->seed_array[j] += 2147483647;
         }
     }
 
-    _i_next   = 0;
-    _i_next_p = 21;
+    rng->i_next   = 0;
+    rng->i_next_p = 21;
 }
 
 /*
  *    Source code def: Sample
  *
- *    @return double    A random number between 0 and 1?
+ *    @param rng_t *rng    The stream.
+ *
+ *    @return double    A random number between 0 and 1.
  */
-double sample(void) {
-    return (double)internal_sample() * 4.656612875245797e-10;
+double rng_sample(rng_t *rng) {
+    return (double)rng_internal_sample(rng) * 4.656612875245797e-10;
 }
 
 /*
  *    Source code def: InternalSample
  *
- *    @return int    A random number between 0 and 2^32-1?
+ *    @param rng_t *rng    The stream.
+ *
+ *    @return int    A random number between 0 and 2^31-2.
  */
-int internal_sample(void) {
-    int num = _i_next;
-    int num2 = _i_next_p;
+int rng_internal_sample(rng_t *rng) {
+    int num = rng->i_next;
+    int num2 = rng->i_next_p;
 
     if (++num >= 56)
         num = 1;
@@ -83,7 +97,7 @@ int internal_sample(void) {
     if (++num2 >= 56)
         num2 = 1;
     
-    int num3 = _seed_array[num] - _seed_array[num2];
+    int num3 = rng->seed_array[num] - rng->seed_array[num2];
 
     if (num3 == 2147483647)
         num3--;
@@ -91,9 +105,9 @@ int internal_sample(void) {
     if (num3 < 0)
         num3 += 2147483647;
 
-    _seed_array[num] = num3;
-    _i_next = num;
-    _i_next_p = num2;
+    rng->seed_array[num] = num3;
+    rng->i_next = num;
+    rng->i_next_p = num2;
 
     return num3;
 }
@@ -101,45 +115,527 @@ int internal_sample(void) {
 /*
  *    Gets the sample for a larger range.
  *
- *    @return double    A random number between 0 and 1?
+ *    @param rng_t *rng    The stream.
+ *
+ *    @return double    A random number between 0 and 1.
  */
-double get_sample_for_large_range(void) {
-    int num = internal_sample();
+double rng_sample_for_large_range(rng_t *rng) {
+    int num = rng_internal_sample(rng);
 
-    if ((internal_sample() % 2) == 0)
+    if ((rng_internal_sample(rng) % 2) == 0)
         num = -num;
 
     return ((double)num + 2147483646.0) / 4294967293.0;
 }
 
 /*
- *    Gets the next random number in the sequence.
+ *    Gets the next random number in a stream.
  *
- *    @return int    A random number between 0 and 2^32-1.
+ *    @param rng_t *rng    The stream.
+ *
+ *    @return int    A random number between 0 and 2^31-2.
  */
-int next(void) {
-    return internal_sample();
+int rng_next(rng_t *rng) {
+    return rng_internal_sample(rng);
 }
 
 /*
- *    Gets the next random number in the sequence.
+ *    Gets the next random number in a stream.
  *
- *    @param int min    The minimum value to return.
- *    @param int max    The maximum value to return.
- *    @return int       A random number between minValue and maxValue.
+ *    @param rng_t *rng    The stream.
+ *    @param int    min    The minimum value to return.
+ *    @param int    max    The maximum value, exclusive.
+ *
+ *    @return int    A random number between min and max.
  */
-int next_minmax(int min, int max) {
+int rng_next_minmax(rng_t *rng, int min, int max) {
     if (min > max) {
         int temp = min;
         min = max;
         max = temp;
     }
 
-    long num2 = (long)(max - min);
+    /* Widened before subtracting, a range wider than an int is what the large sample is for.  */
+    long num2 = (long)max - min;
     if (num2 <= 2147483647)
-        return (int)(sample() * (double)num2) + min;
+        return (int)(rng_sample(rng) * (double)num2) + min;
+
+    return (int)((long)(rng_sample_for_large_range(rng) * (double)num2) + min);
+}
+
+/*
+ *    Gets the next random number in a stream.
+ *
+ *    @param rng_t *rng    The stream.
+ *    @param int    max    The maximum value, exclusive.
+ *
+ *    @return int    A random number between 0 and max.
+ */
+int rng_next_max(rng_t *rng, int max) {
+    return (int)(rng_sample(rng) * (double)max);
+}
+
+/*
+ *    Randomizes a byte array from a stream.
+ *
+ *    @param rng_t *rng       The stream.
+ *    @param char  *buffer    The buffer to randomize.
+ *    @param int    length    The length of the buffer.
+ */
+void rng_next_bytes(rng_t *rng, char *buffer, int length) {
+    if (buffer == (char *)0x0)
+        return;
+
+    int i;
+    for (i = 0; i < length; ++i)
+        buffer[i] = (char)(rng_internal_sample(rng) % 256);
+}
+
+/*
+ *    Advances the shared indices of a group of streams.
+ *
+ *    @param rng_lanes_t *rng    The streams.
+ *
+ *    @return int    The entry of the array to write, the one at i_next_p is read.
+ */
+static int rng_lanes_advance(rng_lanes_t *rng) {
+    if (++rng->i_next >= 56)
+        rng->i_next = 1;
+
+    if (++rng->i_next_p >= 56)
+        rng->i_next_p = 1;
+
+    return rng->i_next;
+}
+
+/*
+ *    Sets the seeds of a group of streams one at a time.
+ *
+ *    @param rng_lanes_t *rng      The streams.
+ *    @param const int   *seeds    RNG_LANES seeds, one per stream.
+ */
+static void rng_lanes_seed_scalar(rng_lanes_t *rng, const int *seeds) {
+    rng_t one;
+
+    int lane;
+    for (lane = 0; lane < RNG_LANES; ++lane) {
+        rng_seed(&one, seeds[lane]);
+
+        int i;
+        for (i = 0; i < 56; ++i)
+            rng->seed_array[i * RNG_LANES + lane] = one.seed_array[i];
+    }
+}
+
+/*
+ *    Gets the next random number in every stream of a group, one at a time.
+ *
+ *    @param rng_lanes_t *rng    The streams.
+ *    @param int         *out    RNG_LANES numbers between 0 and 2^31-2.
+ */
+static void rng_lanes_next_scalar(rng_lanes_t *rng, int *out) {
+    int *a = rng->seed_array + rng_lanes_advance(rng) * RNG_LANES;
+    int *b = rng->seed_array + rng->i_next_p * RNG_LANES;
+
+    int lane;
+    for (lane = 0; lane < RNG_LANES; ++lane) {
+        int num3 = a[lane] - b[lane];
+
+        if (num3 == 2147483647)
+            num3--;
+
+        if (num3 < 0)
+            num3 += 2147483647;
+
+        a[lane]   = num3;
+        out[lane] = num3;
+    }
+}
+
+/*
+ *    Scales the next random number in every stream of a group to a range
+ *    under 2^31, one at a time.
+ *
+ *    @param rng_lanes_t *rng      The streams.
+ *    @param int          range    The size of the range.
+ *    @param int          min      The start of the range.
+ *    @param int         *out      RNG_LANES numbers in the range.
+ */
+static void rng_lanes_scale_scalar(rng_lanes_t *rng, int range, int min, int *out) {
+    rng_lanes_next_scalar(rng, out);
+
+    int lane;
+    for (lane = 0; lane < RNG_LANES; ++lane)
+        out[lane] = (int)((double)out[lane] * 4.656612875245797e-10 * (double)range) + min;
+}
+
+#ifdef RNG_LANES_AVX2
+/*
+ *    Sets the seeds of a group of streams with AVX2. The mixing loops are
+ *    the ones in rng_seed, with every entry holding all of the lanes.
+ *
+ *    @param rng_lanes_t *rng      The streams.
+ *    @param const int   *seeds    RNG_LANES seeds, one per stream.
+ */
+__attribute__((target("avx2")))
+static void rng_lanes_seed_avx2(rng_lanes_t *rng, const int *seeds) {
+    __m256i *array = (__m256i *)rng->seed_array;
+    __m256i  max   = _mm256_set1_epi32(2147483647);
+
+    /* abs of -2^31 is 2^31 unsigned, which is clamped to 2^31-1 like in rng_seed.  */
+    __m256i num  = _mm256_min_epu32(_mm256_abs_epi32(_mm256_loadu_si256((const __m256i *)seeds)), max);
+    __m256i num2 = _mm256_sub_epi32(_mm256_set1_epi32(161803398), num);
+    __m256i num3 = _mm256_set1_epi32(1);
+
+    int i;
+    for (i = 0; i < 56; ++i)
+        array[i] = _mm256_setzero_si256();
+
+    array[55] = num2;
+
+    for (i = 1; i < 55; ++i) {
+        int num4 = (21 * i) % 55;
+
+        array[num4] = num3;
+        num3        = _mm256_sub_epi32(num2, num3);
+        num3        = _mm256_add_epi32(num3, _mm256_and_si256(_mm256_srai_epi32(num3, 31), max));
+        num2        = array[num4];
+    }
+
+    for (i = 1; i < 5; ++i) {
+        int j;
+        for (j = 1; j < 56; ++j) {
+            __m256i v = _mm256_sub_epi32(array[j], array[1 + (j + 30) % 55]);
+            array[j]  = _mm256_add_epi32(v, _mm256_and_si256(_mm256_srai_epi32(v, 31), max));
+        }
+    }
+}
+
+/*
+ *    Gets the next random number in every stream of a group with AVX2.
+ *
+ *    @param rng_lanes_t *rng    The streams.
+ *
+ *    @return __m256i    RNG_LANES numbers between 0 and 2^31-2.
+ */
+__attribute__((target("avx2")))
+static __m256i rng_lanes_next_avx2(rng_lanes_t *rng) {
+    __m256i *array = (__m256i *)rng->seed_array;
+    __m256i  max   = _mm256_set1_epi32(2147483647);
+    int      num   = rng_lanes_advance(rng);
+
+    __m256i num3 = _mm256_sub_epi32(array[num], array[rng->i_next_p]);
+    num3         = _mm256_add_epi32(num3, _mm256_cmpeq_epi32(num3, max));
+    num3         = _mm256_add_epi32(num3, _mm256_and_si256(_mm256_srai_epi32(num3, 31), max));
+
+    array[num] = num3;
+
+    return num3;
+}
+
+/*
+ *    Gets the next random number in every stream of a group with AVX2.
+ *
+ *    @param rng_lanes_t *rng    The streams.
+ *    @param int         *out    RNG_LANES numbers between 0 and 2^31-2.
+ */
+__attribute__((target("avx2")))
+static void rng_lanes_store_avx2(rng_lanes_t *rng, int *out) {
+    _mm256_storeu_si256((__m256i *)out, rng_lanes_next_avx2(rng));
+}
+
+/*
+ *    Scales the next random number in every stream of a group to a range
+ *    under 2^31 with AVX2. The doubles are multiplied in the same order as
+ *    rng_next_minmax, so the results are the same bit for bit.
+ *
+ *    @param rng_lanes_t *rng      The streams.
+ *    @param int          range    The size of the range.
+ *    @param int          min      The start of the range.
+ *    @param int         *out      RNG_LANES numbers in the range.
+ */
+__attribute__((target("avx2")))
+static void rng_lanes_scale_avx2(rng_lanes_t *rng, int range, int min, int *out) {
+    __m256i v     = rng_lanes_next_avx2(rng);
+    __m256d scale = _mm256_set1_pd(4.656612875245797e-10);
+    __m256d size  = _mm256_set1_pd((double)range);
+    __m256d lo    = _mm256_mul_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(v)), scale), size);
+    __m256d hi    = _mm256_mul_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1)), scale), size);
+    __m128i add   = _mm_set1_epi32(min);
+
+    _mm_storeu_si128((__m128i *)out, _mm_add_epi32(_mm256_cvttpd_epi32(lo), add));
+    _mm_storeu_si128((__m128i *)(out + 4), _mm_add_epi32(_mm256_cvttpd_epi32(hi), add));
+}
+
+/*
+ *    Returns whether the AVX2 versions can be used, which is checked once.
+ *
+ *    @return unsigned int    1 if AVX2 is supported, 0 if not.
+ */
+static unsigned int rng_lanes_avx2(void) {
+    static int avx2 = -1;
+    int        has  = __atomic_load_n(&avx2, __ATOMIC_RELAXED);
+
+    if (has < 0) {
+        has = __builtin_cpu_supports("avx2") != 0;
+        __atomic_store_n(&avx2, has, __ATOMIC_RELAXED);
+    }
+
+    return has;
+}
+#endif /* RNG_LANES_AVX2  */
+
+/*
+ *    Sets the seeds of a group of streams.
+ *
+ *    @param rng_lanes_t *rng      The streams.
+ *    @param const int   *seeds    RNG_LANES seeds, one per stream.
+ */
+void rng_lanes_seed(rng_lanes_t *rng, const int *seeds) {
+#ifdef RNG_LANES_AVX2
+    if (rng_lanes_avx2())
+        rng_lanes_seed_avx2(rng, seeds);
+    else
+#endif /* RNG_LANES_AVX2  */
+        rng_lanes_seed_scalar(rng, seeds);
+
+    rng->i_next   = 0;
+    rng->i_next_p = 21;
+}
+
+/*
+ *    Gets the next random number in every stream of a group.
+ *
+ *    @param rng_lanes_t *rng    The streams.
+ *    @param int         *out    RNG_LANES numbers between 0 and 2^31-2.
+ */
+void rng_lanes_next(rng_lanes_t *rng, int *out) {
+#ifdef RNG_LANES_AVX2
+    if (rng_lanes_avx2()) {
+        rng_lanes_store_avx2(rng, out);
+        return;
+    }
+#endif /* RNG_LANES_AVX2  */
+
+    rng_lanes_next_scalar(rng, out);
+}
+
+/*
+ *    Scales the next random number in every stream of a group to a range
+ *    under 2^31.
+ *
+ *    @param rng_lanes_t *rng      The streams.
+ *    @param int          range    The size of the range.
+ *    @param int          min      The start of the range.
+ *    @param int         *out      RNG_LANES numbers in the range.
+ */
+static void rng_lanes_scale(rng_lanes_t *rng, int range, int min, int *out) {
+#ifdef RNG_LANES_AVX2
+    if (rng_lanes_avx2()) {
+        rng_lanes_scale_avx2(rng, range, min, out);
+        return;
+    }
+#endif /* RNG_LANES_AVX2  */
+
+    rng_lanes_scale_scalar(rng, range, min, out);
+}
+
+/*
+ *    Gets the next random number in every stream of a group.
+ *
+ *    @param rng_lanes_t *rng    The streams.
+ *    @param int          max    The maximum value, exclusive.
+ *    @param int         *out    RNG_LANES numbers between 0 and max.
+ */
+void rng_lanes_next_max(rng_lanes_t *rng, int max, int *out) {
+    rng_lanes_scale(rng, max, 0, out);
+}
+
+/*
+ *    Gets the next random number in every stream of a group.
+ *
+ *    @param rng_lanes_t *rng    The streams.
+ *    @param int          min    The minimum value to return.
+ *    @param int          max    The maximum value, exclusive.
+ *    @param int         *out    RNG_LANES numbers between min and max.
+ */
+void rng_lanes_next_minmax(rng_lanes_t *rng, int min, int max, int *out) {
+    if (min > max) {
+        int temp = min;
+        min = max;
+        max = temp;
+    }
+
+    long range = (long)max - min;
+    if (range <= 2147483647) {
+        rng_lanes_scale(rng, range, min, out);
+        return;
+    }
+
+    /* Ranges wider than an int are rare enough to not be worth vectorizing.  */
+    int first[RNG_LANES];
+    int second[RNG_LANES];
+
+    rng_lanes_next(rng, first);
+    rng_lanes_next(rng, second);
+
+    int lane;
+    for (lane = 0; lane < RNG_LANES; ++lane) {
+        int num = (second[lane] % 2) == 0 ? -first[lane] : first[lane];
+
+        out[lane] = (int)((long)(((double)num + 2147483646.0) / 4294967293.0 * (double)range) + min);
+    }
+}
+
+/*
+ *    Copies one stream of a group out, to carry on with it alone.
+ *
+ *    @param rng_lanes_t *rng     The streams.
+ *    @param int          lane    The stream to copy.
+ *    @param rng_t       *out     The stream to copy to.
+ */
+void rng_lanes_extract(rng_lanes_t *rng, int lane, rng_t *out) {
+    int i;
+    for (i = 0; i < 56; ++i)
+        out->seed_array[i] = rng->seed_array[i * RNG_LANES + lane];
+
+    out->i_next   = rng->i_next;
+    out->i_next_p = rng->i_next_p;
+}
+
+#ifdef RNG_LANES_AVX2
+/*
+ *    Gets a run of random numbers under 2^31 apart from a stream with
+ *    AVX2. The entry read for each sample was written 34 samples before,
+ *    so 8 samples that do not wrap around the array can be taken at once.
+ *    The doubles are multiplied in the same order as rng_next_minmax.
+ *
+ *    @param rng_t *rng      The stream.
+ *    @param int    range    The size of the range.
+ *    @param int    min      The start of the range.
+ *    @param int   *out      The numbers in the range.
+ *    @param int    count    The number of numbers to get.
+ */
+__attribute__((target("avx2")))
+static void rng_next_minmax_n_avx2(rng_t *rng, int range, int min, int *out, int count) {
+    __m256i max   = _mm256_set1_epi32(2147483647);
+    __m256d scale = _mm256_set1_pd(4.656612875245797e-10);
+    __m256d size  = _mm256_set1_pd((double)range);
+    __m128i add   = _mm_set1_epi32(min);
+
+    int i = 0;
+    while (i < count) {
+        int num  = rng->i_next + 1;
+        int num2 = rng->i_next_p + 1;
+
+        if (count - i < 8 || num > 48 || num2 > 48) {
+            out[i++] = (int)(rng_sample(rng) * (double)range) + min;
+            continue;
+        }
+
+        __m256i num3 = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *)(rng->seed_array + num)),
+                                        _mm256_loadu_si256((const __m256i *)(rng->seed_array + num2)));
+        num3         = _mm256_add_epi32(num3, _mm256_cmpeq_epi32(num3, max));
+        num3         = _mm256_add_epi32(num3, _mm256_and_si256(_mm256_srai_epi32(num3, 31), max));
+
+        _mm256_storeu_si256((__m256i *)(rng->seed_array + num), num3);
+
+        __m256d lo = _mm256_mul_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(num3)), scale), size);
+        __m256d hi = _mm256_mul_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(num3, 1)), scale), size);
 
-    return (int)((long)(get_sample_for_large_range() * (double)num2) + min);
+        _mm_storeu_si128((__m128i *)(out + i), _mm_add_epi32(_mm256_cvttpd_epi32(lo), add));
+        _mm_storeu_si128((__m128i *)(out + i + 4), _mm_add_epi32(_mm256_cvttpd_epi32(hi), add));
+
+        rng->i_next   = num + 7;
+        rng->i_next_p = num2 + 7;
+        i            += 8;
+    }
+}
+#endif /* RNG_LANES_AVX2  */
+
+/*
+ *    Gets a run of random numbers from a stream, the same ones count calls
+ *    to rng_next_minmax would return.
+ *
+ *    @param rng_t *rng      The stream.
+ *    @param int    min      The minimum value to return.
+ *    @param int    max      The maximum value, exclusive.
+ *    @param int   *out      The numbers between min and max.
+ *    @param int    count    The number of numbers to get.
+ */
+void rng_next_minmax_n(rng_t *rng, int min, int max, int *out, int count) {
+    if (min > max) {
+        int temp = min;
+        min = max;
+        max = temp;
+    }
+
+#ifdef RNG_LANES_AVX2
+    if ((long)max - min <= 2147483647 && rng_lanes_avx2()) {
+        rng_next_minmax_n_avx2(rng, max - min, min, out, count);
+        return;
+    }
+#endif /* RNG_LANES_AVX2  */
+
+    int i;
+    for (i = 0; i < count; ++i)
+        out[i] = rng_next_minmax(rng, min, max);
+}
+
+/*
+ *    Sets the seed for the random number generator.
+ *
+ *    @param int seed    The seed to use.
+ */
+void set_seed(int seed) {
+    rng_seed(&_rng, seed);
+}
+
+/*
+ *    Source code def: Sample
+ *
+ *    @return double    A random number between 0 and 1?
+ */
+double sample(void) {
+    return rng_sample(&_rng);
+}
+
+/*
+ *    Source code def: InternalSample
+ *
+ *    @return int    A random number between 0 and 2^32-1?
+ */
+int internal_sample(void) {
+    return rng_internal_sample(&_rng);
+}
+
+/*
+ *    Gets the sample for a larger range.
+ *
+ *    @return double    A random number between 0 and 1?
+ */
+double get_sample_for_large_range(void) {
+    return rng_sample_for_large_range(&_rng);
+}
+
+/*
+ *    Gets the next random number in the sequence.
+ *
+ *    @return int    A random number between 0 and 2^32-1.
+ */
+int next(void) {
+    return rng_next(&_rng);
+}
+
+/*
+ *    Gets the next random number in the sequence.
+ *
+ *    @param int min    The minimum value to return.
+ *    @param int max    The maximum value to return.
+ *    @return int       A random number between minValue and maxValue.
+ */
+int next_minmax(int min, int max) {
+    return rng_next_minmax(&_rng, min, max);
 }
 
 /*
@@ -149,7 +645,7 @@ int next_minmax(int min, int max) {
  *    @return int       A random number between 0 and maxValue.
  */
 int next_max(int max) {
-    return (int)(sample() * (double)max);
+    return rng_next_max(&_rng, max);
 }
 
 /*
@@ -159,12 +655,7 @@ int next_max(int max) {
  *    @param int length      The length of the buffer.
  */
 void next_bytes(char *buffer, int length) {
-    if (buffer == (char *)0x0)
-        return;
-
-    unsigned long i;
-    for (i = 0; i < length; ++i)
-        buffer[i] = (char)(internal_sample() % 256);
+    rng_next_bytes(&_rng, buffer, length);
 }
 
 /*
@@ -10,6 +10,160 @@
 #ifndef WLD_RAND_H
 #define WLD_RAND_H
 
+/*
+ *    The state of one random number stream, matching System.Random. The
+ *    functions without a context use a single global stream.
+ */
+typedef struct {
+    int i_next;
+    int i_next_p;
+    int seed_array[56];
+} rng_t;
+
+/*
+ *    Sets the seed of a random number stream.
+ *
+ *    @param rng_t *rng     The stream.
+ *    @param int    seed    The seed to use.
+ */
+void rng_seed(rng_t *rng, int seed);
+
+/*
+ *    Source code def: Sample
+ *
+ *    @param rng_t *rng    The stream.
+ *
+ *    @return double    A random number between 0 and 1.
+ */
+double rng_sample(rng_t *rng);
+
+/*
+ *    Source code def: InternalSample
+ *
+ *    @param rng_t *rng    The stream.
+ *
+ *    @return int    A random number between 0 and 2^31-2.
+ */
+int rng_internal_sample(rng_t *rng);
+
+/*
+ *    Gets the sample for a larger range.
+ *
+ *    @param rng_t *rng    The stream.
+ *
+ *    @return double    A random number between 0 and 1.
+ */
+double rng_sample_for_large_range(rng_t *rng);
+
+/*
+ *    Gets the next random number in a stream.
+ *
+ *    @param rng_t *rng    The stream.
+ *
+ *    @return int    A random number between 0 and 2^31-2.
+ */
+int rng_next(rng_t *rng);
+
+/*
+ *    Gets the next random number in a stream.
+ *
+ *    @param rng_t *rng    The stream.
+ *    @param int    min    The minimum value to return.
+ *    @param int    max    The maximum value, exclusive.
+ *
+ *    @return int    A random number between min and max.
+ */
+int rng_next_minmax(rng_t *rng, int min, int max);
+
+/*
+ *    Gets the next random number in a stream.
+ *
+ *    @param rng_t *rng    The stream.
+ *    @param int    max    The maximum value, exclusive.
+ *
+ *    @return int    A random number between 0 and max.
+ */
+int rng_next_max(rng_t *rng, int max);
+
+/*
+ *    Gets a run of random numbers from a stream, the same ones count calls
+ *    to rng_next_minmax would return.
+ *
+ *    @param rng_t *rng      The stream.
+ *    @param int    min      The minimum value to return.
+ *    @param int    max      The maximum value, exclusive.
+ *    @param int   *out      The numbers between min and max.
+ *    @param int    count    The number of numbers to get.
+ */
+void rng_next_minmax_n(rng_t *rng, int min, int max, int *out, int count);
+
+/*
+ *    Randomizes a byte array from a stream.
+ *
+ *    @param rng_t *rng       The stream.
+ *    @param char  *buffer    The buffer to randomize.
+ *    @param int    length    The length of the buffer.
+ */
+void rng_next_bytes(rng_t *rng, char *buffer, int length);
+
+#define RNG_LANES 8
+
+/*
+ *    The state of RNG_LANES independent streams advanced together, for
+ *    trying many seeds at once. Every stream takes the same number of
+ *    samples, so the indices are shared and the array is laid out with
+ *    the lanes of each entry next to each other.
+ */
+typedef struct {
+    int i_next;
+    int i_next_p;
+    int seed_array[56 * RNG_LANES] __attribute__((aligned(32)));
+} rng_lanes_t;
+
+/*
+ *    Sets the seeds of a group of streams.
+ *
+ *    @param rng_lanes_t *rng      The streams.
+ *    @param const int   *seeds    RNG_LANES seeds, one per stream.
+ */
+void rng_lanes_seed(rng_lanes_t *rng, const int *seeds);
+
+/*
+ *    Gets the next random number in every stream of a group.
+ *
+ *    @param rng_lanes_t *rng    The streams.
+ *    @param int         *out    RNG_LANES numbers between 0 and 2^31-2.
+ */
+void rng_lanes_next(rng_lanes_t *rng, int *out);
+
+/*
+ *    Gets the next random number in every stream of a group.
+ *
+ *    @param rng_lanes_t *rng    The streams.
+ *    @param int          max    The maximum value, exclusive.
+ *    @param int         *out    RNG_LANES numbers between 0 and max.
+ */
+void rng_lanes_next_max(rng_lanes_t *rng, int max, int *out);
+
+/*
+ *    Gets the next random number in every stream of a group.
+ *
+ *    @param rng_lanes_t *rng    The streams.
+ *    @param int          min    The minimum value to return.
+ *    @param int          max    The maximum value, exclusive.
+ *    @param int         *out    RNG_LANES numbers between min and max.
+ */
+void rng_lanes_next_minmax(rng_lanes_t *rng, int min, int max, int *out);
+
+/*
+ *    Copies one stream of a group out, to carry on with it alone.
+ *
+ *    @param rng_lanes_t *rng     The streams.
+ *    @param int          lane    The stream to copy.
+ *    @param rng_t       *out     The stream to copy to.
+ */
+void rng_lanes_extract(rng_lanes_t *rng, int lane, rng_t *out);
+
 /*
  *    Sets the seed for the random number generator.
  *
@@ -0,0 +1,174 @@
+/*
+ *    randbench.c    --    benchmark of the random number generator lanes
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 19, 2026
+ *
+ *    Seeds a range of seeds and takes a number of next_max samples from
+ *    each, once with an rng_t per seed and once with rng_lanes_t, and
+ *    prints the seeds per second of both. The lanes are checked against
+ *    rng_t first, so a fast but wrong build fails instead of reporting.
+ *
+ *        randbench [-s seeds] [-d draws]
+ *
+ *    The lanes use AVX2 where the CPU has it. To time the plain loops
+ *    the other CPUs use, build rand.c with -DRNG_LANES_SCALAR:
+ *
+ *        cc -O2 -o randbench randbench.c rand.c
+ *        cc -O2 -DRNG_LANES_SCALAR -o randbench_scalar randbench.c rand.c
+ */
+#include "rand.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ *    Returns the time on the monotonic clock.
+ *
+ *    @return double    The time in seconds.
+ */
+static double randbench_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ *    Checks that every lane matches an rng_t with the same seed, over
+ *    next, next_max and next_minmax, including ranges wider than an int.
+ *
+ *    @param int seeds    The number of seeds to check.
+ *
+ *    @return unsigned int    1 if they match, 0 if not.
+ */
+static unsigned int randbench_check(int seeds) {
+    rng_lanes_t lanes;
+    rng_t       one[RNG_LANES];
+    int         seed[RNG_LANES];
+    int         out[RNG_LANES];
+
+    int s;
+    int i;
+    int lane;
+    for (s = 0; s < seeds; s += RNG_LANES) {
+        for (lane = 0; lane < RNG_LANES; ++lane) {
+            seed[lane] = (int)((unsigned int)(s + lane) * 2654435761u);
+            rng_seed(&one[lane], seed[lane]);
+        }
+
+        rng_lanes_seed(&lanes, seed);
+
+        for (i = 0; i < 100; ++i) {
+            switch (i % 4) {
+            case 0:
+                rng_lanes_next(&lanes, out);
+                for (lane = 0; lane < RNG_LANES; ++lane)
+                    if (out[lane] != rng_next(&one[lane]))
+                        return 0;
+                break;
+            case 1:
+                rng_lanes_next_max(&lanes, 1 + i * 99991, out);
+                for (lane = 0; lane < RNG_LANES; ++lane)
+                    if (out[lane] != rng_next_max(&one[lane], 1 + i * 99991))
+                        return 0;
+                break;
+            case 2:
+                rng_lanes_next_minmax(&lanes, -i * 7, i * 13, out);
+                for (lane = 0; lane < RNG_LANES; ++lane)
+                    if (out[lane] != rng_next_minmax(&one[lane], -i * 7, i * 13))
+                        return 0;
+                break;
+            default:
+                rng_lanes_next_minmax(&lanes, -2000000000, 2000000000, out);
+                for (lane = 0; lane < RNG_LANES; ++lane)
+                    if (out[lane] != rng_next_minmax(&one[lane], -2000000000, 2000000000))
+                        return 0;
+                break;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/*
+ *    Entry.
+ *
+ *    @return int
+ *        0 on success, -1 on failure.
+ */
+int main(int argc, char **argv) {
+    int seeds = 1 << 20;
+    int draws = 300;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:d:")) != -1) {
+        switch (opt) {
+        case 's':
+            seeds = atoi(optarg);
+            break;
+        case 'd':
+            draws = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-s seeds] [-d draws]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    /* Whole groups of lanes, so both loops try the same seeds.  */
+    seeds -= seeds % RNG_LANES;
+
+    if (seeds <= 0 || draws <= 0) {
+        fprintf(stderr, "usage: %s [-s seeds] [-d draws]\n", argv[0]);
+        return -1;
+    }
+
+    if (!randbench_check(1 << 14)) {
+        fprintf(stderr, "rng_lanes_t does not match rng_t\n");
+        return -1;
+    }
+
+    /* Summed so the samples are not optimized away.  */
+    volatile int sink = 0;
+    int          out[RNG_LANES];
+    int          seed[RNG_LANES];
+
+    int s;
+    int i;
+    int lane;
+
+    double start = randbench_now();
+    for (s = 0; s < seeds; ++s) {
+        rng_t rng;
+
+        rng_seed(&rng, s);
+        for (i = 0; i < draws; ++i)
+            sink += rng_next_max(&rng, 6);
+    }
+    double one = randbench_now() - start;
+
+    start = randbench_now();
+    for (s = 0; s < seeds; s += RNG_LANES) {
+        rng_lanes_t lanes;
+
+        for (lane = 0; lane < RNG_LANES; ++lane)
+            seed[lane] = s + lane;
+
+        rng_lanes_seed(&lanes, seed);
+        for (i = 0; i < draws; ++i) {
+            rng_lanes_next_max(&lanes, 6, out);
+            sink += out[0];
+        }
+    }
+    double many = randbench_now() - start;
+
+    printf("%d seeds, %d next_max each\n", seeds, draws);
+    printf("  rng_t, one seed at a time    %.0f seeds/s\n", seeds / one);
+    printf("  rng_lanes_t                  %.0f seeds/s (%.2fx)\n", seeds / many, one / many);
+
+    return 0;
+}
@@ -0,0 +1,270 @@
+/*
+ *    runnerbench.c    --    benchmark of the TileRunner brush
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 19, 2026
+ *
+ *    Walks runners of 2 to 11 steps over a world, half placing and half
+ *    clearing tiles, for a few bands of brush strength, upper bounds
+ *    exclusive. Prints the stamps per second of gen_tile_runner and of
+ *    the plain brush it replaced, which is kept below as the reference.
+ *    Both run on their own copy of the world from the same stream, and
+ *    must leave the same tiles and stream behind, so a fast but wrong
+ *    build fails instead of reporting.
+ *
+ *        runnerbench [-w width] [-h height] [-n runners]
+ */
+#include "tilerunner.h"
+#include "tilestore.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ *    Returns the time on the monotonic clock.
+ *
+ *    @return double    The time in seconds.
+ */
+static double runnerbench_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ *    Source code def: TileRunner, as the game writes it, rolling a jitter
+ *    for every tile under each stamp. gen_tile_runner must match it.
+ *
+ *    @param gen_t         *gen         The generation.
+ *    @param int            i           The starting x coordinate.
+ *    @param int            j           The starting y coordinate.
+ *    @param double         strength    The starting size of the brush.
+ *    @param int            steps       The number of steps to walk.
+ *    @param short          type        The tile to place, -1 to clear tiles.
+ *    @param unsigned char  add         Whether to place tiles in empty space.
+ */
+static void runnerbench_reference(gen_t *gen, int i, int j, double strength, int steps, short type, unsigned char add) {
+    double size  = strength;
+    double left  = steps;
+    double pos_x = i;
+    double pos_y = j;
+    double vel_x = rng_next_minmax(&gen->rng, -10, 11) * 0.1;
+    double vel_y = rng_next_minmax(&gen->rng, -10, 11) * 0.1;
+
+    while (size > 0.0 && left > 0.0) {
+        size  = strength * (left / steps);
+        left -= 1.0;
+
+        int x0 = (int)(pos_x - size * 0.5);
+        int x1 = (int)(pos_x + size * 0.5);
+        int y0 = (int)(pos_y - size * 0.5);
+        int y1 = (int)(pos_y + size * 0.5);
+
+        if (x0 < 1)
+            x0 = 1;
+        if (x1 > gen->width - 1)
+            x1 = gen->width - 1;
+        if (y0 < 1)
+            y0 = 1;
+        if (y1 > gen->height - 1)
+            y1 = gen->height - 1;
+
+        int x;
+        int y;
+        for (x = x0; x < x1; ++x) {
+            for (y = y0; y < y1; ++y) {
+                double dist = (x > pos_x ? x - pos_x : pos_x - x) + (y > pos_y ? y - pos_y : pos_y - y);
+
+                if (dist >= strength * 0.5 * (1.0 + rng_next_minmax(&gen->rng, -10, 11) * 0.015))
+                    continue;
+
+                short tile = gen->tiles[x][y].tile;
+
+                if (type < 0) {
+                    if (tile != -1)
+                        gen_set_tile(gen, x, y, -1);
+                } else if (tile != type && (add || tile != -1)) {
+                    gen_set_tile(gen, x, y, type);
+                }
+            }
+        }
+
+        pos_x += vel_x;
+        pos_y += vel_y;
+        vel_x += rng_next_minmax(&gen->rng, -10, 11) * 0.05;
+        vel_y += rng_next_minmax(&gen->rng, -10, 11) * 0.05;
+
+        if (vel_x > 1.0)
+            vel_x = 1.0;
+        if (vel_x < -1.0)
+            vel_x = -1.0;
+        if (vel_y > 1.0)
+            vel_y = 1.0;
+        if (vel_y < -1.0)
+            vel_y = -1.0;
+    }
+}
+
+/*
+ *    Fills a world with air over stone, and points a generation at it.
+ *
+ *    @param wld_t *wld       The world, with its header sized.
+ *    @param gen_t *gen       The generation to fill.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int runnerbench_world(wld_t *wld, gen_t *gen) {
+    if (!tile_store_alloc(wld))
+        return 0;
+
+    int x;
+    int y;
+    for (x = 0; x < wld->header.width; ++x) {
+        memset(wld->tiles[x], 0, sizeof(tile_t) * wld->header.height);
+
+        for (y = 0; y < wld->header.height; ++y)
+            wld->tiles[x][y].tile = y > wld->header.height / 3 ? 1 : -1;
+    }
+
+    memset(gen, 0, sizeof(*gen));
+
+    gen->wld    = wld;
+    gen->tiles  = wld->tiles;
+    gen->width  = wld->header.width;
+    gen->height = wld->header.height;
+    gen->left   = 0;
+    gen->right  = wld->header.width;
+    gen->strip  = -1;
+
+    rng_seed(&gen->rng, 1);
+
+    return 1;
+}
+
+/*
+ *    Walks a band of runners with one brush.
+ *
+ *    @param gen_t        *gen          The generation.
+ *    @param unsigned int  reference    1 for the reference brush, 0 for gen_tile_runner.
+ *    @param int           runners      The number of runners.
+ *    @param int           min          The smallest strength.
+ *    @param int           max          The largest strength, exclusive.
+ *
+ *    @return unsigned long    The number of stamps.
+ */
+static unsigned long runnerbench_band(gen_t *gen, unsigned int reference, int runners, int min, int max) {
+    unsigned long stamps = 0;
+    rng_t         rng;
+
+    /* The runners come from their own stream, so both brushes get the same ones.  */
+    rng_seed(&rng, 3);
+
+    int i;
+    for (i = 0; i < runners; ++i) {
+        int   steps    = rng_next_minmax(&rng, 2, 12);
+        int   x        = rng_next_max(&rng, gen->width);
+        int   y        = rng_next_max(&rng, gen->height);
+        int   strength = rng_next_minmax(&rng, min, max);
+        short type     = rng_next_max(&rng, 2) ? 1 : -1;
+
+        if (reference)
+            runnerbench_reference(gen, x, y, strength, steps, type, 0);
+        else
+            gen_tile_runner(gen, x, y, strength, steps, type, 0, 0.0, 0.0);
+
+        stamps += steps;
+    }
+
+    return stamps;
+}
+
+/*
+ *    Entry.
+ *
+ *    @return int
+ *        0 on success, -1 on failure.
+ */
+int main(int argc, char **argv) {
+    static const int bands[][2] = {{3, 6}, {6, 20}, {20, 60}};
+
+    wld_t ref_wld;
+    wld_t new_wld;
+    gen_t ref;
+    gen_t gen;
+    int   runners = 200000;
+
+    memset(&ref_wld, 0, sizeof(ref_wld));
+    memset(&new_wld, 0, sizeof(new_wld));
+
+    ref_wld.header.width  = 4200;
+    ref_wld.header.height = 1200;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "w:h:n:")) != -1) {
+        switch (opt) {
+        case 'w':
+            ref_wld.header.width = atoi(optarg);
+            break;
+        case 'h':
+            ref_wld.header.height = atoi(optarg);
+            break;
+        case 'n':
+            runners = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-w width] [-h height] [-n runners]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    new_wld.header.width  = ref_wld.header.width;
+    new_wld.header.height = ref_wld.header.height;
+
+    if (ref_wld.header.width < 2 || ref_wld.header.height < 2 || runners <= 0) {
+        fprintf(stderr, "usage: %s [-w width] [-h height] [-n runners]\n", argv[0]);
+        return -1;
+    }
+
+    if (!runnerbench_world(&ref_wld, &ref) || !runnerbench_world(&new_wld, &gen)) {
+        fprintf(stderr, "Failed to allocate the worlds\n");
+        return -1;
+    }
+
+    printf("%d runners of 2-11 steps on a %dx%d world\n", runners, gen.width, gen.height);
+
+    unsigned int i;
+    for (i = 0; i < sizeof(bands) / sizeof(bands[0]); ++i) {
+        double        start    = runnerbench_now();
+        unsigned long stamps   = runnerbench_band(&ref, 1, runners, bands[i][0], bands[i][1]);
+        double        ref_time = runnerbench_now() - start;
+
+        start = runnerbench_now();
+        runnerbench_band(&gen, 0, runners, bands[i][0], bands[i][1]);
+        double new_time = runnerbench_now() - start;
+
+        if (memcmp(&ref.rng, &gen.rng, sizeof(rng_t)) != 0 || ref.touched != gen.touched) {
+            fprintf(stderr, "gen_tile_runner does not match the reference at strength %d-%d\n", bands[i][0], bands[i][1]);
+            return -1;
+        }
+
+        int x;
+        for (x = 0; x < gen.width; ++x) {
+            if (memcmp(ref.tiles[x], gen.tiles[x], sizeof(tile_t) * gen.height) != 0) {
+                fprintf(stderr, "gen_tile_runner does not match the reference at strength %d-%d\n", bands[i][0], bands[i][1]);
+                return -1;
+            }
+        }
+
+        printf("  strength %2d-%-2d  reference %.2fM stamps/s, gen_tile_runner %.2fM stamps/s (%.2fx)\n", bands[i][0], bands[i][1],
+               stamps / ref_time / 1e6, stamps / new_time / 1e6, ref_time / new_time);
+    }
+
+    tile_store_free(&ref_wld);
+    tile_store_free(&new_wld);
+
+    return 0;
+}
@@ -0,0 +1,118 @@
+/*
+ *    seedcli.c    --    seed search command line tool
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Searches a range of seeds for worlds matching a filter, printing
+ *    matching seeds to stdout as they are found and progress to stderr.
+ *
+ *        seedcli [-j threads] [-w width] [-h height] [-n limit] first last filter
+ *
+ *    For example, small crimson worlds with platinum:
+ *
+ *        seedcli 1 1000000 "crimson == 1 && gold_id == 169"
+ */
+#include "seedsearch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct {
+    unsigned long limit;
+    unsigned long found;
+} seedcli_t;
+
+/*
+ *    Prints a matching seed.
+ *
+ *    @param int                 seed      The seed.
+ *    @param const wld_header_t *header    The generated header.
+ *    @param void               *ctx       The tool state.
+ *
+ *    @return unsigned int    0 once the limit is reached, 1 otherwise.
+ */
+static unsigned int seedcli_match(int seed, const wld_header_t *header, void *ctx) {
+    seedcli_t *cli = (seedcli_t *)ctx;
+
+    (void)header;
+
+    printf("%d\n", seed);
+    fflush(stdout);
+
+    return cli->limit == 0 || ++cli->found < cli->limit;
+}
+
+/*
+ *    Prints the progress of the search.
+ *
+ *    @param const seed_search_progress_t *progress    The progress.
+ *    @param void                         *ctx         The tool state.
+ */
+static void seedcli_progress(const seed_search_progress_t *progress, void *ctx) {
+    (void)ctx;
+
+    fprintf(stderr, "\r%lu/%lu seeds (%.1f%%), %lu matches, %lu failed, %.0f seeds/s", progress->done, progress->total,
+            100.0 * progress->done / progress->total, progress->matches, progress->failed, progress->rate);
+}
+
+/*
+ *    Entry.
+ *
+ *    @return int
+ *        0 on success, -1 on failure.
+ */
+int main(int argc, char **argv) {
+    seed_search_t search = {0};
+    seedcli_t     cli    = {0};
+
+    search.width             = 4200;
+    search.height            = 1200;
+    search.match             = seedcli_match;
+    search.progress          = seedcli_progress;
+    search.progress_interval = 1.0;
+    search.ctx               = &cli;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "j:w:h:n:")) != -1) {
+        switch (opt) {
+        case 'j':
+            search.threads = atoi(optarg);
+            break;
+        case 'w':
+            search.width = atoi(optarg);
+            break;
+        case 'h':
+            search.height = atoi(optarg);
+            break;
+        case 'n':
+            cli.limit = strtoul(optarg, (char **)0x0, 10);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-j threads] [-w width] [-h height] [-n limit] first last filter\n", argv[0]);
+            return -1;
+        }
+    }
+
+    if (argc - optind != 3) {
+        fprintf(stderr, "usage: %s [-j threads] [-w width] [-h height] [-n limit] first last filter\n", argv[0]);
+        return -1;
+    }
+
+    search.first  = atoi(argv[optind]);
+    search.last   = atoi(argv[optind + 1]);
+    search.filter = seed_filter_parse(argv[optind + 2]);
+
+    if (search.filter == (const seed_filter_t *)0x0)
+        return -1;
+
+    seed_search_progress_t result;
+    unsigned int           ok = seed_search_run(&search, &result);
+
+    seedcli_progress(&result, &cli);
+    fprintf(stderr, "\n");
+
+    seed_filter_free((seed_filter_t *)search.filter);
+
+    return ok ? 0 : -1;
+}
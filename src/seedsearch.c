@@ -0,0 +1,540 @@
+/*
+ *    seedsearch.c    --    Source file for seed searches
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Defines the functions used to search a range of seeds. Filters are
+ *    parsed into a flat array of nodes, looking fields up in the header
+ *    field table once, so testing a header never touches a string. The
+ *    range is run on the thread pool in grains, and each worker generates
+ *    headers with its own generator state on its stack.
+ */
+#include "seedsearch.h"
+
+#include "log.h"
+#include "threadpool.h"
+#include "wldheaderfuncs.h"
+#include "worldgen.h"
+
+#include <ctype.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SEED_SEARCH_GRAIN 4096
+
+enum {
+    SEED_NODE_CMP,
+    SEED_NODE_AND,
+    SEED_NODE_OR,
+    SEED_NODE_NOT,
+};
+
+enum {
+    SEED_OP_EQ,
+    SEED_OP_NE,
+    SEED_OP_LT,
+    SEED_OP_LE,
+    SEED_OP_GT,
+    SEED_OP_GE,
+};
+
+typedef struct {
+    unsigned char             kind;
+    unsigned char             op;
+    const wld_header_field_t *field;
+    unsigned long             index;
+    double                    value;
+    int                       lhs;
+    int                       rhs;
+} seed_node_t;
+
+struct seed_filter_s {
+    seed_node_t *nodes;
+    int          count;
+    int          cap;
+    int          root;
+};
+
+typedef struct {
+    seed_filter_t *filter;
+    const char    *expr;
+    const char    *pos;
+} seed_parser_t;
+
+typedef struct {
+    const seed_search_t    *search;
+    pthread_mutex_t         lock;
+    seed_search_progress_t  progress;
+    double                  start;
+    double                  reported;
+    unsigned int            stop;
+} seed_search_state_t;
+
+static int seed_parse_or(seed_parser_t *parser);
+
+/*
+ *    Returns the time on the monotonic clock.
+ *
+ *    @return double    The time in seconds.
+ */
+static double seed_search_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ *    Logs a parse error with where in the expression it happened.
+ *
+ *    @param seed_parser_t *parser    The parser.
+ *    @param const char    *what      What was expected.
+ */
+static void seed_parse_error(seed_parser_t *parser, const char *what) {
+    VLOGF_ERR("Filter: expected %s at column %d of \"%s\".\n", what, (int)(parser->pos - parser->expr) + 1, parser->expr);
+}
+
+/*
+ *    Skips whitespace.
+ *
+ *    @param seed_parser_t *parser    The parser.
+ */
+static void seed_parse_space(seed_parser_t *parser) {
+    while (isspace((unsigned char)*parser->pos))
+        parser->pos++;
+}
+
+/*
+ *    Skips whitespace, then consumes a token if it is next.
+ *
+ *    @param seed_parser_t *parser    The parser.
+ *    @param const char    *token     The token.
+ *
+ *    @return unsigned int    1 if the token was consumed, 0 if not.
+ */
+static unsigned int seed_parse_accept(seed_parser_t *parser, const char *token) {
+    seed_parse_space(parser);
+
+    if (strncmp(parser->pos, token, strlen(token)) != 0)
+        return 0;
+
+    parser->pos += strlen(token);
+
+    return 1;
+}
+
+/*
+ *    Appends a node to a filter.
+ *
+ *    @param seed_filter_t     *filter    The filter.
+ *    @param const seed_node_t *node      The node.
+ *
+ *    @return int    The index of the node, -1 on failure.
+ */
+static int seed_filter_add(seed_filter_t *filter, const seed_node_t *node) {
+    if (filter->count == filter->cap) {
+        int          cap   = filter->cap ? filter->cap * 2 : 16;
+        seed_node_t *nodes = (seed_node_t *)realloc(filter->nodes, sizeof(seed_node_t) * cap);
+
+        if (nodes == (seed_node_t *)0x0) {
+            LOGF_ERR("Failed to allocate memory for filter.\n");
+            return -1;
+        }
+
+        filter->nodes = nodes;
+        filter->cap   = cap;
+    }
+
+    filter->nodes[filter->count] = *node;
+
+    return filter->count++;
+}
+
+/*
+ *    Parses a comparison, a negation or a bracketed expression.
+ *
+ *    @param seed_parser_t *parser    The parser.
+ *
+ *    @return int    The index of the node, -1 on failure.
+ */
+static int seed_parse_term(seed_parser_t *parser) {
+    seed_node_t node = {0};
+
+    if (seed_parse_accept(parser, "!")) {
+        node.kind = SEED_NODE_NOT;
+        node.lhs  = seed_parse_term(parser);
+
+        return node.lhs < 0 ? -1 : seed_filter_add(parser->filter, &node);
+    }
+
+    if (seed_parse_accept(parser, "(")) {
+        int inner = seed_parse_or(parser);
+
+        if (inner < 0)
+            return -1;
+
+        if (!seed_parse_accept(parser, ")")) {
+            seed_parse_error(parser, "')'");
+            return -1;
+        }
+
+        return inner;
+    }
+
+    seed_parse_space(parser);
+
+    const char *name = parser->pos;
+
+    while (isalnum((unsigned char)*parser->pos) || *parser->pos == '_')
+        parser->pos++;
+
+    char field[64];
+
+    if (parser->pos == name || (unsigned long)(parser->pos - name) >= sizeof(field)) {
+        parser->pos = name;
+        seed_parse_error(parser, "a field name");
+        return -1;
+    }
+
+    memcpy(field, name, parser->pos - name);
+    field[parser->pos - name] = '\0';
+
+    node.kind  = SEED_NODE_CMP;
+    node.field = wld_header_find_field(field);
+
+    if (node.field == (const wld_header_field_t *)0x0 || node.field->type == WLD_FIELD_STRING) {
+        parser->pos = name;
+        seed_parse_error(parser, "a numeric header field");
+        return -1;
+    }
+
+    if (seed_parse_accept(parser, "[")) {
+        char *end;
+        node.index = strtoul(parser->pos, &end, 10);
+
+        if (end == parser->pos) {
+            seed_parse_error(parser, "an index");
+            return -1;
+        }
+
+        parser->pos = end;
+
+        if (!seed_parse_accept(parser, "]")) {
+            seed_parse_error(parser, "']'");
+            return -1;
+        }
+
+        if (node.field->count != 0 && node.index >= node.field->count) {
+            seed_parse_error(parser, "an index inside the field");
+            return -1;
+        }
+    }
+
+    /* Two character operators go first, so "<=" is not read as "<".  */
+    if (seed_parse_accept(parser, "=="))
+        node.op = SEED_OP_EQ;
+    else if (seed_parse_accept(parser, "!="))
+        node.op = SEED_OP_NE;
+    else if (seed_parse_accept(parser, "<="))
+        node.op = SEED_OP_LE;
+    else if (seed_parse_accept(parser, ">="))
+        node.op = SEED_OP_GE;
+    else if (seed_parse_accept(parser, "<"))
+        node.op = SEED_OP_LT;
+    else if (seed_parse_accept(parser, ">"))
+        node.op = SEED_OP_GT;
+    else {
+        seed_parse_error(parser, "a comparison");
+        return -1;
+    }
+
+    seed_parse_space(parser);
+
+    char *end;
+    node.value = strtod(parser->pos, &end);
+
+    if (end == parser->pos) {
+        seed_parse_error(parser, "a number");
+        return -1;
+    }
+
+    parser->pos = end;
+
+    return seed_filter_add(parser->filter, &node);
+}
+
+/*
+ *    Parses terms joined by &&.
+ *
+ *    @param seed_parser_t *parser    The parser.
+ *
+ *    @return int    The index of the node, -1 on failure.
+ */
+static int seed_parse_and(seed_parser_t *parser) {
+    int lhs = seed_parse_term(parser);
+
+    while (lhs >= 0 && seed_parse_accept(parser, "&&")) {
+        seed_node_t node = {0};
+
+        node.kind = SEED_NODE_AND;
+        node.lhs  = lhs;
+        node.rhs  = seed_parse_term(parser);
+
+        lhs = node.rhs < 0 ? -1 : seed_filter_add(parser->filter, &node);
+    }
+
+    return lhs;
+}
+
+/*
+ *    Parses terms joined by && and ||, && binding tighter.
+ *
+ *    @param seed_parser_t *parser    The parser.
+ *
+ *    @return int    The index of the node, -1 on failure.
+ */
+static int seed_parse_or(seed_parser_t *parser) {
+    int lhs = seed_parse_and(parser);
+
+    while (lhs >= 0 && seed_parse_accept(parser, "||")) {
+        seed_node_t node = {0};
+
+        node.kind = SEED_NODE_OR;
+        node.lhs  = lhs;
+        node.rhs  = seed_parse_and(parser);
+
+        lhs = node.rhs < 0 ? -1 : seed_filter_add(parser->filter, &node);
+    }
+
+    return lhs;
+}
+
+/*
+ *    Parses a filter expression.
+ *
+ *    @param const char *expr    The expression.
+ *
+ *    @return seed_filter_t *    The filter, NULL if the expression is invalid.
+ */
+seed_filter_t *seed_filter_parse(const char *expr) {
+    if (expr == (const char *)0x0) {
+        LOGF_ERR("Filter expression is NULL.\n");
+        return (seed_filter_t *)0x0;
+    }
+
+    seed_filter_t *filter = (seed_filter_t *)calloc(1, sizeof(seed_filter_t));
+
+    if (filter == (seed_filter_t *)0x0) {
+        LOGF_ERR("Failed to allocate memory for filter.\n");
+        return (seed_filter_t *)0x0;
+    }
+
+    seed_parser_t parser = {filter, expr, expr};
+
+    filter->root = seed_parse_or(&parser);
+
+    seed_parse_space(&parser);
+
+    if (filter->root >= 0 && *parser.pos != '\0') {
+        seed_parse_error(&parser, "&&, || or the end");
+        filter->root = -1;
+    }
+
+    if (filter->root < 0) {
+        seed_filter_free(filter);
+        return (seed_filter_t *)0x0;
+    }
+
+    return filter;
+}
+
+/*
+ *    Tests a header against a node of a filter.
+ *
+ *    @param const seed_filter_t *filter    The filter.
+ *    @param int                  i         The node.
+ *    @param const wld_header_t  *header    The header to test.
+ *
+ *    @return unsigned int    1 if the header matches, 0 if not.
+ */
+static unsigned int seed_filter_eval(const seed_filter_t *filter, int i, const wld_header_t *header) {
+    const seed_node_t *node = &filter->nodes[i];
+
+    switch (node->kind) {
+    case SEED_NODE_AND:
+        return seed_filter_eval(filter, node->lhs, header) && seed_filter_eval(filter, node->rhs, header);
+    case SEED_NODE_OR:
+        return seed_filter_eval(filter, node->lhs, header) || seed_filter_eval(filter, node->rhs, header);
+    case SEED_NODE_NOT:
+        return !seed_filter_eval(filter, node->lhs, header);
+    default:
+        break;
+    }
+
+    /* Elements past the end of a heap array never match.  */
+    if (node->index >= wld_header_field_len(node->field, header))
+        return 0;
+
+    double value = wld_header_field_value(node->field, header, node->index);
+
+    switch (node->op) {
+    case SEED_OP_EQ:
+        return value == node->value;
+    case SEED_OP_NE:
+        return value != node->value;
+    case SEED_OP_LT:
+        return value < node->value;
+    case SEED_OP_LE:
+        return value <= node->value;
+    case SEED_OP_GT:
+        return value > node->value;
+    default:
+        return value >= node->value;
+    }
+}
+
+/*
+ *    Tests a header against a filter.
+ *
+ *    @param const seed_filter_t *filter    The filter.
+ *    @param const wld_header_t  *header    The header to test.
+ *
+ *    @return unsigned int    1 if the header matches, 0 if not.
+ */
+unsigned int seed_filter_match(const seed_filter_t *filter, const wld_header_t *header) {
+    return seed_filter_eval(filter, filter->root, header);
+}
+
+/*
+ *    Frees a filter.
+ *
+ *    @param seed_filter_t *filter    The filter to free.
+ */
+void seed_filter_free(seed_filter_t *filter) {
+    if (filter == (seed_filter_t *)0x0)
+        return;
+
+    free(filter->nodes);
+    free(filter);
+}
+
+/*
+ *    Counts finished seeds, and reports progress if it is time to. Called
+ *    with the state locked.
+ *
+ *    @param seed_search_state_t *state     The search.
+ *    @param unsigned long        done      The number of seeds just finished.
+ *    @param unsigned long        failed    How many of them failed to generate.
+ */
+static void seed_search_count(seed_search_state_t *state, unsigned long done, unsigned long failed) {
+    double now = seed_search_now();
+
+    state->progress.done   += done;
+    state->progress.failed += failed;
+    state->progress.elapsed = now - state->start;
+    state->progress.rate    = state->progress.elapsed > 0 ? state->progress.done / state->progress.elapsed : 0;
+
+    if (state->search->progress == (seed_search_progress_fn_t)0x0 || now - state->reported < state->search->progress_interval)
+        return;
+
+    state->reported = now;
+    state->search->progress(&state->progress, state->search->ctx);
+}
+
+/*
+ *    Searches a grain of seeds.
+ *
+ *    @param unsigned long  begin     The first seed, counted from the start of the range.
+ *    @param unsigned long  end       The end seed, exclusive.
+ *    @param unsigned int   worker    The worker.
+ *    @param void          *ctx       The search.
+ */
+static void seed_search_grain(unsigned long begin, unsigned long end, unsigned int worker, void *ctx) {
+    seed_search_state_t *state  = (seed_search_state_t *)ctx;
+    const seed_search_t *search = state->search;
+    wld_header_t         header;
+    char                 seed[16];
+    unsigned long        failed = 0;
+
+    (void)worker;
+
+    unsigned long i;
+    for (i = begin; i < end && !__atomic_load_n(&state->stop, __ATOMIC_RELAXED); ++i) {
+        int value = (int)((long)search->first + (long)i);
+
+        snprintf(seed, sizeof(seed), "%d", value);
+
+        /* A seed that fails to generate has no header to test, so it is counted and skipped.  */
+        if (wld_gen_header(&header, seed, search->width, search->height) != 0) {
+            failed++;
+            continue;
+        }
+
+        if (!seed_filter_match(search->filter, &header))
+            continue;
+
+        pthread_mutex_lock(&state->lock);
+
+        /* Another worker may have stopped the search while this one waited for the lock.  */
+        if (__atomic_load_n(&state->stop, __ATOMIC_RELAXED)) {
+            pthread_mutex_unlock(&state->lock);
+            break;
+        }
+
+        state->progress.matches++;
+
+        if (search->match != (seed_search_match_fn_t)0x0 && !search->match(value, &header, search->ctx))
+            __atomic_store_n(&state->stop, 1, __ATOMIC_RELAXED);
+
+        pthread_mutex_unlock(&state->lock);
+    }
+
+    pthread_mutex_lock(&state->lock);
+    seed_search_count(state, i - begin, failed);
+    pthread_mutex_unlock(&state->lock);
+}
+
+/*
+ *    Searches the seeds first to last, inclusive, on the thread pool. Each
+ *    seed is generated from its decimal string, like wld_new does.
+ *
+ *    @param const seed_search_t    *search    The search.
+ *    @param seed_search_progress_t *result    Filled with the final progress, may be NULL.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int seed_search_run(const seed_search_t *search, seed_search_progress_t *result) {
+    if (search == (const seed_search_t *)0x0 || search->filter == (const seed_filter_t *)0x0) {
+        LOGF_ERR("Search has no filter.\n");
+        return 0;
+    }
+
+    if (search->first > search->last) {
+        LOGF_ERR("Search range is empty.\n");
+        return 0;
+    }
+
+    seed_search_state_t state;
+
+    memset(&state, 0, sizeof(state));
+    pthread_mutex_init(&state.lock, (pthread_mutexattr_t *)0x0);
+
+    state.search         = search;
+    state.progress.total = (unsigned long)((long)search->last - search->first) + 1;
+    state.start          = seed_search_now();
+    state.reported       = state.start;
+
+    unsigned int ret = threadpool_for(0, state.progress.total, SEED_SEARCH_GRAIN, seed_search_grain, &state, search->threads);
+
+    if (result != (seed_search_progress_t *)0x0)
+        *result = state.progress;
+
+    pthread_mutex_destroy(&state.lock);
+
+    return ret;
+}
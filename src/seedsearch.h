@@ -0,0 +1,94 @@
+/*
+ *    seedsearch.h    --    Header file for seed searches
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Declares the functions used to search a range of seeds for worlds
+ *    whose generated header matches a filter. Filters are expressions over
+ *    the fields of wld_header_t, such as
+ *
+ *        crimson == 1 && iron_id == 167 && tree_styles[0] == 4
+ *
+ *    with ==, !=, <, <=, > and >= comparisons, && and ||, ! and brackets.
+ *    Headers are generated with wld_gen_header, so special seeds are
+ *    detected the same way as in wld_gen_world.
+ */
+#ifndef WLD_SEEDSEARCH_H
+#define WLD_SEEDSEARCH_H
+
+#include "wldheader.h"
+
+typedef struct seed_filter_s seed_filter_t;
+
+typedef struct {
+    unsigned long done;
+    unsigned long total;
+    unsigned long matches;
+    unsigned long failed;
+    double        elapsed;
+    double        rate;
+} seed_search_progress_t;
+
+/*
+ *    Called for every matching seed, one call at a time. The header and its
+ *    seed string are only valid during the call. Returning 0 stops the
+ *    search.
+ */
+typedef unsigned int (*seed_search_match_fn_t)(int seed, const wld_header_t *header, void *ctx);
+
+/*
+ *    Called every so often while a search runs, one call at a time.
+ */
+typedef void (*seed_search_progress_fn_t)(const seed_search_progress_t *progress, void *ctx);
+
+typedef struct {
+    int                        first;
+    int                        last;
+    int                        width;
+    int                        height;
+    unsigned int               threads;
+    const seed_filter_t       *filter;
+    seed_search_match_fn_t     match;
+    seed_search_progress_fn_t  progress;
+    double                     progress_interval;
+    void                      *ctx;
+} seed_search_t;
+
+/*
+ *    Parses a filter expression.
+ *
+ *    @param const char *expr    The expression.
+ *
+ *    @return seed_filter_t *    The filter, NULL if the expression is invalid.
+ */
+seed_filter_t *seed_filter_parse(const char *expr);
+
+/*
+ *    Tests a header against a filter.
+ *
+ *    @param const seed_filter_t *filter    The filter.
+ *    @param const wld_header_t  *header    The header to test.
+ *
+ *    @return unsigned int    1 if the header matches, 0 if not.
+ */
+unsigned int seed_filter_match(const seed_filter_t *filter, const wld_header_t *header);
+
+/*
+ *    Frees a filter.
+ *
+ *    @param seed_filter_t *filter    The filter to free.
+ */
+void seed_filter_free(seed_filter_t *filter);
+
+/*
+ *    Searches the seeds first to last, inclusive, on the thread pool. Each
+ *    seed is generated from its decimal string, like wld_new does.
+ *
+ *    @param const seed_search_t    *search    The search.
+ *    @param seed_search_progress_t *result    Filled with the final progress, may be NULL.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int seed_search_run(const seed_search_t *search, seed_search_progress_t *result);
+
+#endif /* WLD_SEEDSEARCH_H  */
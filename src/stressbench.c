@@ -0,0 +1,283 @@
+/*
+ *    stressbench.c    --    benchmark of loading and saving huge worlds
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 19, 2026
+ *
+ *    Saves a synthetic world far larger than the game makes, loads it
+ *    back, then streams it, and prints the time and peak memory of each.
+ *    The tiles are a pattern with no runs, so the file is about as large
+ *    as the grid, 14 bytes a tile, and the default 32000x4800 world puts
+ *    its section offsets past 2^31. Every tile is checked after the load
+ *    and through the stream, so a build that truncates offsets or sizes
+ *    fails instead of reporting.
+ *
+ *        stressbench [-i template] [-o output] [-w width] [-h height] [-m budget_mb]
+ *
+ *    The headers and sections after the tiles come from the template
+ *    world, world.wld by default. A save holds the grid and the encoded
+ *    file at once, as does a load, so the peak is about twice the grid:
+ *    4.3 GB at the default size, against a default budget of 4608 MB. A
+ *    peak over the budget fails the run. The output is removed at the end.
+ */
+#include "tilefuncs.h"
+#include "tilepalette.h"
+#include "tilestore.h"
+#include "wldlib.h"
+#include "wldstream.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#define STRESSBENCH_TILE 300
+
+/*
+ *    Returns the time on the monotonic clock.
+ *
+ *    @return double    The time in seconds.
+ */
+static double stressbench_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ *    Returns the peak memory of the process so far.
+ *
+ *    @return unsigned long    The peak resident set in megabytes.
+ */
+static unsigned long stressbench_peak_mb(void) {
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+
+    return usage.ru_maxrss / 1024;
+}
+
+/*
+ *    Returns the tile the synthetic world has at a position. Neighbours
+ *    always differ in u, so no two tiles encode as a run.
+ *
+ *    @param int x    The column of the tile.
+ *    @param int y    The row of the tile.
+ *
+ *    @return tile_t    The tile.
+ */
+static tile_t stressbench_tile(int x, int y) {
+    tile_t tile;
+
+    memset(&tile, 0, sizeof(tile));
+
+    tile.tile          = STRESSBENCH_TILE;
+    tile.u             = (x * 7 + y) & 0x7FFF;
+    tile.v             = y & 0x3FF;
+    tile.wall          = 256 + x % 50;
+    tile.liquid_type   = LIQUID_WATER;
+    tile.liquid_amount = 200;
+    tile.wiring        = WIRE_RED;
+    tile.tile_paint    = 1 + y % 30;
+    tile.wall_paint    = 2;
+
+    return tile;
+}
+
+/*
+ *    Counts the tiles of a streamed column that differ from the pattern.
+ *
+ *    @param void         *ctx       The count of differing tiles, an unsigned long.
+ *    @param int           x         The column.
+ *    @param const tile_t *tiles     The tiles of the column.
+ *    @param int           height    The number of tiles.
+ *
+ *    @return unsigned int    1 to keep reading.
+ */
+static unsigned int stressbench_column(void *ctx, int x, const tile_t *tiles, int height) {
+    unsigned long *bad = (unsigned long *)ctx;
+
+    int y;
+    for (y = 0; y < height; ++y)
+        if (!tile_compare(tiles[y], stressbench_tile(x, y)))
+            ++*bad;
+
+    return 1;
+}
+
+/*
+ *    Loads a world without writing tiles.png, as wld_open would.
+ *
+ *    @param const char *path    The world file.
+ *
+ *    @return wld_t *    The world, NULL on failure.
+ */
+static wld_t *stressbench_open(const char *path) {
+    wld_open_ctx_t *ctx = wld_open_begin(path);
+
+    if (ctx == (wld_open_ctx_t *)0x0)
+        return (wld_t *)0x0;
+
+    wld_open_step(ctx, 0);
+
+    return wld_open_end(ctx);
+}
+
+/*
+ *    Entry.
+ *
+ *    @return int
+ *        0 on success, -1 on failure.
+ */
+int main(int argc, char **argv) {
+    const char   *template = "world.wld";
+    const char   *output   = "stress.wld";
+    int           width    = 32000;
+    int           height   = 4800;
+    unsigned long budget   = 4608;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "i:o:w:h:m:")) != -1) {
+        switch (opt) {
+        case 'i':
+            template = optarg;
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        case 'w':
+            width = atoi(optarg);
+            break;
+        case 'h':
+            height = atoi(optarg);
+            break;
+        case 'm':
+            budget = strtoul(optarg, (char **)0x0, 10);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-i template] [-o output] [-w width] [-h height] [-m budget_mb]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    if (width < 1 || height < 1 || budget == 0) {
+        fprintf(stderr, "usage: %s [-i template] [-o output] [-w width] [-h height] [-m budget_mb]\n", argv[0]);
+        return -1;
+    }
+
+    wld_t *wld = stressbench_open(template);
+
+    if (wld == (wld_t *)0x0) {
+        fprintf(stderr, "Failed to open %s\n", template);
+        return -1;
+    }
+
+    if (wld->info.tilemask <= STRESSBENCH_TILE) {
+        fprintf(stderr, "%s is too old to have tile %d\n", template, STRESSBENCH_TILE);
+        wld_free(wld);
+        return -1;
+    }
+
+    /* The tiles are replaced, and tile uvs saved, so no two encode alike.  */
+    wld->info.uvs[STRESSBENCH_TILE / 8] |= 1 << (STRESSBENCH_TILE % 8);
+
+    free_tiles(wld);
+
+    wld->column_offsets = (unsigned long *)0x0;
+    wld->header.width   = width;
+    wld->header.height  = height;
+
+    if (!tile_store_alloc(wld)) {
+        fprintf(stderr, "Failed to allocate a %dx%d world\n", width, height);
+        wld_free(wld);
+        return -1;
+    }
+
+    int x;
+    int y;
+    for (x = 0; x < width; ++x)
+        for (y = 0; y < height; ++y)
+            wld->tiles[x][y] = stressbench_tile(x, y);
+
+    printf("%dx%d world, %.2f GB of tiles, budget %lu MB\n", width, height, (double)width * height * sizeof(tile_t) / 1e9, budget);
+
+    double       start = stressbench_now();
+    unsigned int ok    = wld_write(wld, output);
+    double       save  = stressbench_now() - start;
+
+    wld_free(wld);
+
+    if (!ok) {
+        fprintf(stderr, "Failed to save %s\n", output);
+        remove(output);
+        return -1;
+    }
+
+    FILE *fp  = fopen(output, "rb");
+    long  len = 0;
+
+    if (fp != (FILE *)0x0) {
+        fseek(fp, 0, SEEK_END);
+        len = ftell(fp);
+        fclose(fp);
+    }
+
+    printf("  save    %6.1fs  %.2f GB file, peak %lu MB\n", save, len / 1e9, stressbench_peak_mb());
+
+    start       = stressbench_now();
+    wld         = stressbench_open(output);
+    double load = stressbench_now() - start;
+
+    if (wld == (wld_t *)0x0) {
+        fprintf(stderr, "Failed to load %s\n", output);
+        remove(output);
+        return -1;
+    }
+
+    unsigned long bad = 0;
+
+    for (x = 0; x < width; ++x)
+        for (y = 0; y < height; ++y)
+            if (!tile_compare(tile_get(wld, x, y), stressbench_tile(x, y)))
+                ++bad;
+
+    printf("  load    %6.1fs  last section at %ld, peak %lu MB\n", load, wld->info.sections[wld->info.numsections - 1],
+           stressbench_peak_mb());
+
+    wld_free(wld);
+
+    wld_stream_callbacks_t cb;
+    unsigned long          streamed_bad = 0;
+
+    memset(&cb, 0, sizeof(cb));
+    cb.column = stressbench_column;
+
+    start         = stressbench_now();
+    ok            = wld_stream(output, &cb, &streamed_bad, 0);
+    double stream = stressbench_now() - start;
+
+    printf("  stream  %6.1fs  peak %lu MB\n", stream, stressbench_peak_mb());
+
+    remove(output);
+
+    if (!ok) {
+        fprintf(stderr, "Failed to stream %s\n", output);
+        return -1;
+    }
+
+    if (bad != 0 || streamed_bad != 0) {
+        fprintf(stderr, "%lu tiles differ after the load, %lu through the stream\n", bad, streamed_bad);
+        return -1;
+    }
+
+    if (stressbench_peak_mb() > budget) {
+        fprintf(stderr, "Peak of %lu MB is over the budget of %lu MB\n", stressbench_peak_mb(), budget);
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,270 @@
+/*
+ *    threadpool.c    --    Source file for the worker thread pool
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Defines the pool of worker threads the library runs parallel loops
+ *    on. Loops run one at a time. Each worker owns a counter over its part
+ *    of the range, in grains, and takes grains by adding to it. Stealing
+ *    is adding to another worker's counter, so a grain is only ever handed
+ *    out once and no locks are taken while a loop runs.
+ */
+#include "threadpool.h"
+
+#include "log.h"
+
+#include <malloc.h>
+#include <pthread.h>
+#include <unistd.h>
+
+typedef struct {
+    unsigned long next;
+    unsigned long end;
+} __attribute__((aligned(64))) threadpool_range_t;
+
+typedef struct {
+    pthread_mutex_t     lock;
+    pthread_cond_t      wake;
+    pthread_cond_t      done;
+    pthread_t           threads[THREADPOOL_MAX_THREADS];
+    unsigned int        count;
+    unsigned int        stop;
+    unsigned long       generation;
+    unsigned long       spawned;
+    unsigned int        active;
+    unsigned int        running;
+    unsigned long       begin;
+    unsigned long       end;
+    unsigned long       grain;
+    threadpool_fn_t     fn;
+    void               *ctx;
+    threadpool_range_t  ranges[THREADPOOL_MAX_THREADS];
+} threadpool_t;
+
+static threadpool_t _pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+};
+
+/* Held for the whole of a loop, so loops from different threads queue up.  */
+static pthread_mutex_t _pool_loop = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread unsigned int _pool_inside = 0;
+
+/*
+ *    Returns the number of workers a loop asking for a number of threads
+ *    can use, which is how many per worker results it needs.
+ *
+ *    @param unsigned int threads    The number of threads asked for, 0 for one per CPU.
+ *
+ *    @return unsigned int    The number of workers.
+ */
+unsigned int threadpool_workers(unsigned int threads) {
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads   = cpus > 0 ? cpus : 1;
+    }
+
+    return threads > THREADPOOL_MAX_THREADS ? THREADPOOL_MAX_THREADS : threads;
+}
+
+/*
+ *    Runs the grains of the current loop from one worker's part, then
+ *    steals from the others until every part is empty.
+ *
+ *    @param unsigned int worker    The worker.
+ */
+static void threadpool_run(unsigned int worker) {
+    unsigned int i;
+    for (i = 0; i < _pool.active; ++i) {
+        threadpool_range_t *range = &_pool.ranges[(worker + i) % _pool.active];
+
+        for (;;) {
+            unsigned long g = __atomic_fetch_add(&range->next, 1, __ATOMIC_RELAXED);
+
+            if (g >= range->end)
+                break;
+
+            unsigned long begin = _pool.begin + g * _pool.grain;
+            unsigned long end   = begin + _pool.grain;
+
+            _pool.fn(begin, end < _pool.end ? end : _pool.end, worker, _pool.ctx);
+        }
+    }
+}
+
+/*
+ *    The body of a pool thread, which waits for loops and works on them.
+ *
+ *    @param void *arg    The worker index of the thread.
+ *
+ *    @return void *    NULL.
+ */
+static void *threadpool_thread(void *arg) {
+    unsigned int  worker = (unsigned int)(unsigned long)arg;
+    unsigned long seen   = 0;
+
+    _pool_inside = 1;
+
+    /* The loop that started this thread may already be running, so wait from before it.  */
+    pthread_mutex_lock(&_pool.lock);
+    seen = _pool.spawned;
+
+    for (;;) {
+        while (_pool.generation == seen && !_pool.stop)
+            pthread_cond_wait(&_pool.wake, &_pool.lock);
+
+        if (_pool.stop)
+            break;
+
+        seen = _pool.generation;
+
+        if (worker >= _pool.active)
+            continue;
+
+        pthread_mutex_unlock(&_pool.lock);
+        threadpool_run(worker);
+        pthread_mutex_lock(&_pool.lock);
+
+        if (--_pool.running == 0)
+            pthread_cond_signal(&_pool.done);
+    }
+
+    pthread_mutex_unlock(&_pool.lock);
+
+    return (void *)0x0;
+}
+
+/*
+ *    Starts pool threads until there are enough for a number of workers.
+ *    Worker 0 is the thread running the loop, so it has no pool thread.
+ *
+ *    @param unsigned int workers    The number of workers wanted.
+ *
+ *    @return unsigned int    The number of workers available.
+ */
+static unsigned int threadpool_grow(unsigned int workers) {
+    pthread_mutex_lock(&_pool.lock);
+
+    _pool.spawned = _pool.generation;
+
+    while (_pool.count + 1 < workers) {
+        if (pthread_create(&_pool.threads[_pool.count], (pthread_attr_t *)0x0, threadpool_thread, (void *)(unsigned long)(_pool.count + 1)) != 0) {
+            VLOGF_WARN("Failed to start pool thread %u.\n", _pool.count + 1);
+            break;
+        }
+
+        _pool.count++;
+    }
+
+    unsigned int available = _pool.count + 1;
+
+    pthread_mutex_unlock(&_pool.lock);
+
+    return available < workers ? available : workers;
+}
+
+/*
+ *    Runs a function over a range in grains, in parallel. The calling
+ *    thread works as worker 0 and the call returns once every grain is
+ *    done. A loop started from inside another runs on the calling thread.
+ *
+ *    @param unsigned long    begin      The start of the range.
+ *    @param unsigned long    end        The end of the range, exclusive.
+ *    @param unsigned long    grain      The size of a grain, the last one may be shorter.
+ *    @param threadpool_fn_t  fn         The function to run.
+ *    @param void            *ctx        Passed to the function.
+ *    @param unsigned int     threads    The number of threads to use, 0 for one per CPU.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int threadpool_for(unsigned long begin, unsigned long end, unsigned long grain, threadpool_fn_t fn, void *ctx, unsigned int threads) {
+    if (fn == (threadpool_fn_t)0x0) {
+        LOGF_ERR("Loop function is NULL.\n");
+        return 0;
+    }
+
+    if (begin >= end)
+        return 1;
+
+    if (grain == 0)
+        grain = 1;
+
+    unsigned long grains  = (end - begin + grain - 1) / grain;
+    unsigned int  workers = threadpool_workers(threads);
+
+    if (workers > grains)
+        workers = grains;
+
+    if (workers == 1 || _pool_inside) {
+        unsigned long i;
+        for (i = begin; i < end; i += grain)
+            fn(i, end - i > grain ? i + grain : end, 0, ctx);
+
+        return 1;
+    }
+
+    pthread_mutex_lock(&_pool_loop);
+
+    workers = threadpool_grow(workers);
+
+    unsigned int w;
+    for (w = 0; w < workers; ++w) {
+        _pool.ranges[w].next = grains * w / workers;
+        _pool.ranges[w].end  = grains * (w + 1) / workers;
+    }
+
+    pthread_mutex_lock(&_pool.lock);
+
+    _pool.begin   = begin;
+    _pool.end     = end;
+    _pool.grain   = grain;
+    _pool.fn      = fn;
+    _pool.ctx     = ctx;
+    _pool.active  = workers;
+    _pool.running = workers - 1;
+    _pool.generation++;
+
+    pthread_cond_broadcast(&_pool.wake);
+    pthread_mutex_unlock(&_pool.lock);
+
+    _pool_inside = 1;
+    threadpool_run(0);
+    _pool_inside = 0;
+
+    pthread_mutex_lock(&_pool.lock);
+
+    while (_pool.running > 0)
+        pthread_cond_wait(&_pool.done, &_pool.lock);
+
+    pthread_mutex_unlock(&_pool.lock);
+    pthread_mutex_unlock(&_pool_loop);
+
+    return 1;
+}
+
+/*
+ *    Stops the worker threads. A later loop starts them again.
+ */
+void threadpool_shutdown(void) {
+    pthread_mutex_lock(&_pool_loop);
+    pthread_mutex_lock(&_pool.lock);
+
+    _pool.stop = 1;
+
+    pthread_cond_broadcast(&_pool.wake);
+    pthread_mutex_unlock(&_pool.lock);
+
+    unsigned int i;
+    for (i = 0; i < _pool.count; ++i)
+        pthread_join(_pool.threads[i], (void **)0x0);
+
+    pthread_mutex_lock(&_pool.lock);
+
+    _pool.count = 0;
+    _pool.stop  = 0;
+
+    pthread_mutex_unlock(&_pool.lock);
+    pthread_mutex_unlock(&_pool_loop);
+}
@@ -0,0 +1,56 @@
+/*
+ *    threadpool.h    --    Header file for the worker thread pool
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Declares the pool of worker threads the library runs parallel loops
+ *    on. The threads are started the first time they are needed and stay
+ *    around for later loops. A loop splits its range into one contiguous
+ *    part per worker, and a worker that finishes its part steals grains
+ *    from the others.
+ */
+#ifndef WLD_THREADPOOL_H
+#define WLD_THREADPOOL_H
+
+#define THREADPOOL_MAX_THREADS 256
+
+/*
+ *    Called for every grain of a loop. The worker index is below the
+ *    value of threadpool_workers for the loop, and a worker never runs
+ *    two grains at once, so it can index per worker results without
+ *    atomics.
+ */
+typedef void (*threadpool_fn_t)(unsigned long begin, unsigned long end, unsigned int worker, void *ctx);
+
+/*
+ *    Returns the number of workers a loop asking for a number of threads
+ *    can use, which is how many per worker results it needs.
+ *
+ *    @param unsigned int threads    The number of threads asked for, 0 for one per CPU.
+ *
+ *    @return unsigned int    The number of workers.
+ */
+unsigned int threadpool_workers(unsigned int threads);
+
+/*
+ *    Runs a function over a range in grains, in parallel. The calling
+ *    thread works as worker 0 and the call returns once every grain is
+ *    done. A loop started from inside another runs on the calling thread.
+ *
+ *    @param unsigned long    begin      The start of the range.
+ *    @param unsigned long    end        The end of the range, exclusive.
+ *    @param unsigned long    grain      The size of a grain, the last one may be shorter.
+ *    @param threadpool_fn_t  fn         The function to run.
+ *    @param void            *ctx        Passed to the function.
+ *    @param unsigned int     threads    The number of threads to use, 0 for one per CPU.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int threadpool_for(unsigned long begin, unsigned long end, unsigned long grain, threadpool_fn_t fn, void *ctx, unsigned int threads);
+
+/*
+ *    Stops the worker threads. A later loop starts them again.
+ */
+void threadpool_shutdown(void);
+
+#endif /* WLD_THREADPOOL_H  */
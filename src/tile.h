@@ -44,6 +44,56 @@ typedef struct {
     unsigned char wall_paint;
 } tile_t;
 
+#define TILE_CHUNK_COLUMNS 64
+
+/*
+ *    A mapping that tile chunks can live in, such as a world cache. It is
+ *    unmapped once the last chunk in it is released.
+ */
+typedef struct {
+    unsigned int  refs;
+    void         *base;
+    unsigned long len;
+} tile_map_t;
+
+/*
+ *    TILE_CHUNK_COLUMNS columns of tiles, stored one after the other and
+ *    shared between a world and its snapshots until one of them writes.
+ */
+typedef struct {
+    unsigned int  refs;
+    tile_map_t   *map;
+    tile_t       *tiles;
+} tile_chunk_t;
+
+/*
+ *    TILE_CHUNK_COLUMNS columns of palette indices, stored one after the
+ *    other and shared between a paletted world and its snapshots until
+ *    one of them writes.
+ */
+typedef struct {
+    unsigned int    refs;
+    unsigned short *cells;
+} tile_cell_chunk_t;
+
+/*
+ *    The distinct tiles of a world, and for every tile the index of its
+ *    value, kept in chunks of columns like the tiles themselves, with
+ *    cells[x] pointing at column x. Values are found again through an
+ *    open addressed table of index + 1, where 0 is empty.
+ */
+typedef struct {
+    tile_t             *values;
+    unsigned int        count;
+    unsigned int        cap;
+    unsigned int       *slots;
+    unsigned int        slot_mask;
+    int                 width;
+    int                 height;
+    tile_cell_chunk_t **chunks;
+    unsigned short    **cells;
+} tile_palette_t;
+
 static const unsigned int _tile_palette[] = {
     0x976b4b,
 };
\ No newline at end of file
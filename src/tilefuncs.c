@@ -23,6 +23,8 @@
 
 #include "log.h"
 #include "parseutil.h"
+#include "tilepalette.h"
+#include "tilestore.h"
 
 #include <malloc.h>
 #include <spng.h>
@@ -86,330 +88,592 @@ unsigned int tile_is_important(wld_t *wld, tile_t tile) {
 }
 
 /*
- *    Returns the list of tiles in the world.
+ *    Parses a single run of tiles from a buffer.
  *
- *    @param wld_t *wld    The world to get the tiles from.
+ *    @param wld_t         *wld     The world the tiles belong to.
+ *    @param unsigned char *buf     The buffer to parse from.
+ *    @param unsigned long *pos     The position to parse at, advanced past the run.
+ *    @param tile_t        *tile    The tile the run is made of.
+ *
+ *    @return unsigned int    The number of tiles in the run.
  */
-void get_tiles(wld_t *wld) {
-    if (wld == (wld_t *)0x0)
-        LOGF_ERR("world is NULL\n");
+unsigned int tile_parse_run(wld_t *wld, unsigned char *buf, unsigned long *pos, tile_t *tile) {
+    tile_t t = {0};
+    t.tile = -1;
+    t.wall = -1;
+
+    unsigned char  activeFlags     = 0;
+    unsigned char  tileFlagsLow    = 0;
+    unsigned char  tileFlagsHigh   = 0;
+    unsigned char  additionalFlags = 0;
+    short          tempWall        = 0;
+    unsigned short copies          = 0;
+
+    /* Read the first byte.  */
+    PARSE(buf, *pos, unsigned char, activeFlags);
+
+    /* If the first bit is set, read the next byte.  */
+    if (activeFlags & 1 << 0) {
+        PARSE(buf, *pos, unsigned char, tileFlagsLow);
+
+        /* If the second byte's first bit is set, read the next byte.  */
+        if (tileFlagsLow & 1 << 0) {
+            PARSE(buf, *pos, unsigned char, tileFlagsHigh);
+
+            /* If the third byte's first bit is set, read the next byte.  */
+            if (tileFlagsHigh & 1 << 0) {
+                PARSE(buf, *pos, unsigned char, additionalFlags);
+            }
+        }
+    }
 
-    /* Seek to the tile data.  */
-    filestream_seek(wld->file, wld->info.sections[1]);
+    /* Bit 1: Tile is present.  */
+    if (activeFlags & 1 << 1) {
+        /* Bit 5: Tile is 16 bits.  */
+        if (activeFlags & 1 << 5) {
+            PARSE(buf, *pos, unsigned short, t.tile);
+        } else {
+            PARSE(buf, *pos, unsigned char, t.tile);
+        }
 
-    wld->tiles = (tile_t **)malloc(sizeof(tile_t *) * wld->header.width);
-    if (wld->tiles == (tile_t **)0x0) {
-        LOGF_ERR("failed to allocate memory for tiles\n");
-        return;
+        /* If tile is important (lookup in info header), read texture UVs.  */
+        if (tile_is_important(wld, t)) {
+            PARSE(buf, *pos, short, t.u);
+            PARSE(buf, *pos, short, t.v);
+        }
+
+        /* High tile flags bit 3: Tile is painted.  */
+        if (tileFlagsHigh & 1 << 3) {
+            PARSE(buf, *pos, unsigned char, t.tile_paint);
+        }
     }
 
-    int x;
-    int y;
-    for (x = 0; x < wld->header.width; ++x) {
-        wld->tiles[x] = (tile_t *)malloc(sizeof(tile_t) * wld->header.height);
-        if (wld->tiles[x] == (tile_t *)0x0) {
-            VLOGF_ERR("failed to allocate memory for tile column %d\n", x);
-            return;
+    /* Bit 2: Wall is present.  */
+    if (activeFlags & 1 << 2) {
+        PARSE(buf, *pos, unsigned char, t.wall);
+        /* High tile flags bit 4: Wall is painted.  */
+
+        if (tileFlagsHigh & 1 << 4) {
+            PARSE(buf, *pos, unsigned char, t.wall_paint);
         }
+    }
 
-        for (y = 0; y < wld->header.height;) {
-            tile_t t = {0};
-            t.tile = -1;
-            t.wall = -1;
-
-            unsigned char activeFlags     = 0;
-            unsigned char tileFlagsLow    = 0;
-            unsigned char tileFlagsHigh   = 0;
-            unsigned char additionalFlags = 0;
-            short         tempWall        = 0;
-            short         copies          = 0;
-
-            /* Read the first byte.  */
-            PARSE(wld->file->buf, wld->file->pos, unsigned char, activeFlags);
-
-            /* If the first bit is set, read the next byte.  */
-            if (activeFlags & 1 << 0) {
-                PARSE(wld->file->buf, wld->file->pos, unsigned char, tileFlagsLow);
-
-                /* If the second byte's first bit is set, read the next byte.  */
-                if (tileFlagsLow & 1 << 0) {
-                    PARSE(wld->file->buf, wld->file->pos, unsigned char, tileFlagsHigh);
-
-                    /* If the third byte's first bit is set, read the next byte.  */
-                    if (tileFlagsHigh & 1 << 0) {
-                        PARSE(wld->file->buf, wld->file->pos, unsigned char, additionalFlags);
-                    }
-                }
-            }
+    /* Bits 3-4: Liquid is present, next byte is the liquid amount.  */
+    if (activeFlags & (1 << 3 | 1 << 4)) {
+        if (tileFlagsHigh & 1 << 8) 
+            t.liquid_type = LIQUID_SHIMMER;
+        else
+            t.liquid_type = (activeFlags & (1 << 3 | 1 << 4)) >> 3;
 
-            /* Bit 1: Tile is present.  */
-            if (activeFlags & 1 << 1) {
-                /* Bit 5: Tile is 16 bits.  */
-                if (activeFlags & 1 << 5) {
-                    PARSE(wld->file->buf, wld->file->pos, unsigned short, t.tile);
-                } else {
-                    PARSE(wld->file->buf, wld->file->pos, unsigned char, t.tile);
-                }
-
-                /* If tile is important (lookup in info header), read texture UVs.  */
-                if (tile_is_important(wld, t)) {
-                    PARSE(wld->file->buf, wld->file->pos, short, t.u);
-                    PARSE(wld->file->buf, wld->file->pos, short, t.v);
-                }
-
-                /* High tile flags bit 3: Tile is painted.  */
-                if (tileFlagsHigh & 1 << 3) {
-                    PARSE(wld->file->buf, wld->file->pos, unsigned char, t.tile_paint);
-                }
-            }
+        PARSE(buf, *pos, unsigned char, t.liquid_amount);
+    }
 
-            /* Bit 2: Wall is present.  */
-            if (activeFlags & 1 << 2) {
-                PARSE(wld->file->buf, wld->file->pos, unsigned char, t.wall);
-                /* High tile flags bit 4: Wall is painted.  */
+    /* Low tile flags bit 1: Red wire present.  */
+    if (tileFlagsLow & 1 << 1) {
+        t.wiring |= WIRE_RED;
+    }
 
-                if (tileFlagsHigh & 1 << 4) {
-                    PARSE(wld->file->buf, wld->file->pos, unsigned char, t.wall_paint);
-                }
-            }
+    /* Low tile flags bit 2: Blue wire present.  */
+    if (tileFlagsLow & 1 << 2) {
+        t.wiring |= WIRE_BLUE;
+    }
 
-            /* Bits 3-4: Liquid is present, next byte is the liquid amount.  */
-            if (activeFlags & (1 << 3 | 1 << 4)) {
-                if (tileFlagsHigh & 1 << 8) 
-                    t.liquid_type = LIQUID_SHIMMER;
-                else
-                    t.liquid_type = (activeFlags & (1 << 3 | 1 << 4)) >> 3;
+    /* Low tile flags bit 3: Green wire present.  */
+    if (tileFlagsLow & 1 << 3) {
+        t.wiring |= WIRE_GREEN;
+    }
 
-                PARSE(wld->file->buf, wld->file->pos, unsigned char, t.liquid_amount);
-            }
+    /* Low tile flags bits 4-6: Tile orientation.  */
+    if (tileFlagsLow & (1 << 4 | 1 << 5 | 1 << 6)) {
+        t.orientation = (tileFlagsLow & (1 << 4 | 1 << 5 | 1 << 6)) >> 4;
+    }
 
-            /* Low tile flags bit 1: Red wire present.  */
-            if (tileFlagsLow & 1 << 1) {
-                t.wiring |= WIRE_RED;
-            }
+    /* High tile flags bit 1: Actuator present.  */
+    if (tileFlagsHigh & 1 << 1) {
+        t.wiring |= WIRE_ACTUATOR;
+    }
 
-            /* Low tile flags bit 2: Blue wire present.  */
-            if (tileFlagsLow & 1 << 2) {
-                t.wiring |= WIRE_BLUE;
-            }
+    /* High tile flags bit 2: Actuator active.  */
+    if (tileFlagsHigh & 1 << 2) {
+        t.wiring |= WIRE_ACTIVE_ACTUATOR;
+    }
 
-            /* Low tile flags bit 3: Green wire present.  */
-            if (tileFlagsLow & 1 << 3) {
-                t.wiring |= WIRE_GREEN;
-            }
+    /* High tile flags bit 5: Yellow wire present.  */
+    if (tileFlagsHigh & 1 << 5) {
+        t.wiring |= WIRE_YELLOW;
+    }
 
-            /* Low tile flags bits 4-6: Tile orientation.  */
-            if (tileFlagsLow & (1 << 4 | 1 << 5 | 1 << 6)) {
-                t.orientation = (tileFlagsLow & (1 << 4 | 1 << 5 | 1 << 6)) >> 4;
-            }
+    /* High tile flags bit 6: Next byte is the 8 bit extension of wall id.  */
+    if (tileFlagsHigh & 1 << 6) {
+        PARSE(buf, *pos, unsigned char, tempWall);
+        t.wall |= tempWall << 8;
+    }
 
-            /* High tile flags bit 1: Actuator present.  */
-            if (tileFlagsHigh & 1 << 1) {
-                t.wiring |= WIRE_ACTUATOR;
-            }
+    /* Bits 6-7 = 1: [1,255] copies of the tile.  */
+    if ((activeFlags & (1 << 6 | 1 << 7)) >> 6 == 1) {
+        PARSE(buf, *pos, unsigned char, copies);
+    }
+    /* Bits 6-7 = 2: [1,65535] copies of the tile.  */
+    else if ((activeFlags & (1 << 6 | 1 << 7)) >> 6 == 2) {
+        PARSE(buf, *pos, unsigned short, copies);
+    }
 
-            /* High tile flags bit 2: Actuator active.  */
-            if (tileFlagsHigh & 1 << 2) {
-                t.wiring |= WIRE_ACTIVE_ACTUATOR;
-            }
+    *tile = t;
 
-            /* High tile flags bit 5: Yellow wire present.  */
-            if (tileFlagsHigh & 1 << 5) {
-                t.wiring |= WIRE_YELLOW;
-            }
+    return (unsigned int)copies + 1;
+}
 
-            /* High tile flags bit 6: Next byte is the 8 bit extension of wall id.  */
-            if (tileFlagsHigh & 1 << 6) {
-                PARSE(wld->file->buf, wld->file->pos, unsigned char, tempWall);
-                t.wall |= tempWall << 8;
-            }
+/*
+ *    Skips over a column of tiles in a buffer.
+ *
+ *    @param wld_t         *wld    The world the tiles belong to.
+ *    @param unsigned char *buf    The buffer to parse from.
+ *    @param unsigned long  pos    The position of the column.
+ *
+ *    @return unsigned long    The position of the next column.
+ */
+unsigned long tile_skip_column(wld_t *wld, unsigned char *buf, unsigned long pos) {
+    tile_t t;
+    int    y = 0;
 
-            /* Bits 6-7 = 1: [1,255] copies of the tile.  */
-            if ((activeFlags & (1 << 6 | 1 << 7)) >> 6 == 1) {
-                PARSE(wld->file->buf, wld->file->pos, unsigned char, copies);
-            }
-            /* Bits 6-7 = 2: [1,65535] copies of the tile.  */
-            else if ((activeFlags & (1 << 6 | 1 << 7)) >> 6 == 2) {
-                PARSE(wld->file->buf, wld->file->pos, short, copies);
+    while (y < wld->header.height)
+        y += tile_parse_run(wld, buf, &pos, &t);
+
+    return pos;
+}
+
+/*
+ *    Finds where each tile column starts in the world's file stream,
+ *    without decoding the tiles.
+ *
+ *    @param wld_t *wld    The world to scan.
+ *
+ *    @return unsigned long *    The column offsets, NULL on failure.
+ */
+unsigned long *tile_scan_columns(wld_t *wld) {
+    if (wld == (wld_t *)0x0 || wld->file == (filestream_t *)0x0) {
+        LOGF_ERR("world has no file stream\n");
+        return (unsigned long *)0x0;
+    }
+
+    if (wld->column_offsets != (unsigned long *)0x0)
+        return wld->column_offsets;
+
+    wld->column_offsets = (unsigned long *)malloc(sizeof(unsigned long) * (wld->header.width + 1));
+    if (wld->column_offsets == (unsigned long *)0x0) {
+        LOGF_ERR("failed to allocate memory for column offsets\n");
+        return (unsigned long *)0x0;
+    }
+
+    unsigned long pos = wld->info.sections[1];
+    int           x;
+    for (x = 0; x < wld->header.width; ++x) {
+        wld->column_offsets[x] = pos;
+        pos                    = tile_skip_column(wld, wld->file->buf, pos);
+    }
+
+    wld->column_offsets[x] = pos;
+
+    return wld->column_offsets;
+}
+
+/*
+ *    Starts decoding the tiles of a world, allocating them and seeking to
+ *    the tile section.
+ *
+ *    @param wld_t *wld    The world to decode the tiles of.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int get_tiles_begin(wld_t *wld) {
+    if (wld == (wld_t *)0x0) {
+        LOGF_ERR("world is NULL\n");
+        return 0;
+    }
+
+    /* Seek to the tile data.  */
+    filestream_seek(wld->file, wld->info.sections[1]);
+
+    if (tile_palette_enabled()) {
+        if (!tile_palette_alloc(wld)) {
+            LOGF_ERR("failed to allocate memory for tile palette\n");
+            return 0;
+        }
+    } else if (!tile_store_alloc(wld)) {
+        LOGF_ERR("failed to allocate memory for tiles\n");
+        return 0;
+    }
+
+    wld->column_offsets = (unsigned long *)malloc(sizeof(unsigned long) * (wld->header.width + 1));
+    if (wld->column_offsets == (unsigned long *)0x0) {
+        LOGF_ERR("failed to allocate memory for column offsets\n");
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ *    Decodes a column of tiles into the world's palette, looking each run
+ *    up once.
+ *
+ *    @param wld_t         *wld    The world to decode the tiles of.
+ *    @param int            x      The column to decode.
+ *    @param unsigned long *pos    The position of the column, advanced past it on success.
+ *
+ *    @return unsigned int    1 on success, 0 if the palette is full.
+ */
+static unsigned int get_tiles_column_palette(wld_t *wld, int x, unsigned long *pos) {
+    unsigned short *cells = wld->palette->cells[x];
+    unsigned long   at    = *pos;
+    int             y;
+
+    for (y = 0; y < wld->header.height;) {
+        tile_t         t;
+        unsigned short index;
+        unsigned int   count = tile_parse_run(wld, wld->file->buf, &at, &t);
+
+        if (!tile_palette_index(wld->palette, t, &index))
+            return 0;
+
+        unsigned int i;
+        for (i = 0; i < count && y < wld->header.height; ++i, ++y) {
+            cells[y] = index;
+        }
+    }
+
+    *pos = at;
+
+    return 1;
+}
+
+/*
+ *    Decodes a range of tile columns, which must follow the columns
+ *    already decoded. Columns are decoded into the world's palette if it
+ *    has one, and the world is expanded once the palette is full.
+ *
+ *    @param wld_t *wld      The world to decode the tiles of.
+ *    @param int    begin    The first column.
+ *    @param int    end      The column after the last, clamped to the width.
+ *
+ *    @return unsigned int    1 on success, 0 if a full palette could not be expanded.
+ */
+unsigned int get_tiles_columns(wld_t *wld, int begin, int end) {
+    unsigned long pos = wld->file->pos;
+    int           x;
+    int           y;
+
+    if (end > wld->header.width)
+        end = wld->header.width;
+
+    for (x = begin; x < end; ++x) {
+        wld->column_offsets[x] = pos;
+
+        if (wld->palette != (tile_palette_t *)0x0) {
+            if (get_tiles_column_palette(wld, x, &pos))
+                continue;
+
+            /* Columns before this one are expanded, and it is decoded again.  */
+            if (!tile_palette_expand(wld)) {
+                LOGF_ERR("failed to expand full tile palette\n");
+                return 0;
             }
+        }
+
+        for (y = 0; y < wld->header.height;) {
+            tile_t       t;
+            unsigned int count = tile_parse_run(wld, wld->file->buf, &pos, &t);
 
             /* Uncompress RLE.  */
-            int i;
-            for (i = 0; i <= copies && y < wld->header.height; ++i, ++y) {
+            unsigned int i;
+            for (i = 0; i < count && y < wld->header.height; ++i, ++y) {
                 wld->tiles[x][y] = t;
             }
         }
     }
 
+    wld->file->pos = pos;
+
+    return 1;
+}
+
+/*
+ *    Finishes decoding the tiles of a world, once every column is done.
+ *
+ *    @param wld_t *wld    The world to decode the tiles of.
+ */
+void get_tiles_end(wld_t *wld) {
+    wld->column_offsets[wld->header.width] = wld->file->pos;
+
     if (wld->file->pos != wld->info.sections[2]) {
-        VLOGF_WARN("tile section is not the expected length, diff = %d\n", wld->info.sections[2] - wld->file->pos);
+        VLOGF_WARN("tile section is not the expected length, diff = %ld\n", wld->info.sections[2] - (long)wld->file->pos);
     }
 }
 
 /*
- *    Returns the tile as a buffer.
+ *    Returns the list of tiles in the world.
  *
- *    @param wld_t *wld     The world to get the tile from.
- *    @param unsigned int   *size    The length of the buffer.
+ *    @param wld_t *wld    The world to get the tiles from.
  *
- *    @return char *    The tile as a buffer.
+ *    @return unsigned int    1 on success, 0 on failure.
  */
-char *tile_get_buffer(wld_t *wld, unsigned int *size) {
-    if (wld == (wld_t *)0x0) {
-        LOGF_ERR("world is NULL\n");
-        return (char *)0x0;
+unsigned int get_tiles(wld_t *wld) {
+    if (!get_tiles_begin(wld) || !get_tiles_columns(wld, 0, wld->header.width))
+        return 0;
+
+    get_tiles_end(wld);
+
+    return 1;
+}
+
+/*
+ *    Encodes a run of tiles.
+ *
+ *    @param wld_t        *wld       The world the tiles are from.
+ *    @param const tile_t *t         The tile the run is made of.
+ *    @param unsigned int  copies    The number of tiles in the run after the first.
+ *    @param char         *buf       The buffer to encode into.
+ *
+ *    @return unsigned int    The length of the encoded run, 0 on failure.
+ */
+static unsigned int tile_encode_run(wld_t *wld, const tile_t *t, unsigned int copies, char *buf) {
+    char        *out = buf;
+    unsigned int len = 0;
+
+    unsigned char activeFlags   = 0;
+    unsigned char tileFlagsLow  = 0;
+    unsigned char tileFlagsHigh = 0;
+    unsigned int  writeFlags    = 0;
+
+    /* Tile is present.  */
+    if (t->tile != -1) {
+        activeFlags |= 1 << 1;
+
+        /* Tile is 16 bits.  */
+        if (t->tile & 0xFF00) {
+            activeFlags |= 1 << 5;
+            writeFlags |= TILE_WRITE_TILE_ID16;
+        } else {
+            writeFlags |= TILE_WRITE_TILE_ID;
+        }
+
+        /* If tile is important (lookup in info header), write texture UVs.  */
+        if (tile_is_important(wld, *t))
+            writeFlags |= TILE_WRITE_TILE_UV;
+
+        /* Tile is painted.  */
+        if (t->tile_paint) {
+            tileFlagsHigh |= 1 << 3;
+            writeFlags |= TILE_WRITE_TILE_COLOR;
+        }
     }
-    if (size == (unsigned int *)0x0) {
-        LOGF_ERR("length is NULL\n");
-        return (char *)0x0;
+
+    /* Wall is present.  */
+    if (t->wall != -1) {
+        activeFlags |= 1 << 2;
+        writeFlags |= TILE_WRITE_WALL_ID;
+
+        /* Wall is 16 bits.  */
+        if (t->wall & 0xFF00) {
+            tileFlagsHigh |= 1 << 6;
+            writeFlags |= TILE_WRITE_WALL_ID16;
+        }
+
+        if (t->wall_paint) {
+            tileFlagsHigh |= 1 << 4;
+            writeFlags |= TILE_WRITE_WALL_COLOR;
+        }
     }
 
-    char *buf = (char *)malloc(wld->header.width * wld->header.height * 17 * sizeof(char));
-    if (buf == (char *)0x0) {
-        LOGF_ERR("failed to allocate memory for buffer\n");
-        return (char *)0x0;
+    if (t->orientation)
+        tileFlagsLow |= t->orientation << 4;
+
+    /* Liquid is present.  */
+    if (t->liquid_amount) {
+        activeFlags |= t->liquid_type << 3;
+        writeFlags |= TILE_WRITE_LIQUID_AMT;
+
+        if (t->liquid_type == LIQUID_SHIMMER)
+            tileFlagsHigh |= 1 << 8;
     }
 
-    unsigned int len = 0;
-    int          x;
-    int          y;
-    for (x = 0; x < wld->header.width; ++x) {
-        for (y = 0; y < wld->header.height; ++y) {
-            tile_t       *t             = &wld->tiles[x][y];
-            unsigned char activeFlags   = 0;
-            unsigned char tileFlagsLow  = 0;
-            unsigned char tileFlagsHigh = 0;
-            unsigned int  writeFlags    = 0;
-
-            /* Tile is present.  */
-            if (t->tile != -1) {
-                activeFlags |= 1 << 1;
-
-                /* Tile is 16 bits.  */
-                if (t->tile & 0xFF00) {
-                    activeFlags |= 1 << 5;
-                    writeFlags |= TILE_WRITE_TILE_ID16;
-                } else {
-                    writeFlags |= TILE_WRITE_TILE_ID;
-                }
-
-                /* If tile is important (lookup in info header), write texture UVs.  */
-                if (tile_is_important(wld, *t))
-                    writeFlags |= TILE_WRITE_TILE_UV;
-
-                /* Tile is painted.  */
-                if (t->tile_paint) {
-                    tileFlagsHigh |= 1 << 3;
-                    writeFlags |= TILE_WRITE_TILE_COLOR;
-                }
-            }
+    if (t->wiring & WIRE_RED)
+        tileFlagsLow |= 1 << 1;
 
-            /* Wall is present.  */
-            if (t->wall != -1) {
-                activeFlags |= 1 << 2;
-                writeFlags |= TILE_WRITE_WALL_ID;
-
-                /* Wall is 16 bits.  */
-                if (t->wall & 0xFF00) {
-                    tileFlagsHigh |= 1 << 6;
-                    writeFlags |= TILE_WRITE_WALL_ID16;
-                }
-
-                if (t->wall_paint) {
-                    tileFlagsHigh |= 1 << 4;
-                    writeFlags |= TILE_WRITE_WALL_COLOR;
-                }
-            }
+    if (t->wiring & WIRE_GREEN)
+        tileFlagsLow |= 1 << 3;
 
-            if (t->orientation)
-                tileFlagsLow |= t->orientation << 4;
+    if (t->wiring & WIRE_BLUE)
+        tileFlagsLow |= 1 << 2;
 
-            /* Liquid is present.  */
-            if (t->liquid_amount) {
-                activeFlags |= t->liquid_type << 3;
-                writeFlags |= TILE_WRITE_LIQUID_AMT;
+    if (t->wiring & WIRE_YELLOW)
+        tileFlagsHigh |= 1 << 5;
 
-                if (t->liquid_type == LIQUID_SHIMMER)
-                    tileFlagsHigh |= 1 << 8;
-            }
+    if (t->wiring & WIRE_ACTUATOR)
+        tileFlagsHigh |= 1 << 1;
 
-            if (t->wiring & WIRE_RED)
-                tileFlagsLow |= 1 << 1;
+    if (t->wiring & WIRE_ACTIVE_ACTUATOR)
+        tileFlagsHigh |= 1 << 2;
 
-            if (t->wiring & WIRE_GREEN)
-                tileFlagsLow |= 1 << 3;
+    if (tileFlagsHigh) {
+        tileFlagsLow |= 1 << 0;
+        writeFlags |= TILE_WRITE_TILE_FLAGS_HIGH;
+    }
 
-            if (t->wiring & WIRE_BLUE)
-                tileFlagsLow |= 1 << 2;
+    if (tileFlagsLow) {
+        activeFlags |= 1 << 0;
+        writeFlags |= TILE_WRITE_TILE_FLAGS_LOW;
+    }
 
-            if (t->wiring & WIRE_YELLOW)
-                tileFlagsHigh |= 1 << 5;
+    if (copies) {
+        if (copies > 0xFF) {
+            activeFlags |= 1 << 7;
+            writeFlags |= TILE_WRITE_COPIES16;
+        } else {
+            activeFlags |= 1 << 6;
+            writeFlags |= TILE_WRITE_COPIES;
+        }
+    }
 
-            if (t->wiring & WIRE_ACTUATOR)
-                tileFlagsHigh |= 1 << 1;
+    unsigned int ret = 0;
+
+    /* Write flags.  */
+    buf[len++] = activeFlags;
+    append_u8(&out, tileFlagsLow, &len, writeFlags, TILE_WRITE_TILE_FLAGS_LOW, &ret);
+    append_u8(&out, tileFlagsHigh, &len, writeFlags, TILE_WRITE_TILE_FLAGS_HIGH, &ret);
+    append_u8(&out, t->tile, &len, writeFlags, TILE_WRITE_TILE_ID, &ret);
+    append_u16(&out, t->tile, &len, writeFlags, TILE_WRITE_TILE_ID16, &ret);
+    append_u16(&out, t->u, &len, writeFlags, TILE_WRITE_TILE_UV, &ret);
+    append_u16(&out, t->v, &len, writeFlags, TILE_WRITE_TILE_UV, &ret);
+    append_u8(&out, t->tile_paint, &len, writeFlags, TILE_WRITE_TILE_COLOR, &ret);
+    append_u8(&out, t->wall & 0xFF, &len, writeFlags, TILE_WRITE_WALL_ID, &ret);
+    append_u8(&out, t->wall_paint, &len, writeFlags, TILE_WRITE_WALL_COLOR, &ret);
+    append_u8(&out, t->liquid_amount, &len, writeFlags, TILE_WRITE_LIQUID_AMT, &ret);
+    append_u8(&out, (unsigned char)((t->wall & 0xFF00) >> 8), &len, writeFlags, TILE_WRITE_WALL_ID16, &ret);
+    append_u8(&out, copies, &len, writeFlags, TILE_WRITE_COPIES, &ret);
+    append_u16(&out, copies, &len, writeFlags, TILE_WRITE_COPIES16, &ret);
+
+    if (ret != 0) {
+        LOGF_ERR("failed to write tile\n");
+        return 0;
+    }
 
-            if (t->wiring & WIRE_ACTIVE_ACTUATOR)
-                tileFlagsHigh |= 1 << 2;
+    return len;
+}
 
-            if (tileFlagsHigh) {
-                tileFlagsLow |= 1 << 0;
-                writeFlags |= TILE_WRITE_TILE_FLAGS_HIGH;
-            }
+/*
+ *    Encodes a column of tiles.
+ *
+ *    @param wld_t        *wld       The world the column is from.
+ *    @param const tile_t *column    The column, header.height tiles long.
+ *    @param char         *buf       The buffer, at least TILE_COLUMN_MAX(header.height) bytes long.
+ *
+ *    @return unsigned int    The length of the encoded column, 0 on failure.
+ */
+unsigned int tile_encode_column(wld_t *wld, const tile_t *column, char *buf) {
+    unsigned int len    = 0;
+    unsigned int height = wld->header.height;
+    unsigned int y;
 
-            if (tileFlagsLow) {
-                activeFlags |= 1 << 0;
-                writeFlags |= TILE_WRITE_TILE_FLAGS_LOW;
-            }
+    for (y = 0; y < height; ++y) {
+        /* Tile is copied.  */
+        unsigned int copies = 0;
+        while (y + copies + 1 < height && tile_compare(column[y + copies + 1], column[y]))
+            ++copies;
 
-            /* Tile is copied.  */
-            unsigned int copies = 0;
-            for (int i = 1; y < wld->header.height; ++i) {
-                if (tile_compare(wld->tiles[x][y + i], *t)) {
-                    ++copies;
-                } else {
-                    y += i - 1;
-                    break;
-                }
-            }
+        unsigned int run = tile_encode_run(wld, &column[y], copies, buf + len);
 
-            if (copies) {
-                if (copies > 0xFF) {
-                    activeFlags |= 1 << 7;
-                    writeFlags |= TILE_WRITE_COPIES16;
-                } else {
-                    activeFlags |= 1 << 6;
-                    writeFlags |= TILE_WRITE_COPIES;
-                }
-            }
+        if (run == 0)
+            return 0;
 
-            unsigned int ret = 0;
-
-            /* Write flags.  */
-            buf[len++] = activeFlags;
-            append_u8(&buf, tileFlagsLow, &len, writeFlags, TILE_WRITE_TILE_FLAGS_LOW, &ret);
-            append_u8(&buf, tileFlagsHigh, &len, writeFlags, TILE_WRITE_TILE_FLAGS_HIGH, &ret);
-            append_u8(&buf, t->tile, &len, writeFlags, TILE_WRITE_TILE_ID, &ret);
-            append_u16(&buf, t->tile, &len, writeFlags, TILE_WRITE_TILE_ID16, &ret);
-            append_u16(&buf, t->u, &len, writeFlags, TILE_WRITE_TILE_UV, &ret);
-            append_u16(&buf, t->v, &len, writeFlags, TILE_WRITE_TILE_UV, &ret);
-            append_u8(&buf, t->tile_paint, &len, writeFlags, TILE_WRITE_TILE_COLOR, &ret);
-            append_u8(&buf, t->wall & 0xFF, &len, writeFlags, TILE_WRITE_WALL_ID, &ret);
-            append_u8(&buf, t->wall_paint, &len, writeFlags, TILE_WRITE_WALL_COLOR, &ret);
-            append_u8(&buf, t->liquid_amount, &len, writeFlags, TILE_WRITE_LIQUID_AMT, &ret);
-            append_u8(&buf, (unsigned char)((t->wall & 0xFF00) >> 8), &len, writeFlags, TILE_WRITE_WALL_ID16, &ret);
-            append_u8(&buf, copies, &len, writeFlags, TILE_WRITE_COPIES, &ret);
-            append_u16(&buf, copies, &len, writeFlags, TILE_WRITE_COPIES16, &ret);
-
-            if (ret != 0) {
-                LOGF_ERR("failed to write tile\n");
-                free(buf);
-                return (char *)0x0;
-            }
+        len += run;
+        y += copies;
+    }
+
+    return len;
+}
+
+/*
+ *    Encodes a column of palette indices. Cells hold the same tile exactly
+ *    when they hold the same index, so runs are found by comparing them.
+ *
+ *    @param wld_t                *wld      The world the column is from.
+ *    @param const unsigned short *cells    The column, header.height indices long.
+ *    @param char                 *buf      The buffer, at least TILE_COLUMN_MAX(header.height) bytes long.
+ *
+ *    @return unsigned int    The length of the encoded column, 0 on failure.
+ */
+static unsigned int tile_encode_column_indices(wld_t *wld, const unsigned short *cells, char *buf) {
+    unsigned int len    = 0;
+    unsigned int height = wld->header.height;
+    unsigned int y;
+
+    for (y = 0; y < height; ++y) {
+        /* Tile is copied.  */
+        unsigned int copies = 0;
+        while (y + copies + 1 < height && cells[y + copies + 1] == cells[y])
+            ++copies;
+
+        unsigned int run = tile_encode_run(wld, &wld->palette->values[cells[y]], copies, buf + len);
+
+        if (run == 0)
+            return 0;
+
+        len += run;
+        y += copies;
+    }
+
+    return len;
+}
+
+/*
+ *    Returns the tile as a buffer.
+ *
+ *    @param wld_t *wld     The world to get the tile from.
+ *    @param unsigned long  *size    The length of the buffer.
+ *
+ *    @return char *    The tile as a buffer.
+ */
+char *tile_get_buffer(wld_t *wld, unsigned long *size) {
+    if (wld == (wld_t *)0x0) {
+        LOGF_ERR("world is NULL\n");
+        return (char *)0x0;
+    }
+    if (size == (unsigned long *)0x0) {
+        LOGF_ERR("length is NULL\n");
+        return (char *)0x0;
+    }
+
+    /* Only the pages the columns are encoded into are ever touched.  */
+    char *buf = (char *)malloc((unsigned long)wld->header.width * TILE_COLUMN_MAX((unsigned long)wld->header.height) * sizeof(char));
+    if (buf == (char *)0x0) {
+        LOGF_ERR("failed to allocate memory for buffer\n");
+        return (char *)0x0;
+    }
+
+    unsigned long len = 0;
+    int           x;
+    for (x = 0; x < wld->header.width; ++x) {
+        unsigned int column;
+
+        if (wld->palette != (tile_palette_t *)0x0)
+            column = tile_encode_column_indices(wld, wld->palette->cells[x], buf + len);
+        else
+            column = tile_encode_column(wld, wld->tiles[x], buf + len);
+
+        if (column == 0) {
+            free(buf);
+            return (char *)0x0;
         }
+
+        len += column;
     }
     *size = len;
 
-    return buf;
+    /* Give back the worst case the columns did not use.  */
+    char *fit = (char *)realloc(buf, len > 0 ? len : 1);
+
+    return fit != (char *)0x0 ? fit : buf;
 }
 
 /*
@@ -476,11 +740,8 @@ void free_tiles(wld_t *wld) {
     if (wld == (wld_t *)0x0)
         LOGF_WARN("world is NULL\n");
 
-    int x;
-    for (x = 0; x < wld->header.width; ++x)
-        free(wld->tiles[x]);
-
-    free(wld->tiles);
+    tile_store_free(wld);
+    free(wld->column_offsets);
 }
 
 /*
@@ -514,10 +775,13 @@ unsigned int dump_tiles_png(wld_t *wld, char *path) {
     int y;
     for (x = 0; x < wld->header.width; ++x) {
         for (y = 0; y < wld->header.height; ++y) {
-            pBuf[(y * wld->header.width + x) * 4 + 0] = wld->tiles[x][y].tile;
-            pBuf[(y * wld->header.width + x) * 4 + 1] = wld->tiles[x][y].tile;
-            pBuf[(y * wld->header.width + x) * 4 + 2] = wld->tiles[x][y].tile;
-            pBuf[(y * wld->header.width + x) * 4 + 3] = 255;
+            unsigned long i    = ((unsigned long)y * wld->header.width + x) * 4;
+            tile_t        tile = tile_get(wld, x, y);
+
+            pBuf[i + 0] = tile.tile;
+            pBuf[i + 1] = tile.tile;
+            pBuf[i + 2] = tile.tile;
+            pBuf[i + 3] = 255;
         }
     }
 
@@ -10,6 +10,12 @@
 
 #include "tile.h"
 #include "wld.h"
+
+/*
+ *    The most bytes a column of a given height can take encoded.
+ */
+#define TILE_COLUMN_MAX(height) ((height) * 17)
+
 /*
  *    Compares two tiles.
  *
@@ -30,22 +36,97 @@ unsigned int tile_compare(tile_t t0, tile_t t1);
  */
 unsigned int tile_is_important(wld_t *wld, tile_t tile);
 
+/*
+ *    Parses a single run of tiles from a buffer.
+ *
+ *    @param wld_t         *wld     The world the tiles belong to.
+ *    @param unsigned char *buf     The buffer to parse from.
+ *    @param unsigned long *pos     The position to parse at, advanced past the run.
+ *    @param tile_t        *tile    The tile the run is made of.
+ *
+ *    @return unsigned int    The number of tiles in the run.
+ */
+unsigned int tile_parse_run(wld_t *wld, unsigned char *buf, unsigned long *pos, tile_t *tile);
+
+/*
+ *    Skips over a column of tiles in a buffer.
+ *
+ *    @param wld_t         *wld    The world the tiles belong to.
+ *    @param unsigned char *buf    The buffer to parse from.
+ *    @param unsigned long  pos    The position of the column.
+ *
+ *    @return unsigned long    The position of the next column.
+ */
+unsigned long tile_skip_column(wld_t *wld, unsigned char *buf, unsigned long pos);
+
+/*
+ *    Finds where each tile column starts in the world's file stream,
+ *    without decoding the tiles.
+ *
+ *    @param wld_t *wld    The world to scan.
+ *
+ *    @return unsigned long *    The column offsets, NULL on failure.
+ */
+unsigned long *tile_scan_columns(wld_t *wld);
+
+/*
+ *    Starts decoding the tiles of a world, allocating them and seeking to
+ *    the tile section.
+ *
+ *    @param wld_t *wld    The world to decode the tiles of.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int get_tiles_begin(wld_t *wld);
+
+/*
+ *    Decodes a range of tile columns, which must follow the columns
+ *    already decoded.
+ *
+ *    @param wld_t *wld      The world to decode the tiles of.
+ *    @param int    begin    The first column.
+ *    @param int    end      The column after the last, clamped to the width.
+ *
+ *    @return unsigned int    1 on success, 0 if a full palette could not be expanded.
+ */
+unsigned int get_tiles_columns(wld_t *wld, int begin, int end);
+
+/*
+ *    Finishes decoding the tiles of a world, once every column is done.
+ *
+ *    @param wld_t *wld    The world to decode the tiles of.
+ */
+void get_tiles_end(wld_t *wld);
+
 /*
  *    Returns the list of tiles in the world.
  *
  *    @param wld_t *wld    The world to get the tiles from.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int get_tiles(wld_t *wld);
+
+/*
+ *    Encodes a column of tiles.
+ *
+ *    @param wld_t        *wld       The world the column is from.
+ *    @param const tile_t *column    The column, header.height tiles long.
+ *    @param char         *buf       The buffer, at least TILE_COLUMN_MAX(header.height) bytes long.
+ *
+ *    @return unsigned int    The length of the encoded column, 0 on failure.
  */
-void get_tiles(wld_t *wld);
+unsigned int tile_encode_column(wld_t *wld, const tile_t *column, char *buf);
 
 /*
  *    Returns the tile as a buffer.
  *
  *    @param wld_t *wld     The world to get the tile from.
- *    @param unsigned int   *size    The length of the buffer.
+ *    @param unsigned long  *size    The length of the buffer.
  *
  *    @return char *    The tile as a buffer.
  */
-char *tile_get_buffer(wld_t *wld, unsigned int *size);
+char *tile_get_buffer(wld_t *wld, unsigned long *size);
 
 /*
  *    Appends a unsigned char to the buffer.
@@ -0,0 +1,493 @@
+/*
+ *    tilepalette.c    --    Source file for palette compressed tiles
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Defines the functions used to keep a world's tiles as indices into a
+ *    palette. Since tile_t has no padding, two tiles are equal exactly
+ *    when their bytes are, so tiles are hashed and compared as bytes, and
+ *    two cells hold the same tile exactly when they hold the same index.
+ */
+#include "tilepalette.h"
+
+#include "hash.h"
+#include "log.h"
+#include "tilestore.h"
+
+#include <malloc.h>
+#include <string.h>
+
+#define TILE_PALETTE_MIN 256
+
+static unsigned int _palette_enabled = 0;
+
+/*
+ *    Enables or disables decoding tiles into a palette. Disabled by
+ *    default. Worlds loaded from the cache are never paletted.
+ *
+ *    @param unsigned int enabled    1 to enable, 0 to disable.
+ */
+void tile_palette_set_enabled(unsigned int enabled) {
+    _palette_enabled = enabled != 0;
+}
+
+/*
+ *    Returns whether tiles are decoded into a palette.
+ *
+ *    @return unsigned int    1 if enabled, 0 if not.
+ */
+unsigned int tile_palette_enabled(void) {
+    return _palette_enabled;
+}
+
+/*
+ *    Resizes the values of a palette, and rebuilds its table to twice
+ *    their number of slots.
+ *
+ *    @param tile_palette_t *palette    The palette.
+ *    @param unsigned int    cap        The number of values to hold.
+ *
+ *    @return unsigned int    1 on success, 0 on failure, in which case the palette is left alone.
+ */
+static unsigned int tile_palette_reserve(tile_palette_t *palette, unsigned int cap) {
+    tile_t       *values = (tile_t *)realloc(palette->values, sizeof(tile_t) * cap);
+    unsigned int *slots  = (unsigned int *)calloc(cap * 2, sizeof(unsigned int));
+
+    if (values == (tile_t *)0x0 || slots == (unsigned int *)0x0) {
+        LOGF_ERR("Failed to allocate memory for palette.\n");
+        if (values != (tile_t *)0x0)
+            palette->values = values;
+        free(slots);
+        return 0;
+    }
+
+    unsigned int mask = cap * 2 - 1;
+    unsigned int i;
+    for (i = 0; i < palette->count; ++i) {
+        unsigned int slot = (unsigned int)hash_fnv1a(&values[i], sizeof(tile_t)) & mask;
+
+        while (slots[slot] != 0)
+            slot = (slot + 1) & mask;
+
+        slots[slot] = i + 1;
+    }
+
+    free(palette->slots);
+
+    palette->values    = values;
+    palette->cap       = cap;
+    palette->slots     = slots;
+    palette->slot_mask = mask;
+
+    return 1;
+}
+
+/*
+ *    Returns the number of chunks a palette's cells are split into.
+ *
+ *    @param const tile_palette_t *palette    The palette.
+ *
+ *    @return int    The number of chunks.
+ */
+static int tile_palette_chunk_count(const tile_palette_t *palette) {
+    return (palette->width + TILE_CHUNK_COLUMNS - 1) / TILE_CHUNK_COLUMNS;
+}
+
+/*
+ *    Returns the number of cells in a chunk.
+ *
+ *    @param const tile_palette_t *palette    The palette.
+ *    @param int                   c          The chunk.
+ *
+ *    @return unsigned long    The number of cells in the chunk.
+ */
+static unsigned long tile_palette_chunk_len(const tile_palette_t *palette, int c) {
+    int columns = palette->width - c * TILE_CHUNK_COLUMNS;
+
+    if (columns > TILE_CHUNK_COLUMNS)
+        columns = TILE_CHUNK_COLUMNS;
+
+    return (unsigned long)columns * palette->height;
+}
+
+/*
+ *    Points the columns of a chunk at its cells.
+ *
+ *    @param tile_palette_t *palette    The palette.
+ *    @param int             c          The chunk.
+ */
+static void tile_palette_point(tile_palette_t *palette, int c) {
+    unsigned short *cells = palette->chunks[c]->cells;
+
+    int x;
+    for (x = c * TILE_CHUNK_COLUMNS; x < palette->width && x < (c + 1) * TILE_CHUNK_COLUMNS; ++x)
+        palette->cells[x] = cells + (unsigned long)(x - c * TILE_CHUNK_COLUMNS) * palette->height;
+}
+
+/*
+ *    Allocates the column and chunk tables of a palette, sized by its
+ *    width and height.
+ *
+ *    @param tile_palette_t *palette    The palette.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int tile_palette_tables(tile_palette_t *palette) {
+    palette->cells  = (unsigned short **)malloc(sizeof(unsigned short *) * palette->width);
+    palette->chunks = (tile_cell_chunk_t **)calloc(tile_palette_chunk_count(palette), sizeof(tile_cell_chunk_t *));
+
+    if (palette->cells == (unsigned short **)0x0 || palette->chunks == (tile_cell_chunk_t **)0x0) {
+        LOGF_ERR("Failed to allocate memory for palette tables.\n");
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ *    Drops a reference to a chunk of cells, freeing it with the last one.
+ *
+ *    @param tile_cell_chunk_t *chunk    The chunk to release.
+ */
+static void tile_cell_chunk_release(tile_cell_chunk_t *chunk) {
+    if (__atomic_sub_fetch(&chunk->refs, 1, __ATOMIC_ACQ_REL) != 0)
+        return;
+
+    free(chunk->cells);
+    free(chunk);
+}
+
+/*
+ *    Allocates an empty palette for a world, sized by its header, with
+ *    every cell at index 0.
+ *
+ *    @param wld_t *wld    The world to allocate the palette of.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int tile_palette_alloc(wld_t *wld) {
+    tile_palette_t *palette = (tile_palette_t *)calloc(1, sizeof(tile_palette_t));
+
+    if (palette == (tile_palette_t *)0x0) {
+        LOGF_ERR("Failed to allocate memory for palette.\n");
+        return 0;
+    }
+
+    palette->width  = wld->header.width;
+    palette->height = wld->header.height;
+
+    if (!tile_palette_tables(palette) || !tile_palette_reserve(palette, TILE_PALETTE_MIN)) {
+        tile_palette_free(palette);
+        return 0;
+    }
+
+    int c;
+    for (c = 0; c < tile_palette_chunk_count(palette); ++c) {
+        tile_cell_chunk_t *chunk = (tile_cell_chunk_t *)malloc(sizeof(tile_cell_chunk_t));
+
+        if (chunk == (tile_cell_chunk_t *)0x0) {
+            LOGF_ERR("Failed to allocate memory for palette chunk.\n");
+            tile_palette_free(palette);
+            return 0;
+        }
+
+        chunk->refs  = 1;
+        chunk->cells = (unsigned short *)calloc(tile_palette_chunk_len(palette, c), sizeof(unsigned short));
+
+        if (chunk->cells == (unsigned short *)0x0) {
+            VLOGF_ERR("Failed to allocate memory for palette chunk %d.\n", c);
+            free(chunk);
+            tile_palette_free(palette);
+            return 0;
+        }
+
+        palette->chunks[c] = chunk;
+        tile_palette_point(palette, c);
+    }
+
+    wld->palette = palette;
+
+    return 1;
+}
+
+/*
+ *    Finds the index of a tile in a palette, adding it if it is new.
+ *
+ *    @param tile_palette_t *palette    The palette.
+ *    @param tile_t          tile       The tile to find.
+ *    @param unsigned short *index      Filled with the index of the tile.
+ *
+ *    @return unsigned int    1 on success, 0 if the palette is full or out of memory.
+ */
+unsigned int tile_palette_index(tile_palette_t *palette, tile_t tile, unsigned short *index) {
+    unsigned int slot = (unsigned int)hash_fnv1a(&tile, sizeof(tile_t)) & palette->slot_mask;
+
+    while (palette->slots[slot] != 0) {
+        unsigned int i = palette->slots[slot] - 1;
+
+        if (memcmp(&palette->values[i], &tile, sizeof(tile_t)) == 0) {
+            *index = (unsigned short)i;
+            return 1;
+        }
+
+        slot = (slot + 1) & palette->slot_mask;
+    }
+
+    if (palette->count == TILE_PALETTE_MAX)
+        return 0;
+
+    if (palette->count == palette->cap) {
+        if (!tile_palette_reserve(palette, palette->cap * 2))
+            return 0;
+
+        /* The table was rebuilt, so the free slot moved.  */
+        slot = (unsigned int)hash_fnv1a(&tile, sizeof(tile_t)) & palette->slot_mask;
+
+        while (palette->slots[slot] != 0)
+            slot = (slot + 1) & palette->slot_mask;
+    }
+
+    palette->values[palette->count] = tile;
+    palette->slots[slot]            = palette->count + 1;
+
+    *index = (unsigned short)palette->count++;
+
+    return 1;
+}
+
+/*
+ *    Expands the palette of a world back into full tiles, then frees it.
+ *    Worlds without a palette are left alone.
+ *
+ *    @param wld_t *wld    The world to expand.
+ *
+ *    @return unsigned int    1 on success, 0 on failure, in which case the palette is kept.
+ */
+unsigned int tile_palette_expand(wld_t *wld) {
+    tile_palette_t *palette = wld->palette;
+
+    if (palette == (tile_palette_t *)0x0)
+        return 1;
+
+    /* A failed allocation releases the world's tiles, palette included.  */
+    wld->palette = (tile_palette_t *)0x0;
+
+    if (!tile_store_alloc(wld)) {
+        LOGF_ERR("Failed to allocate memory to expand palette.\n");
+        wld->palette = palette;
+        return 0;
+    }
+
+    int x;
+    int y;
+    for (x = 0; x < wld->header.width; ++x) {
+        const unsigned short *cells  = palette->cells[x];
+        tile_t               *column = wld->tiles[x];
+
+        for (y = 0; y < wld->header.height; ++y)
+            column[y] = palette->values[cells[y]];
+    }
+
+    VLOGF_NOTE("Expanded palette of %u tiles.\n", palette->count);
+
+    tile_palette_free(palette);
+
+    return 1;
+}
+
+/*
+ *    Shares a palette with a snapshot of a paletted world. The values are
+ *    copied, which is at most TILE_PALETTE_MAX tiles, and the cells are
+ *    shared until either palette writes to them.
+ *
+ *    @param const tile_palette_t *palette    The palette to share.
+ *
+ *    @return tile_palette_t *    The snapshot's palette, NULL on failure.
+ */
+tile_palette_t *tile_palette_share(const tile_palette_t *palette) {
+    tile_palette_t *copy = (tile_palette_t *)calloc(1, sizeof(tile_palette_t));
+
+    if (copy == (tile_palette_t *)0x0) {
+        LOGF_ERR("Failed to allocate memory for palette.\n");
+        return (tile_palette_t *)0x0;
+    }
+
+    copy->values    = (tile_t *)malloc(sizeof(tile_t) * palette->cap);
+    copy->slots     = (unsigned int *)malloc(sizeof(unsigned int) * (palette->slot_mask + 1));
+    copy->count     = palette->count;
+    copy->cap       = palette->cap;
+    copy->slot_mask = palette->slot_mask;
+    copy->width     = palette->width;
+    copy->height    = palette->height;
+
+    if (copy->values == (tile_t *)0x0 || copy->slots == (unsigned int *)0x0 || !tile_palette_tables(copy)) {
+        LOGF_ERR("Failed to allocate memory for palette copy.\n");
+        tile_palette_free(copy);
+        return (tile_palette_t *)0x0;
+    }
+
+    memcpy(copy->values, palette->values, sizeof(tile_t) * palette->count);
+    memcpy(copy->slots, palette->slots, sizeof(unsigned int) * (palette->slot_mask + 1));
+
+    int c;
+    for (c = 0; c < tile_palette_chunk_count(palette); ++c) {
+        __atomic_add_fetch(&palette->chunks[c]->refs, 1, __ATOMIC_RELAXED);
+
+        copy->chunks[c] = palette->chunks[c];
+        tile_palette_point(copy, c);
+    }
+
+    return copy;
+}
+
+/*
+ *    Returns a column of cells that is safe to write to, copying its
+ *    chunk first if it is shared with a snapshot.
+ *
+ *    @param tile_palette_t *palette    The palette to write to.
+ *    @param int             x          The column to write to.
+ *
+ *    @return unsigned short *    The column, NULL on failure.
+ */
+unsigned short *tile_palette_column_mut(tile_palette_t *palette, int x) {
+    int                c     = x / TILE_CHUNK_COLUMNS;
+    tile_cell_chunk_t *chunk = palette->chunks[c];
+
+    /* Snapshots only ever drop their references, never add to this one.  */
+    if (__atomic_load_n(&chunk->refs, __ATOMIC_ACQUIRE) == 1)
+        return palette->cells[x];
+
+    unsigned long      len  = tile_palette_chunk_len(palette, c);
+    tile_cell_chunk_t *copy = (tile_cell_chunk_t *)malloc(sizeof(tile_cell_chunk_t));
+
+    if (copy == (tile_cell_chunk_t *)0x0) {
+        LOGF_ERR("Failed to allocate memory for palette chunk.\n");
+        return (unsigned short *)0x0;
+    }
+
+    copy->refs  = 1;
+    copy->cells = (unsigned short *)malloc(sizeof(unsigned short) * len);
+
+    if (copy->cells == (unsigned short *)0x0) {
+        VLOGF_ERR("Failed to allocate memory for palette chunk %d.\n", c);
+        free(copy);
+        return (unsigned short *)0x0;
+    }
+
+    memcpy(copy->cells, chunk->cells, sizeof(unsigned short) * len);
+
+    palette->chunks[c] = copy;
+    tile_palette_point(palette, c);
+    tile_cell_chunk_release(chunk);
+
+    return palette->cells[x];
+}
+
+/*
+ *    Frees a palette, releasing its chunks of cells.
+ *
+ *    @param tile_palette_t *palette    The palette to free.
+ */
+void tile_palette_free(tile_palette_t *palette) {
+    if (palette == (tile_palette_t *)0x0)
+        return;
+
+    if (palette->chunks != (tile_cell_chunk_t **)0x0) {
+        int c;
+        for (c = 0; c < tile_palette_chunk_count(palette); ++c) {
+            if (palette->chunks[c] != (tile_cell_chunk_t *)0x0)
+                tile_cell_chunk_release(palette->chunks[c]);
+        }
+    }
+
+    free(palette->values);
+    free(palette->slots);
+    free(palette->chunks);
+    free(palette->cells);
+    free(palette);
+}
+
+/*
+ *    Returns a column of tiles to read, whether or not the world is
+ *    paletted. A paletted column is expanded into the scratch column.
+ *
+ *    @param wld_t  *wld        The world to read from.
+ *    @param int     x          The column to read.
+ *    @param tile_t *scratch    A column of header.height tiles to expand into.
+ *
+ *    @return const tile_t *    The column.
+ */
+const tile_t *tile_column_get(wld_t *wld, int x, tile_t *scratch) {
+    tile_palette_t *palette = wld->palette;
+
+    if (palette == (tile_palette_t *)0x0)
+        return wld->tiles[x];
+
+    const unsigned short *cells = palette->cells[x];
+
+    int y;
+    for (y = 0; y < wld->header.height; ++y)
+        scratch[y] = palette->values[cells[y]];
+
+    return scratch;
+}
+
+/*
+ *    Returns a tile of a world, whether or not it is paletted.
+ *
+ *    @param wld_t *wld    The world to read from.
+ *    @param int    x      The column of the tile.
+ *    @param int    y      The row of the tile.
+ *
+ *    @return tile_t    The tile.
+ */
+tile_t tile_get(wld_t *wld, int x, int y) {
+    tile_palette_t *palette = wld->palette;
+
+    if (palette == (tile_palette_t *)0x0)
+        return wld->tiles[x][y];
+
+    return palette->values[palette->cells[x][y]];
+}
+
+/*
+ *    Sets a tile of a world, adding it to the palette if the world is
+ *    paletted. The column is marked as modified, as tile_column_mut does.
+ *
+ *    @param wld_t  *wld     The world to write to.
+ *    @param int     x       The column of the tile.
+ *    @param int     y       The row of the tile.
+ *    @param tile_t  tile    The tile to write.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int tile_set(wld_t *wld, int x, int y, tile_t tile) {
+    tile_palette_t *palette = wld->palette;
+
+    if (palette != (tile_palette_t *)0x0) {
+        unsigned short  index;
+        unsigned short *cells = tile_palette_column_mut(palette, x);
+
+        if (cells == (unsigned short *)0x0 || !tile_store_marks(wld))
+            return 0;
+
+        if (tile_palette_index(palette, tile, &index)) {
+            cells[y]             = index;
+            wld->column_dirty[x] = 1;
+            return 1;
+        }
+
+        /* The palette is full, so the world goes back to full tiles.  */
+        if (!tile_palette_expand(wld))
+            return 0;
+    }
+
+    tile_t *column = tile_column_mut(wld, x);
+
+    if (column == (tile_t *)0x0)
+        return 0;
+
+    column[y] = tile;
+
+    return 1;
+}
@@ -0,0 +1,136 @@
+/*
+ *    tilepalette.h    --    Header file for palette compressed tiles
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Declares the functions used to keep a world's tiles as 16 bit
+ *    indices into a palette of the distinct tiles in it, which is a
+ *    seventh of the memory of the 14 byte tiles. A world usually holds
+ *    a few thousand distinct tiles; once it holds TILE_PALETTE_MAX the
+ *    tiles are expanded back into wld->tiles. A paletted world has no
+ *    wld->tiles, so code reading tiles should go through tile_get or
+ *    tile_column_get, and code writing them through tile_set, or
+ *    tile_column_mut, which expands the world first.
+ */
+#ifndef WLD_TILEPALETTE_H
+#define WLD_TILEPALETTE_H
+
+#include "wld.h"
+
+/*
+ *    The most distinct tiles a palette can hold.
+ */
+#define TILE_PALETTE_MAX 0x10000
+
+/*
+ *    Enables or disables decoding tiles into a palette. Disabled by
+ *    default. Worlds loaded from the cache are never paletted.
+ *
+ *    @param unsigned int enabled    1 to enable, 0 to disable.
+ */
+void tile_palette_set_enabled(unsigned int enabled);
+
+/*
+ *    Returns whether tiles are decoded into a palette.
+ *
+ *    @return unsigned int    1 if enabled, 0 if not.
+ */
+unsigned int tile_palette_enabled(void);
+
+/*
+ *    Allocates an empty palette for a world, sized by its header, with
+ *    every cell at index 0.
+ *
+ *    @param wld_t *wld    The world to allocate the palette of.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int tile_palette_alloc(wld_t *wld);
+
+/*
+ *    Finds the index of a tile in a palette, adding it if it is new.
+ *
+ *    @param tile_palette_t *palette    The palette.
+ *    @param tile_t          tile       The tile to find.
+ *    @param unsigned short *index      Filled with the index of the tile.
+ *
+ *    @return unsigned int    1 on success, 0 if the palette is full or out of memory.
+ */
+unsigned int tile_palette_index(tile_palette_t *palette, tile_t tile, unsigned short *index);
+
+/*
+ *    Expands the palette of a world back into full tiles, then frees it.
+ *    Worlds without a palette are left alone.
+ *
+ *    @param wld_t *wld    The world to expand.
+ *
+ *    @return unsigned int    1 on success, 0 on failure, in which case the palette is kept.
+ */
+unsigned int tile_palette_expand(wld_t *wld);
+
+/*
+ *    Shares a palette with a snapshot of a paletted world. The values are
+ *    copied, which is at most TILE_PALETTE_MAX tiles, and the cells are
+ *    shared until either palette writes to them.
+ *
+ *    @param const tile_palette_t *palette    The palette to share.
+ *
+ *    @return tile_palette_t *    The snapshot's palette, NULL on failure.
+ */
+tile_palette_t *tile_palette_share(const tile_palette_t *palette);
+
+/*
+ *    Returns a column of cells that is safe to write to, copying its
+ *    chunk first if it is shared with a snapshot.
+ *
+ *    @param tile_palette_t *palette    The palette to write to.
+ *    @param int             x          The column to write to.
+ *
+ *    @return unsigned short *    The column, NULL on failure.
+ */
+unsigned short *tile_palette_column_mut(tile_palette_t *palette, int x);
+
+/*
+ *    Frees a palette, releasing its chunks of cells.
+ *
+ *    @param tile_palette_t *palette    The palette to free.
+ */
+void tile_palette_free(tile_palette_t *palette);
+
+/*
+ *    Returns a column of tiles to read, whether or not the world is
+ *    paletted. A paletted column is expanded into the scratch column.
+ *
+ *    @param wld_t  *wld        The world to read from.
+ *    @param int     x          The column to read.
+ *    @param tile_t *scratch    A column of header.height tiles to expand into.
+ *
+ *    @return const tile_t *    The column.
+ */
+const tile_t *tile_column_get(wld_t *wld, int x, tile_t *scratch);
+
+/*
+ *    Returns a tile of a world, whether or not it is paletted.
+ *
+ *    @param wld_t *wld    The world to read from.
+ *    @param int    x      The column of the tile.
+ *    @param int    y      The row of the tile.
+ *
+ *    @return tile_t    The tile.
+ */
+tile_t tile_get(wld_t *wld, int x, int y);
+
+/*
+ *    Sets a tile of a world, adding it to the palette if the world is
+ *    paletted. The column is marked as modified, as tile_column_mut does.
+ *
+ *    @param wld_t  *wld     The world to write to.
+ *    @param int     x       The column of the tile.
+ *    @param int     y       The row of the tile.
+ *    @param tile_t  tile    The tile to write.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int tile_set(wld_t *wld, int x, int y, tile_t tile);
+
+#endif /* WLD_TILEPALETTE_H  */
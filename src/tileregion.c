@@ -0,0 +1,407 @@
+/*
+ *    tileregion.c    --    Source file for region edits
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Defines the functions used to edit every tile in a rectangle at once.
+ *    Every edit is described as a pair of byte masks over a tile, and a
+ *    tile becomes (tile & keep) | set. A replace additionally only applies
+ *    to tiles whose id matches. Since a column is contiguous, the masks are
+ *    repeated over eight tiles, which is exactly seven 16 byte vectors, and
+ *    each span of a column is edited a vector at a time.
+ */
+#include "tileregion.h"
+
+#include "log.h"
+#include "tilepalette.h"
+#include "tilestore.h"
+
+#include <malloc.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif /* __SSE2__  */
+
+#define TILE_REGION_BLOCK_TILES 8
+#define TILE_REGION_BLOCK_SIZE  (sizeof(tile_t) * TILE_REGION_BLOCK_TILES)
+#define TILE_REGION_BLOCK_VECS  (TILE_REGION_BLOCK_SIZE / 16)
+
+typedef struct {
+    unsigned char keep[TILE_REGION_BLOCK_SIZE];
+    unsigned char set[TILE_REGION_BLOCK_SIZE];
+    unsigned char lanes[TILE_REGION_BLOCK_SIZE];
+    unsigned int  match;
+    short         from;
+} tile_region_op_t;
+
+/*
+ *    Starts an edit that leaves every tile as it is.
+ *
+ *    @param tile_region_op_t *op    The edit to start.
+ */
+static void tile_region_op_init(tile_region_op_t *op) {
+    memset(op->keep, 0xFF, sizeof(op->keep));
+    memset(op->set, 0x00, sizeof(op->set));
+    memset(op->lanes, 0x00, sizeof(op->lanes));
+
+    op->match = 0;
+    op->from  = 0;
+}
+
+/*
+ *    Makes an edit overwrite a field of every tile.
+ *
+ *    @param tile_region_op_t *op        The edit.
+ *    @param unsigned long     offset    The offset of the field in a tile.
+ *    @param const void       *value     The value to write.
+ *    @param unsigned long     size      The size of the field.
+ */
+static void tile_region_op_set(tile_region_op_t *op, unsigned long offset, const void *value, unsigned long size) {
+    int i;
+    for (i = 0; i < TILE_REGION_BLOCK_TILES; ++i) {
+        memset(op->keep + i * sizeof(tile_t) + offset, 0x00, size);
+        memcpy(op->set + i * sizeof(tile_t) + offset, value, size);
+    }
+}
+
+/*
+ *    Makes an edit only apply to tiles with a given id.
+ *
+ *    @param tile_region_op_t *op      The edit.
+ *    @param short             from    The tile id to match.
+ */
+static void tile_region_op_match(tile_region_op_t *op, short from) {
+    int i;
+    for (i = 0; i < TILE_REGION_BLOCK_TILES; ++i)
+        memset(op->lanes + i * sizeof(tile_t) + offsetof(tile_t, tile), 0xFF, sizeof(short));
+
+    op->match = 1;
+    op->from  = from;
+}
+
+/*
+ *    Applies an edit to tiles one at a time.
+ *
+ *    @param tile_t                 *tiles    The tiles to edit.
+ *    @param unsigned long           count    The number of tiles.
+ *    @param const tile_region_op_t *op       The edit.
+ */
+static void tile_region_scalar(tile_t *tiles, unsigned long count, const tile_region_op_t *op) {
+    unsigned long i;
+    for (i = 0; i < count; ++i) {
+        if (op->match && tiles[i].tile != op->from)
+            continue;
+
+        unsigned char *bytes = (unsigned char *)&tiles[i];
+
+        unsigned long j;
+        for (j = 0; j < sizeof(tile_t); ++j)
+            bytes[j] = (bytes[j] & op->keep[j]) | op->set[j];
+    }
+}
+
+#ifdef __SSE2__
+/*
+ *    Applies an edit to tiles eight at a time, finishing the rest one at
+ *    a time. Tile ids sit on even offsets in every vector of a block, so
+ *    the id comparison lines up with the 16 bit lanes.
+ *
+ *    @param tile_t                 *tiles    The tiles to edit.
+ *    @param unsigned long           count    The number of tiles.
+ *    @param const tile_region_op_t *op       The edit.
+ */
+static void tile_region_simd(tile_t *tiles, unsigned long count, const tile_region_op_t *op) {
+    __m128i keep[TILE_REGION_BLOCK_VECS];
+    __m128i set[TILE_REGION_BLOCK_VECS];
+    __m128i lanes[TILE_REGION_BLOCK_VECS];
+    __m128i from = _mm_set1_epi16(op->from);
+
+    unsigned long k;
+    for (k = 0; k < TILE_REGION_BLOCK_VECS; ++k) {
+        keep[k]  = _mm_loadu_si128((const __m128i *)(op->keep + k * 16));
+        set[k]   = _mm_loadu_si128((const __m128i *)(op->set + k * 16));
+        lanes[k] = _mm_loadu_si128((const __m128i *)(op->lanes + k * 16));
+    }
+
+    unsigned char *bytes  = (unsigned char *)tiles;
+    unsigned long  blocks = count / TILE_REGION_BLOCK_TILES;
+
+    unsigned long i;
+    if (op->match) {
+        for (i = 0; i < blocks; ++i, bytes += TILE_REGION_BLOCK_SIZE) {
+            for (k = 0; k < TILE_REGION_BLOCK_VECS; ++k) {
+                __m128i v    = _mm_loadu_si128((const __m128i *)(bytes + k * 16));
+                __m128i out  = _mm_or_si128(_mm_and_si128(v, keep[k]), set[k]);
+                __m128i cond = _mm_and_si128(_mm_cmpeq_epi16(v, from), lanes[k]);
+
+                /* The match covers the id bytes, which are all that a replace writes.  */
+                _mm_storeu_si128((__m128i *)(bytes + k * 16), _mm_or_si128(_mm_and_si128(cond, out), _mm_andnot_si128(cond, v)));
+            }
+        }
+    } else {
+        for (i = 0; i < blocks; ++i, bytes += TILE_REGION_BLOCK_SIZE) {
+            for (k = 0; k < TILE_REGION_BLOCK_VECS; ++k) {
+                __m128i v = _mm_loadu_si128((const __m128i *)(bytes + k * 16));
+                _mm_storeu_si128((__m128i *)(bytes + k * 16), _mm_or_si128(_mm_and_si128(v, keep[k]), set[k]));
+            }
+        }
+    }
+
+    tile_region_scalar(tiles + blocks * TILE_REGION_BLOCK_TILES, count - blocks * TILE_REGION_BLOCK_TILES, op);
+}
+#endif /* __SSE2__  */
+
+/*
+ *    Applies an edit to a rectangle of a paletted world. The edit is made
+ *    once to each value of the palette found in the rectangle, and the
+ *    cells are pointed at the results, so the world stays paletted.
+ *
+ *    @param wld_t                  *wld     The world to edit.
+ *    @param rect_t                  rect    The rectangle to edit, already clamped.
+ *    @param const tile_region_op_t *op      The edit.
+ *
+ *    @return unsigned int    1 on success, 0 if the palette filled up.
+ */
+static unsigned int tile_region_apply_palette(wld_t *wld, rect_t rect, const tile_region_op_t *op) {
+    tile_palette_t *palette = wld->palette;
+
+    /* Index + 1 of each value's result, 0 until it is first seen.  */
+    unsigned int *remap = (unsigned int *)calloc(palette->count, sizeof(unsigned int));
+
+    if (remap == (unsigned int *)0x0) {
+        LOGF_ERR("Failed to allocate memory for palette remap.\n");
+        return 0;
+    }
+
+    if (!tile_store_marks(wld)) {
+        free(remap);
+        return 0;
+    }
+
+    int x;
+    int y;
+    for (x = rect.x0; x < rect.x; ++x) {
+        unsigned short *cells = tile_palette_column_mut(palette, x);
+
+        if (cells == (unsigned short *)0x0) {
+            free(remap);
+            return 0;
+        }
+
+        wld->column_dirty[x] = 1;
+
+        for (y = rect.y0; y < rect.y; ++y) {
+            unsigned short index = cells[y];
+
+            if (remap[index] == 0) {
+                tile_t         t = palette->values[index];
+                unsigned short to;
+
+                tile_region_scalar(&t, 1, op);
+
+                if (!tile_palette_index(palette, t, &to)) {
+                    free(remap);
+                    return 0;
+                }
+
+                remap[index] = to + 1;
+            }
+
+            cells[y] = remap[index] - 1;
+        }
+    }
+
+    free(remap);
+
+    return 1;
+}
+
+/*
+ *    Applies an edit to every tile in a rectangle, one column span at a time.
+ *
+ *    @param wld_t                  *wld     The world to edit.
+ *    @param rect_t                  rect    The rectangle to edit.
+ *    @param const tile_region_op_t *op      The edit.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int tile_region_apply(wld_t *wld, rect_t rect, const tile_region_op_t *op) {
+    if (wld == (wld_t *)0x0 || (wld->tiles == (tile_t **)0x0 && wld->palette == (tile_palette_t *)0x0)) {
+        LOGF_ERR("World has no tiles.\n");
+        return 0;
+    }
+
+    if (rect.x0 < 0)
+        rect.x0 = 0;
+    if (rect.y0 < 0)
+        rect.y0 = 0;
+    if (rect.x > wld->header.width)
+        rect.x = wld->header.width;
+    if (rect.y > wld->header.height)
+        rect.y = wld->header.height;
+
+    if (rect.x0 >= rect.x || rect.y0 >= rect.y)
+        return 1;
+
+    /*
+     *    Every edit sets fields to fixed values, so making it again over
+     *    cells it already reached is harmless if the palette fills up.
+     */
+    if (wld->palette != (tile_palette_t *)0x0 && tile_region_apply_palette(wld, rect, op))
+        return 1;
+
+    int x;
+    for (x = rect.x0; x < rect.x; ++x) {
+        tile_t *column = tile_column_mut(wld, x);
+
+        if (column == (tile_t *)0x0) {
+            VLOGF_ERR("Failed to get column %d for writing.\n", x);
+            return 0;
+        }
+
+#ifdef __SSE2__
+        tile_region_simd(column + rect.y0, rect.y - rect.y0, op);
+#else
+        tile_region_scalar(column + rect.y0, rect.y - rect.y0, op);
+#endif /* __SSE2__  */
+    }
+
+    return 1;
+}
+
+/*
+ *    Sets every tile in a rectangle to the same tile.
+ *
+ *    @param wld_t  *wld     The world to edit.
+ *    @param rect_t  rect    The rectangle to fill.
+ *    @param tile_t  tile    The tile to fill with.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int tile_region_fill(wld_t *wld, rect_t rect, tile_t tile) {
+    tile_region_op_t op;
+
+    tile_region_op_init(&op);
+    tile_region_op_set(&op, 0, &tile, sizeof(tile_t));
+
+    return tile_region_apply(wld, rect, &op);
+}
+
+/*
+ *    Replaces one tile id with another in a rectangle, leaving everything
+ *    else about the tiles alone.
+ *
+ *    @param wld_t  *wld     The world to edit.
+ *    @param rect_t  rect    The rectangle to edit.
+ *    @param short   from    The tile id to replace, -1 for empty tiles.
+ *    @param short   to      The tile id to replace it with, -1 to clear.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int tile_region_replace(wld_t *wld, rect_t rect, short from, short to) {
+    tile_region_op_t op;
+
+    tile_region_op_init(&op);
+    tile_region_op_set(&op, offsetof(tile_t, tile), &to, sizeof(short));
+    tile_region_op_match(&op, from);
+
+    return tile_region_apply(wld, rect, &op);
+}
+
+/*
+ *    Removes the walls, and their paint, from a rectangle.
+ *
+ *    @param wld_t  *wld     The world to edit.
+ *    @param rect_t  rect    The rectangle to clear.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int tile_region_clear_walls(wld_t *wld, rect_t rect) {
+    tile_region_op_t op;
+    short            wall  = -1;
+    unsigned char    paint = 0;
+
+    tile_region_op_init(&op);
+    tile_region_op_set(&op, offsetof(tile_t, wall), &wall, sizeof(short));
+    tile_region_op_set(&op, offsetof(tile_t, wall_paint), &paint, sizeof(unsigned char));
+
+    return tile_region_apply(wld, rect, &op);
+}
+
+/*
+ *    Sets the liquid in a rectangle. An amount of 0 removes the liquid.
+ *
+ *    @param wld_t         *wld       The world to edit.
+ *    @param rect_t         rect      The rectangle to edit.
+ *    @param unsigned char  type      The liquid, one of LIQUID_*.
+ *    @param unsigned char  amount    The amount of liquid, 0 to 255.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int tile_region_set_liquid(wld_t *wld, rect_t rect, unsigned char type, unsigned char amount) {
+    tile_region_op_t op;
+
+    /* A type without an amount would be written as an empty liquid anyway.  */
+    if (amount == 0)
+        type = 0;
+
+    tile_region_op_init(&op);
+    tile_region_op_set(&op, offsetof(tile_t, liquid_type), &type, sizeof(unsigned char));
+    tile_region_op_set(&op, offsetof(tile_t, liquid_amount), &amount, sizeof(unsigned char));
+
+    return tile_region_apply(wld, rect, &op);
+}
+
+/*
+ *    Paints the tiles and/or walls in a rectangle. A paint of 0 removes it.
+ *
+ *    @param wld_t         *wld        The world to edit.
+ *    @param rect_t         rect       The rectangle to paint.
+ *    @param unsigned char  paint      The paint.
+ *    @param unsigned int   targets    TILE_REGION_TILES and/or TILE_REGION_WALLS.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int tile_region_paint(wld_t *wld, rect_t rect, unsigned char paint, unsigned int targets) {
+    tile_region_op_t op;
+
+    if (!(targets & (TILE_REGION_TILES | TILE_REGION_WALLS))) {
+        LOGF_WARN("Nothing to paint.\n");
+        return 1;
+    }
+
+    tile_region_op_init(&op);
+
+    if (targets & TILE_REGION_TILES)
+        tile_region_op_set(&op, offsetof(tile_t, tile_paint), &paint, sizeof(unsigned char));
+    if (targets & TILE_REGION_WALLS)
+        tile_region_op_set(&op, offsetof(tile_t, wall_paint), &paint, sizeof(unsigned char));
+
+    return tile_region_apply(wld, rect, &op);
+}
+
+/*
+ *    Adds and removes wires in a rectangle.
+ *
+ *    @param wld_t         *wld       The world to edit.
+ *    @param rect_t         rect      The rectangle to edit.
+ *    @param unsigned char  add       The WIRE_* flags to add.
+ *    @param unsigned char  remove    The WIRE_* flags to remove.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int tile_region_wire(wld_t *wld, rect_t rect, unsigned char add, unsigned char remove) {
+    tile_region_op_t op;
+
+    tile_region_op_init(&op);
+
+    int i;
+    for (i = 0; i < TILE_REGION_BLOCK_TILES; ++i) {
+        op.keep[i * sizeof(tile_t) + offsetof(tile_t, wiring)] = ~remove;
+        op.set[i * sizeof(tile_t) + offsetof(tile_t, wiring)]  = add;
+    }
+
+    return tile_region_apply(wld, rect, &op);
+}
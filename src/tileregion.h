@@ -0,0 +1,91 @@
+/*
+ *    tileregion.h    --    Header file for region edits
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Declares the functions used to edit every tile in a rectangle at
+ *    once. Rectangles are half open, like the ones from wld_diff, and are
+ *    clipped to the world. Every touched column goes through
+ *    tile_column_mut, so edits are safe with snapshots and are marked.
+ */
+#ifndef WLD_TILEREGION_H
+#define WLD_TILEREGION_H
+
+#include "wld.h"
+
+enum {
+    TILE_REGION_TILES = 1 << 0,
+    TILE_REGION_WALLS = 1 << 1,
+};
+
+/*
+ *    Sets every tile in a rectangle to the same tile.
+ *
+ *    @param wld_t  *wld     The world to edit.
+ *    @param rect_t  rect    The rectangle to fill.
+ *    @param tile_t  tile    The tile to fill with.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int tile_region_fill(wld_t *wld, rect_t rect, tile_t tile);
+
+/*
+ *    Replaces one tile id with another in a rectangle, leaving everything
+ *    else about the tiles alone.
+ *
+ *    @param wld_t  *wld     The world to edit.
+ *    @param rect_t  rect    The rectangle to edit.
+ *    @param short   from    The tile id to replace, -1 for empty tiles.
+ *    @param short   to      The tile id to replace it with, -1 to clear.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int tile_region_replace(wld_t *wld, rect_t rect, short from, short to);
+
+/*
+ *    Removes the walls, and their paint, from a rectangle.
+ *
+ *    @param wld_t  *wld     The world to edit.
+ *    @param rect_t  rect    The rectangle to clear.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int tile_region_clear_walls(wld_t *wld, rect_t rect);
+
+/*
+ *    Sets the liquid in a rectangle. An amount of 0 removes the liquid.
+ *
+ *    @param wld_t         *wld       The world to edit.
+ *    @param rect_t         rect      The rectangle to edit.
+ *    @param unsigned char  type      The liquid, one of LIQUID_*.
+ *    @param unsigned char  amount    The amount of liquid, 0 to 255.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int tile_region_set_liquid(wld_t *wld, rect_t rect, unsigned char type, unsigned char amount);
+
+/*
+ *    Paints the tiles and/or walls in a rectangle. A paint of 0 removes it.
+ *
+ *    @param wld_t         *wld        The world to edit.
+ *    @param rect_t         rect       The rectangle to paint.
+ *    @param unsigned char  paint      The paint.
+ *    @param unsigned int   targets    TILE_REGION_TILES and/or TILE_REGION_WALLS.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int tile_region_paint(wld_t *wld, rect_t rect, unsigned char paint, unsigned int targets);
+
+/*
+ *    Adds and removes wires in a rectangle.
+ *
+ *    @param wld_t         *wld       The world to edit.
+ *    @param rect_t         rect      The rectangle to edit.
+ *    @param unsigned char  add       The WIRE_* flags to add.
+ *    @param unsigned char  remove    The WIRE_* flags to remove.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int tile_region_wire(wld_t *wld, rect_t rect, unsigned char add, unsigned char remove);
+
+#endif /* WLD_TILEREGION_H  */
@@ -0,0 +1,220 @@
+/*
+ *    tilerunner.c    --    Source file for the TileRunner brush
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Defines the brush world generation uses to place ores and blobs.
+ *    The game rolls a jitter for every tile under each stamp, which is
+ *    what makes the brush slow. Here the jitters of a stamp are taken in
+ *    one run, the thresholds they pick between are worked out once per
+ *    brush, and the rows of a column that are under the brush whatever
+ *    the jitter are written without looking at their rolls.
+ */
+#include "tilerunner.h"
+
+#include <malloc.h>
+
+#define TILE_RUNNER_JITTERS 21
+#define TILE_RUNNER_STACK   4096
+#define TILE_RUNNER_SHORT   8
+
+/*
+ *    Places or clears a tile under the brush.
+ *
+ *    @param tile_t        *tile    The tile.
+ *    @param short          type    The tile to place, -1 to clear it.
+ *    @param unsigned char  add     Whether to place tiles in empty space.
+ *
+ *    @return unsigned long    1 if the tile changed, 0 if not.
+ */
+static unsigned long tile_runner_place(tile_t *tile, short type, unsigned char add) {
+    if (type < 0) {
+        if (tile->tile == -1)
+            return 0;
+    } else if (tile->tile == type || (!add && tile->tile == -1)) {
+        return 0;
+    }
+
+    tile->tile = type;
+
+    return 1;
+}
+
+/*
+ *    Finds the rows of a column that are under the brush at a threshold.
+ *    The distance only grows away from the centre, so the rows form one
+ *    span, which is guessed and then nudged until the edges match the
+ *    exact test.
+ *
+ *    @param double  dx       The distance of the column from the centre.
+ *    @param double  pos_y    The y coordinate of the centre.
+ *    @param double  limit    The threshold.
+ *    @param int     y0       The first row of the stamp.
+ *    @param int     y1       The row after the stamp.
+ *    @param int    *s0       The first row of the span.
+ *    @param int    *s1       The row after the span.
+ */
+static void tile_runner_span(double dx, double pos_y, double limit, int y0, int y1, int *s0, int *s1) {
+    double reach = limit - dx;
+
+    if (reach <= 0.0) {
+        *s0 = y0;
+        *s1 = y0;
+        return;
+    }
+
+    int a = (int)(pos_y - reach);
+    int b = (int)(pos_y + reach) + 1;
+
+    if (a < y0)
+        a = y0;
+    if (a > y1)
+        a = y1;
+    if (b > y1)
+        b = y1;
+    if (b < a)
+        b = a;
+
+    while (a < b && dx + (a > pos_y ? a - pos_y : pos_y - a) >= limit)
+        a++;
+    while (a > y0 && dx + (a - 1 > pos_y ? a - 1 - pos_y : pos_y - (a - 1)) < limit)
+        a--;
+    while (b > a && dx + (b - 1 > pos_y ? b - 1 - pos_y : pos_y - (b - 1)) >= limit)
+        b--;
+    while (b < y1 && dx + (b > pos_y ? b - pos_y : pos_y - b) < limit)
+        b++;
+
+    *s0 = a;
+    *s1 = b;
+}
+
+/*
+ *    Source code def: TileRunner. Walks a diamond shaped brush that
+ *    shrinks with every step, placing or clearing tiles under it. Without
+ *    add, only existing tiles are replaced. The brush is clipped to the
+ *    columns the generation can use.
+ *
+ *    @param gen_t         *gen         The generation.
+ *    @param int            i           The starting x coordinate.
+ *    @param int            j           The starting y coordinate.
+ *    @param double         strength    The starting size of the brush.
+ *    @param int            steps       The number of steps to walk.
+ *    @param short          type        The tile to place, -1 to clear tiles.
+ *    @param unsigned char  add         Whether to place tiles in empty space.
+ *    @param double         speed_x     The starting x velocity, 0 for a random one.
+ *    @param double         speed_y     The starting y velocity, 0 for a random one.
+ */
+void gen_tile_runner(gen_t *gen, int i, int j, double strength, int steps, short type, unsigned char add, double speed_x, double speed_y) {
+    double size  = strength;
+    double left  = steps;
+    double pos_x = i;
+    double pos_y = j;
+    double vel_x = rng_next_minmax(&gen->rng, -10, 11) * 0.1;
+    double vel_y = rng_next_minmax(&gen->rng, -10, 11) * 0.1;
+
+    if (speed_x != 0.0 || speed_y != 0.0) {
+        vel_x = speed_x;
+        vel_y = speed_y;
+    }
+
+    /* The jittered size of the brush, from the smallest roll to the largest.  */
+    double limits[TILE_RUNNER_JITTERS];
+
+    int k;
+    for (k = 0; k < TILE_RUNNER_JITTERS; ++k)
+        limits[k] = strength * 0.5 * (1.0 + (k - 10) * 0.015);
+
+    /* A stamp is never wider or taller than the brush is at the start.  */
+    int  stack[TILE_RUNNER_STACK];
+    int  span    = strength > 0.0 ? (int)strength + 2 : 0;
+    int *jitters = stack;
+
+    if (span * span > TILE_RUNNER_STACK) {
+        jitters = (int *)malloc(span * span * sizeof(int));
+
+        if (jitters == (int *)0x0)
+            return;
+    }
+
+    while (size > 0.0 && left > 0.0) {
+        size  = strength * (left / steps);
+        left -= 1.0;
+
+        /* Clipped once per stamp, every column below shares the rows.  */
+        int x0 = (int)(pos_x - size * 0.5);
+        int x1 = (int)(pos_x + size * 0.5);
+        int y0 = (int)(pos_y - size * 0.5);
+        int y1 = (int)(pos_y + size * 0.5);
+
+        if (x0 < 1)
+            x0 = 1;
+        if (x0 < gen->left)
+            x0 = gen->left;
+        if (x1 > gen->width - 1)
+            x1 = gen->width - 1;
+        if (x1 > gen->right)
+            x1 = gen->right;
+        if (y0 < 1)
+            y0 = 1;
+        if (y1 > gen->height - 1)
+            y1 = gen->height - 1;
+
+        /* The game rolls column by column, so the rolls are in the same order.  */
+        if (x0 < x1 && y0 < y1)
+            rng_next_minmax_n(&gen->rng, 0, TILE_RUNNER_JITTERS, jitters, (x1 - x0) * (y1 - y0));
+
+        int x;
+        int y;
+        for (x = x0; x < x1 && y0 < y1; ++x) {
+            tile_t *column = gen->tiles[x];
+            double  dx     = x > pos_x ? x - pos_x : pos_x - x;
+            int    *rolls  = jitters + (x - x0) * (y1 - y0) - y0;
+
+            int inner0;
+            int inner1;
+            int outer0;
+            int outer1;
+
+            /* Short columns are cheaper to test row by row than to find spans in.  */
+            if (y1 - y0 > TILE_RUNNER_SHORT) {
+                tile_runner_span(dx, pos_y, limits[0], y0, y1, &inner0, &inner1);
+                tile_runner_span(dx, pos_y, limits[TILE_RUNNER_JITTERS - 1], y0, y1, &outer0, &outer1);
+            } else {
+                inner0 = y0;
+                inner1 = y0;
+                outer0 = y0;
+                outer1 = y1;
+            }
+
+            for (y = outer0; y < inner0; ++y) {
+                if (dx + (y > pos_y ? y - pos_y : pos_y - y) < limits[rolls[y]])
+                    gen->touched += tile_runner_place(&column[y], type, add);
+            }
+
+            for (y = inner0; y < inner1; ++y)
+                gen->touched += tile_runner_place(&column[y], type, add);
+
+            for (y = inner1 > outer0 ? inner1 : outer0; y < outer1; ++y) {
+                if (dx + (y > pos_y ? y - pos_y : pos_y - y) < limits[rolls[y]])
+                    gen->touched += tile_runner_place(&column[y], type, add);
+            }
+        }
+
+        pos_x += vel_x;
+        pos_y += vel_y;
+        vel_x += rng_next_minmax(&gen->rng, -10, 11) * 0.05;
+        vel_y += rng_next_minmax(&gen->rng, -10, 11) * 0.05;
+
+        if (vel_x > 1.0)
+            vel_x = 1.0;
+        if (vel_x < -1.0)
+            vel_x = -1.0;
+        if (vel_y > 1.0)
+            vel_y = 1.0;
+        if (vel_y < -1.0)
+            vel_y = -1.0;
+    }
+
+    if (jitters != stack)
+        free(jitters);
+}
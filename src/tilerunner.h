@@ -0,0 +1,33 @@
+/*
+ *    tilerunner.h    --    Header file for the TileRunner brush
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Declares the brush world generation uses to place ores and blobs of
+ *    dirt and stone, and to dig caves. It takes the same samples from the
+ *    generation's stream as the game, so worlds come out the same.
+ */
+#ifndef WLD_TILERUNNER_H
+#define WLD_TILERUNNER_H
+
+#include "worldgen.h"
+
+/*
+ *    Source code def: TileRunner. Walks a diamond shaped brush that
+ *    shrinks with every step, placing or clearing tiles under it. Without
+ *    add, only existing tiles are replaced. The brush is clipped to the
+ *    columns the generation can use.
+ *
+ *    @param gen_t         *gen         The generation.
+ *    @param int            i           The starting x coordinate.
+ *    @param int            j           The starting y coordinate.
+ *    @param double         strength    The starting size of the brush.
+ *    @param int            steps       The number of steps to walk.
+ *    @param short          type        The tile to place, -1 to clear tiles.
+ *    @param unsigned char  add         Whether to place tiles in empty space.
+ *    @param double         speed_x     The starting x velocity, 0 for a random one.
+ *    @param double         speed_y     The starting y velocity, 0 for a random one.
+ */
+void gen_tile_runner(gen_t *gen, int i, int j, double strength, int steps, short type, unsigned char add, double speed_x, double speed_y);
+
+#endif /* WLD_TILERUNNER_H  */
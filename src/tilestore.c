@@ -0,0 +1,362 @@
+/*
+ *    tilestore.c    --    Source file for chunked tile storage
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Defines the functions that manage a world's tile chunks. Reference
+ *    counts are atomic so a snapshot can be read and released on another
+ *    thread while the world it was taken from keeps being edited.
+ */
+#include "tilestore.h"
+
+#include "log.h"
+#include "tilepalette.h"
+
+#include <malloc.h>
+#include <string.h>
+#include <sys/mman.h>
+
+/*
+ *    Returns the number of chunks a world's tiles are split into.
+ *
+ *    @param wld_t *wld    The world.
+ *
+ *    @return int    The number of chunks.
+ */
+static int tile_store_count(wld_t *wld) {
+    return (wld->header.width + TILE_CHUNK_COLUMNS - 1) / TILE_CHUNK_COLUMNS;
+}
+
+/*
+ *    Returns the number of tiles in a chunk.
+ *
+ *    @param wld_t *wld    The world.
+ *    @param int    c      The chunk.
+ *
+ *    @return unsigned long    The number of tiles in the chunk.
+ */
+static unsigned long tile_store_chunk_len(wld_t *wld, int c) {
+    int columns = wld->header.width - c * TILE_CHUNK_COLUMNS;
+
+    if (columns > TILE_CHUNK_COLUMNS)
+        columns = TILE_CHUNK_COLUMNS;
+
+    return (unsigned long)columns * wld->header.height;
+}
+
+/*
+ *    Points the columns of a chunk at its tiles.
+ *
+ *    @param wld_t *wld    The world.
+ *    @param int    c      The chunk.
+ */
+static void tile_store_point(wld_t *wld, int c) {
+    tile_t *tiles = wld->tile_chunks[c]->tiles;
+
+    int x;
+    for (x = c * TILE_CHUNK_COLUMNS; x < wld->header.width && x < (c + 1) * TILE_CHUNK_COLUMNS; ++x)
+        wld->tiles[x] = tiles + (unsigned long)(x - c * TILE_CHUNK_COLUMNS) * wld->header.height;
+}
+
+/*
+ *    Allocates the column and chunk tables of a world.
+ *
+ *    @param wld_t *wld    The world.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int tile_store_tables(wld_t *wld) {
+    wld->tiles       = (tile_t **)malloc(sizeof(tile_t *) * wld->header.width);
+    wld->tile_chunks = (tile_chunk_t **)calloc(tile_store_count(wld), sizeof(tile_chunk_t *));
+
+    if (wld->tiles == (tile_t **)0x0 || wld->tile_chunks == (tile_chunk_t **)0x0) {
+        LOGF_ERR("Failed to allocate memory for tile tables.\n");
+        free(wld->tiles);
+        free(wld->tile_chunks);
+        wld->tiles       = (tile_t **)0x0;
+        wld->tile_chunks = (tile_chunk_t **)0x0;
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ *    Drops a reference to a chunk, freeing it with the last one.
+ *
+ *    @param tile_chunk_t *chunk    The chunk to release.
+ */
+static void tile_chunk_release(tile_chunk_t *chunk) {
+    if (__atomic_sub_fetch(&chunk->refs, 1, __ATOMIC_ACQ_REL) != 0)
+        return;
+
+    if (chunk->map == (tile_map_t *)0x0) {
+        free(chunk->tiles);
+    } else if (__atomic_sub_fetch(&chunk->map->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        munmap(chunk->map->base, chunk->map->len);
+        free(chunk->map);
+    }
+
+    free(chunk);
+}
+
+/*
+ *    Allocates the tiles of a world on the heap, sized by its header.
+ *    The tiles are left uninitialized.
+ *
+ *    @param wld_t *wld    The world to allocate the tiles of.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int tile_store_alloc(wld_t *wld) {
+    if (wld == (wld_t *)0x0) {
+        LOGF_ERR("World is NULL.\n");
+        return 0;
+    }
+
+    if (!tile_store_tables(wld))
+        return 0;
+
+    int c;
+    for (c = 0; c < tile_store_count(wld); ++c) {
+        tile_chunk_t *chunk = (tile_chunk_t *)malloc(sizeof(tile_chunk_t));
+
+        if (chunk == (tile_chunk_t *)0x0) {
+            LOGF_ERR("Failed to allocate memory for tile chunk.\n");
+            tile_store_free(wld);
+            return 0;
+        }
+
+        chunk->refs  = 1;
+        chunk->map   = (tile_map_t *)0x0;
+        chunk->tiles = (tile_t *)malloc(sizeof(tile_t) * tile_store_chunk_len(wld, c));
+
+        if (chunk->tiles == (tile_t *)0x0) {
+            VLOGF_ERR("Failed to allocate memory for tile chunk %d.\n", c);
+            free(chunk);
+            tile_store_free(wld);
+            return 0;
+        }
+
+        wld->tile_chunks[c] = chunk;
+        tile_store_point(wld, c);
+    }
+
+    return 1;
+}
+
+/*
+ *    Points the tiles of a world into a mapping holding the columns back
+ *    to back, sized by its header. The world takes ownership of the
+ *    mapping, which should be private and writable.
+ *
+ *    @param wld_t         *wld          The world to set the tiles of.
+ *    @param void          *base         The start of the mapping.
+ *    @param unsigned long  len          The length of the mapping.
+ *    @param unsigned long  tiles_pos    The offset of the first column in the mapping.
+ *
+ *    @return unsigned int    1 on success, 0 on failure, in which case the mapping is left alone.
+ */
+unsigned int tile_store_map(wld_t *wld, void *base, unsigned long len, unsigned long tiles_pos) {
+    if (wld == (wld_t *)0x0) {
+        LOGF_ERR("World is NULL.\n");
+        return 0;
+    }
+
+    tile_map_t *map = (tile_map_t *)malloc(sizeof(tile_map_t));
+
+    if (map == (tile_map_t *)0x0 || !tile_store_tables(wld)) {
+        LOGF_ERR("Failed to allocate memory for tile map.\n");
+        free(map);
+        return 0;
+    }
+
+    int     count = tile_store_count(wld);
+    tile_t *tiles = (tile_t *)((unsigned char *)base + tiles_pos);
+
+    int c;
+    for (c = 0; c < count; ++c) {
+        wld->tile_chunks[c] = (tile_chunk_t *)malloc(sizeof(tile_chunk_t));
+
+        if (wld->tile_chunks[c] == (tile_chunk_t *)0x0) {
+            LOGF_ERR("Failed to allocate memory for tile chunk.\n");
+
+            /* Nothing holds the mapping yet, so it is not released.  */
+            while (c-- > 0)
+                free(wld->tile_chunks[c]);
+
+            free(wld->tile_chunks);
+            free(wld->tiles);
+            free(map);
+            wld->tile_chunks = (tile_chunk_t **)0x0;
+            wld->tiles       = (tile_t **)0x0;
+            return 0;
+        }
+
+        wld->tile_chunks[c]->refs  = 1;
+        wld->tile_chunks[c]->map   = map;
+        wld->tile_chunks[c]->tiles = tiles + (unsigned long)c * TILE_CHUNK_COLUMNS * wld->header.height;
+        tile_store_point(wld, c);
+    }
+
+    map->refs = count;
+    map->base = base;
+    map->len  = len;
+
+    return 1;
+}
+
+/*
+ *    Shares the tiles of one world with another without copying them.
+ *
+ *    @param wld_t *dst    The world to share the tiles with.
+ *    @param wld_t *src    The world holding the tiles.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int tile_store_share(wld_t *dst, wld_t *src) {
+    if (dst == (wld_t *)0x0 || src == (wld_t *)0x0 || (src->tile_chunks == (tile_chunk_t **)0x0 && src->palette == (tile_palette_t *)0x0)) {
+        LOGF_ERR("World has no tile chunks to share.\n");
+        return 0;
+    }
+
+    if (dst->header.width != src->header.width || dst->header.height != src->header.height) {
+        LOGF_ERR("Worlds are not the same size.\n");
+        return 0;
+    }
+
+    /* A paletted world shares its chunks of cells the same way.  */
+    if (src->palette != (tile_palette_t *)0x0) {
+        dst->palette = tile_palette_share(src->palette);
+        return dst->palette != (tile_palette_t *)0x0;
+    }
+
+    if (!tile_store_tables(dst))
+        return 0;
+
+    int c;
+    for (c = 0; c < tile_store_count(src); ++c) {
+        __atomic_add_fetch(&src->tile_chunks[c]->refs, 1, __ATOMIC_RELAXED);
+
+        dst->tile_chunks[c] = src->tile_chunks[c];
+        tile_store_point(dst, c);
+    }
+
+    return 1;
+}
+
+/*
+ *    Allocates the marks of modified columns of a world, if it has none
+ *    yet. tile_column_mut does this itself, but code writing columns from
+ *    several threads should call it first.
+ *
+ *    @param wld_t *wld    The world.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int tile_store_marks(wld_t *wld) {
+    if (wld->column_dirty != (unsigned char *)0x0)
+        return 1;
+
+    wld->column_dirty = (unsigned char *)calloc(wld->header.width, sizeof(unsigned char));
+
+    if (wld->column_dirty == (unsigned char *)0x0) {
+        LOGF_ERR("Failed to allocate memory for column marks.\n");
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ *    Returns a column of tiles that is safe to write to, copying its chunk
+ *    first if it is shared with a snapshot. The column is marked as
+ *    modified since the world was loaded.
+ *
+ *    @param wld_t *wld    The world to write to.
+ *    @param int    x      The column to write to.
+ *
+ *    @return tile_t *    The column, NULL on failure.
+ */
+tile_t *tile_column_mut(wld_t *wld, int x) {
+    if (!tile_palette_expand(wld) || !tile_store_marks(wld))
+        return (tile_t *)0x0;
+
+    int           c     = x / TILE_CHUNK_COLUMNS;
+    tile_chunk_t *chunk = wld->tile_chunks[c];
+
+    wld->column_dirty[x] = 1;
+
+    /* Only this world can add references, so a count of one stays one.  */
+    if (__atomic_load_n(&chunk->refs, __ATOMIC_ACQUIRE) == 1)
+        return wld->tiles[x];
+
+    unsigned long len  = tile_store_chunk_len(wld, c);
+    tile_chunk_t *copy = (tile_chunk_t *)malloc(sizeof(tile_chunk_t));
+
+    if (copy == (tile_chunk_t *)0x0) {
+        LOGF_ERR("Failed to allocate memory for tile chunk.\n");
+        return (tile_t *)0x0;
+    }
+
+    copy->refs  = 1;
+    copy->map   = (tile_map_t *)0x0;
+    copy->tiles = (tile_t *)malloc(sizeof(tile_t) * len);
+
+    if (copy->tiles == (tile_t *)0x0) {
+        VLOGF_ERR("Failed to allocate memory for tile chunk %d.\n", c);
+        free(copy);
+        return (tile_t *)0x0;
+    }
+
+    memcpy(copy->tiles, chunk->tiles, sizeof(tile_t) * len);
+
+    wld->tile_chunks[c] = copy;
+    tile_store_point(wld, c);
+    tile_chunk_release(chunk);
+
+    return wld->tiles[x];
+}
+
+/*
+ *    Returns whether a column was written through tile_column_mut since
+ *    the world was loaded.
+ *
+ *    @param wld_t *wld    The world.
+ *    @param int    x      The column.
+ *
+ *    @return unsigned int    1 if the column was modified, 0 if not.
+ */
+unsigned int tile_column_dirty(wld_t *wld, int x) {
+    return wld->column_dirty != (unsigned char *)0x0 && wld->column_dirty[x];
+}
+
+/*
+ *    Releases the tiles of a world.
+ *
+ *    @param wld_t *wld    The world to release the tiles of.
+ */
+void tile_store_free(wld_t *wld) {
+    if (wld == (wld_t *)0x0) {
+        LOGF_WARN("World is NULL.\n");
+        return;
+    }
+
+    if (wld->tile_chunks != (tile_chunk_t **)0x0) {
+        int c;
+        for (c = 0; c < tile_store_count(wld); ++c) {
+            if (wld->tile_chunks[c] != (tile_chunk_t *)0x0)
+                tile_chunk_release(wld->tile_chunks[c]);
+        }
+    }
+
+    tile_palette_free(wld->palette);
+    free(wld->tile_chunks);
+    free(wld->tiles);
+    free(wld->column_dirty);
+
+    wld->palette      = (tile_palette_t *)0x0;
+    wld->tile_chunks  = (tile_chunk_t **)0x0;
+    wld->tiles        = (tile_t **)0x0;
+    wld->column_dirty = (unsigned char *)0x0;
+}
@@ -0,0 +1,97 @@
+/*
+ *    tilestore.h    --    Header file for chunked tile storage
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Declares the functions that manage a world's tile chunks. Tiles are
+ *    still read through wld->tiles[x][y], but every column belongs to a
+ *    reference counted chunk, so a snapshot of the tiles only has to take
+ *    a reference. Code that writes tiles must get the column through
+ *    tile_column_mut first, which copies the chunk if it is shared, or
+ *    use tile_set. Writing through wld->tiles directly would change every
+ *    snapshot sharing the chunk, race with wld_save_async, and go unseen
+ *    by wld_diff.
+ *    Worlds decoded into a palette have no chunks, see tilepalette.h.
+ */
+#ifndef WLD_TILESTORE_H
+#define WLD_TILESTORE_H
+
+#include "wld.h"
+
+/*
+ *    Allocates the tiles of a world on the heap, sized by its header.
+ *    The tiles are left uninitialized.
+ *
+ *    @param wld_t *wld    The world to allocate the tiles of.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int tile_store_alloc(wld_t *wld);
+
+/*
+ *    Points the tiles of a world into a mapping holding the columns back
+ *    to back, sized by its header. The world takes ownership of the
+ *    mapping, which should be private and writable.
+ *
+ *    @param wld_t         *wld          The world to set the tiles of.
+ *    @param void          *base         The start of the mapping.
+ *    @param unsigned long  len          The length of the mapping.
+ *    @param unsigned long  tiles_pos    The offset of the first column in the mapping.
+ *
+ *    @return unsigned int    1 on success, 0 on failure, in which case the mapping is left alone.
+ */
+unsigned int tile_store_map(wld_t *wld, void *base, unsigned long len, unsigned long tiles_pos);
+
+/*
+ *    Shares the tiles of one world with another without copying them.
+ *    The palette of a paletted world is copied instead.
+ *
+ *    @param wld_t *dst    The world to share the tiles with.
+ *    @param wld_t *src    The world holding the tiles.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int tile_store_share(wld_t *dst, wld_t *src);
+
+/*
+ *    Allocates the marks of modified columns of a world, if it has none
+ *    yet. tile_column_mut does this itself, but code writing columns from
+ *    several threads should call it first.
+ *
+ *    @param wld_t *wld    The world.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int tile_store_marks(wld_t *wld);
+
+/*
+ *    Returns a column of tiles that is safe to write to, copying its chunk
+ *    first if it is shared with a snapshot. A paletted world is expanded
+ *    first. The column is marked as modified since the world was loaded.
+ *
+ *    @param wld_t *wld    The world to write to.
+ *    @param int    x      The column to write to.
+ *
+ *    @return tile_t *    The column, NULL on failure.
+ */
+tile_t *tile_column_mut(wld_t *wld, int x);
+
+/*
+ *    Returns whether a column was written through tile_column_mut since
+ *    the world was loaded.
+ *
+ *    @param wld_t *wld    The world.
+ *    @param int    x      The column.
+ *
+ *    @return unsigned int    1 if the column was modified, 0 if not.
+ */
+unsigned int tile_column_dirty(wld_t *wld, int x);
+
+/*
+ *    Releases the tiles of a world.
+ *
+ *    @param wld_t *wld    The world to release the tiles of.
+ */
+void tile_store_free(wld_t *wld);
+
+#endif /* WLD_TILESTORE_H  */
@@ -20,8 +20,15 @@ typedef struct {
     unsigned int      ver;
     wld_info_header_t info;
     wld_header_t      header;
+    /* Written only through tile_column_mut or tile_set, see tilestore.h.  */
     tile_t          **tiles;
+    unsigned long    *column_offsets;
+    tile_chunk_t    **tile_chunks;
+    unsigned char    *column_dirty;
+    tile_palette_t   *palette;
     short             chest_count;
+    /* Item slots each chest was loaded with, only the first 40 are read.  */
+    short             chest_item_count;
     chest_t          *chests;
     short             sign_count;
     sign_t           *signs;
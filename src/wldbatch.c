@@ -0,0 +1,876 @@
+/*
+ *    wldbatch.c    --    Source file for batch world loads and saves
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Defines batch loads and saves. Every file in flight has a slot, and
+ *    the calling thread hands slots to the I/O backend, then decodes or
+ *    encodes whichever world is ready while the rest are read or written.
+ *    The io_uring backend talks to the kernel rings directly, with a
+ *    write and its fsync linked so they go in together. The fallback runs
+ *    each slot's I/O on one of a few threads. Short reads and writes are
+ *    finished with plain calls on the calling thread.
+ */
+#define _GNU_SOURCE
+
+#include "wldbatch.h"
+
+#include "log.h"
+#include "wldsave.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef WLD_HAVE_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif /* WLD_HAVE_URING  */
+
+/* Completions of cancels carry this in their user data instead of a slot.  */
+#define WLD_BATCH_CANCEL (1UL << 33)
+
+#define WLD_BATCH_FREE    0
+#define WLD_BATCH_PENDING 1
+#define WLD_BATCH_RUNNING 2
+#define WLD_BATCH_DONE    3
+
+typedef struct {
+    unsigned long  index;
+    unsigned int   used;
+    int            state;
+    int            fd;
+    unsigned int   write;
+    unsigned char *buf;
+    unsigned long  len;
+    struct iovec   iov[WLD_ENCODED_SECTIONS];
+    wld_encoded_t  enc;
+    char          *tmp;
+    long           res;
+    long           sync_res;
+    unsigned int   pending;
+} wld_batch_slot_t;
+
+typedef struct {
+    wld_batch_slot_t  slots[WLD_BATCH_DEPTH];
+    unsigned int      uring;
+    pthread_t         threads[WLD_BATCH_DEPTH];
+    unsigned int      thread_count;
+    pthread_mutex_t   lock;
+    pthread_cond_t    cond;
+    unsigned int      stop;
+#ifdef WLD_HAVE_URING
+    int                  ring;
+    unsigned int        *sq_tail;
+    unsigned int        *sq_mask;
+    unsigned int        *sq_array;
+    unsigned int        *cq_head;
+    unsigned int        *cq_tail;
+    unsigned int        *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void                *sq_map;
+    void                *cq_map;
+    unsigned long        sq_len;
+    unsigned long        cq_len;
+    unsigned long        sqe_len;
+#endif /* WLD_HAVE_URING  */
+} wld_batch_io_t;
+
+static unsigned int _batch_uring = 1;
+
+/*
+ *    Enables or disables io_uring for batches, when it is built in.
+ *    Enabled by default; batches fall back to I/O threads without it.
+ *
+ *    @param unsigned int enabled    1 to use io_uring, 0 to use I/O threads.
+ */
+void wld_batch_set_uring(unsigned int enabled) {
+    _batch_uring = enabled != 0;
+}
+
+/*
+ *    Returns the time on the monotonic clock.
+ *
+ *    @return double    The time in seconds.
+ */
+static double wld_batch_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ *    Does a slot's I/O with plain calls, reading until the buffer is full
+ *    or writing every section and syncing.
+ *
+ *    @param wld_batch_slot_t *slot    The slot.
+ */
+static void wld_batch_do_io(wld_batch_slot_t *slot) {
+    slot->res      = 0;
+    slot->sync_res = 0;
+
+    if (!slot->write) {
+        while ((unsigned long)slot->res < slot->len) {
+            ssize_t got = pread(slot->fd, slot->buf + slot->res, slot->len - slot->res, slot->res);
+
+            if (got <= 0) {
+                slot->res = got < 0 ? -errno : slot->res;
+                return;
+            }
+
+            slot->res += got;
+        }
+
+        return;
+    }
+
+    int i;
+    for (i = 0; i < WLD_ENCODED_SECTIONS; ++i) {
+        unsigned long done = 0;
+
+        while (done < slot->iov[i].iov_len) {
+            ssize_t put = pwrite(slot->fd, (char *)slot->iov[i].iov_base + done, slot->iov[i].iov_len - done, slot->res);
+
+            if (put <= 0) {
+                slot->res = -EIO;
+                return;
+            }
+
+            done      += put;
+            slot->res += put;
+        }
+    }
+
+    slot->sync_res = fsync(slot->fd) == 0 ? 0 : -errno;
+}
+
+/*
+ *    Runs the I/O of pending slots on an I/O thread.
+ *
+ *    @param void *arg    The backend.
+ *
+ *    @return void *    NULL.
+ */
+static void *wld_batch_thread(void *arg) {
+    wld_batch_io_t *io = (wld_batch_io_t *)arg;
+
+    pthread_mutex_lock(&io->lock);
+
+    while (!io->stop) {
+        wld_batch_slot_t *slot = (wld_batch_slot_t *)0x0;
+
+        int i;
+        for (i = 0; i < WLD_BATCH_DEPTH && slot == (wld_batch_slot_t *)0x0; ++i) {
+            if (io->slots[i].state == WLD_BATCH_PENDING)
+                slot = &io->slots[i];
+        }
+
+        if (slot == (wld_batch_slot_t *)0x0) {
+            pthread_cond_wait(&io->cond, &io->lock);
+            continue;
+        }
+
+        slot->state = WLD_BATCH_RUNNING;
+        pthread_mutex_unlock(&io->lock);
+
+        wld_batch_do_io(slot);
+
+        pthread_mutex_lock(&io->lock);
+        slot->state = WLD_BATCH_DONE;
+        pthread_cond_broadcast(&io->cond);
+    }
+
+    pthread_mutex_unlock(&io->lock);
+
+    return (void *)0x0;
+}
+
+#ifdef WLD_HAVE_URING
+/*
+ *    Sets up an io_uring with room for every slot's I/O.
+ *
+ *    @param wld_batch_io_t *io    The backend.
+ *
+ *    @return unsigned int    1 on success, 0 if io_uring is not available.
+ */
+static unsigned int wld_batch_uring_init(wld_batch_io_t *io) {
+    struct io_uring_params params;
+
+    memset(&params, 0, sizeof(params));
+
+    io->ring = syscall(__NR_io_uring_setup, WLD_BATCH_DEPTH * 2, &params);
+
+    if (io->ring < 0)
+        return 0;
+
+    io->sq_len  = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    io->cq_len  = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    io->sqe_len = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) && io->cq_len > io->sq_len)
+        io->sq_len = io->cq_len;
+
+    io->sq_map = mmap(0, io->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, io->ring, IORING_OFF_SQ_RING);
+    io->cq_map = io->sq_map;
+
+    if (io->sq_map != MAP_FAILED && !(params.features & IORING_FEAT_SINGLE_MMAP))
+        io->cq_map = mmap(0, io->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, io->ring, IORING_OFF_CQ_RING);
+
+    io->sqes = (struct io_uring_sqe *)mmap(0, io->sqe_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, io->ring, IORING_OFF_SQES);
+
+    if (io->sq_map == MAP_FAILED || io->cq_map == MAP_FAILED || io->sqes == MAP_FAILED) {
+        if (io->sqes != MAP_FAILED)
+            munmap(io->sqes, io->sqe_len);
+        if (io->cq_map != MAP_FAILED && io->cq_map != io->sq_map)
+            munmap(io->cq_map, io->cq_len);
+        if (io->sq_map != MAP_FAILED)
+            munmap(io->sq_map, io->sq_len);
+
+        close(io->ring);
+        return 0;
+    }
+
+    io->sq_tail  = (unsigned int *)((char *)io->sq_map + params.sq_off.tail);
+    io->sq_mask  = (unsigned int *)((char *)io->sq_map + params.sq_off.ring_mask);
+    io->sq_array = (unsigned int *)((char *)io->sq_map + params.sq_off.array);
+    io->cq_head  = (unsigned int *)((char *)io->cq_map + params.cq_off.head);
+    io->cq_tail  = (unsigned int *)((char *)io->cq_map + params.cq_off.tail);
+    io->cq_mask  = (unsigned int *)((char *)io->cq_map + params.cq_off.ring_mask);
+    io->cqes     = (struct io_uring_cqe *)((char *)io->cq_map + params.cq_off.cqes);
+
+    return 1;
+}
+
+/*
+ *    Queues a submission on the ring. The caller enters the ring after.
+ *
+ *    @param wld_batch_io_t *io    The backend.
+ *
+ *    @return struct io_uring_sqe *    The cleared submission to fill.
+ */
+static struct io_uring_sqe *wld_batch_uring_sqe(wld_batch_io_t *io) {
+    unsigned int         tail = *io->sq_tail;
+    unsigned int         idx  = tail & *io->sq_mask;
+    struct io_uring_sqe *sqe  = &io->sqes[idx];
+
+    memset(sqe, 0, sizeof(*sqe));
+    io->sq_array[idx] = idx;
+
+    /* The kernel must see the submission before the new tail.  */
+    __atomic_store_n(io->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    return sqe;
+}
+
+/*
+ *    Submits a slot's I/O to the ring. A write is linked to an fsync, so
+ *    the sync only starts once the write is done.
+ *
+ *    @param wld_batch_io_t   *io      The backend.
+ *    @param wld_batch_slot_t *slot    The slot.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int wld_batch_uring_submit(wld_batch_io_t *io, wld_batch_slot_t *slot) {
+    unsigned long        id  = slot - io->slots;
+    struct io_uring_sqe *sqe = wld_batch_uring_sqe(io);
+
+    slot->res      = 0;
+    slot->sync_res = 0;
+
+    if (!slot->write) {
+        sqe->opcode    = IORING_OP_READ;
+        sqe->fd        = slot->fd;
+        sqe->addr      = (unsigned long)slot->buf;
+        sqe->len       = slot->len > 0x7FFFF000 ? 0x7FFFF000 : slot->len;
+        sqe->user_data = id;
+        slot->pending  = 1;
+    } else {
+        sqe->opcode    = IORING_OP_WRITEV;
+        sqe->fd        = slot->fd;
+        sqe->addr      = (unsigned long)slot->iov;
+        sqe->len       = WLD_ENCODED_SECTIONS;
+        sqe->flags     = IOSQE_IO_LINK;
+        sqe->user_data = id;
+
+        sqe = wld_batch_uring_sqe(io);
+
+        sqe->opcode    = IORING_OP_FSYNC;
+        sqe->fd        = slot->fd;
+        sqe->user_data = id | 1UL << 32;
+        slot->pending  = 2;
+    }
+
+    int ret;
+    do {
+        ret = syscall(__NR_io_uring_enter, io->ring, slot->pending, 0, 0, (void *)0x0, 0);
+    } while (ret < 0 && errno == EINTR);
+
+    return ret >= 0;
+}
+
+/*
+ *    Waits for the ring to finish a slot's I/O.
+ *
+ *    @param wld_batch_io_t *io    The backend.
+ *
+ *    @return wld_batch_slot_t *    The finished slot, NULL on failure.
+ */
+static wld_batch_slot_t *wld_batch_uring_wait(wld_batch_io_t *io) {
+    for (;;) {
+        unsigned int head = *io->cq_head;
+
+        if (head == __atomic_load_n(io->cq_tail, __ATOMIC_ACQUIRE)) {
+            int ret = syscall(__NR_io_uring_enter, io->ring, 0, 1, IORING_ENTER_GETEVENTS, (void *)0x0, 0);
+
+            if (ret < 0 && errno != EINTR) {
+                LOGF_ERR("Failed to wait for io_uring.\n");
+                return (wld_batch_slot_t *)0x0;
+            }
+
+            continue;
+        }
+
+        struct io_uring_cqe *cqe  = &io->cqes[head & *io->cq_mask];
+        wld_batch_slot_t    *slot = &io->slots[cqe->user_data & 0xFFFFFFFF];
+
+        if (cqe->user_data & WLD_BATCH_CANCEL) {
+            __atomic_store_n(io->cq_head, head + 1, __ATOMIC_RELEASE);
+            continue;
+        }
+
+        if (cqe->user_data >> 32)
+            slot->sync_res = cqe->res;
+        else
+            slot->res = cqe->res;
+
+        __atomic_store_n(io->cq_head, head + 1, __ATOMIC_RELEASE);
+
+        if (--slot->pending == 0) {
+            slot->state = WLD_BATCH_DONE;
+            return slot;
+        }
+    }
+}
+
+/*
+ *    Cancels the I/O a broken batch left on the ring, and reaps it until
+ *    the kernel is done with every slot.
+ *
+ *    @param wld_batch_io_t *io    The backend.
+ *
+ *    @return unsigned int    1 once nothing is in flight, 0 if the ring could not be drained.
+ */
+static unsigned int wld_batch_uring_cancel(wld_batch_io_t *io) {
+    unsigned int count = 0;
+
+    int i;
+    for (i = 0; i < WLD_BATCH_DEPTH; ++i) {
+        wld_batch_slot_t *slot = &io->slots[i];
+
+        if (!slot->used || slot->pending == 0)
+            continue;
+
+        /* A write's fsync is cancelled on its own, in case the write is already done.  */
+        unsigned int j;
+        for (j = 0; j < (slot->write ? 2U : 1U); ++j) {
+            struct io_uring_sqe *sqe = wld_batch_uring_sqe(io);
+
+            sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+            sqe->addr      = (unsigned long)i | (unsigned long)j << 32;
+            sqe->user_data = WLD_BATCH_CANCEL;
+            ++count;
+        }
+    }
+
+    if (count == 0)
+        return 1;
+
+    int ret;
+    do {
+        ret = syscall(__NR_io_uring_enter, io->ring, count, 0, 0, (void *)0x0, 0);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret < 0) {
+        LOGF_ERR("Failed to cancel io_uring requests.\n");
+        return 0;
+    }
+
+    for (;;) {
+        for (i = 0; i < WLD_BATCH_DEPTH; ++i) {
+            if (io->slots[i].used && io->slots[i].pending > 0)
+                break;
+        }
+
+        if (i == WLD_BATCH_DEPTH)
+            return 1;
+
+        if (wld_batch_uring_wait(io) == (wld_batch_slot_t *)0x0)
+            return 0;
+    }
+}
+#endif /* WLD_HAVE_URING  */
+
+/*
+ *    Starts a backend, trying io_uring first.
+ *
+ *    @param wld_batch_io_t *io    The backend.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int wld_batch_io_init(wld_batch_io_t *io) {
+    memset(io, 0, sizeof(*io));
+
+#ifdef WLD_HAVE_URING
+    if (_batch_uring && wld_batch_uring_init(io)) {
+        io->uring = 1;
+        return 1;
+    }
+#endif /* WLD_HAVE_URING  */
+
+    pthread_mutex_init(&io->lock, (pthread_mutexattr_t *)0x0);
+    pthread_cond_init(&io->cond, (pthread_condattr_t *)0x0);
+
+    for (io->thread_count = 0; io->thread_count < WLD_BATCH_DEPTH; ++io->thread_count) {
+        if (pthread_create(&io->threads[io->thread_count], (pthread_attr_t *)0x0, wld_batch_thread, io) != 0)
+            break;
+    }
+
+    if (io->thread_count == 0) {
+        LOGF_ERR("Failed to start batch I/O threads.\n");
+        pthread_cond_destroy(&io->cond);
+        pthread_mutex_destroy(&io->lock);
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ *    Stops a backend. The I/O still on a ring is cancelled and reaped
+ *    first, and the threads finish what they started, so the slots can
+ *    be freed after. A ring that cannot be drained may still read into
+ *    or write from its slots, whose buffers then have to be leaked.
+ *
+ *    @param wld_batch_io_t *io    The backend.
+ *
+ *    @return unsigned int    1 if the slots can be freed, 0 if their buffers have to be leaked.
+ */
+static unsigned int wld_batch_io_free(wld_batch_io_t *io) {
+#ifdef WLD_HAVE_URING
+    if (io->uring) {
+        unsigned int drained = wld_batch_uring_cancel(io);
+
+        munmap(io->sqes, io->sqe_len);
+        if (io->cq_map != io->sq_map)
+            munmap(io->cq_map, io->cq_len);
+        munmap(io->sq_map, io->sq_len);
+        close(io->ring);
+
+        return drained;
+    }
+#endif /* WLD_HAVE_URING  */
+
+    pthread_mutex_lock(&io->lock);
+    io->stop = 1;
+    pthread_cond_broadcast(&io->cond);
+    pthread_mutex_unlock(&io->lock);
+
+    unsigned int i;
+    for (i = 0; i < io->thread_count; ++i)
+        pthread_join(io->threads[i], (void **)0x0);
+
+    pthread_cond_destroy(&io->cond);
+    pthread_mutex_destroy(&io->lock);
+
+    return 1;
+}
+
+/*
+ *    Hands a filled slot to the backend.
+ *
+ *    @param wld_batch_io_t   *io      The backend.
+ *    @param wld_batch_slot_t *slot    The slot.
+ */
+static void wld_batch_io_submit(wld_batch_io_t *io, wld_batch_slot_t *slot) {
+    slot->used = 1;
+
+#ifdef WLD_HAVE_URING
+    if (io->uring) {
+        slot->state = WLD_BATCH_RUNNING;
+
+        /* Whatever the ring refused is done here instead.  */
+        if (!wld_batch_uring_submit(io, slot)) {
+            wld_batch_do_io(slot);
+            slot->pending = 0;
+            slot->state   = WLD_BATCH_DONE;
+        }
+
+        return;
+    }
+#endif /* WLD_HAVE_URING  */
+
+    pthread_mutex_lock(&io->lock);
+    slot->state = WLD_BATCH_PENDING;
+    pthread_cond_broadcast(&io->cond);
+    pthread_mutex_unlock(&io->lock);
+}
+
+/*
+ *    Waits for any slot's I/O to finish, and finishes reads and writes
+ *    the backend left short.
+ *
+ *    @param wld_batch_io_t *io    The backend.
+ *
+ *    @return wld_batch_slot_t *    The finished slot, NULL on failure.
+ */
+static wld_batch_slot_t *wld_batch_io_wait(wld_batch_io_t *io) {
+    wld_batch_slot_t *slot = (wld_batch_slot_t *)0x0;
+
+    int i;
+    for (i = 0; i < WLD_BATCH_DEPTH && slot == (wld_batch_slot_t *)0x0; ++i) {
+        if (io->uring && io->slots[i].state == WLD_BATCH_DONE)
+            slot = &io->slots[i];
+    }
+
+#ifdef WLD_HAVE_URING
+    if (io->uring && slot == (wld_batch_slot_t *)0x0)
+        slot = wld_batch_uring_wait(io);
+#endif /* WLD_HAVE_URING  */
+
+    /* The slot stays used until the caller is done with it.  */
+    if (io->uring && slot != (wld_batch_slot_t *)0x0)
+        slot->state = WLD_BATCH_FREE;
+
+    if (!io->uring) {
+        pthread_mutex_lock(&io->lock);
+
+        while (slot == (wld_batch_slot_t *)0x0) {
+            for (i = 0; i < WLD_BATCH_DEPTH && slot == (wld_batch_slot_t *)0x0; ++i) {
+                if (io->slots[i].state == WLD_BATCH_DONE)
+                    slot = &io->slots[i];
+            }
+
+            if (slot == (wld_batch_slot_t *)0x0)
+                pthread_cond_wait(&io->cond, &io->lock);
+        }
+
+        slot->state = WLD_BATCH_FREE;
+        pthread_mutex_unlock(&io->lock);
+    }
+
+    if (slot == (wld_batch_slot_t *)0x0)
+        return slot;
+
+    unsigned long total = slot->len;
+
+    if (slot->write) {
+        total = 0;
+        for (i = 0; i < WLD_ENCODED_SECTIONS; ++i)
+            total += slot->iov[i].iov_len;
+    }
+
+    /* A short read or write, which cuts the link to the fsync, is redone.  */
+    if (slot->res >= 0 && (unsigned long)slot->res < total)
+        wld_batch_do_io(slot);
+
+    return slot;
+}
+
+/*
+ *    Fills in the stats of a finished batch and logs them.
+ *
+ *    @param wld_batch_stats_t *stats    The stats.
+ *    @param double             start    When the batch started.
+ *    @param const char        *verb     What the batch did.
+ */
+static void wld_batch_report(wld_batch_stats_t *stats, double start, const char *verb) {
+    stats->time       = wld_batch_now() - start;
+    stats->throughput = stats->time > 0.0 ? stats->bytes / stats->time : 0.0;
+
+    VLOGF_NOTE("%s %lu worlds (%lu failed), %.1f MB in %.3f s through %s, %.1f MB/s, %.3f s decoding or encoding.\n", verb,
+               stats->worlds, stats->failed, stats->bytes / 1e6, stats->time, stats->uring ? "io_uring" : "threads",
+               stats->throughput / 1e6, stats->busy_time);
+}
+
+/*
+ *    Loads many worlds, decoding each as soon as its file is read while
+ *    the next files are still being read.
+ *
+ *    @param const char *const *paths     The files to load.
+ *    @param unsigned long      count     The number of files.
+ *    @param wld_t            **worlds    Filled with the worlds, NULL for those that failed.
+ *    @param wld_batch_stats_t *stats     Filled with what the batch did, may be NULL.
+ *
+ *    @return unsigned int    1 if every world loaded, 0 otherwise.
+ */
+unsigned int wld_batch_load(const char *const *paths, unsigned long count, wld_t **worlds, wld_batch_stats_t *stats) {
+    wld_batch_stats_t local;
+    wld_batch_io_t    io;
+    double            start = wld_batch_now();
+
+    if (stats == (wld_batch_stats_t *)0x0)
+        stats = &local;
+
+    memset(stats, 0, sizeof(*stats));
+
+    if (paths == (const char *const *)0x0 || worlds == (wld_t **)0x0) {
+        LOGF_ERR("Paths or worlds are NULL.\n");
+        return 0;
+    }
+
+    /* A broken ring ends the batch early, so every world starts out failed.  */
+    unsigned long next;
+    for (next = 0; next < count; ++next)
+        worlds[next] = (wld_t *)0x0;
+
+    if (!wld_batch_io_init(&io))
+        return 0;
+
+    stats->worlds = count;
+    stats->uring  = io.uring;
+
+    unsigned long flight = 0;
+
+    next = 0;
+
+    while (next < count || flight > 0) {
+        /* Keep every slot reading while there are files left.  */
+        int i;
+        for (i = 0; i < WLD_BATCH_DEPTH && next < count; ++i) {
+            wld_batch_slot_t *slot = &io.slots[i];
+            struct stat       st;
+
+            if (slot->used)
+                continue;
+
+            slot->index = next++;
+            slot->write = 0;
+            slot->fd    = open(paths[slot->index], O_RDONLY);
+
+            if (slot->fd < 0 || fstat(slot->fd, &st) != 0 ||
+                (slot->buf = (unsigned char *)malloc(st.st_size > 0 ? st.st_size : 1)) == (unsigned char *)0x0) {
+                VLOGF_ERR("Failed to read %s.\n", paths[slot->index]);
+
+                if (slot->fd >= 0)
+                    close(slot->fd);
+
+                stats->failed++;
+                continue;
+            }
+
+            slot->len = st.st_size;
+            flight++;
+
+            wld_batch_io_submit(&io, slot);
+        }
+
+        if (flight == 0)
+            continue;
+
+        wld_batch_slot_t *slot = wld_batch_io_wait(&io);
+
+        if (slot == (wld_batch_slot_t *)0x0)
+            break;
+
+        close(slot->fd);
+        flight--;
+
+        /* Decoding this one overlaps with reading the others.  */
+        if (slot->res >= 0 && (unsigned long)slot->res == slot->len) {
+            double busy = wld_batch_now();
+
+            stats->bytes          += slot->len;
+            worlds[slot->index]    = wld_open_buffer(slot->buf, slot->len, paths[slot->index]);
+            stats->busy_time      += wld_batch_now() - busy;
+        } else {
+            VLOGF_ERR("Failed to read %s.\n", paths[slot->index]);
+            free(slot->buf);
+        }
+
+        if (worlds[slot->index] == (wld_t *)0x0)
+            stats->failed++;
+
+        slot->buf  = (unsigned char *)0x0;
+        slot->used = 0;
+    }
+
+    /*
+     *    Only a broken ring leaves slots behind. Their reads are cancelled
+     *    before their buffers are freed, or the buffers are leaked if the
+     *    ring cannot be drained, and the files no slot got to failed too.
+     */
+    unsigned int drained = wld_batch_io_free(&io);
+
+    stats->failed += count - next;
+
+    int i;
+    for (i = 0; i < WLD_BATCH_DEPTH; ++i) {
+        wld_batch_slot_t *slot = &io.slots[i];
+
+        if (!slot->used)
+            continue;
+
+        close(slot->fd);
+
+        if (drained)
+            free(slot->buf);
+
+        slot->buf  = (unsigned char *)0x0;
+        slot->used = 0;
+        stats->failed++;
+    }
+
+    wld_batch_report(stats, start, "Loaded");
+
+    return stats->failed == 0;
+}
+
+/*
+ *    Finishes a slot's save, renaming its file into place.
+ *
+ *    @param wld_batch_slot_t  *slot     The slot.
+ *    @param const char        *path     The file being saved.
+ *    @param wld_batch_stats_t *stats    The stats.
+ */
+static void wld_batch_save_finish(wld_batch_slot_t *slot, const char *path, wld_batch_stats_t *stats) {
+    unsigned long total = 0;
+
+    int i;
+    for (i = 0; i < WLD_ENCODED_SECTIONS; ++i)
+        total += slot->iov[i].iov_len;
+
+    unsigned int ok = slot->res >= 0 && (unsigned long)slot->res == total && slot->sync_res == 0;
+
+    if (wld_save_finish(&slot->enc, slot->fd, slot->tmp, path, ok))
+        stats->bytes += total;
+    else
+        stats->failed++;
+
+    wld_encoded_free(&slot->enc);
+
+    slot->tmp  = (char *)0x0;
+    slot->used = 0;
+}
+
+/*
+ *    Saves many worlds, encoding each while the files before it are
+ *    still being written. Every file is committed like wld_save_commit.
+ *
+ *    @param wld_t *const      *worlds    The worlds to save.
+ *    @param const char *const *paths     The files to save them to.
+ *    @param unsigned long      count     The number of worlds.
+ *    @param wld_batch_stats_t *stats     Filled with what the batch did, may be NULL.
+ *
+ *    @return unsigned int    1 if every world saved, 0 otherwise.
+ */
+unsigned int wld_batch_save(wld_t *const *worlds, const char *const *paths, unsigned long count, wld_batch_stats_t *stats) {
+    wld_batch_stats_t local;
+    wld_batch_io_t    io;
+    double            start = wld_batch_now();
+
+    if (stats == (wld_batch_stats_t *)0x0)
+        stats = &local;
+
+    memset(stats, 0, sizeof(*stats));
+
+    if (paths == (const char *const *)0x0 || worlds == (wld_t *const *)0x0) {
+        LOGF_ERR("Paths or worlds are NULL.\n");
+        return 0;
+    }
+
+    if (!wld_batch_io_init(&io))
+        return 0;
+
+    stats->worlds = count;
+    stats->uring  = io.uring;
+
+    unsigned long next   = 0;
+    unsigned long flight = 0;
+
+    while (next < count || flight > 0) {
+        wld_batch_slot_t *slot = (wld_batch_slot_t *)0x0;
+
+        int i;
+        for (i = 0; i < WLD_BATCH_DEPTH && next < count && slot == (wld_batch_slot_t *)0x0; ++i) {
+            if (!io.slots[i].used)
+                slot = &io.slots[i];
+        }
+
+        /* Encoding this one overlaps with writing the others.  */
+        if (slot != (wld_batch_slot_t *)0x0) {
+            double busy = wld_batch_now();
+
+            slot->index = next++;
+            slot->write = 1;
+
+            if (worlds[slot->index] == (wld_t *)0x0 || !wld_encode(worlds[slot->index], &slot->enc)) {
+                VLOGF_ERR("Failed to encode %s.\n", paths[slot->index]);
+                stats->failed++;
+                continue;
+            }
+
+            stats->busy_time += wld_batch_now() - busy;
+            slot->tmp         = wld_save_begin(paths[slot->index], &slot->fd);
+
+            if (slot->tmp == (char *)0x0) {
+                wld_encoded_free(&slot->enc);
+                stats->failed++;
+                continue;
+            }
+
+            for (i = 0; i < WLD_ENCODED_SECTIONS; ++i) {
+                slot->iov[i].iov_base = slot->enc.sections[i];
+                slot->iov[i].iov_len  = slot->enc.sizes[i];
+            }
+
+            flight++;
+            wld_batch_io_submit(&io, slot);
+
+            continue;
+        }
+
+        slot = wld_batch_io_wait(&io);
+
+        if (slot == (wld_batch_slot_t *)0x0)
+            break;
+
+        flight--;
+        wld_batch_save_finish(slot, paths[slot->index], stats);
+    }
+
+    /*
+     *    Only a broken ring leaves slots behind, and their saves are
+     *    abandoned. Their writes are cancelled before their sections are
+     *    freed, or the sections are leaked if the ring cannot be drained,
+     *    and the worlds no slot got to failed too.
+     */
+    unsigned int drained = wld_batch_io_free(&io);
+
+    stats->failed += count - next;
+
+    int i;
+    for (i = 0; i < WLD_BATCH_DEPTH; ++i) {
+        if (io.slots[i].used) {
+            if (!drained)
+                memset(&io.slots[i].enc, 0, sizeof(io.slots[i].enc));
+
+            io.slots[i].res = -EIO;
+            wld_batch_save_finish(&io.slots[i], paths[io.slots[i].index], stats);
+        }
+    }
+
+    wld_batch_report(stats, start, "Saved");
+
+    return stats->failed == 0;
+}
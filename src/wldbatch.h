@@ -0,0 +1,70 @@
+/*
+ *    wldbatch.h    --    Header file for batch world loads and saves
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Declares the functions used to load or save many worlds at once, as
+ *    a host does when it starts or stops. Several files are read or
+ *    written at a time while the calling thread decodes or encodes the
+ *    next world, through io_uring when it is built in with WLD_HAVE_URING
+ *    and available, or through I/O threads otherwise.
+ */
+#ifndef WLD_WLDBATCH_H
+#define WLD_WLDBATCH_H
+
+#include "wldlib.h"
+
+/*
+ *    The most files read or written at once.
+ */
+#define WLD_BATCH_DEPTH 8
+
+/*
+ *    What a batch did. Times are in seconds, and the throughput is in
+ *    bytes of files read or written per second of the whole batch.
+ */
+typedef struct {
+    unsigned long worlds;
+    unsigned long failed;
+    unsigned long bytes;
+    double        time;
+    double        busy_time;
+    double        throughput;
+    unsigned int  uring;
+} wld_batch_stats_t;
+
+/*
+ *    Enables or disables io_uring for batches, when it is built in.
+ *    Enabled by default; batches fall back to I/O threads without it.
+ *
+ *    @param unsigned int enabled    1 to use io_uring, 0 to use I/O threads.
+ */
+void wld_batch_set_uring(unsigned int enabled);
+
+/*
+ *    Loads many worlds, decoding each as soon as its file is read while
+ *    the next files are still being read.
+ *
+ *    @param const char *const *paths     The files to load.
+ *    @param unsigned long      count     The number of files.
+ *    @param wld_t            **worlds    Filled with the worlds, NULL for those that failed.
+ *    @param wld_batch_stats_t *stats     Filled with what the batch did, may be NULL.
+ *
+ *    @return unsigned int    1 if every world loaded, 0 otherwise.
+ */
+unsigned int wld_batch_load(const char *const *paths, unsigned long count, wld_t **worlds, wld_batch_stats_t *stats);
+
+/*
+ *    Saves many worlds, encoding each while the files before it are
+ *    still being written. Every file is committed like wld_save_commit.
+ *
+ *    @param wld_t *const      *worlds    The worlds to save.
+ *    @param const char *const *paths     The files to save them to.
+ *    @param unsigned long      count     The number of worlds.
+ *    @param wld_batch_stats_t *stats     Filled with what the batch did, may be NULL.
+ *
+ *    @return unsigned int    1 if every world saved, 0 otherwise.
+ */
+unsigned int wld_batch_save(wld_t *const *worlds, const char *const *paths, unsigned long count, wld_batch_stats_t *stats);
+
+#endif /* WLD_WLDBATCH_H  */
@@ -0,0 +1,331 @@
+/*
+ *    wldcache.c    --    Source file for the decoded world cache
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Defines the sidecar cache. The cache of "world.wld" is "world.wld.cache"
+ *    and holds a header describing the file it was made from, the column
+ *    offsets of the tile section, and the decoded tiles column by column
+ *    starting on a page boundary. Loading maps the file privately, so edits
+ *    to the tiles copy the touched pages and never reach the cache.
+ */
+#include "wldcache.h"
+
+#include "log.h"
+#include "tilepalette.h"
+#include "tilestore.h"
+
+#include <fcntl.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define WLD_CACHE_VERSION 1
+
+typedef struct {
+    char               sig[8];
+    int                ver;
+    int                tile_size;
+    unsigned long      src_len;
+    long long          src_mtime;
+    long               src_mtime_nsec;
+    unsigned long long src_hash;
+    int                width;
+    int                height;
+    unsigned long      offsets_pos;
+    unsigned long      tiles_pos;
+} wld_cache_header_t;
+
+static unsigned int _cache_enabled = 0;
+
+/*
+ *    Enables or disables the cache for wld_open. Disabled by default.
+ *
+ *    @param unsigned int enabled    1 to enable the cache, 0 to disable it.
+ */
+void wld_cache_set_enabled(unsigned int enabled) {
+    _cache_enabled = enabled != 0;
+}
+
+/*
+ *    Returns whether wld_open uses the cache.
+ *
+ *    @return unsigned int    1 if the cache is enabled, 0 otherwise.
+ */
+unsigned int wld_cache_enabled(void) {
+    return _cache_enabled;
+}
+
+/*
+ *    Builds the path of a world's cache.
+ *
+ *    @param const char *path      The world file.
+ *    @param const char *suffix    The suffix to append.
+ *
+ *    @return char *    The cache path, NULL on failure.
+ */
+static char *wld_cache_path(const char *path, const char *suffix) {
+    char *cache = (char *)malloc(strlen(path) + strlen(suffix) + 1);
+
+    if (cache == (char *)0x0) {
+        LOGF_ERR("Failed to allocate memory for cache path.\n");
+        return (char *)0x0;
+    }
+
+    strcpy(cache, path);
+    strcat(cache, suffix);
+
+    return cache;
+}
+
+/*
+ *    Fills a cache header with what identifies a world file.
+ *
+ *    @param wld_t              *wld       The world loaded from the file.
+ *    @param const char         *path      The world file.
+ *    @param wld_cache_header_t *header    The header to fill.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int wld_cache_identify(wld_t *wld, const char *path, wld_cache_header_t *header) {
+    struct stat st;
+
+    if (stat(path, &st) != 0)
+        return 0;
+
+    memset(header, 0, sizeof(*header));
+    memcpy(header->sig, "wldcache", 8);
+
+    header->ver            = WLD_CACHE_VERSION;
+    header->tile_size      = sizeof(tile_t);
+    header->src_len        = st.st_size;
+    header->src_mtime      = st.st_mtim.tv_sec;
+    header->src_mtime_nsec = st.st_mtim.tv_nsec;
+    header->width          = wld->header.width;
+    header->height         = wld->header.height;
+
+    return 1;
+}
+
+/*
+ *    Maps the cached tile grid of a world. The world must already have
+ *    its file stream and headers loaded. The cache is only used when the
+ *    size, modification time and checksum of the world file match the
+ *    ones it was made from.
+ *
+ *    @param wld_t              *wld     The world to load the tiles of.
+ *    @param const char         *path    The world file the world was loaded from.
+ *    @param unsigned long long  hash    The FNV-1a hash of the world file.
+ *
+ *    @return unsigned int    1 if the tiles were mapped, 0 if the cache is missing or stale.
+ */
+unsigned int wld_cache_load(wld_t *wld, const char *path, unsigned long long hash) {
+    if (wld == (wld_t *)0x0 || wld->file == (filestream_t *)0x0) {
+        LOGF_ERR("World has no file stream.\n");
+        return 0;
+    }
+
+    wld_cache_header_t expected;
+
+    /* Size and mtime are checked before opening anything.  */
+    if (!wld_cache_identify(wld, path, &expected) || expected.src_len != wld->file->len)
+        return 0;
+
+    char *cache = wld_cache_path(path, ".cache");
+
+    if (cache == (char *)0x0)
+        return 0;
+
+    int fd = open(cache, O_RDONLY);
+    free(cache);
+
+    if (fd < 0)
+        return 0;
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || (unsigned long)st.st_size < sizeof(wld_cache_header_t)) {
+        close(fd);
+        return 0;
+    }
+
+    unsigned long len = st.st_size;
+    void         *map = mmap((void *)0x0, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED) {
+        LOGF_WARN("Failed to map world cache.\n");
+        return 0;
+    }
+
+    wld_cache_header_t *header = (wld_cache_header_t *)map;
+    unsigned long       column = sizeof(tile_t) * header->height;
+
+    if (memcmp(header->sig, expected.sig, 8) != 0 || header->ver != expected.ver ||
+        header->tile_size != expected.tile_size || header->src_len != expected.src_len ||
+        header->src_mtime != expected.src_mtime || header->src_mtime_nsec != expected.src_mtime_nsec ||
+        header->width != expected.width || header->height != expected.height ||
+        header->offsets_pos + sizeof(unsigned long) * (header->width + 1) > header->tiles_pos ||
+        header->tiles_pos + column * header->width > len || header->src_hash != hash) {
+        munmap(map, len);
+        return 0;
+    }
+
+    /* The offsets are copied out, the mapping goes away with the last chunk.  */
+    wld->column_offsets = (unsigned long *)malloc(sizeof(unsigned long) * (header->width + 1));
+
+    if (wld->column_offsets == (unsigned long *)0x0) {
+        LOGF_ERR("Failed to allocate memory for column offsets.\n");
+        munmap(map, len);
+        return 0;
+    }
+
+    memcpy(wld->column_offsets, (unsigned char *)map + header->offsets_pos, sizeof(unsigned long) * (header->width + 1));
+
+    if (!tile_store_map(wld, map, len, header->tiles_pos)) {
+        free(wld->column_offsets);
+        wld->column_offsets = (unsigned long *)0x0;
+        munmap(map, len);
+        return 0;
+    }
+
+    wld->file->pos = wld->info.sections[2];
+
+    return 1;
+}
+
+/*
+ *    Starts writing the tile grid of a world to its cache, which
+ *    wld_cache_store_columns then does a few columns at a time.
+ *
+ *    @param wld_cache_writer_t *writer    The writer to start.
+ *    @param wld_t              *wld       The world to cache the tiles of.
+ *    @param const char         *path      The world file the world was loaded from.
+ *    @param unsigned long long  hash      The FNV-1a hash of the world file.
+ *
+ *    @return unsigned int    1 on success, 0 on failure, in which case there is nothing to end.
+ */
+unsigned int wld_cache_store_begin(wld_cache_writer_t *writer, wld_t *wld, const char *path, unsigned long long hash) {
+    memset(writer, 0, sizeof(*writer));
+
+    if (wld == (wld_t *)0x0 || wld->file == (filestream_t *)0x0 || wld->column_offsets == (unsigned long *)0x0) {
+        LOGF_ERR("World was not loaded from a file.\n");
+        return 0;
+    }
+
+    wld_cache_header_t header;
+
+    if (!wld_cache_identify(wld, path, &header)) {
+        VLOGF_ERR("Failed to stat %s.\n", path);
+        return 0;
+    }
+
+    unsigned long page = sysconf(_SC_PAGESIZE);
+
+    header.src_hash    = hash;
+    header.offsets_pos = sizeof(header);
+    header.tiles_pos   = header.offsets_pos + sizeof(unsigned long) * (header.width + 1);
+    header.tiles_pos   = (header.tiles_pos + page - 1) / page * page;
+
+    writer->cache = wld_cache_path(path, ".cache");
+    writer->tmp   = wld_cache_path(path, ".cache.tmp");
+
+    /* Paletted columns are expanded here, since the cache holds full tiles.  */
+    writer->scratch = (tile_t *)malloc(sizeof(tile_t) * header.height);
+
+    if (writer->cache == (char *)0x0 || writer->tmp == (char *)0x0 || writer->scratch == (tile_t *)0x0) {
+        LOGF_ERR("Failed to allocate memory for cache.\n");
+        free(writer->cache);
+        free(writer->tmp);
+        free(writer->scratch);
+        return 0;
+    }
+
+    writer->fp = fopen(writer->tmp, "wb");
+
+    if (writer->fp == (FILE *)0x0) {
+        VLOGF_ERR("Failed to open %s.\n", writer->tmp);
+        free(writer->cache);
+        free(writer->tmp);
+        free(writer->scratch);
+        return 0;
+    }
+
+    fwrite(&header, sizeof(header), 1, writer->fp);
+    fwrite(wld->column_offsets, sizeof(unsigned long), header.width + 1, writer->fp);
+    fseek(writer->fp, header.tiles_pos, SEEK_SET);
+
+    return 1;
+}
+
+/*
+ *    Writes the next columns of a cache.
+ *
+ *    @param wld_cache_writer_t *writer    The writer.
+ *    @param wld_t              *wld       The world being cached.
+ *    @param int                 count     The most columns to write.
+ *
+ *    @return unsigned int    1 once every column is written, 0 if there are more.
+ */
+unsigned int wld_cache_store_columns(wld_cache_writer_t *writer, wld_t *wld, int count) {
+    int end = writer->column + count > wld->header.width ? wld->header.width : writer->column + count;
+
+    for (; writer->column < end; ++writer->column)
+        fwrite(tile_column_get(wld, writer->column, writer->scratch), sizeof(tile_t), wld->header.height, writer->fp);
+
+    return writer->column == wld->header.width;
+}
+
+/*
+ *    Finishes writing a cache, renaming it into place, or throws it away.
+ *
+ *    @param wld_cache_writer_t *writer    The writer, which is released.
+ *    @param unsigned int        keep      1 to keep the cache, 0 to throw it away.
+ *
+ *    @return unsigned int    1 if the cache was written, 0 otherwise.
+ */
+unsigned int wld_cache_store_end(wld_cache_writer_t *writer, unsigned int keep) {
+    unsigned int ret = keep && ferror(writer->fp) == 0;
+
+    if (fclose(writer->fp) != 0)
+        ret = 0;
+
+    /* Renaming over the old cache means a reader never sees half of one.  */
+    if (ret == 0 || rename(writer->tmp, writer->cache) != 0) {
+        if (keep)
+            VLOGF_ERR("Failed to write %s.\n", writer->cache);
+        remove(writer->tmp);
+        ret = 0;
+    }
+
+    free(writer->scratch);
+    free(writer->cache);
+    free(writer->tmp);
+
+    memset(writer, 0, sizeof(*writer));
+
+    return ret;
+}
+
+/*
+ *    Writes the tile grid of a world to its cache in one go.
+ *
+ *    @param wld_t              *wld     The world to cache the tiles of.
+ *    @param const char         *path    The world file the world was loaded from.
+ *    @param unsigned long long  hash    The FNV-1a hash of the world file.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int wld_cache_store(wld_t *wld, const char *path, unsigned long long hash) {
+    wld_cache_writer_t writer;
+
+    if (!wld_cache_store_begin(&writer, wld, path, hash))
+        return 0;
+
+    wld_cache_store_columns(&writer, wld, wld->header.width);
+
+    return wld_cache_store_end(&writer, 1);
+}
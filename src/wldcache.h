@@ -0,0 +1,101 @@
+/*
+ *    wldcache.h    --    Header file for the decoded world cache
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Declares the sidecar cache that holds a world's decoded tile grid
+ *    next to the world file, laid out so it can be mapped straight back
+ *    into a wld_t without decoding the tile section.
+ */
+#ifndef WLD_WLDCACHE_H
+#define WLD_WLDCACHE_H
+
+#include "wld.h"
+
+#include <stdio.h>
+
+/*
+ *    A cache being written a few columns at a time.
+ */
+typedef struct {
+    FILE   *fp;
+    char   *cache;
+    char   *tmp;
+    tile_t *scratch;
+    int     column;
+} wld_cache_writer_t;
+
+/*
+ *    Enables or disables the cache for wld_open. Disabled by default.
+ *
+ *    @param unsigned int enabled    1 to enable the cache, 0 to disable it.
+ */
+void wld_cache_set_enabled(unsigned int enabled);
+
+/*
+ *    Returns whether wld_open uses the cache.
+ *
+ *    @return unsigned int    1 if the cache is enabled, 0 otherwise.
+ */
+unsigned int wld_cache_enabled(void);
+
+/*
+ *    Maps the cached tile grid of a world. The world must already have
+ *    its file stream and headers loaded. The cache is only used when the
+ *    size, modification time and checksum of the world file match the
+ *    ones it was made from.
+ *
+ *    @param wld_t              *wld     The world to load the tiles of.
+ *    @param const char         *path    The world file the world was loaded from.
+ *    @param unsigned long long  hash    The FNV-1a hash of the world file.
+ *
+ *    @return unsigned int    1 if the tiles were mapped, 0 if the cache is missing or stale.
+ */
+unsigned int wld_cache_load(wld_t *wld, const char *path, unsigned long long hash);
+
+/*
+ *    Starts writing the tile grid of a world to its cache, which
+ *    wld_cache_store_columns then does a few columns at a time.
+ *
+ *    @param wld_cache_writer_t *writer    The writer to start.
+ *    @param wld_t              *wld       The world to cache the tiles of.
+ *    @param const char         *path      The world file the world was loaded from.
+ *    @param unsigned long long  hash      The FNV-1a hash of the world file.
+ *
+ *    @return unsigned int    1 on success, 0 on failure, in which case there is nothing to end.
+ */
+unsigned int wld_cache_store_begin(wld_cache_writer_t *writer, wld_t *wld, const char *path, unsigned long long hash);
+
+/*
+ *    Writes the next columns of a cache.
+ *
+ *    @param wld_cache_writer_t *writer    The writer.
+ *    @param wld_t              *wld       The world being cached.
+ *    @param int                 count     The most columns to write.
+ *
+ *    @return unsigned int    1 once every column is written, 0 if there are more.
+ */
+unsigned int wld_cache_store_columns(wld_cache_writer_t *writer, wld_t *wld, int count);
+
+/*
+ *    Finishes writing a cache, renaming it into place, or throws it away.
+ *
+ *    @param wld_cache_writer_t *writer    The writer, which is released.
+ *    @param unsigned int        keep      1 to keep the cache, 0 to throw it away.
+ *
+ *    @return unsigned int    1 if the cache was written, 0 otherwise.
+ */
+unsigned int wld_cache_store_end(wld_cache_writer_t *writer, unsigned int keep);
+
+/*
+ *    Writes the tile grid of a world to its cache in one go.
+ *
+ *    @param wld_t              *wld     The world to cache the tiles of.
+ *    @param const char         *path    The world file the world was loaded from.
+ *    @param unsigned long long  hash    The FNV-1a hash of the world file.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int wld_cache_store(wld_t *wld, const char *path, unsigned long long hash);
+
+#endif /* WLD_WLDCACHE_H  */
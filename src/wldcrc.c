@@ -0,0 +1,346 @@
+/*
+ *    wldcrc.c    --    Source file for section checksums
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Defines the functions used to detect corrupted world files. The
+ *    sidecar holds a small header followed by the start and CRC32 of each
+ *    section, and is replaced by renaming, like the cache. Saves write it
+ *    before renaming the world, so a crash in between leaves a sidecar
+ *    whose size and mtime match neither file, which loads treat as stale.
+ */
+#include "wldcrc.h"
+
+#include "hash.h"
+#include "log.h"
+
+#include <malloc.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define WLD_CRC_VERSION 2
+
+typedef struct {
+    char          sig[8];
+    int           ver;
+    unsigned int  count;
+    unsigned long len;
+    long long     mtime;
+    long          mtime_nsec;
+} wld_crc_header_t;
+
+static unsigned int _crc_enabled = 0;
+
+/*
+ *    Enables or disables checksums in wld_open and saves. Disabled by
+ *    default.
+ *
+ *    @param unsigned int enabled    1 to enable checksums, 0 to disable them.
+ */
+void wld_crc_set_enabled(unsigned int enabled) {
+    _crc_enabled = enabled != 0;
+}
+
+/*
+ *    Returns whether loads and saves use checksums.
+ *
+ *    @return unsigned int    1 if checksums are enabled, 0 otherwise.
+ */
+unsigned int wld_crc_enabled(void) {
+    return _crc_enabled;
+}
+
+/*
+ *    Builds the path of a world's sidecar.
+ *
+ *    @param const char *path      The world file.
+ *    @param const char *suffix    The suffix to append.
+ *
+ *    @return char *    The sidecar path, NULL on failure.
+ */
+static char *wld_crc_path(const char *path, const char *suffix) {
+    char *crc = (char *)malloc(strlen(path) + strlen(suffix) + 1);
+
+    if (crc == (char *)0x0) {
+        LOGF_ERR("Failed to allocate memory for checksum path.\n");
+        return (char *)0x0;
+    }
+
+    strcpy(crc, path);
+    strcat(crc, suffix);
+
+    return crc;
+}
+
+/*
+ *    Starts checksumming the sections of a loaded world file, which
+ *    wld_crc_update then does a range of bytes at a time. The world must
+ *    have its file stream and info header loaded.
+ *
+ *    @param wld_t     *wld    The world.
+ *    @param wld_crc_t *crc    The checksums to fill.
+ *
+ *    @return unsigned int    1 on success, 0 if the section offsets are invalid.
+ */
+unsigned int wld_crc_begin(wld_t *wld, wld_crc_t *crc) {
+    if (wld == (wld_t *)0x0 || wld->file == (filestream_t *)0x0 || wld->info.sections == (long *)0x0) {
+        LOGF_ERR("World was not loaded from a file.\n");
+        return 0;
+    }
+
+    if (wld->info.numsections < 0 || wld->info.numsections + 1 > WLD_CRC_MAX_SECTIONS) {
+        VLOGF_ERR("World has too many sections to checksum (%d).\n", wld->info.numsections);
+        return 0;
+    }
+
+    memset(crc, 0, sizeof(*crc));
+
+    crc->len   = wld->file->len;
+    crc->count = wld->info.numsections + 1;
+
+    unsigned int i;
+    for (i = 1; i < crc->count; ++i) {
+        crc->starts[i] = wld->info.sections[i - 1];
+
+        if (crc->starts[i] < crc->starts[i - 1] || crc->starts[i] > crc->len) {
+            VLOGF_ERR("Section %u has an invalid offset.\n", i);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ *    Checksums a range of a loaded world file into the sections it
+ *    covers. The ranges must follow each other from the start of the file.
+ *
+ *    @param wld_t         *wld    The world.
+ *    @param wld_crc_t     *crc    The checksums, from wld_crc_begin.
+ *    @param unsigned long  pos    The start of the range.
+ *    @param unsigned long  len    The length of the range.
+ */
+void wld_crc_update(wld_t *wld, wld_crc_t *crc, unsigned long pos, unsigned long len) {
+    unsigned long stop = pos + len > crc->len ? crc->len : pos + len;
+
+    unsigned int i;
+    for (i = 0; i < crc->count && pos < stop; ++i) {
+        unsigned long end = i + 1 < crc->count ? crc->starts[i + 1] : crc->len;
+
+        if (pos >= end)
+            continue;
+
+        if (end > stop)
+            end = stop;
+
+        crc->crcs[i] = hash_crc32_update(crc->crcs[i], wld->file->buf + pos, end - pos);
+        pos          = end;
+    }
+}
+
+/*
+ *    Checksums every section of a loaded world file in one pass. The
+ *    world must have its file stream and info header loaded.
+ *
+ *    @param wld_t     *wld    The world.
+ *    @param wld_crc_t *crc    The checksums to fill.
+ *
+ *    @return unsigned int    1 on success, 0 if the section offsets are invalid.
+ */
+unsigned int wld_crc_compute(wld_t *wld, wld_crc_t *crc) {
+    if (!wld_crc_begin(wld, crc))
+        return 0;
+
+    wld_crc_update(wld, crc, 0, crc->len);
+
+    return 1;
+}
+
+/*
+ *    Checksums every section of an encoded world, as it will be written.
+ *
+ *    @param wld_encoded_t *enc    The encoded sections.
+ *    @param wld_crc_t     *crc    The checksums to fill.
+ */
+void wld_crc_compute_encoded(wld_encoded_t *enc, wld_crc_t *crc) {
+    memset(crc, 0, sizeof(*crc));
+
+    crc->count = WLD_ENCODED_SECTIONS;
+
+    unsigned int i;
+    for (i = 0; i < WLD_ENCODED_SECTIONS; ++i) {
+        crc->starts[i] = crc->len;
+        crc->crcs[i]   = hash_crc32(enc->sections[i], enc->sizes[i]);
+        crc->len      += enc->sizes[i];
+    }
+}
+
+/*
+ *    Writes the checksums of a world file to its sidecar, which is synced
+ *    before it is renamed into place. The checksums must carry the size
+ *    and mtime the file will have.
+ *
+ *    @param const wld_crc_t *crc     The checksums.
+ *    @param const char      *path    The world file.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int wld_crc_store(const wld_crc_t *crc, const char *path) {
+    char *side = wld_crc_path(path, ".crc");
+    char *tmp  = wld_crc_path(path, ".crc.tmp");
+
+    if (side == (char *)0x0 || tmp == (char *)0x0) {
+        free(side);
+        free(tmp);
+        return 0;
+    }
+
+    FILE *fp = fopen(tmp, "wb");
+
+    if (fp == (FILE *)0x0) {
+        VLOGF_ERR("Failed to open %s.\n", tmp);
+        free(side);
+        free(tmp);
+        return 0;
+    }
+
+    wld_crc_header_t header;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.sig, "wldcrc32", 8);
+
+    header.ver        = WLD_CRC_VERSION;
+    header.count      = crc->count;
+    header.len        = crc->len;
+    header.mtime      = crc->mtime;
+    header.mtime_nsec = crc->mtime_nsec;
+
+    fwrite(&header, sizeof(header), 1, fp);
+    fwrite(crc->starts, sizeof(unsigned long), crc->count, fp);
+    fwrite(crc->crcs, sizeof(unsigned int), crc->count, fp);
+
+    /* The sidecar has to be on disk before the rename can point at it.  */
+    unsigned int ret = fflush(fp) == 0 && ferror(fp) == 0 && fsync(fileno(fp)) == 0;
+
+    if (fclose(fp) != 0)
+        ret = 0;
+
+    if (ret == 0 || rename(tmp, side) != 0) {
+        VLOGF_ERR("Failed to write %s.\n", side);
+        remove(tmp);
+        ret = 0;
+    }
+
+    free(side);
+    free(tmp);
+
+    return ret;
+}
+
+/*
+ *    Reads the checksums of a world file from its sidecar.
+ *
+ *    @param wld_crc_t  *crc     The checksums to fill.
+ *    @param const char *path    The world file.
+ *
+ *    @return unsigned int    1 on success, 0 if there is no valid sidecar.
+ */
+static unsigned int wld_crc_load(wld_crc_t *crc, const char *path) {
+    char *side = wld_crc_path(path, ".crc");
+
+    if (side == (char *)0x0)
+        return 0;
+
+    FILE *fp = fopen(side, "rb");
+    free(side);
+
+    if (fp == (FILE *)0x0)
+        return 0;
+
+    wld_crc_header_t header;
+    unsigned int     ret = 0;
+
+    memset(crc, 0, sizeof(*crc));
+
+    if (fread(&header, sizeof(header), 1, fp) == 1 && memcmp(header.sig, "wldcrc32", 8) == 0 &&
+        header.ver == WLD_CRC_VERSION && header.count <= WLD_CRC_MAX_SECTIONS) {
+        crc->len        = header.len;
+        crc->mtime      = header.mtime;
+        crc->mtime_nsec = header.mtime_nsec;
+        crc->count      = header.count;
+
+        ret = fread(crc->starts, sizeof(unsigned long), crc->count, fp) == crc->count &&
+              fread(crc->crcs, sizeof(unsigned int), crc->count, fp) == crc->count;
+    }
+
+    fclose(fp);
+
+    return ret;
+}
+
+/*
+ *    Checks the checksums of a world file against its sidecar, logging
+ *    every section that does not match. A sidecar made for another size
+ *    or mtime of the file is stale, and is replaced like a missing one.
+ *
+ *    @param wld_crc_t  *actual    The checksums of the file as it was loaded.
+ *    @param const char *path      The world file.
+ *
+ *    @return unsigned int    1 if the file matches or had no fresh sidecar, 0 if it is corrupt.
+ */
+unsigned int wld_crc_check(wld_crc_t *actual, const char *path) {
+    wld_crc_t   expected;
+    struct stat st;
+
+    /* Without the mtime no sidecar can be trusted, or written.  */
+    if (stat(path, &st) != 0 || (unsigned long)st.st_size != actual->len) {
+        VLOGF_WARN("%s changed while it was loaded, skipping its checksums.\n", path);
+        return 1;
+    }
+
+    actual->mtime      = st.st_mtim.tv_sec;
+    actual->mtime_nsec = st.st_mtim.tv_nsec;
+
+    if (!wld_crc_load(&expected, path) || expected.len != actual->len || expected.mtime != actual->mtime ||
+        expected.mtime_nsec != actual->mtime_nsec) {
+        wld_crc_store(actual, path);
+        return 1;
+    }
+
+    if (expected.count != actual->count) {
+        VLOGF_ERR("%s has %u sections, expected %u.\n", path, actual->count, expected.count);
+        return 0;
+    }
+
+    unsigned int ret = 1;
+
+    unsigned int i;
+    for (i = 0; i < actual->count; ++i) {
+        if (expected.starts[i] != actual->starts[i] || expected.crcs[i] != actual->crcs[i]) {
+            VLOGF_ERR("Section %u of %s is corrupt: CRC32 %08x, expected %08x.\n", i, path, actual->crcs[i], expected.crcs[i]);
+            ret = 0;
+        }
+    }
+
+    return ret;
+}
+
+/*
+ *    Checks a loaded world file against its sidecar, as wld_crc_check
+ *    does, checksumming it in one pass.
+ *
+ *    @param wld_t      *wld     The world.
+ *    @param const char *path    The world file the world was loaded from.
+ *
+ *    @return unsigned int    1 if the world matches or had no fresh sidecar, 0 if it is corrupt.
+ */
+unsigned int wld_crc_verify(wld_t *wld, const char *path) {
+    wld_crc_t actual;
+
+    if (!wld_crc_compute(wld, &actual))
+        return 0;
+
+    return wld_crc_check(&actual, path);
+}
@@ -0,0 +1,125 @@
+/*
+ *    wldcrc.h    --    Header file for section checksums
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Declares the functions used to detect corrupted world files. The
+ *    CRC32 of every section of a world is kept in a sidecar file next to
+ *    it, "world.wld.crc", which saves record and loads check. The sidecar
+ *    also holds the size and mtime of the file it was made for, so a file
+ *    written by anything else, such as the game, is not taken for corrupt.
+ */
+#ifndef WLD_WLDCRC_H
+#define WLD_WLDCRC_H
+
+#include "wldlib.h"
+
+#define WLD_CRC_MAX_SECTIONS 32
+
+/*
+ *    The checksums of a world file. Section 0 is the info header, and
+ *    section i after it starts at info.sections[i - 1]. The typedef is
+ *    in wldlib.h, so a stepped load can hold one.
+ */
+struct wld_crc_s {
+    unsigned long len;
+    long long     mtime;
+    long          mtime_nsec;
+    unsigned int  count;
+    unsigned long starts[WLD_CRC_MAX_SECTIONS];
+    unsigned int  crcs[WLD_CRC_MAX_SECTIONS];
+};
+
+/*
+ *    Enables or disables checksums in wld_open and saves. Disabled by
+ *    default.
+ *
+ *    @param unsigned int enabled    1 to enable checksums, 0 to disable them.
+ */
+void wld_crc_set_enabled(unsigned int enabled);
+
+/*
+ *    Returns whether loads and saves use checksums.
+ *
+ *    @return unsigned int    1 if checksums are enabled, 0 otherwise.
+ */
+unsigned int wld_crc_enabled(void);
+
+/*
+ *    Starts checksumming the sections of a loaded world file, which
+ *    wld_crc_update then does a range of bytes at a time. The world must
+ *    have its file stream and info header loaded.
+ *
+ *    @param wld_t     *wld    The world.
+ *    @param wld_crc_t *crc    The checksums to fill.
+ *
+ *    @return unsigned int    1 on success, 0 if the section offsets are invalid.
+ */
+unsigned int wld_crc_begin(wld_t *wld, wld_crc_t *crc);
+
+/*
+ *    Checksums a range of a loaded world file into the sections it
+ *    covers. The ranges must follow each other from the start of the file.
+ *
+ *    @param wld_t         *wld    The world.
+ *    @param wld_crc_t     *crc    The checksums, from wld_crc_begin.
+ *    @param unsigned long  pos    The start of the range.
+ *    @param unsigned long  len    The length of the range.
+ */
+void wld_crc_update(wld_t *wld, wld_crc_t *crc, unsigned long pos, unsigned long len);
+
+/*
+ *    Checksums every section of a loaded world file in one pass. The
+ *    world must have its file stream and info header loaded.
+ *
+ *    @param wld_t     *wld    The world.
+ *    @param wld_crc_t *crc    The checksums to fill.
+ *
+ *    @return unsigned int    1 on success, 0 if the section offsets are invalid.
+ */
+unsigned int wld_crc_compute(wld_t *wld, wld_crc_t *crc);
+
+/*
+ *    Checksums every section of an encoded world, as it will be written.
+ *
+ *    @param wld_encoded_t *enc    The encoded sections.
+ *    @param wld_crc_t     *crc    The checksums to fill.
+ */
+void wld_crc_compute_encoded(wld_encoded_t *enc, wld_crc_t *crc);
+
+/*
+ *    Writes the checksums of a world file to its sidecar, which is synced
+ *    before it is renamed into place. The checksums must carry the size
+ *    and mtime the file will have.
+ *
+ *    @param const wld_crc_t *crc     The checksums.
+ *    @param const char      *path    The world file.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int wld_crc_store(const wld_crc_t *crc, const char *path);
+
+/*
+ *    Checks the checksums of a world file against its sidecar, logging
+ *    every section that does not match. A sidecar made for another size
+ *    or mtime of the file is stale, and is replaced like a missing one.
+ *
+ *    @param wld_crc_t  *actual    The checksums of the file as it was loaded.
+ *    @param const char *path      The world file.
+ *
+ *    @return unsigned int    1 if the file matches or had no fresh sidecar, 0 if it is corrupt.
+ */
+unsigned int wld_crc_check(wld_crc_t *actual, const char *path);
+
+/*
+ *    Checks a loaded world file against its sidecar, as wld_crc_check
+ *    does, checksumming it in one pass.
+ *
+ *    @param wld_t      *wld     The world.
+ *    @param const char *path    The world file the world was loaded from.
+ *
+ *    @return unsigned int    1 if the world matches or had no fresh sidecar, 0 if it is corrupt.
+ */
+unsigned int wld_crc_verify(wld_t *wld, const char *path);
+
+#endif /* WLD_WLDCRC_H  */
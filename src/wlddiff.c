@@ -0,0 +1,905 @@
+/*
+ *    wlddiff.c    --    Source file for world diffing
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Defines the functions used to compute what changed between two
+ *    saves of the same world.
+ */
+#define _GNU_SOURCE
+
+#include "wlddiff.h"
+
+#include "hash.h"
+#include "log.h"
+#include "parseutil.h"
+#include "tilefuncs.h"
+#include "tilepalette.h"
+#include "tilestore.h"
+#include "wldheaderfuncs.h"
+
+#include <malloc.h>
+#include <stdio.h>
+#include <string.h>
+
+#define WLD_DIFF_VERSION 1
+
+typedef struct {
+    int y0;
+    int y;
+    int x0;
+} diff_span_t;
+
+typedef struct {
+    unsigned int count;
+    unsigned int cap;
+    diff_span_t *spans;
+} diff_spans_t;
+
+/*
+ *    Adds a rectangle of changed tiles to a diff.
+ *
+ *    @param wld_diff_t *diff    The diff to add to.
+ *    @param rect_t      rect    The rectangle to add.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int diff_push_rect(wld_diff_t *diff, rect_t rect) {
+    if (diff->rect_count == diff->rect_cap) {
+        unsigned int cap   = diff->rect_cap ? diff->rect_cap * 2 : 64;
+        rect_t      *rects = (rect_t *)realloc(diff->rects, sizeof(rect_t) * cap);
+
+        if (rects == (rect_t *)0x0) {
+            LOGF_ERR("Failed to allocate memory for diff rectangles.\n");
+            return 0;
+        }
+
+        diff->rects    = rects;
+        diff->rect_cap = cap;
+    }
+
+    diff->rects[diff->rect_count++] = rect;
+
+    return 1;
+}
+
+/*
+ *    Adds a changed record to a diff.
+ *
+ *    @param wld_diff_t        *diff      The diff to add to.
+ *    @param unsigned char      kind      The kind of record.
+ *    @param unsigned char      op        What happened to the record.
+ *    @param int                index     The index of the record.
+ *    @param int                x         The x position of the record.
+ *    @param int                y         The y position of the record.
+ *    @param const char        *field     The header field, if any.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int diff_push_record(wld_diff_t *diff, unsigned char kind, unsigned char op, int index, int x, int y, const char *field) {
+    if (diff->record_count == diff->record_cap) {
+        unsigned int       cap     = diff->record_cap ? diff->record_cap * 2 : 64;
+        wld_diff_record_t *records = (wld_diff_record_t *)realloc(diff->records, sizeof(wld_diff_record_t) * cap);
+
+        if (records == (wld_diff_record_t *)0x0) {
+            LOGF_ERR("Failed to allocate memory for diff records.\n");
+            return 0;
+        }
+
+        diff->records    = records;
+        diff->record_cap = cap;
+    }
+
+    wld_diff_record_t *record = &diff->records[diff->record_count++];
+
+    record->kind  = kind;
+    record->op    = op;
+    record->index = index;
+    record->x     = x;
+    record->y     = y;
+    record->field = field;
+
+    return 1;
+}
+
+/*
+ *    Adds a span of changed rows to a column's list of spans,
+ *    merging it with the previous span when they touch.
+ *
+ *    @param diff_spans_t *spans    The spans of the column.
+ *    @param int           y0       The first changed row.
+ *    @param int           y        One past the last changed row.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int diff_push_span(diff_spans_t *spans, int y0, int y) {
+    if (spans->count > 0 && spans->spans[spans->count - 1].y == y0) {
+        spans->spans[spans->count - 1].y = y;
+        return 1;
+    }
+
+    if (spans->count == spans->cap) {
+        unsigned int cap = spans->cap ? spans->cap * 2 : 64;
+        diff_span_t *p   = (diff_span_t *)realloc(spans->spans, sizeof(diff_span_t) * cap);
+
+        if (p == (diff_span_t *)0x0) {
+            LOGF_ERR("Failed to allocate memory for diff spans.\n");
+            return 0;
+        }
+
+        spans->spans = p;
+        spans->cap   = cap;
+    }
+
+    spans->spans[spans->count].y0 = y0;
+    spans->spans[spans->count].y  = y;
+    spans->spans[spans->count].x0 = 0;
+    ++spans->count;
+
+    return 1;
+}
+
+/*
+ *    Returns whether the compressed columns of two worlds can be
+ *    compared byte for byte.
+ *
+ *    @param wld_t *a    The old world.
+ *    @param wld_t *b    The new world.
+ *
+ *    @return unsigned int    1 if they can, 0 if not.
+ */
+static unsigned int diff_can_hash(wld_t *a, wld_t *b) {
+    if (a->file == (filestream_t *)0x0 || b->file == (filestream_t *)0x0)
+        return 0;
+
+    if (a->column_offsets == (unsigned long *)0x0 || b->column_offsets == (unsigned long *)0x0)
+        return 0;
+
+    /* Loads allocate the marks, so a world without them has untracked edits.  */
+    if (a->column_dirty == (unsigned char *)0x0 || b->column_dirty == (unsigned char *)0x0)
+        return 0;
+
+    /* The same bytes only decode to the same tiles under the same UV mask.  */
+    if (a->info.tilemask != b->info.tilemask)
+        return 0;
+
+    return memcmp(a->info.uvs, b->info.uvs, (a->info.tilemask + 7) / 8) == 0;
+}
+
+/*
+ *    Finds the changed rows of a column by walking the runs of both
+ *    compressed columns side by side.
+ *
+ *    @param wld_t        *a         The old world.
+ *    @param wld_t        *b         The new world.
+ *    @param int           x         The column to compare.
+ *    @param int           height    The number of rows to compare.
+ *    @param diff_spans_t *spans     The spans to fill.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int diff_column_runs(wld_t *a, wld_t *b, int x, int height, diff_spans_t *spans) {
+    unsigned long pa = a->column_offsets[x];
+    unsigned long pb = b->column_offsets[x];
+    unsigned int  la = 0;
+    unsigned int  lb = 0;
+    tile_t        ta;
+    tile_t        tb;
+
+    int y = 0;
+    while (y < height) {
+        if (la == 0)
+            la = tile_parse_run(a, a->file->buf, &pa, &ta);
+
+        if (lb == 0)
+            lb = tile_parse_run(b, b->file->buf, &pb, &tb);
+
+        unsigned int n = la < lb ? la : lb;
+
+        if (n > (unsigned int)(height - y))
+            n = height - y;
+
+        if (!tile_compare(ta, tb) && !diff_push_span(spans, y, y + n))
+            return 0;
+
+        y += n;
+        la -= n;
+        lb -= n;
+    }
+
+    return 1;
+}
+
+/*
+ *    Finds the changed rows of a column from the decoded tiles.
+ *
+ *    @param const tile_t *a         The old column.
+ *    @param const tile_t *b         The new column.
+ *    @param int           height    The number of rows to compare.
+ *    @param diff_spans_t *spans     The spans to fill.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int diff_column_tiles(const tile_t *a, const tile_t *b, int height, diff_spans_t *spans) {
+    int y;
+    for (y = 0; y < height; ++y) {
+        if (!tile_compare(a[y], b[y]) && !diff_push_span(spans, y, y + 1))
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ *    Merges the changed spans of a column into the spans still open from
+ *    the previous column, closing the spans that did not continue into
+ *    rectangles.
+ *
+ *    @param wld_diff_t   *diff    The diff to add rectangles to.
+ *    @param diff_spans_t *open    The spans open up to column x.
+ *    @param diff_spans_t *cur     The spans of column x, which become the open spans.
+ *    @param int           x       The current column.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int diff_merge_spans(wld_diff_t *diff, diff_spans_t *open, diff_spans_t *cur, int x) {
+    unsigned int i = 0;
+    unsigned int j = 0;
+
+    while (i < open->count || j < cur->count) {
+        diff_span_t *o = i < open->count ? &open->spans[i] : (diff_span_t *)0x0;
+        diff_span_t *c = j < cur->count ? &cur->spans[j] : (diff_span_t *)0x0;
+
+        /* Same rows as the column before, the rectangle keeps growing.  */
+        if (o && c && o->y0 == c->y0 && o->y == c->y) {
+            c->x0 = o->x0;
+            ++i;
+            ++j;
+            continue;
+        }
+
+        if (o && (c == (diff_span_t *)0x0 || o->y0 <= c->y0)) {
+            rect_t rect = {o->x0, x, o->y0, o->y};
+
+            if (!diff_push_rect(diff, rect))
+                return 0;
+
+            ++i;
+            continue;
+        }
+
+        c->x0 = x;
+        ++j;
+    }
+
+    diff_spans_t tmp = *open;
+    *open            = *cur;
+    *cur             = tmp;
+    cur->count       = 0;
+
+    return 1;
+}
+
+/*
+ *    Diffs the tiles of two worlds.
+ *
+ *    @param wld_diff_t *diff    The diff to fill.
+ *    @param wld_t      *a       The old world.
+ *    @param wld_t      *b       The new world.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int diff_tiles(wld_diff_t *diff, wld_t *a, wld_t *b) {
+    int width  = a->header.width < b->header.width ? a->header.width : b->header.width;
+    int height = a->header.height < b->header.height ? a->header.height : b->header.height;
+    int hash   = diff_can_hash(a, b) && a->header.height == b->header.height;
+
+    tile_t *scratch_a = (tile_t *)malloc(sizeof(tile_t) * (height > 0 ? height : 1));
+    tile_t *scratch_b = (tile_t *)malloc(sizeof(tile_t) * (height > 0 ? height : 1));
+
+    if (scratch_a == (tile_t *)0x0 || scratch_b == (tile_t *)0x0) {
+        LOGF_ERR("Failed to allocate memory for columns.\n");
+        free(scratch_a);
+        free(scratch_b);
+        return 0;
+    }
+
+    diff_spans_t open = {0};
+    diff_spans_t cur  = {0};
+    unsigned int ret  = 1;
+
+    int x;
+    for (x = 0; x < width && ret; ++x) {
+        /* Edited columns no longer match the bytes they were loaded from.  */
+        if (hash && !tile_column_dirty(a, x) && !tile_column_dirty(b, x)) {
+            unsigned long la = a->column_offsets[x + 1] - a->column_offsets[x];
+            unsigned long lb = b->column_offsets[x + 1] - b->column_offsets[x];
+
+            if (la == lb &&
+                hash_fnv1a(a->file->buf + a->column_offsets[x], la) == hash_fnv1a(b->file->buf + b->column_offsets[x], lb)) {
+                ++diff->columns_skipped;
+                ret = diff_merge_spans(diff, &open, &cur, x);
+                continue;
+            }
+
+            ret = diff_column_runs(a, b, x, height, &cur);
+        } else {
+            const tile_t *ca = tile_column_get(a, x, scratch_a);
+            const tile_t *cb = tile_column_get(b, x, scratch_b);
+
+            if (memcmp(ca, cb, sizeof(tile_t) * height) == 0) {
+                ++diff->columns_skipped;
+                ret = diff_merge_spans(diff, &open, &cur, x);
+                continue;
+            }
+
+            ret = diff_column_tiles(ca, cb, height, &cur);
+        }
+
+        ret = ret && diff_merge_spans(diff, &open, &cur, x);
+    }
+
+    /* Close whatever is still open at the right edge.  */
+    ret = ret && diff_merge_spans(diff, &open, &cur, width);
+
+    free(open.spans);
+    free(cur.spans);
+    free(scratch_a);
+    free(scratch_b);
+
+    if (!ret)
+        return 0;
+
+    /* Anything outside of the shared area changed by definition.  */
+    int max_width  = a->header.width > b->header.width ? a->header.width : b->header.width;
+    int max_height = a->header.height > b->header.height ? a->header.height : b->header.height;
+
+    if (max_width > width) {
+        rect_t rect = {width, max_width, 0, max_height};
+
+        if (!diff_push_rect(diff, rect))
+            return 0;
+    }
+
+    if (max_height > height) {
+        rect_t rect = {0, width, height, max_height};
+
+        if (!diff_push_rect(diff, rect))
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ *    Diffs the world format headers of two worlds.
+ *
+ *    @param wld_diff_t *diff    The diff to fill.
+ *    @param wld_t      *a       The old world.
+ *    @param wld_t      *b       The new world.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int diff_header(wld_diff_t *diff, wld_t *a, wld_t *b) {
+    const wld_header_field_t *field;
+
+    unsigned int i;
+    for (i = 0; (field = wld_header_get_field(i)) != (const wld_header_field_t *)0x0; ++i) {
+        if (wld_header_field_compare(field, &a->header, &b->header))
+            continue;
+
+        if (!diff_push_record(diff, WLD_DIFF_HEADER, WLD_DIFF_CHANGED, i, 0, 0, field->name))
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ *    Compares two strings which may be NULL.
+ *
+ *    @param const char *s0    The first string.
+ *    @param const char *s1    The second string.
+ *
+ *    @return unsigned int    1 if the strings are equal, 0 if they are not.
+ */
+static unsigned int diff_string_equal(const char *s0, const char *s1) {
+    if (s0 == (const char *)0x0 || s1 == (const char *)0x0)
+        return s0 == s1;
+
+    return strcmp(s0, s1) == 0;
+}
+
+/*
+ *    Record keys: chests and signs are keyed by their position,
+ *    NPCs and pets by their id.
+ */
+static int diff_chest_key(const void *p0, const void *p1) {
+    const chest_t *c0 = (const chest_t *)p0;
+    const chest_t *c1 = (const chest_t *)p1;
+
+    if (c0->x != c1->x)
+        return c0->x < c1->x ? -1 : 1;
+
+    if (c0->y != c1->y)
+        return c0->y < c1->y ? -1 : 1;
+
+    return 0;
+}
+
+static int diff_sign_key(const void *p0, const void *p1) {
+    const sign_t *s0 = (const sign_t *)p0;
+    const sign_t *s1 = (const sign_t *)p1;
+
+    if (s0->x != s1->x)
+        return s0->x < s1->x ? -1 : 1;
+
+    if (s0->y != s1->y)
+        return s0->y < s1->y ? -1 : 1;
+
+    return 0;
+}
+
+static int diff_npc_key(const void *p0, const void *p1) {
+    const npc_t *n0 = (const npc_t *)p0;
+    const npc_t *n1 = (const npc_t *)p1;
+
+    if (n0->id != n1->id)
+        return n0->id < n1->id ? -1 : 1;
+
+    return 0;
+}
+
+static int (*_diff_keys[])(const void *, const void *) = {
+    (int (*)(const void *, const void *))0x0,
+    diff_chest_key,
+    diff_sign_key,
+    diff_npc_key,
+};
+
+/*
+ *    Orders two record pointers by key, keeping records with
+ *    the same key in their original order. The key function is
+ *    passed through qsort_r, so sorts can run on several threads.
+ */
+static int diff_sort_cmp(const void *p0, const void *p1, void *key) {
+    const char *r0 = *(const char **)p0;
+    const char *r1 = *(const char **)p1;
+    int         c  = (*(int (**)(const void *, const void *))key)(r0, r1);
+
+    if (c != 0)
+        return c;
+
+    return r0 < r1 ? -1 : r0 > r1;
+}
+
+/*
+ *    Sorts the records of a section by key, as an array of pointers.
+ *
+ *    @param unsigned char  kind       The kind of record.
+ *    @param void          *records    The records.
+ *    @param unsigned long  count      The number of records.
+ *    @param unsigned long  size       The size of a record.
+ *
+ *    @return void **    The sorted pointers, NULL on failure.
+ */
+static void **diff_sort(unsigned char kind, void *records, unsigned long count, unsigned long size) {
+    void **sorted = (void **)malloc(sizeof(void *) * (count ? count : 1));
+
+    if (sorted == (void **)0x0) {
+        LOGF_ERR("Failed to allocate memory for sorted records.\n");
+        return (void **)0x0;
+    }
+
+    unsigned long i;
+    for (i = 0; i < count; ++i)
+        sorted[i] = (char *)records + i * size;
+
+    qsort_r(sorted, count, sizeof(void *), diff_sort_cmp, (void *)&_diff_keys[kind]);
+
+    return sorted;
+}
+
+/*
+ *    Compares the contents of two chests.
+ *
+ *    @param chest_t *c0    The first chest.
+ *    @param chest_t *c1    The second chest.
+ *
+ *    @return unsigned int    1 if the chests are equal, 0 if they are not.
+ */
+static unsigned int diff_chest_equal(chest_t *c0, chest_t *c1) {
+    if (!diff_string_equal(c0->name, c1->name))
+        return 0;
+
+    int i;
+    for (i = 0; i < 40; ++i) {
+        item_t *i0 = &c0->items[i];
+        item_t *i1 = &c1->items[i];
+
+        if (i0->stack != i1->stack)
+            return 0;
+
+        if (i0->stack != 0 && (i0->id != i1->id || i0->prefix != i1->prefix))
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ *    Compares two NPCs.
+ *
+ *    @param npc_t *n0    The first NPC.
+ *    @param npc_t *n1    The second NPC.
+ *
+ *    @return unsigned int    1 if the NPCs are equal, 0 if they are not.
+ */
+static unsigned int diff_npc_equal(npc_t *n0, npc_t *n1) {
+    if (n0->x != n1->x || n0->y != n1->y)
+        return 0;
+
+    return diff_string_equal(n0->name, n1->name) && n0->homeless == n1->homeless &&
+           n0->home_x == n1->home_x && n0->home_y == n1->home_y && n0->variation == n1->variation;
+}
+
+/*
+ *    Walks two sorted sections side by side and records the records that
+ *    were added, removed or changed.
+ *
+ *    @param wld_diff_t    *diff     The diff to fill.
+ *    @param unsigned char  kind     The kind of record.
+ *    @param void          *base0    The records of the old world.
+ *    @param void         **s0       The sorted records of the old world.
+ *    @param unsigned long  n0       The number of old records.
+ *    @param void          *base1    The records of the new world.
+ *    @param void         **s1       The sorted records of the new world.
+ *    @param unsigned long  n1       The number of new records.
+ *    @param unsigned long  size     The size of a record.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int diff_walk(wld_diff_t *diff, unsigned char kind, void *base0, void **s0, unsigned long n0,
+                              void *base1, void **s1, unsigned long n1, unsigned long size) {
+    unsigned long i = 0;
+    unsigned long j = 0;
+
+    while (i < n0 || j < n1) {
+        int c;
+
+        if (i == n0)
+            c = 1;
+        else if (j == n1)
+            c = -1;
+        else
+            c = _diff_keys[kind](s0[i], s1[j]);
+
+        if (c == 0) {
+            unsigned int equal;
+
+            if (kind == WLD_DIFF_CHEST)
+                equal = diff_chest_equal((chest_t *)s0[i], (chest_t *)s1[j]);
+            else if (kind == WLD_DIFF_SIGN)
+                equal = diff_string_equal(((sign_t *)s0[i])->text, ((sign_t *)s1[j])->text);
+            else
+                equal = diff_npc_equal((npc_t *)s0[i], (npc_t *)s1[j]);
+
+            ++i;
+            ++j;
+
+            if (equal)
+                continue;
+        } else if (c < 0) {
+            ++i;
+        } else {
+            ++j;
+        }
+
+        /* Removed records are reported at their old index, the rest at their new one.  */
+        char         *r     = c < 0 ? (char *)s0[i - 1] : (char *)s1[j - 1];
+        int           index = (int)((r - (char *)(c < 0 ? base0 : base1)) / size);
+        unsigned char op    = c < 0 ? WLD_DIFF_REMOVED : c > 0 ? WLD_DIFF_ADDED : WLD_DIFF_CHANGED;
+        int           x;
+        int           y;
+
+        if (kind == WLD_DIFF_CHEST) {
+            x = ((chest_t *)r)->x;
+            y = ((chest_t *)r)->y;
+        } else if (kind == WLD_DIFF_SIGN) {
+            x = ((sign_t *)r)->x;
+            y = ((sign_t *)r)->y;
+        } else {
+            x = (int)((npc_t *)r)->x;
+            y = (int)((npc_t *)r)->y;
+        }
+
+        if (!diff_push_record(diff, kind, op, index, x, y, (const char *)0x0))
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ *    Diffs the chests, signs and NPCs of two worlds.
+ *
+ *    @param wld_diff_t *diff    The diff to fill.
+ *    @param wld_t      *a       The old world.
+ *    @param wld_t      *b       The new world.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int diff_records(wld_diff_t *diff, wld_t *a, wld_t *b) {
+    unsigned int ret = 1;
+
+    void **c0 = diff_sort(WLD_DIFF_CHEST, a->chests, a->chest_count, sizeof(chest_t));
+    void **c1 = diff_sort(WLD_DIFF_CHEST, b->chests, b->chest_count, sizeof(chest_t));
+    void **s0 = diff_sort(WLD_DIFF_SIGN, a->signs, a->sign_count, sizeof(sign_t));
+    void **s1 = diff_sort(WLD_DIFF_SIGN, b->signs, b->sign_count, sizeof(sign_t));
+    void **n0 = diff_sort(WLD_DIFF_NPC, a->npcs, a->npc_count, sizeof(npc_t));
+    void **n1 = diff_sort(WLD_DIFF_NPC, b->npcs, b->npc_count, sizeof(npc_t));
+
+    if (!c0 || !c1 || !s0 || !s1 || !n0 || !n1) {
+        ret = 0;
+    } else {
+        ret = diff_walk(diff, WLD_DIFF_CHEST, a->chests, c0, a->chest_count, b->chests, c1, b->chest_count, sizeof(chest_t)) &&
+              diff_walk(diff, WLD_DIFF_SIGN, a->signs, s0, a->sign_count, b->signs, s1, b->sign_count, sizeof(sign_t)) &&
+              diff_walk(diff, WLD_DIFF_NPC, a->npcs, n0, a->npc_count, b->npcs, n1, b->npc_count, sizeof(npc_t));
+    }
+
+    free(c0);
+    free(c1);
+    free(s0);
+    free(s1);
+    free(n0);
+    free(n1);
+
+    return ret;
+}
+
+/*
+ *    Computes the changes from one world to another.
+ *
+ *    When both worlds still hold the file stream they were loaded from,
+ *    columns left unedited since the load, which marks every column clean,
+ *    are compared by the hash of their compressed bytes and only differing
+ *    columns are decoded, run by run. Edited columns, and every column of
+ *    a world that was not loaded, are compared as decoded tiles.
+ *
+ *    @param wld_t *a    The old world.
+ *    @param wld_t *b    The new world.
+ *
+ *    @return wld_diff_t *    The changes from a to b, NULL on failure.
+ */
+wld_diff_t *wld_diff(wld_t *a, wld_t *b) {
+    if (a == (wld_t *)0x0 || b == (wld_t *)0x0) {
+        LOGF_ERR("World is NULL.\n");
+        return (wld_diff_t *)0x0;
+    }
+
+    wld_diff_t *diff = (wld_diff_t *)calloc(1, sizeof(wld_diff_t));
+
+    if (diff == (wld_diff_t *)0x0) {
+        LOGF_ERR("Failed to allocate memory for diff.\n");
+        return (wld_diff_t *)0x0;
+    }
+
+    diff->width  = b->header.width;
+    diff->height = b->header.height;
+
+    if (!diff_tiles(diff, a, b) || !diff_header(diff, a, b) || !diff_records(diff, a, b)) {
+        wld_diff_free(diff);
+        return (wld_diff_t *)0x0;
+    }
+
+    return diff;
+}
+
+/*
+ *    Serializes a diff to a buffer.
+ *
+ *    @param wld_diff_t    *diff    The diff to serialize.
+ *    @param unsigned long *size    The length of the buffer.
+ *
+ *    @return char *    The buffer containing the diff, NULL on failure.
+ */
+char *wld_diff_serialize(wld_diff_t *diff, unsigned long *size) {
+    if (diff == (wld_diff_t *)0x0) {
+        LOGF_ERR("Diff is NULL.\n");
+        return (char *)0x0;
+    }
+
+    unsigned long len = 7 + sizeof(int) * 3 + sizeof(unsigned int) * 2 + sizeof(rect_t) * diff->rect_count;
+
+    unsigned int i;
+    for (i = 0; i < diff->record_count; ++i) {
+        const char *field = diff->records[i].field;
+
+        len += 2 + sizeof(int) * 3 + 1 + (field ? strlen(field) : 0);
+    }
+
+    char *buf = (char *)malloc(len);
+    if (buf == (char *)0x0) {
+        LOGF_ERR("Failed to allocate memory for diff buffer.\n");
+        return (char *)0x0;
+    }
+
+    unsigned long pos = 0;
+
+    WRITE_ARRAY(buf, pos, char, "wlddiff", 7);
+    WRITE(buf, pos, int, WLD_DIFF_VERSION);
+    WRITE(buf, pos, int, diff->width);
+    WRITE(buf, pos, int, diff->height);
+    WRITE(buf, pos, unsigned int, diff->rect_count);
+    WRITE_ARRAY(buf, pos, rect_t, diff->rects, (int)diff->rect_count);
+    WRITE(buf, pos, unsigned int, diff->record_count);
+
+    for (i = 0; i < diff->record_count; ++i) {
+        wld_diff_record_t *record = &diff->records[i];
+        unsigned char      flen   = record->field ? strlen(record->field) : 0;
+
+        WRITE(buf, pos, unsigned char, record->kind);
+        WRITE(buf, pos, unsigned char, record->op);
+        WRITE(buf, pos, int, record->index);
+        WRITE(buf, pos, int, record->x);
+        WRITE(buf, pos, int, record->y);
+        WRITE(buf, pos, unsigned char, flen);
+        WRITE_ARRAY(buf, pos, char, record->field, flen);
+    }
+
+    *size = pos;
+
+    return buf;
+}
+
+/*
+ *    Reads a diff back from a buffer made by wld_diff_serialize.
+ *
+ *    @param unsigned char *buf     The buffer to read from.
+ *    @param unsigned long  size    The length of the buffer.
+ *
+ *    @return wld_diff_t *    The diff, NULL on failure.
+ */
+wld_diff_t *wld_diff_deserialize(unsigned char *buf, unsigned long size) {
+    unsigned long pos = 0;
+    int           ver = 0;
+
+    if (buf == (unsigned char *)0x0 || size < 7 + sizeof(int) * 3 + sizeof(unsigned int) * 2 || memcmp(buf, "wlddiff", 7) != 0) {
+        LOGF_ERR("Buffer is not a diff.\n");
+        return (wld_diff_t *)0x0;
+    }
+
+    pos += 7;
+    PARSE(buf, pos, int, ver);
+
+    if (ver != WLD_DIFF_VERSION) {
+        VLOGF_ERR("Unknown diff version: %d\n", ver);
+        return (wld_diff_t *)0x0;
+    }
+
+    wld_diff_t *diff = (wld_diff_t *)calloc(1, sizeof(wld_diff_t));
+
+    if (diff == (wld_diff_t *)0x0) {
+        LOGF_ERR("Failed to allocate memory for diff.\n");
+        return (wld_diff_t *)0x0;
+    }
+
+    unsigned int count = 0;
+
+    PARSE(buf, pos, int, diff->width);
+    PARSE(buf, pos, int, diff->height);
+    PARSE(buf, pos, unsigned int, count);
+
+    if (pos + (unsigned long)count * sizeof(rect_t) + sizeof(unsigned int) > size) {
+        LOGF_ERR("Diff buffer is truncated.\n");
+        wld_diff_free(diff);
+        return (wld_diff_t *)0x0;
+    }
+
+    unsigned int i;
+    for (i = 0; i < count; ++i) {
+        rect_t rect;
+
+        PARSE(buf, pos, rect_t, rect);
+
+        if (!diff_push_rect(diff, rect)) {
+            wld_diff_free(diff);
+            return (wld_diff_t *)0x0;
+        }
+    }
+
+    PARSE(buf, pos, unsigned int, count);
+
+    for (i = 0; i < count; ++i) {
+        unsigned char kind;
+        unsigned char op;
+        int           index;
+        int           x;
+        int           y;
+
+        if (pos + 2 + sizeof(int) * 3 + 1 > size || pos + 2 + sizeof(int) * 3 + 1 + buf[pos + 2 + sizeof(int) * 3] > size) {
+            LOGF_ERR("Diff buffer is truncated.\n");
+            wld_diff_free(diff);
+            return (wld_diff_t *)0x0;
+        }
+
+        PARSE(buf, pos, unsigned char, kind);
+        PARSE(buf, pos, unsigned char, op);
+        PARSE(buf, pos, int, index);
+        PARSE(buf, pos, int, x);
+        PARSE(buf, pos, int, y);
+
+        if (kind > WLD_DIFF_NPC || op > WLD_DIFF_CHANGED) {
+            VLOGF_ERR("Unknown diff record: kind %u, op %u\n", kind, op);
+            wld_diff_free(diff);
+            return (wld_diff_t *)0x0;
+        }
+
+        /* Field names point into the header field table, not the buffer.  */
+        char                     *name  = parse_string(buf, &pos);
+        const wld_header_field_t *field = wld_header_find_field(name);
+
+        free(name);
+
+        if (!diff_push_record(diff, kind, op, index, x, y, field ? field->name : (const char *)0x0)) {
+            wld_diff_free(diff);
+            return (wld_diff_t *)0x0;
+        }
+    }
+
+    return diff;
+}
+
+/*
+ *    Dumps a diff to stdout.
+ *
+ *    @param wld_diff_t *diff    The diff to dump.
+ */
+void wld_diff_dump(wld_diff_t *diff) {
+    static const char *kinds[] = {"header", "chest", "sign", "npc"};
+    static const char *ops[]   = {"added", "removed", "changed"};
+
+    if (diff == (wld_diff_t *)0x0) {
+        LOGF_ERR("Diff is NULL.\n");
+        return;
+    }
+
+    printf("World Diff:\n");
+    printf("    Size:                   %d x %d\n", diff->width, diff->height);
+    printf("    Columns skipped:        %u\n", diff->columns_skipped);
+    printf("    Changed rectangles:     %u\n", diff->rect_count);
+
+    unsigned int i;
+    for (i = 0; i < diff->rect_count; ++i)
+        printf("        [%d, %d) x [%d, %d)\n", diff->rects[i].x0, diff->rects[i].x, diff->rects[i].y0, diff->rects[i].y);
+
+    printf("    Changed records:        %u\n", diff->record_count);
+
+    for (i = 0; i < diff->record_count; ++i) {
+        wld_diff_record_t *record = &diff->records[i];
+
+        const char        *kind   = record->kind <= WLD_DIFF_NPC ? kinds[record->kind] : "?";
+        const char        *op     = record->op <= WLD_DIFF_CHANGED ? ops[record->op] : "?";
+
+        if (record->kind == WLD_DIFF_HEADER)
+            printf("        %s %s: %s\n", kind, op, record->field ? record->field : "?");
+        else
+            printf("        %s %s: #%d at %d, %d\n", kind, op, record->index, record->x, record->y);
+    }
+}
+
+/*
+ *    Frees a diff.
+ *
+ *    @param wld_diff_t *diff    The diff to free.
+ */
+void wld_diff_free(wld_diff_t *diff) {
+    if (diff == (wld_diff_t *)0x0) {
+        LOGF_WARN("Diff is NULL.\n");
+        return;
+    }
+
+    free(diff->rects);
+    free(diff->records);
+    free(diff);
+}
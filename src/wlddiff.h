@@ -0,0 +1,104 @@
+/*
+ *    wlddiff.h    --    Header file for world diffing
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Declares the functions used to compute what changed between two
+ *    saves of the same world, as rectangles of changed tiles and a list
+ *    of changed records (header fields, chests, signs and NPCs).
+ */
+#ifndef WLD_WLDDIFF_H
+#define WLD_WLDDIFF_H
+
+#include "wld.h"
+
+enum {
+    WLD_DIFF_HEADER = 0,
+    WLD_DIFF_CHEST  = 1,
+    WLD_DIFF_SIGN   = 2,
+    WLD_DIFF_NPC    = 3,
+};
+
+enum {
+    WLD_DIFF_ADDED   = 0,
+    WLD_DIFF_REMOVED = 1,
+    WLD_DIFF_CHANGED = 2,
+};
+
+typedef struct {
+    unsigned char kind;
+    unsigned char op;
+    int           index;
+    int           x;
+    int           y;
+    const char   *field;
+} wld_diff_record_t;
+
+/*
+ *    Tile rectangles are half open: x0 and y0 are the first changed
+ *    column and row, x and y are one past the last.
+ */
+typedef struct {
+    int                width;
+    int                height;
+    unsigned int       rect_count;
+    unsigned int       rect_cap;
+    rect_t            *rects;
+    unsigned int       record_count;
+    unsigned int       record_cap;
+    wld_diff_record_t *records;
+    unsigned int       columns_skipped;
+} wld_diff_t;
+
+/*
+ *    Computes the changes from one world to another.
+ *
+ *    When both worlds still hold the file stream they were loaded from,
+ *    columns left unedited since the load, which marks every column clean,
+ *    are compared by the hash of their compressed bytes and only differing
+ *    columns are decoded, run by run. Edited columns, and every column of
+ *    a world that was not loaded, are compared byte for byte, then tile by
+ *    tile.
+ *
+ *    @param wld_t *a    The old world.
+ *    @param wld_t *b    The new world.
+ *
+ *    @return wld_diff_t *    The changes from a to b, NULL on failure.
+ */
+wld_diff_t *wld_diff(wld_t *a, wld_t *b);
+
+/*
+ *    Serializes a diff to a buffer.
+ *
+ *    @param wld_diff_t    *diff    The diff to serialize.
+ *    @param unsigned long *size    The length of the buffer.
+ *
+ *    @return char *    The buffer containing the diff, NULL on failure.
+ */
+char *wld_diff_serialize(wld_diff_t *diff, unsigned long *size);
+
+/*
+ *    Reads a diff back from a buffer made by wld_diff_serialize.
+ *
+ *    @param unsigned char *buf     The buffer to read from.
+ *    @param unsigned long  size    The length of the buffer.
+ *
+ *    @return wld_diff_t *    The diff, NULL on failure.
+ */
+wld_diff_t *wld_diff_deserialize(unsigned char *buf, unsigned long size);
+
+/*
+ *    Dumps a diff to stdout.
+ *
+ *    @param wld_diff_t *diff    The diff to dump.
+ */
+void wld_diff_dump(wld_diff_t *diff);
+
+/*
+ *    Frees a diff.
+ *
+ *    @param wld_diff_t *diff    The diff to free.
+ */
+void wld_diff_free(wld_diff_t *diff);
+
+#endif /* WLD_WLDDIFF_H  */
@@ -21,7 +21,7 @@ typedef struct {
     int   revisions;
     long  favorite;
     short numsections;
-    int  *sections;
+    long *sections;
     short tilemask;
     char *uvs;
 } wld_info_header_t;
@@ -199,4 +199,31 @@ typedef struct {
     unsigned char copper_slime;
     unsigned char moondial_active;
     unsigned char moondial_cooldown;
-} wld_header_t;
\ No newline at end of file
+} wld_header_t;
+
+enum {
+    WLD_FIELD_U8,
+    WLD_FIELD_I8,
+    WLD_FIELD_I16,
+    WLD_FIELD_I32,
+    WLD_FIELD_I64,
+    WLD_FIELD_F32,
+    WLD_FIELD_F64,
+    WLD_FIELD_STRING,
+};
+
+/*
+ *    Describes a field of the world format header, so that headers can
+ *    be compared and queried by field name.
+ *
+ *    Fields with a count of 0 are heap arrays, whose length is stored in
+ *    another field of the header at len_offset.
+ */
+typedef struct {
+    const char   *name;
+    unsigned long offset;
+    unsigned char type;
+    unsigned int  count;
+    unsigned long len_offset;
+    unsigned char len_type;
+} wld_header_field_t;
\ No newline at end of file
@@ -14,12 +14,205 @@
 #include "wldheader.h"
 
 #include <malloc.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 
 #define WLD_INFO_HEADER_LEN 0xFF
 #define WLD_HEADER_LEN      0xFFFF
 
+#define WLD_HEADER_FIELD(field, type, count) \
+    { #field, offsetof(wld_header_t, field), type, count, 0, 0 }
+
+#define WLD_HEADER_ARRAY(field, type, len, len_type) \
+    { #field, offsetof(wld_header_t, field), type, 0, offsetof(wld_header_t, len), len_type }
+
+static const wld_header_field_t _header_fields[] = {
+    WLD_HEADER_FIELD(name, WLD_FIELD_STRING, 1),
+    WLD_HEADER_FIELD(seed, WLD_FIELD_STRING, 1),
+    WLD_HEADER_FIELD(generator_ver, WLD_FIELD_I64, 1),
+    WLD_HEADER_FIELD(guid, WLD_FIELD_U8, 16),
+    WLD_HEADER_FIELD(id, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(bounds, WLD_FIELD_I32, 4),
+    WLD_HEADER_FIELD(height, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(width, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(gamemode, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(drunk, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(ftw, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(tenth, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(dont_starve, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(bees, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(remix, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(no_traps, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(zenith, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(creation_time, WLD_FIELD_I64, 1),
+    WLD_HEADER_FIELD(moon_type, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(tree_x, WLD_FIELD_I32, 3),
+    WLD_HEADER_FIELD(tree_styles, WLD_FIELD_I32, 4),
+    WLD_HEADER_FIELD(cave_back_x, WLD_FIELD_I32, 3),
+    WLD_HEADER_FIELD(cave_back_style, WLD_FIELD_I32, 4),
+    WLD_HEADER_FIELD(ice_back_style, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(jungle_back_style, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(hell_back_style, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(spawn_x, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(spawn_y, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(ground_level, WLD_FIELD_F64, 1),
+    WLD_HEADER_FIELD(rock_level, WLD_FIELD_F64, 1),
+    WLD_HEADER_FIELD(time, WLD_FIELD_F64, 1),
+    WLD_HEADER_FIELD(day, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(moon_phase, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(blood_moon, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(eclipse, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(dungeon_x, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(dungeon_y, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(crimson, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_eoc, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_evil_boss, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_skeletron, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_queen_bee, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_destroyer, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_twins, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_skeletron_prime, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_hm_boss, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_plantera, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_golem, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_king_slime, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(saved_tinkerer, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(saved_wizard, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(saved_mechanic, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_goblin, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_clown, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_frost, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_pirate, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(broke_orb, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(meteor, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(orb_smashed, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(altar_count, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(hardmode, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(after_doom_party, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(invasion_delay, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(invasion_size, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(invasion_type, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(invasion_x, WLD_FIELD_F64, 1),
+    WLD_HEADER_FIELD(slime_rain_time, WLD_FIELD_F64, 1),
+    WLD_HEADER_FIELD(sundial_cooldown, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(is_raining, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(rain_time, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(max_rain, WLD_FIELD_F32, 1),
+    WLD_HEADER_FIELD(ore_tier_1, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(ore_tier_2, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(ore_tier_3, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(tree_style, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(corruption_style, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(jungle_style, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(snow_style, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(hallow_style, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(crimson_style, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(desert_style, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(ocean_style, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(cloud_bg, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(num_clouds, WLD_FIELD_I16, 1),
+    WLD_HEADER_FIELD(wind_speed, WLD_FIELD_F32, 1),
+    WLD_HEADER_FIELD(players, WLD_FIELD_I32, 1),
+    WLD_HEADER_ARRAY(playernames, WLD_FIELD_STRING, players, WLD_FIELD_I32),
+    WLD_HEADER_FIELD(saved_angler, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(angler_quest, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(saved_stylist, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(saved_tax_collector, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(saved_golfer, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(invasion_start_size, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(cultist_delay, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(kill_count_len, WLD_FIELD_I16, 1),
+    WLD_HEADER_ARRAY(kill_counts, WLD_FIELD_I32, kill_count_len, WLD_FIELD_I16),
+    WLD_HEADER_FIELD(fast_forward_time, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_fishron, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_martian, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_cultist, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_moonlord, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_pumpking, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_wood, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_ice_queen, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_tank, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_everscream, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_solar, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_vortex, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_nebula, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_stardust, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(active_solar, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(active_vortex, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(active_nebula, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(active_stardust, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(active_lunar, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(manual_party, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(invite_party, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(party_cooldown, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(partier_len, WLD_FIELD_I32, 1),
+    WLD_HEADER_ARRAY(partiers, WLD_FIELD_I32, partier_len, WLD_FIELD_I32),
+    WLD_HEADER_FIELD(active_sandstorm, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(sandstorm_time, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(sandstorm_severity, WLD_FIELD_F32, 1),
+    WLD_HEADER_FIELD(sandstorm_max_severity, WLD_FIELD_F32, 1),
+    WLD_HEADER_FIELD(saved_bartender, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_dd2_1, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_dd2_2, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_dd2_3, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(style_8, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(style_9, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(style_10, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(style_11, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(style_12, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(combat_book, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(lantern_night_cooldown, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(lantern_night, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(manual_lantern_night, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(next_lantern_real, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(tree_tops_len, WLD_FIELD_I32, 1),
+    WLD_HEADER_ARRAY(tree_tops, WLD_FIELD_I32, tree_tops_len, WLD_FIELD_I32),
+    WLD_HEADER_FIELD(forced_halloween, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(forced_christmas, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(copper_id, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(iron_id, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(silver_id, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(gold_id, WLD_FIELD_I32, 1),
+    WLD_HEADER_FIELD(bought_cat, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(bought_dog, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(bought_bunny, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_eol, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_queen_slime, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(kill_deer, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(blue_slime, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(unlocked_merchant, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(unlocked_demo, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(unlocked_party, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(unlocked_dye, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(unlocked_truffle, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(unlocked_arms_dealer, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(unlocked_nurse, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(unlocked_princess, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(combat_book_2, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(peddler_satchel, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(green_slime, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(old_slime, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(purple_slime, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(rainbow_slime, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(red_slime, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(yellow_slime, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(copper_slime, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(moondial_active, WLD_FIELD_U8, 1),
+    WLD_HEADER_FIELD(moondial_cooldown, WLD_FIELD_U8, 1),
+};
+
+static const unsigned long _field_sizes[] = {
+    sizeof(unsigned char),
+    sizeof(char),
+    sizeof(short),
+    sizeof(int),
+    sizeof(long),
+    sizeof(float),
+    sizeof(double),
+    sizeof(char *),
+};
+
 /*
  *    Peeks at the world header and returns the version of the world.
  *    Returns -1 if the world is invalid.
@@ -61,7 +254,7 @@ unsigned int wld_info_parse(wld_t *wld) {
     }
 
     unsigned char *buf = wld->file->buf;
-    unsigned int  *pos = &wld->file->pos;
+    unsigned long *pos = &wld->file->pos;
 
     PARSE(buf, *pos, unsigned int, wld->info.ver);
     PARSE_ARRAY(buf, *pos, unsigned char, wld->info.sig, 7);
@@ -70,14 +263,15 @@ unsigned int wld_info_parse(wld_t *wld) {
     PARSE(buf, *pos, long, wld->info.favorite);
     PARSE(buf, *pos, short, wld->info.numsections);
 
-    wld->info.sections = (int *)malloc(sizeof(int) * wld->info.numsections);
+    wld->info.sections = (long *)malloc(sizeof(long) * wld->info.numsections);
 
-    if (wld->info.sections == (int *)0x0) {
+    if (wld->info.sections == (long *)0x0) {
         LOGF_ERR("Failed to allocate memory for sections.\n");
         return 0;
     }
 
-    PARSE_ARRAY(buf, *pos, int, wld->info.sections, wld->info.numsections);
+    /* Offsets are 32 bits on disk, read unsigned to reach 4 GB.  */
+    PARSE_ARRAY(buf, *pos, unsigned int, wld->info.sections, wld->info.numsections);
 
     PARSE(buf, *pos, short, wld->info.tilemask);
 
@@ -117,7 +311,7 @@ unsigned int wld_header_parse(wld_t *wld) {
     }
 
     unsigned char *buf    = wld->file->buf;
-    unsigned int  *pos    = &wld->file->pos;
+    unsigned long *pos    = &wld->file->pos;
     wld_header_t  *header = &wld->header;
 
     header->name = parse_string(buf, pos);
@@ -514,7 +708,8 @@ unsigned int wld_header_parse(wld_t *wld) {
 }
 
 /*
- *    Returns the world info header as a buffer.
+ *    Returns the world info header as a buffer. The buffer belongs to
+ *    the calling thread and is reused by its next call.
  *
  *    @param wld_t *wld      The world to get the header from.
  *    @param unsigned int   *len      The length of the header.
@@ -522,7 +717,7 @@ unsigned int wld_header_parse(wld_t *wld) {
  *    @return char *           The world info header.
  */
 char *wld_info_get_header(wld_t *wld, unsigned int *len) {
-    static char   buf[WLD_INFO_HEADER_LEN];
+    static __thread char buf[WLD_INFO_HEADER_LEN];
     unsigned long pos = 0;
 
     WRITE(buf, pos, int, wld->info.ver);
@@ -531,7 +726,7 @@ char *wld_info_get_header(wld_t *wld, unsigned int *len) {
     WRITE(buf, pos, int, wld->info.revisions);
     WRITE(buf, pos, long, wld->info.favorite);
     WRITE(buf, pos, short, wld->info.numsections);
-    WRITE_ARRAY(buf, pos, int, wld->info.sections, wld->info.numsections);
+    WRITE_ARRAY(buf, pos, unsigned int, wld->info.sections, wld->info.numsections);
     WRITE(buf, pos, short, wld->info.tilemask);
     WRITE_ARRAY(buf, pos, char, wld->info.uvs, wld->info.tilemask / 8);
     WRITE(buf, pos, char, '\000');
@@ -542,7 +737,8 @@ char *wld_info_get_header(wld_t *wld, unsigned int *len) {
 }
 
 /*
- *    Returns the world format header as a buffer.
+ *    Returns the world format header as a buffer. The buffer belongs to
+ *    the calling thread and is reused by its next call.
  *
  *    @param wld_t *wld    The world to get the header from.
  *    @param unsigned int   *len    The length of the header.
@@ -550,7 +746,7 @@ char *wld_info_get_header(wld_t *wld, unsigned int *len) {
  *    @return char *         The world format header.
  */
 char *wld_header_get_header(wld_t *wld, unsigned int *len) {
-    static char   buf[WLD_HEADER_LEN];
+    static __thread char buf[WLD_HEADER_LEN];
     unsigned long pos = 0;
 
     WRITE(buf, pos, char, (char)strlen(wld->header.name));
@@ -739,6 +935,161 @@ char *wld_header_get_header(wld_t *wld, unsigned int *len) {
     return buf;
 }
 
+/*
+ *    Finds a field of the world format header by name.
+ *
+ *    @param const char *name    The name of the field, as in wld_header_t.
+ *
+ *    @return const wld_header_field_t *    The field, NULL if there is no such field.
+ */
+const wld_header_field_t *wld_header_find_field(const char *name) {
+    if (name == (const char *)0x0)
+        return (const wld_header_field_t *)0x0;
+
+    unsigned long i;
+    for (i = 0; i < sizeof(_header_fields) / sizeof(_header_fields[0]); ++i) {
+        if (strcmp(_header_fields[i].name, name) == 0)
+            return &_header_fields[i];
+    }
+
+    return (const wld_header_field_t *)0x0;
+}
+
+/*
+ *    Returns the field of the world format header at an index.
+ *
+ *    @param unsigned int i    The index of the field.
+ *
+ *    @return const wld_header_field_t *    The field, NULL past the last field.
+ */
+const wld_header_field_t *wld_header_get_field(unsigned int i) {
+    if (i >= sizeof(_header_fields) / sizeof(_header_fields[0]))
+        return (const wld_header_field_t *)0x0;
+
+    return &_header_fields[i];
+}
+
+/*
+ *    Returns the number of elements in a field of a world format header.
+ *
+ *    @param const wld_header_field_t *field     The field.
+ *    @param const wld_header_t       *header    The header the field is in.
+ *
+ *    @return unsigned long    The number of elements in the field.
+ */
+unsigned long wld_header_field_len(const wld_header_field_t *field, const wld_header_t *header) {
+    if (field->count != 0)
+        return field->count;
+
+    const char *len = (const char *)header + field->len_offset;
+
+    if (*(char **)((const char *)header + field->offset) == (char *)0x0)
+        return 0;
+
+    if (field->len_type == WLD_FIELD_I16)
+        return *(short *)len < 0 ? 0 : *(short *)len;
+
+    return *(int *)len < 0 ? 0 : *(int *)len;
+}
+
+/*
+ *    Returns a pointer to an element of a field of a world format header.
+ *
+ *    @param const wld_header_field_t *field     The field.
+ *    @param const wld_header_t       *header    The header the field is in.
+ *    @param unsigned long             i         The element to get.
+ *
+ *    @return const char *    The element.
+ */
+static const char *wld_header_field_ptr(const wld_header_field_t *field, const wld_header_t *header, unsigned long i) {
+    const char *base = (const char *)header + field->offset;
+
+    /* Heap arrays hold a pointer to their elements, not the elements.  */
+    if (field->count == 0)
+        base = *(const char **)base;
+
+    return base + i * _field_sizes[field->type];
+}
+
+/*
+ *    Returns an element of a numeric field of a world format header.
+ *
+ *    @param const wld_header_field_t *field     The field.
+ *    @param const wld_header_t       *header    The header the field is in.
+ *    @param unsigned long             i         The element to get.
+ *
+ *    @return double    The value of the element, 0 if it does not exist.
+ */
+double wld_header_field_value(const wld_header_field_t *field, const wld_header_t *header, unsigned long i) {
+    if (i >= wld_header_field_len(field, header))
+        return 0;
+
+    const char *p = wld_header_field_ptr(field, header, i);
+
+    switch (field->type) {
+    case WLD_FIELD_U8:
+        return *(unsigned char *)p;
+    case WLD_FIELD_I8:
+        return *(char *)p;
+    case WLD_FIELD_I16:
+        return *(short *)p;
+    case WLD_FIELD_I32:
+        return *(int *)p;
+    case WLD_FIELD_I64:
+        return *(long *)p;
+    case WLD_FIELD_F32:
+        return *(float *)p;
+    case WLD_FIELD_F64:
+        return *(double *)p;
+    default:
+        return 0;
+    }
+}
+
+/*
+ *    Compares a field of two world format headers.
+ *
+ *    @param const wld_header_field_t *field    The field to compare.
+ *    @param const wld_header_t       *h0       The first header.
+ *    @param const wld_header_t       *h1       The second header.
+ *
+ *    @return unsigned int    1 if the fields are equal, 0 if they are not.
+ */
+unsigned int wld_header_field_compare(const wld_header_field_t *field, const wld_header_t *h0, const wld_header_t *h1) {
+    unsigned long len = wld_header_field_len(field, h0);
+
+    if (len != wld_header_field_len(field, h1))
+        return 0;
+
+    unsigned long i;
+    for (i = 0; i < len; ++i) {
+        const char *p0 = wld_header_field_ptr(field, h0, i);
+        const char *p1 = wld_header_field_ptr(field, h1, i);
+
+        if (field->type != WLD_FIELD_STRING) {
+            if (memcmp(p0, p1, _field_sizes[field->type]) != 0)
+                return 0;
+
+            continue;
+        }
+
+        const char *s0 = *(const char **)p0;
+        const char *s1 = *(const char **)p1;
+
+        if (s0 == (const char *)0x0 || s1 == (const char *)0x0) {
+            if (s0 != s1)
+                return 0;
+
+            continue;
+        }
+
+        if (strcmp(s0, s1) != 0)
+            return 0;
+    }
+
+    return 1;
+}
+
 /*
  *    Dumps the contents of the world format header to stdout.
  *
@@ -836,7 +1187,7 @@ void wld_info_header_dump(wld_info_header_t info) {
     printf("    Section Offsets:\n");
 
     for (i = 0; i < info.numsections; i++)
-        printf("        %d: %d\n", i, info.sections[i]);
+        printf("        %d: %ld\n", i, info.sections[i]);
 
     printf("\n");
     printf("    Tile Mask: %d\n", info.tilemask);
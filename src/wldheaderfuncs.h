@@ -40,7 +40,8 @@ unsigned int wld_info_parse(wld_t *wld);
 unsigned int wld_header_parse(wld_t *wld);
 
 /*
- *    Returns the world info header as a buffer.
+ *    Returns the world info header as a buffer. The buffer belongs to
+ *    the calling thread and is reused by its next call.
  *
  *    @param wld_t *wld      The world to get the header from.
  *    @param unsigned int   *len      The length of the header.
@@ -50,7 +51,8 @@ unsigned int wld_header_parse(wld_t *wld);
 char *wld_info_get_header(wld_t *wld, unsigned int *len);
 
 /*
- *    Returns the world format header as a buffer.
+ *    Returns the world format header as a buffer. The buffer belongs to
+ *    the calling thread and is reused by its next call.
  *
  *    @param wld_t *wld    The world to get the header from.
  *    @param unsigned int   *len    The length of the header.
@@ -59,6 +61,56 @@ char *wld_info_get_header(wld_t *wld, unsigned int *len);
  */
 char *wld_header_get_header(wld_t *wld, unsigned int *len);
 
+/*
+ *    Finds a field of the world format header by name.
+ *
+ *    @param const char *name    The name of the field, as in wld_header_t.
+ *
+ *    @return const wld_header_field_t *    The field, NULL if there is no such field.
+ */
+const wld_header_field_t *wld_header_find_field(const char *name);
+
+/*
+ *    Returns the field of the world format header at an index.
+ *
+ *    @param unsigned int i    The index of the field.
+ *
+ *    @return const wld_header_field_t *    The field, NULL past the last field.
+ */
+const wld_header_field_t *wld_header_get_field(unsigned int i);
+
+/*
+ *    Returns the number of elements in a field of a world format header.
+ *
+ *    @param const wld_header_field_t *field     The field.
+ *    @param const wld_header_t       *header    The header the field is in.
+ *
+ *    @return unsigned long    The number of elements in the field.
+ */
+unsigned long wld_header_field_len(const wld_header_field_t *field, const wld_header_t *header);
+
+/*
+ *    Returns an element of a numeric field of a world format header.
+ *
+ *    @param const wld_header_field_t *field     The field.
+ *    @param const wld_header_t       *header    The header the field is in.
+ *    @param unsigned long             i         The element to get.
+ *
+ *    @return double    The value of the element, 0 if it does not exist.
+ */
+double wld_header_field_value(const wld_header_field_t *field, const wld_header_t *header, unsigned long i);
+
+/*
+ *    Compares a field of two world format headers.
+ *
+ *    @param const wld_header_field_t *field    The field to compare.
+ *    @param const wld_header_t       *h0       The first header.
+ *    @param const wld_header_t       *h1       The second header.
+ *
+ *    @return unsigned int    1 if the fields are equal, 0 if they are not.
+ */
+unsigned int wld_header_field_compare(const wld_header_field_t *field, const wld_header_t *h0, const wld_header_t *h1);
+
 /*
  *    Dumps the contents of the world format header to stdout.
  *
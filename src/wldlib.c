@@ -8,15 +8,22 @@
  *    functions definitions for parsing Terraria's world format.
  */
 #include "wldlib.h"
+#include "hash.h"
 #include "log.h"
 #include "parseutil.h"
 #include "tilefuncs.h"
+#include "tilestore.h"
+#include "wldcache.h"
+#include "wldcrc.h"
 #include "wldheaderfuncs.h"
+#include "wldsave.h"
 #include "worldgen.h"
-#include "rand.h"
 
 #include <malloc.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
 
 /*
  *    Loads the chests from a world.
@@ -82,7 +89,8 @@ unsigned int get_chests(wld_t *wld) {
         return 0;
     }
 
-    wld->chest_count = chest_count;
+    wld->chest_count      = chest_count;
+    wld->chest_item_count = item_count;
 }
 
 /*
@@ -724,22 +732,20 @@ char *write_bestiary(wld_t *wld, unsigned long *size) {
  *    @return wld_t *    The created world, or NULL on failure.
  */
 wld_t *wld_new(int width, int height, const char *name, const char *seed) {
-    wld_t *wld = (wld_t *)malloc(sizeof(wld_t));
+    /* Cleared, generation only sets the flags of special seeds.  */
+    wld_t *wld = (wld_t *)calloc(1, sizeof(wld_t));
 
     if (wld == (wld_t *)0x0) {
         LOGF_ERR("Failed to allocate memory for world.\n");
         return (wld_t *)0x0;
     }
 
-    int seed_int;
-
-    if (atoi(seed) != 0) {
-        seed_int = atoi(seed);
-    } else {
-        seed_int = rand_crc32(seed, strlen(seed));
-    }
+    int seed_int = wld_gen_parse_seed(seed);
 
     wld->file = (filestream_t *)0x0;
+    wld->column_offsets = (unsigned long *)0x0;
+    wld->tile_chunks    = (tile_chunk_t **)0x0;
+    wld->column_dirty   = (unsigned char *)0x0;
 
     wld->chest_count = 0;
     wld->chests = (chest_t *)0x0;
@@ -748,6 +754,7 @@ wld_t *wld_new(int width, int height, const char *name, const char *seed) {
     wld->npc_count = 0;
     wld->npcs = (npc_t *)0x0;
     wld->kill_count = 0;
+    wld->kills = (kill_t *)0x0;
     wld->pet_count = 0;
     wld->tile_entity_count = 0;
     wld->tile_entities = (tile_entity_t *)0x0;
@@ -768,26 +775,12 @@ wld_t *wld_new(int width, int height, const char *name, const char *seed) {
     wld->header.width  = width;
     wld->header.height = height;
 
-    wld->tiles = (tile_t **)malloc(sizeof(tile_t*) * width);
-
-    if (wld->tiles == (tile_t *)0x0) {
+    if (!tile_store_alloc(wld)) {
         LOGF_ERR("Failed to allocate memory for tiles.\n");
         free(wld);
         return (wld_t *)0x0;
     }
 
-    unsigned long i;
-    for (i = 0; i < width; ++i) {
-        wld->tiles[i] = (tile_t*)malloc(sizeof(tile_t) * height);
-
-        if (wld->tiles[i] == (tile_t*)0x0) {
-            LOGF_ERR("Failed to allocate memory for tiles.\n");
-            free(wld->tiles);
-            free(wld);
-            return (wld_t *)0x0;
-        }
-    }
-
     unsigned long x;
     unsigned long y;
     for (x = 0; x < width; ++x) {
@@ -798,73 +791,668 @@ wld_t *wld_new(int width, int height, const char *name, const char *seed) {
         }
     }
 
-    wld_gen_world(wld, seed_int, name, width, height);
+    if (wld_gen_world(wld, seed_int, name, width, height, (gen_stats_t *)0x0) != 0) {
+        LOGF_ERR("Failed to generate world.\n");
+        tile_store_free(wld);
+        free(wld);
+        return (wld_t *)0x0;
+    }
 
     return wld;
 }
 
+typedef struct {
+    unsigned int    ver;
+    unsigned int  (*fn)(wld_t *);
+} wld_open_section_t;
+
 /*
- *    Loads a terraria world.
+ *    The sections after the tiles, each loaded in one go, and the first
+ *    version to have them.
+ */
+static const wld_open_section_t _open_sections[] = {
+    {0,   get_chests},
+    {0,   get_signs},
+    {0,   get_npcs},
+    {116, get_tile_entities},
+    {170, get_pressure_plates},
+    {189, get_town_elements},
+    {210, get_bestiary},
+};
+
+#define WLD_OPEN_SECTION_COUNT (sizeof(_open_sections) / sizeof(_open_sections[0]))
+
+/*
+ *    Returns the time on the monotonic clock.
  *
- *    @param char *path    The file to load.
+ *    @return double    The time in seconds.
+ */
+static double wld_open_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ *    Reads the next chunk of a load's file, handing the contents to a
+ *    new world once it is all read.
+ *
+ *    @param wld_open_ctx_t *ctx    The load.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int wld_open_read(wld_open_ctx_t *ctx) {
+    if (ctx->buf == (unsigned char *)0x0 || ctx->len == ctx->cap) {
+        unsigned long  cap = ctx->buf == (unsigned char *)0x0 ? ctx->cap : ctx->cap * 2;
+        unsigned char *buf;
+
+        if (cap < WLD_OPEN_CHUNK)
+            cap = WLD_OPEN_CHUNK;
+
+        buf = (unsigned char *)realloc(ctx->buf, cap);
+
+        if (buf == (unsigned char *)0x0) {
+            LOGF_ERR("Failed to allocate memory for file.\n");
+            return 0;
+        }
+
+        ctx->buf = buf;
+        ctx->cap = cap;
+    }
+
+    unsigned long want = ctx->cap - ctx->len < WLD_OPEN_CHUNK ? ctx->cap - ctx->len : WLD_OPEN_CHUNK;
+    unsigned long got  = compress_read(&ctx->in, ctx->buf + ctx->len, want);
+
+    ctx->len += got;
+
+    if (got == want)
+        return 1;
+
+    unsigned int failed = ctx->in.failed;
+
+    compress_close(&ctx->in);
+
+    if (failed) {
+        VLOGF_ERR("Failed to read %s.\n", ctx->path);
+        return 0;
+    }
+
+    /* The contents are already decompressed, and the stream takes them over.  */
+    filestream_t *stream = filestream_from_buffer(ctx->buf, ctx->len);
+
+    ctx->buf = (unsigned char *)0x0;
+
+    if (stream == (filestream_t *)0x0)
+        return 0;
+
+    ctx->wld = (wld_t *)calloc(1, sizeof(wld_t));
+    if (ctx->wld == (wld_t *)0x0) {
+        LOGF_ERR("Failed to allocate memory for world.\n");
+        filestream_free(stream);
+        return 0;
+    }
+
+    ctx->wld->file = stream;
+    ctx->stage     = WLD_OPEN_HEADER;
+
+    return 1;
+}
+
+/*
+ *    Takes a load's tiles from the cache when the cache is fresh, or
+ *    starts decoding them.
+ *
+ *    @param wld_open_ctx_t *ctx    The load.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int wld_open_tiles_begin(wld_open_ctx_t *ctx) {
+    /* Edits are tracked from the load on, so wld_diff can trust clean columns.  */
+    if (!tile_store_marks(ctx->wld))
+        return 0;
+
+    /* A fresh cache saves decoding the tile section.  */
+    if (ctx->path != (const char *)0x0 && wld_cache_enabled() && wld_cache_load(ctx->wld, ctx->path, ctx->hash)) {
+        ctx->stage = WLD_OPEN_SECTIONS;
+        return 1;
+    }
+
+    ctx->stage = WLD_OPEN_TILES;
+
+    return get_tiles_begin(ctx->wld);
+}
+
+/*
+ *    Decodes the headers of a load's world, and starts checksumming it
+ *    when checksums or the cache are enabled.
+ *
+ *    @param wld_open_ctx_t *ctx    The load.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int wld_open_header(wld_open_ctx_t *ctx) {
+    wld_t *wld = ctx->wld;
+
+    if (wld_decude_parsing_type(wld) == 0) {
+        LOGF_FAT("Failed to decode parsing type.\n");
+        return 0;
+    }
+
+    if (wld->ver >= 116 && wld->ver < 122) {
+        VLOGF_ERR("World version %d is not supported.\n", wld->ver);
+    }
+
+    if (ctx->path == (const char *)0x0 || (!wld_crc_enabled() && !wld_cache_enabled()))
+        return wld_open_tiles_begin(ctx);
+
+    if (wld_crc_enabled()) {
+        ctx->crc = (wld_crc_t *)malloc(sizeof(wld_crc_t));
+
+        if (ctx->crc == (wld_crc_t *)0x0) {
+            LOGF_ERR("Failed to allocate memory for checksums.\n");
+            return 0;
+        }
+
+        if (!wld_crc_begin(wld, ctx->crc))
+            return 0;
+    }
+
+    ctx->checked = 0;
+    ctx->hash    = HASH_FNV_OFFSET;
+    ctx->stage   = WLD_OPEN_CHECKSUM;
+
+    return 1;
+}
+
+/*
+ *    Checksums the next chunk of a load's file, and checks the file
+ *    against its sidecar after the last.
+ *
+ *    @param wld_open_ctx_t *ctx    The load.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int wld_open_checksum(wld_open_ctx_t *ctx) {
+    filestream_t *file = ctx->wld->file;
+
+    if (ctx->checked < file->len) {
+        unsigned long len = file->len - ctx->checked < WLD_OPEN_CHUNK ? file->len - ctx->checked : WLD_OPEN_CHUNK;
+
+        if (ctx->crc != (wld_crc_t *)0x0)
+            wld_crc_update(ctx->wld, ctx->crc, ctx->checked, len);
+
+        if (wld_cache_enabled())
+            ctx->hash = hash_fnv1a_update(ctx->hash, file->buf + ctx->checked, len);
+
+        ctx->checked += len;
+
+        return 1;
+    }
+
+    if (ctx->crc != (wld_crc_t *)0x0) {
+        unsigned int ok = wld_crc_check(ctx->crc, ctx->path);
+
+        free(ctx->crc);
+        ctx->crc = (wld_crc_t *)0x0;
+
+        if (!ok) {
+            VLOGF_ERR("%s failed its checksums.\n", ctx->path);
+            return 0;
+        }
+    }
+
+    return wld_open_tiles_begin(ctx);
+}
+
+/*
+ *    Decodes the next few tile columns of a load's world, and starts
+ *    caching them after the last.
+ *
+ *    @param wld_open_ctx_t *ctx    The load.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int wld_open_tiles(wld_open_ctx_t *ctx) {
+    wld_t *wld = ctx->wld;
+
+    if (!get_tiles_columns(wld, ctx->column, ctx->column + WLD_OPEN_COLUMNS))
+        return 0;
+
+    ctx->column += WLD_OPEN_COLUMNS;
+
+    if (ctx->column < wld->header.width)
+        return 1;
+
+    get_tiles_end(wld);
+
+    /* A cache that fails to start is only a slower next load.  */
+    if (ctx->path != (const char *)0x0 && wld_cache_enabled() && wld_cache_store_begin(&ctx->cache, wld, ctx->path, ctx->hash)) {
+        ctx->stage = WLD_OPEN_CACHING;
+        return 1;
+    }
+
+    ctx->stage = WLD_OPEN_SECTIONS;
+
+    return 1;
+}
+
+/*
+ *    Writes the next few tile columns of a load's world to its cache.
+ *
+ *    @param wld_open_ctx_t *ctx    The load.
+ */
+static void wld_open_caching(wld_open_ctx_t *ctx) {
+    if (!wld_cache_store_columns(&ctx->cache, ctx->wld, WLD_OPEN_COLUMNS))
+        return;
+
+    wld_cache_store_end(&ctx->cache, 1);
+
+    ctx->stage = WLD_OPEN_SECTIONS;
+}
+
+/*
+ *    Loads the next section of a load's world, and finishes the world
+ *    after the last.
+ *
+ *    @param wld_open_ctx_t *ctx    The load.
+ */
+static void wld_open_section(wld_open_ctx_t *ctx) {
+    wld_t *wld = ctx->wld;
+
+    if ((unsigned long)ctx->section < WLD_OPEN_SECTION_COUNT) {
+        const wld_open_section_t *section = &_open_sections[ctx->section++];
+
+        if (wld->ver >= section->ver)
+            section->fn(wld);
+
+        return;
+    }
+
+    wld->creative_powers_len = 31;
+    wld->creative_powers = "\001\000\000\000\001\b\000\000\000\000\000\001\t\000\000\001\n\000\000\001\f\000\000\000\000\000\001\r\000\000\000";
+
+    ctx->stage = WLD_OPEN_DONE;
+}
+
+/*
+ *    Starts loading a terraria world a step at a time, so a caller with a
+ *    frame to keep can spread the load over many frames. Nothing is read
+ *    until the first step.
+ *
+ *    @param const char *path    The file to load.
+ *
+ *    @return wld_open_ctx_t *    The load, or NULL on failure.
+ */
+wld_open_ctx_t *wld_open_begin(const char *path) {
+    if (path == (const char *)0x0) {
+        LOGF_ERR("Path is NULL.\n");
+        return (wld_open_ctx_t *)0x0;
+    }
+
+    wld_open_ctx_t *ctx  = (wld_open_ctx_t *)calloc(1, sizeof(wld_open_ctx_t));
+    char           *copy = (char *)malloc(strlen(path) + 1);
+
+    if (ctx == (wld_open_ctx_t *)0x0 || copy == (char *)0x0) {
+        LOGF_ERR("Failed to allocate memory for load.\n");
+        free(ctx);
+        free(copy);
+        return (wld_open_ctx_t *)0x0;
+    }
+
+    strcpy(copy, path);
+
+    ctx->path = copy;
+
+    if (!compress_open(&ctx->in, path)) {
+        VLOGF_ERR("Failed to open %s.\n", path);
+        free(copy);
+        free(ctx);
+        return (wld_open_ctx_t *)0x0;
+    }
+
+    /* The size on disk only guides the progress of compressed files.  */
+    struct stat st;
+
+    if (fstat(fileno(ctx->in.fp), &st) == 0)
+        ctx->size = st.st_size;
+
+    /* A plain file fits exactly, with a byte over to find its end.  */
+    if (ctx->in.type == COMPRESS_NONE)
+        ctx->cap = ctx->size + 1;
+
+    ctx->stage = WLD_OPEN_READING;
+
+    return ctx;
+}
+
+/*
+ *    Runs a load until it finishes or its time budget runs out. The
+ *    budget is checked between chunks of the file, tile columns and
+ *    sections, so a step can overrun it by one of those.
+ *
+ *    @param wld_open_ctx_t *ctx          The load.
+ *    @param unsigned long   budget_us    The time to spend in microseconds, 0 for no limit.
+ *
+ *    @return int    The stage the load is at, WLD_OPEN_DONE or WLD_OPEN_FAILED once it is over.
+ */
+int wld_open_step(wld_open_ctx_t *ctx, unsigned long budget_us) {
+    if (ctx == (wld_open_ctx_t *)0x0) {
+        LOGF_ERR("Load is NULL.\n");
+        return WLD_OPEN_FAILED;
+    }
+
+    double deadline = wld_open_now() + budget_us / 1e6;
+
+    while (ctx->stage < WLD_OPEN_DONE) {
+        unsigned int ok = 1;
+
+        switch (ctx->stage) {
+            case WLD_OPEN_READING:
+                ok = wld_open_read(ctx);
+                break;
+            case WLD_OPEN_HEADER:
+                ok = wld_open_header(ctx);
+                break;
+            case WLD_OPEN_CHECKSUM:
+                ok = wld_open_checksum(ctx);
+                break;
+            case WLD_OPEN_TILES:
+                ok = wld_open_tiles(ctx);
+                break;
+            case WLD_OPEN_CACHING:
+                wld_open_caching(ctx);
+                break;
+            case WLD_OPEN_SECTIONS:
+                wld_open_section(ctx);
+                break;
+        }
+
+        if (!ok) {
+            ctx->stage = WLD_OPEN_FAILED;
+            break;
+        }
+
+        if (budget_us != 0 && wld_open_now() >= deadline)
+            break;
+    }
+
+    return ctx->stage;
+}
+
+/*
+ *    Returns how far along a load is.
+ *
+ *    @param wld_open_ctx_t *ctx    The load.
+ *
+ *    @return float    The percentage done, from 0 to 100.
+ */
+float wld_open_progress(wld_open_ctx_t *ctx) {
+    if (ctx == (wld_open_ctx_t *)0x0)
+        return 0.f;
+
+    /* Reading and checksums are about a tenth of a load each, the tiles most of the rest.  */
+    switch (ctx->stage) {
+        case WLD_OPEN_READING: {
+            long pos = ctx->in.fp != (FILE *)0x0 ? ftell(ctx->in.fp) : 0;
+
+            if (ctx->size == 0 || pos <= 0)
+                return 0.f;
+
+            return 10.f * ((unsigned long)pos > ctx->size ? 1.f : (float)pos / ctx->size);
+        }
+        case WLD_OPEN_HEADER:
+            return 10.f;
+        case WLD_OPEN_CHECKSUM:
+            return 10.f + 10.f * ctx->checked / (ctx->wld->file->len + 1);
+        case WLD_OPEN_TILES:
+            return 20.f + 65.f * ctx->column / ctx->wld->header.width;
+        case WLD_OPEN_CACHING:
+            return 85.f + 5.f * ctx->cache.column / ctx->wld->header.width;
+        case WLD_OPEN_SECTIONS:
+            return 90.f + 10.f * ctx->section / (WLD_OPEN_SECTION_COUNT + 1);
+        case WLD_OPEN_DONE:
+            return 100.f;
+    }
+
+    return 0.f;
+}
+
+/*
+ *    Ends a load, cancelling it if it is not done.
+ *
+ *    @param wld_open_ctx_t *ctx    The load, which is freed.
+ *
+ *    @return wld_t *    The loaded world, or NULL if the load failed or was cancelled.
+ */
+wld_t *wld_open_end(wld_open_ctx_t *ctx) {
+    if (ctx == (wld_open_ctx_t *)0x0)
+        return (wld_t *)0x0;
+
+    wld_t *wld = ctx->wld;
+
+    if (ctx->stage == WLD_OPEN_CACHING)
+        wld_cache_store_end(&ctx->cache, 0);
+
+    if (ctx->stage != WLD_OPEN_DONE) {
+        if (wld != (wld_t *)0x0)
+            wld_free(wld);
+
+        wld = (wld_t *)0x0;
+    }
+
+    if (ctx->in.fp != (FILE *)0x0)
+        compress_close(&ctx->in);
+
+    free(ctx->crc);
+    free(ctx->buf);
+    free((char *)ctx->path);
+    free(ctx);
+
+    return wld;
+}
+
+/*
+ *    Decodes a world from a file stream, which the world takes over.
+ *
+ *    @param filestream_t *stream    The file stream.
+ *    @param const char   *path      The file the stream was read from, for checksums and the cache, may be NULL.
  *
  *    @return wld_t *    The loaded world, or NULL on failure.
  */
-wld_t *wld_open(const char *path) {
-    wld_t *wld = (wld_t *)malloc(sizeof(wld_t));
-    if (wld == (wld_t *)0x0) {
+static wld_t *wld_open_stream(filestream_t *stream, const char *path) {
+    wld_open_ctx_t ctx;
+
+    memset(&ctx, 0, sizeof(ctx));
+
+    ctx.path = path;
+    ctx.wld  = (wld_t *)calloc(1, sizeof(wld_t));
+    if (ctx.wld == (wld_t *)0x0) {
         LOGF_ERR("Failed to allocate memory for world.\n");
+        filestream_free(stream);
         return (wld_t *)0x0;
     }
 
+    ctx.wld->file = stream;
+    ctx.stage     = WLD_OPEN_HEADER;
+
+    /* Without a budget the load runs to the end, so only the checksums can be left.  */
+    if (wld_open_step(&ctx, 0) != WLD_OPEN_DONE) {
+        free(ctx.crc);
+        wld_free(ctx.wld);
+        return (wld_t *)0x0;
+    }
+
+    return ctx.wld;
+}
+
+/*
+ *    Loads a terraria world.
+ *
+ *    @param char *path    The file to load.
+ *
+ *    @return wld_t *    The loaded world, or NULL on failure.
+ */
+wld_t *wld_open(const char *path) {
     filestream_t *pStream = filestream_open(path);
 
     if (pStream == (filestream_t *)0x0) {
         LOGF_ERR("Failed to open file.\n");
-        free(wld);
         return (wld_t *)0x0;
     }
 
-    wld->file = pStream;
+    wld_t *wld = wld_open_stream(pStream, path);
 
-    if (wld_decude_parsing_type(wld) == 0) {
-        LOGF_FAT("Failed to decode parsing type.\n");
+    /* The image takes a while, so loads in steps and from buffers leave it out.  */
+    if (wld != (wld_t *)0x0)
+        dump_tiles_png(wld, "tiles.png");
+
+    return wld;
+}
+
+/*
+ *    Loads a terraria world from a file already read into memory. Unlike
+ *    wld_open, no tiles.png is written.
+ *
+ *    @param unsigned char *buf     The file's contents, allocated with malloc, which the world takes over.
+ *    @param unsigned long  len     The length of the contents.
+ *    @param const char    *path    The file it was read from, for checksums and the cache, may be NULL.
+ *
+ *    @return wld_t *    The loaded world, or NULL on failure.
+ */
+wld_t *wld_open_buffer(unsigned char *buf, unsigned long len, const char *path) {
+    filestream_t *stream = filestream_from_buffer(buf, len);
+
+    if (stream == (filestream_t *)0x0)
         return (wld_t *)0x0;
+
+    return wld_open_stream(stream, path);
+}
+
+/*
+ *    Copies a buffer owned by someone else into an encoded section.
+ *
+ *    @param const char    *buf    The buffer to copy.
+ *    @param unsigned long  len    The length of the buffer.
+ *
+ *    @return char *    The copy, NULL on failure.
+ */
+static char *wld_encode_copy(const char *buf, unsigned long len) {
+    char *copy = (char *)malloc(len > 0 ? len : 1);
+
+    if (copy == (char *)0x0) {
+        LOGF_ERR("Failed to allocate memory for section.\n");
+        return (char *)0x0;
     }
 
-    get_tiles(wld);
-    get_chests(wld);
-    get_signs(wld);
-    get_npcs(wld);
+    memcpy(copy, buf, len);
+
+    return copy;
+}
 
-    if (wld->ver >= 116) {
-        if (wld->ver < 122) {
-           VLOGF_ERR("World version %d is not supported.\n", wld->ver);
+/*
+ *    Encodes a world into the sections of a world file. The section
+ *    offsets in the world's info header are updated to match.
+ *
+ *    @param wld_t         *wld    The world to encode.
+ *    @param wld_encoded_t *enc    Filled with the encoded sections.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int wld_encode(wld_t *wld, wld_encoded_t *enc) {
+    if (wld == (wld_t *)0x0 || enc == (wld_encoded_t *)0x0) {
+        LOGF_ERR("World or encoding is NULL.\n");
+        return 0;
+    }
+
+    memset(enc, 0, sizeof(*enc));
+
+    unsigned int  len  = 0;
+    unsigned long name = strlen(wld->header.name);
+    char         *buf;
+
+    /* Sized later, once the offsets it holds are known.  */
+    enc->sections[0] = (char *)0x0;
+
+    buf              = wld_header_get_header(wld, &len);
+    enc->sections[1] = wld_encode_copy(buf, len);
+    enc->sizes[1]    = len;
+
+    enc->sections[2]  = tile_get_buffer(wld, &enc->sizes[2]);
+    enc->sections[3]  = write_chests(wld, &enc->sizes[3]);
+    enc->sections[4]  = write_signs(wld, &enc->sizes[4]);
+    enc->sections[5]  = write_npcs(wld, &enc->sizes[5]);
+    enc->sections[6]  = write_tile_entities(wld, &enc->sizes[6]);
+    enc->sections[7]  = write_pressure_plates(wld, &enc->sizes[7]);
+    enc->sections[8]  = write_town_elements(wld, &enc->sizes[8]);
+    enc->sections[9]  = write_bestiary(wld, &enc->sizes[9]);
+    enc->sections[10] = wld_encode_copy("\001\000\000\000\001\b\000\000\000\000\000\001\t\000\000\001\n\000\000\001\f\000\000\000\000\000\001\r\000\000\000", 31);
+    enc->sizes[10]    = 31;
+    enc->sections[11] = (char *)malloc(2 + name + sizeof(wld->header.id));
+    enc->sizes[11]    = 2 + name + sizeof(wld->header.id);
+
+    int i;
+    for (i = 1; i < WLD_ENCODED_SECTIONS; ++i) {
+        if (enc->sections[i] == (char *)0x0) {
+            VLOGF_ERR("Failed to encode section %d.\n", i);
+            wld_encoded_free(enc);
+            return 0;
         }
-        get_tile_entities(wld);
     }
 
-    if (wld->ver >= 170) {
-        get_pressure_plates(wld);
+    enc->sections[11][0] = 1;
+    enc->sections[11][1] = (char)name;
+    memcpy(enc->sections[11] + 2, wld->header.name, name);
+    memcpy(enc->sections[11] + 2 + name, &wld->header.id, sizeof(wld->header.id));
+
+    /* The info header does not change size when its offsets change.  */
+    wld_info_get_header(wld, &len);
+    enc->sizes[0] = len;
+
+    unsigned long total = 0;
+
+    for (i = 0; i < WLD_ENCODED_SECTIONS; ++i) {
+        total += enc->sizes[i];
+
+        if (i < wld->info.numsections)
+            wld->info.sections[i] = total;
     }
 
-    if (wld->ver >= 189) {
-        get_town_elements(wld);
+    /* Offsets are 32 bits on disk, so larger worlds cannot be written.  */
+    if (total > 0xFFFFFFFF) {
+        VLOGF_ERR("World encodes to %lu bytes, more than a world file can hold.\n", total);
+        wld_encoded_free(enc);
+        return 0;
     }
 
-    if (wld->ver >= 210) {
-        get_bestiary(wld);
+    buf              = wld_info_get_header(wld, &len);
+    enc->sections[0] = wld_encode_copy(buf, len);
+
+    if (enc->sections[0] == (char *)0x0) {
+        wld_encoded_free(enc);
+        return 0;
     }
-    
-    wld->creative_powers_len = 31;
-    wld->creative_powers = "\001\000\000\000\001\b\000\000\000\000\000\001\t\000\000\001\n\000\000\001\f\000\000\000\000\000\001\r\000\000\000";
-    dump_tiles_png(wld, "tiles.png");
 
-    return wld;
+    return 1;
+}
+
+/*
+ *    Frees encoded sections.
+ *
+ *    @param wld_encoded_t *enc    The encoded sections to free.
+ */
+void wld_encoded_free(wld_encoded_t *enc) {
+    int i;
+    for (i = 0; i < WLD_ENCODED_SECTIONS; ++i) {
+        free(enc->sections[i]);
+        enc->sections[i] = (char *)0x0;
+    }
 }
 
 /*
- *    Writes a world to a file.
+ *    Writes a world to a file. The file is replaced atomically and
+ *    durably, see wld_save_commit.
  *
  *    @param wld_t *wld    The world to write.
  *    @param char *path      The file to write to.
@@ -872,53 +1460,242 @@ wld_t *wld_open(const char *path) {
  *    @return unsigned int          1 on success, 0 on failure.
  */
 unsigned int wld_write(wld_t *wld, const char *path) {
-    FILE *pFile = fopen(path, "wb");
+    wld_encoded_t enc;
 
-    if (pFile == (FILE *)0x0) {
-        LOGF_ERR("Failed to open file.\n");
+    if (!wld_encode(wld, &enc))
         return 0;
+
+    unsigned int ret = wld_save_commit(&enc, path);
+
+    wld_encoded_free(&enc);
+
+    return ret;
+}
+
+/*
+ *    Copies a string, keeping NULL as NULL.
+ *
+ *    @param const char   *str    The string to copy.
+ *    @param unsigned int *ok     Cleared if the copy fails.
+ *
+ *    @return char *    The copy.
+ */
+static char *wld_copy_string(const char *str, unsigned int *ok) {
+    if (str == (const char *)0x0)
+        return (char *)0x0;
+
+    char *copy = strdup(str);
+
+    if (copy == (char *)0x0)
+        *ok = 0;
+
+    return copy;
+}
+
+/*
+ *    Copies a buffer, keeping empty buffers as NULL.
+ *
+ *    @param const void    *buf    The buffer to copy.
+ *    @param unsigned long  len    The length of the buffer.
+ *    @param unsigned int  *ok     Cleared if the copy fails.
+ *
+ *    @return void *    The copy.
+ */
+static void *wld_copy_buffer(const void *buf, unsigned long len, unsigned int *ok) {
+    if (buf == (const void *)0x0 || len == 0)
+        return (void *)0x0;
+
+    void *copy = malloc(len);
+
+    if (copy == (void *)0x0) {
+        *ok = 0;
+        return (void *)0x0;
     }
 
-    unsigned long pos = 0;
+    memcpy(copy, buf, len);
 
-    char *sections[11];
-    unsigned int section_sizes[11];
-    char  footer[0x1000];
-
-    sprintf(footer, "\001%c%s", strlen(wld->header.name), wld->header.name);
-    memcpy(footer + 2 + strlen(wld->header.name), &wld->header.id, sizeof(wld->header.id));
-
-    sections[0] = wld_info_get_header(wld, &section_sizes[0]);
-    sections[1] = wld_header_get_header(wld, &section_sizes[1]);
-    sections[2] = tile_get_buffer(wld, &section_sizes[2]);
-    sections[3] = write_chests(wld, &section_sizes[3]);
-    sections[4] = write_signs(wld, &section_sizes[4]);
-    sections[5] = write_npcs(wld, &section_sizes[5]);
-    sections[6] = write_tile_entities(wld, &section_sizes[6]);
-    sections[7] = write_pressure_plates(wld, &section_sizes[7]);
-    sections[8] = write_town_elements(wld, &section_sizes[8]);
-    sections[9] = write_bestiary(wld, &section_sizes[9]);
-    sections[10] = "\001\000\000\000\001\b\000\000\000\000\000\001\t\000\000\001\n\000\000\001\f\000\000\000\000\000\001\r\000\000\000";
-    section_sizes[10]  = 31;
-    sections[11] = footer;
-    section_sizes[11] = 2 + strlen(wld->header.name) + 4;
-
-    unsigned int total_size = 0;
+    return copy;
+}
 
-    int i;
-    for (i = 0; i <= 11; ++i) {
-        total_size += section_sizes[i];
-        wld->info.sections[i] = total_size;
+/*
+ *    Copies the items of a chest into 40 slots, clearing the slots past
+ *    the ones the chest was loaded with.
+ *
+ *    @param const item_t *items    The items of the chest.
+ *    @param short         count    The number of items the chest has.
+ *    @param unsigned int *ok       Cleared if the copy fails.
+ *
+ *    @return item_t *    The copy.
+ */
+static item_t *wld_copy_items(const item_t *items, short count, unsigned int *ok) {
+    if (items == (const item_t *)0x0)
+        return (item_t *)0x0;
+
+    item_t *copy = (item_t *)calloc(40, sizeof(item_t));
+
+    if (copy == (item_t *)0x0) {
+        *ok = 0;
+        return (item_t *)0x0;
     }
 
-    sections[0] = wld_info_get_header(wld, &section_sizes[0]);
+    if (count > 0)
+        memcpy(copy, items, sizeof(item_t) * (count < 40 ? count : 40));
 
-    for (i = 0; i <= 11; ++i)
-        fwrite(sections[i], 1, section_sizes[i], pFile);
+    return copy;
+}
 
-    fclose(pFile);
+/*
+ *    Copies the headers of a world into a snapshot.
+ *
+ *    @param wld_t *snap    The snapshot.
+ *    @param wld_t *wld     The world.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int wld_snapshot_headers(wld_t *snap, wld_t *wld) {
+    unsigned int ok = 1;
+
+    snap->info               = wld->info;
+    snap->info.sections      = wld_copy_buffer(wld->info.sections, sizeof(long) * wld->info.numsections, &ok);
+    snap->info.uvs           = wld_copy_buffer(wld->info.uvs, (wld->info.tilemask + 7) / 8, &ok);
+    snap->header             = wld->header;
+    snap->header.name        = wld_copy_string(wld->header.name, &ok);
+    snap->header.seed        = wld_copy_string(wld->header.seed, &ok);
+    snap->header.playernames = (char **)0x0;
+    snap->header.kill_counts = wld_copy_buffer(wld->header.kill_counts, sizeof(int) * wld->header.kill_count_len, &ok);
+    snap->header.partiers    = wld_copy_buffer(wld->header.partiers, sizeof(int) * wld->header.partier_len, &ok);
+    snap->header.tree_tops   = wld_copy_buffer(wld->header.tree_tops, sizeof(int) * wld->header.tree_tops_len, &ok);
+
+    if (wld->header.playernames != (char **)0x0 && wld->header.players > 0) {
+        snap->header.playernames = (char **)calloc(wld->header.players, sizeof(char *));
+
+        if (snap->header.playernames == (char **)0x0)
+            return 0;
 
-    return 1;
+        int i;
+        for (i = 0; i < wld->header.players; ++i)
+            snap->header.playernames[i] = wld_copy_string(wld->header.playernames[i], &ok);
+    }
+
+    return ok;
+}
+
+/*
+ *    Copies the records of a world into a snapshot.
+ *
+ *    @param wld_t *snap    The snapshot.
+ *    @param wld_t *wld     The world.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int wld_snapshot_records(wld_t *snap, wld_t *wld) {
+    unsigned int ok = 1;
+
+    snap->chests = (chest_t *)wld_copy_buffer(wld->chests, sizeof(chest_t) * wld->chest_count, &ok);
+    snap->signs  = (sign_t *)wld_copy_buffer(wld->signs, sizeof(sign_t) * wld->sign_count, &ok);
+
+    if (!ok)
+        return 0;
+
+    /* Counts are only set once the arrays behind them exist, for wld_free.  */
+    short i;
+    for (i = 0; i < wld->chest_count; ++i) {
+        snap->chests[i].name  = wld_copy_string(wld->chests[i].name, &ok);
+        snap->chests[i].items = wld_copy_items(wld->chests[i].items, wld->chest_item_count, &ok);
+        snap->chest_count     = i + 1;
+    }
+
+    snap->chest_item_count = 40;
+
+    for (i = 0; i < wld->sign_count; ++i) {
+        snap->signs[i].text = wld_copy_string(wld->signs[i].text, &ok);
+        snap->sign_count    = i + 1;
+    }
+
+    if (wld->npcs != (npc_t *)0x0) {
+        snap->npcs = (npc_t *)wld_copy_buffer(wld->npcs, sizeof(npc_t) * 256, &ok);
+
+        if (snap->npcs == (npc_t *)0x0)
+            return 0;
+
+        /* Pets have no names.  */
+        unsigned long j;
+        for (j = 0; j < 256; ++j)
+            snap->npcs[j].name = j < wld->npc_count ? wld_copy_string(wld->npcs[j].name, &ok) : (char *)0x0;
+
+        snap->npc_count = wld->npc_count;
+        snap->pet_count = wld->pet_count;
+    }
+
+    snap->tile_entities   = (tile_entity_t *)wld_copy_buffer(wld->tile_entities, sizeof(tile_entity_t) * wld->tile_entity_count, &ok);
+    snap->pressure_plates = (pressure_plate_t *)wld_copy_buffer(wld->pressure_plates, sizeof(pressure_plate_t) * wld->pressure_plate_count, &ok);
+    snap->town_elements   = (town_element_t *)wld_copy_buffer(wld->town_elements, sizeof(town_element_t) * wld->town_element_count, &ok);
+    snap->kills           = (kill_t *)wld_copy_buffer(wld->kills, sizeof(kill_t) * wld->kill_count, &ok);
+    snap->trackers        = (tracker_t *)wld_copy_buffer(wld->trackers, sizeof(tracker_t) * wld->tracker_count, &ok);
+    snap->chatters        = (chatted_t *)wld_copy_buffer(wld->chatters, sizeof(chatted_t) * wld->chatter_count, &ok);
+
+    if (!ok)
+        return 0;
+
+    snap->tile_entity_count    = wld->tile_entity_count;
+    snap->pressure_plate_count = wld->pressure_plate_count;
+    snap->town_element_count   = wld->town_element_count;
+
+    int j;
+    for (j = 0; j < wld->kill_count; ++j) {
+        snap->kills[j].name = wld_copy_string(wld->kills[j].name, &ok);
+        snap->kill_count    = j + 1;
+    }
+
+    for (j = 0; j < wld->tracker_count; ++j) {
+        snap->trackers[j].item = wld_copy_string(wld->trackers[j].item, &ok);
+        snap->tracker_count    = j + 1;
+    }
+
+    for (j = 0; j < wld->chatter_count; ++j) {
+        snap->chatters[j].item = wld_copy_string(wld->chatters[j].item, &ok);
+        snap->chatter_count    = j + 1;
+    }
+
+    snap->creative_powers_len = wld->creative_powers_len;
+    snap->creative_powers     = wld->creative_powers;
+
+    return ok;
+}
+
+/*
+ *    Takes a snapshot of a world. Headers and records are copied, but
+ *    tiles are shared until either world writes to them, so this takes
+ *    no time proportional to the size of the world. The snapshot can be
+ *    written out on another thread while the world keeps being edited,
+ *    as long as tiles are edited through tile_column_mut.
+ *
+ *    @param wld_t *wld    The world to take a snapshot of.
+ *
+ *    @return wld_t *    The snapshot, to be freed with wld_free, or NULL on failure.
+ */
+wld_t *wld_snapshot(wld_t *wld) {
+    if (wld == (wld_t *)0x0) {
+        LOGF_ERR("World is NULL.\n");
+        return (wld_t *)0x0;
+    }
+
+    wld_t *snap = (wld_t *)calloc(1, sizeof(wld_t));
+
+    if (snap == (wld_t *)0x0) {
+        LOGF_ERR("Failed to allocate memory for snapshot.\n");
+        return (wld_t *)0x0;
+    }
+
+    snap->ver = wld->ver;
+
+    if (!wld_snapshot_headers(snap, wld) || !wld_snapshot_records(snap, wld) || !tile_store_share(snap, wld)) {
+        LOGF_ERR("Failed to copy world into snapshot.\n");
+        wld_free(snap);
+        return (wld_t *)0x0;
+    }
+
+    return snap;
 }
 
 /*
@@ -935,15 +1712,47 @@ void wld_free(wld_t *wld) {
     if (wld->file != (filestream_t *)0x0)
         filestream_free(wld->file);
 
+    short i;
+    for (i = 0; i < wld->sign_count; ++i) {
+        free(wld->signs[i].text);
+    }
+
     free(wld->signs);
 
-    short i;
     for (i = 0; i < wld->chest_count; ++i) {
+        free(wld->chests[i].name);
         free(wld->chests[i].items);
     }
 
     free(wld->chests);
 
+    unsigned long j;
+    for (j = 0; j < wld->npc_count; ++j) {
+        free(wld->npcs[j].name);
+    }
+
+    free(wld->npcs);
+
+    int k;
+    for (k = 0; k < wld->kill_count; ++k) {
+        free(wld->kills[k].name);
+    }
+
+    for (k = 0; k < wld->tracker_count; ++k) {
+        free(wld->trackers[k].item);
+    }
+
+    for (k = 0; k < wld->chatter_count; ++k) {
+        free(wld->chatters[k].item);
+    }
+
+    free(wld->kills);
+    free(wld->trackers);
+    free(wld->chatters);
+    free(wld->tile_entities);
+    free(wld->pressure_plates);
+    free(wld->town_elements);
+
     free_tiles(wld);
     wld_header_free(wld->header);
     wld_info_header_free(wld->info);
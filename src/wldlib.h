@@ -9,7 +9,64 @@
  */
 #pragma once
 
+#include "compress.h"
 #include "wld.h"
+#include "wldcache.h"
+
+#define WLD_ENCODED_SECTIONS 12
+
+#define WLD_OPEN_READING  0
+#define WLD_OPEN_HEADER   1
+#define WLD_OPEN_CHECKSUM 2
+#define WLD_OPEN_TILES    3
+#define WLD_OPEN_CACHING  4
+#define WLD_OPEN_SECTIONS 5
+#define WLD_OPEN_DONE     6
+#define WLD_OPEN_FAILED   7
+
+/*
+ *    The most bytes read or checksummed, or tile columns decoded or
+ *    cached, between checks of a load's time budget.
+ */
+#define WLD_OPEN_CHUNK   0x40000
+#define WLD_OPEN_COLUMNS 8
+
+/*
+ *    A world encoded into the sections of a world file, in file order:
+ *    the info header, the header, the sections listed in the info
+ *    header, and the footer.
+ */
+typedef struct {
+    char          *sections[WLD_ENCODED_SECTIONS];
+    unsigned long  sizes[WLD_ENCODED_SECTIONS];
+} wld_encoded_t;
+
+/*
+ *    The checksums of a world file, defined in wldcrc.h.
+ */
+typedef struct wld_crc_s wld_crc_t;
+
+/*
+ *    A world being loaded a step at a time. The stage is one of the
+ *    WLD_OPEN_* values. The checksums and cache hash are only kept when
+ *    the load has a path and checksums or the cache are enabled.
+ */
+typedef struct {
+    const char          *path;
+    int                  stage;
+    compress_reader_t    in;
+    unsigned long        size;
+    unsigned char       *buf;
+    unsigned long        len;
+    unsigned long        cap;
+    wld_t               *wld;
+    wld_crc_t           *crc;
+    unsigned long        checked;
+    unsigned long long   hash;
+    wld_cache_writer_t   cache;
+    int                  column;
+    int                  section;
+} wld_open_ctx_t;
 
 /*
  *    Creates a new Terraria world.
@@ -33,7 +90,80 @@ wld_t *wld_new(int width, int height, const char *name, const char *seed);
 wld_t *wld_open(const char *path);
 
 /*
- *    Writes a world to a file.
+ *    Loads a terraria world from a file already read into memory. Unlike
+ *    wld_open, no tiles.png is written.
+ *
+ *    @param unsigned char *buf     The file's contents, allocated with malloc, which the world takes over.
+ *    @param unsigned long  len     The length of the contents.
+ *    @param const char    *path    The file it was read from, for checksums and the cache, may be NULL.
+ *
+ *    @return wld_t *    The loaded world, or NULL on failure.
+ */
+wld_t *wld_open_buffer(unsigned char *buf, unsigned long len, const char *path);
+
+/*
+ *    Starts loading a terraria world a step at a time, so a caller with a
+ *    frame to keep can spread the load over many frames. Nothing is read
+ *    until the first step.
+ *
+ *    @param const char *path    The file to load.
+ *
+ *    @return wld_open_ctx_t *    The load, or NULL on failure.
+ */
+wld_open_ctx_t *wld_open_begin(const char *path);
+
+/*
+ *    Runs a load until it finishes or its time budget runs out. The
+ *    budget is checked between chunks of the file, of its checksums,
+ *    of tile columns, decoded or cached, and between sections, so a
+ *    step can overrun it by one of those.
+ *
+ *    @param wld_open_ctx_t *ctx          The load.
+ *    @param unsigned long   budget_us    The time to spend in microseconds, 0 for no limit.
+ *
+ *    @return int    The stage the load is at, WLD_OPEN_DONE or WLD_OPEN_FAILED once it is over.
+ */
+int wld_open_step(wld_open_ctx_t *ctx, unsigned long budget_us);
+
+/*
+ *    Returns how far along a load is.
+ *
+ *    @param wld_open_ctx_t *ctx    The load.
+ *
+ *    @return float    The percentage done, from 0 to 100.
+ */
+float wld_open_progress(wld_open_ctx_t *ctx);
+
+/*
+ *    Ends a load, cancelling it if it is not done.
+ *
+ *    @param wld_open_ctx_t *ctx    The load, which is freed.
+ *
+ *    @return wld_t *    The loaded world, or NULL if the load failed or was cancelled.
+ */
+wld_t *wld_open_end(wld_open_ctx_t *ctx);
+
+/*
+ *    Encodes a world into the sections of a world file. The section
+ *    offsets in the world's info header are updated to match.
+ *
+ *    @param wld_t         *wld    The world to encode.
+ *    @param wld_encoded_t *enc    Filled with the encoded sections.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int wld_encode(wld_t *wld, wld_encoded_t *enc);
+
+/*
+ *    Frees encoded sections.
+ *
+ *    @param wld_encoded_t *enc    The encoded sections to free.
+ */
+void wld_encoded_free(wld_encoded_t *enc);
+
+/*
+ *    Writes a world to a file. The file is replaced atomically and
+ *    durably, see wld_save_commit.
  *
  *    @param wld_t *wld    The world to write.
  *    @param char *path      The file to write to.
@@ -42,6 +172,19 @@ wld_t *wld_open(const char *path);
  */
 unsigned int wld_write(wld_t *wld, const char *path);
 
+/*
+ *    Takes a snapshot of a world. Headers and records are copied, but
+ *    tiles are shared until either world writes to them, so this takes
+ *    no time proportional to the size of the world. The snapshot can be
+ *    written out on another thread while the world keeps being edited,
+ *    as long as tiles are edited through tile_column_mut.
+ *
+ *    @param wld_t *wld    The world to take a snapshot of.
+ *
+ *    @return wld_t *    The snapshot, to be freed with wld_free, or NULL on failure.
+ */
+wld_t *wld_snapshot(wld_t *wld);
+
 /*
  *    Frees a world.
  *
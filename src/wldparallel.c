@@ -0,0 +1,147 @@
+/*
+ *    wldparallel.c    --    Source file for parallel passes over worlds
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Defines the functions used to run a pass over the tiles of a world
+ *    on the library's thread pool. Column passes are split on tile chunk
+ *    boundaries: a chunk is contiguous in memory, and only one worker
+ *    ever copies it when it is shared with a snapshot.
+ */
+#include "wldparallel.h"
+
+#include "log.h"
+#include "tilepalette.h"
+#include "tilestore.h"
+
+#include <malloc.h>
+
+typedef struct {
+    wld_t           *wld;
+    int              x0;
+    int              x;
+    wld_column_fn_t  column_fn;
+    wld_row_fn_t     row_fn;
+    void            *ctx;
+} wld_parallel_t;
+
+/*
+ *    Runs a column callback over a range of chunks, clipped to the pass.
+ *
+ *    @param unsigned long  begin     The first chunk.
+ *    @param unsigned long  end       The end chunk, exclusive.
+ *    @param unsigned int   worker    The worker.
+ *    @param void          *ctx       The pass.
+ */
+static void wld_parallel_columns(unsigned long begin, unsigned long end, unsigned int worker, void *ctx) {
+    wld_parallel_t *pass = (wld_parallel_t *)ctx;
+    int             x0   = begin * TILE_CHUNK_COLUMNS;
+    int             x    = end * TILE_CHUNK_COLUMNS;
+
+    pass->column_fn(pass->wld, x0 > pass->x0 ? x0 : pass->x0, x < pass->x ? x : pass->x, worker, pass->ctx);
+}
+
+/*
+ *    Runs a row callback over a band of rows.
+ *
+ *    @param unsigned long  begin     The first row.
+ *    @param unsigned long  end       The end row, exclusive.
+ *    @param unsigned int   worker    The worker.
+ *    @param void          *ctx       The pass.
+ */
+static void wld_parallel_rows(unsigned long begin, unsigned long end, unsigned int worker, void *ctx) {
+    wld_parallel_t *pass = (wld_parallel_t *)ctx;
+
+    pass->row_fn(pass->wld, begin, end, worker, pass->ctx);
+}
+
+/*
+ *    Runs a function over columns of a world in parallel. Ranges never
+ *    straddle a tile chunk, so callbacks may get their columns through
+ *    tile_column_mut and write to them.
+ *
+ *    @param wld_t           *wld        The world.
+ *    @param int              x0         The first column.
+ *    @param int              x          The end column, exclusive.
+ *    @param wld_column_fn_t  fn         The function to run.
+ *    @param void            *ctx        Passed to the function.
+ *    @param unsigned int     threads    The number of threads to use, 0 for one per CPU.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int wld_parallel_for_columns(wld_t *wld, int x0, int x, wld_column_fn_t fn, void *ctx, unsigned int threads) {
+    /* Callbacks are handed wld->tiles, which a paletted world has none of.  */
+    if (wld != (wld_t *)0x0 && !tile_palette_expand(wld))
+        return 0;
+
+    if (wld == (wld_t *)0x0 || wld->tiles == (tile_t **)0x0 || fn == (wld_column_fn_t)0x0) {
+        LOGF_ERR("World has no tiles or function is NULL.\n");
+        return 0;
+    }
+
+    if (x0 < 0)
+        x0 = 0;
+    if (x > wld->header.width)
+        x = wld->header.width;
+
+    if (x0 >= x)
+        return 1;
+
+    /* Workers would race to allocate the marks in tile_column_mut.  */
+    if (!tile_store_marks(wld))
+        return 0;
+
+    wld_parallel_t pass = {wld, x0, x, fn, (wld_row_fn_t)0x0, ctx};
+
+    return threadpool_for(x0 / TILE_CHUNK_COLUMNS, (x - 1) / TILE_CHUNK_COLUMNS + 1, 1, wld_parallel_columns, &pass, threads);
+}
+
+/*
+ *    Runs a function over bands of rows of a world in parallel. Every band
+ *    spans all columns, so callbacks must not call tile_column_mut; a pass
+ *    that writes asks for every column to be made writable before it
+ *    starts, and may then write through wld->tiles.
+ *
+ *    @param wld_t         *wld         The world.
+ *    @param int            y0          The first row.
+ *    @param int            y           The end row, exclusive.
+ *    @param wld_row_fn_t   fn          The function to run.
+ *    @param void          *ctx         Passed to the function.
+ *    @param unsigned int   writable    1 if the callbacks write tiles, 0 if they only read them.
+ *    @param unsigned int   threads     The number of threads to use, 0 for one per CPU.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int wld_parallel_for_rows(wld_t *wld, int y0, int y, wld_row_fn_t fn, void *ctx, unsigned int writable, unsigned int threads) {
+    /* Callbacks are handed wld->tiles, which a paletted world has none of.  */
+    if (wld != (wld_t *)0x0 && !tile_palette_expand(wld))
+        return 0;
+
+    if (wld == (wld_t *)0x0 || wld->tiles == (tile_t **)0x0 || fn == (wld_row_fn_t)0x0) {
+        LOGF_ERR("World has no tiles or function is NULL.\n");
+        return 0;
+    }
+
+    if (y0 < 0)
+        y0 = 0;
+    if (y > wld->header.height)
+        y = wld->header.height;
+
+    if (y0 >= y)
+        return 1;
+
+    /* Copies shared with snapshots are made here, before any band writes.  */
+    if (writable) {
+        int x;
+        for (x = 0; x < wld->header.width; ++x) {
+            if (tile_column_mut(wld, x) == (tile_t *)0x0) {
+                VLOGF_ERR("Failed to get column %d for writing.\n", x);
+                return 0;
+            }
+        }
+    }
+
+    wld_parallel_t pass = {wld, 0, wld->header.width, (wld_column_fn_t)0x0, fn, ctx};
+
+    return threadpool_for(y0, y, WLD_PARALLEL_ROW_BAND, wld_parallel_rows, &pass, threads);
+}
@@ -0,0 +1,64 @@
+/*
+ *    wldparallel.h    --    Header file for parallel passes over worlds
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Declares the functions used to run a pass over the tiles of a world
+ *    on the library's thread pool, either by columns or by bands of rows.
+ *    Callbacks get the index of the worker running them, so a pass can
+ *    keep one result per worker, sized by threadpool_workers, and combine
+ *    them afterwards instead of using atomics.
+ */
+#ifndef WLD_WLDPARALLEL_H
+#define WLD_WLDPARALLEL_H
+
+#include "threadpool.h"
+#include "wld.h"
+
+/*
+ *    The number of rows in a band handed to a row callback.
+ */
+#define WLD_PARALLEL_ROW_BAND 32
+
+/*
+ *    Called with a range of columns, x0 to x - 1, or a band of rows, y0
+ *    to y - 1, depending on the pass.
+ */
+typedef void (*wld_column_fn_t)(wld_t *wld, int x0, int x, unsigned int worker, void *ctx);
+typedef void (*wld_row_fn_t)(wld_t *wld, int y0, int y, unsigned int worker, void *ctx);
+
+/*
+ *    Runs a function over columns of a world in parallel. Ranges never
+ *    straddle a tile chunk, so callbacks may get their columns through
+ *    tile_column_mut and write to them.
+ *
+ *    @param wld_t           *wld        The world.
+ *    @param int              x0         The first column.
+ *    @param int              x          The end column, exclusive.
+ *    @param wld_column_fn_t  fn         The function to run.
+ *    @param void            *ctx        Passed to the function.
+ *    @param unsigned int     threads    The number of threads to use, 0 for one per CPU.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int wld_parallel_for_columns(wld_t *wld, int x0, int x, wld_column_fn_t fn, void *ctx, unsigned int threads);
+
+/*
+ *    Runs a function over bands of rows of a world in parallel. Every band
+ *    spans all columns, so callbacks must not call tile_column_mut; a pass
+ *    that writes asks for every column to be made writable before it
+ *    starts, and may then write through wld->tiles.
+ *
+ *    @param wld_t         *wld         The world.
+ *    @param int            y0          The first row.
+ *    @param int            y           The end row, exclusive.
+ *    @param wld_row_fn_t   fn          The function to run.
+ *    @param void          *ctx         Passed to the function.
+ *    @param unsigned int   writable    1 if the callbacks write tiles, 0 if they only read them.
+ *    @param unsigned int   threads     The number of threads to use, 0 for one per CPU.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int wld_parallel_for_rows(wld_t *wld, int y0, int y, wld_row_fn_t fn, void *ctx, unsigned int writable, unsigned int threads);
+
+#endif /* WLD_WLDPARALLEL_H  */
@@ -0,0 +1,474 @@
+/*
+ *    wldsave.c    --    Source file for world saves
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Defines world saves. Backups are made by reflinking the old file
+ *    before the new one is renamed over it, which copies nothing; where
+ *    reflinks are not supported it is copied in the kernel with
+ *    copy_file_range, or through a buffer as a last resort. Background
+ *    saves get their own detached thread, which owns the snapshot and
+ *    frees it once the callback returns.
+ */
+#define _GNU_SOURCE
+
+#include "wldsave.h"
+
+#include "log.h"
+#include "wldcrc.h"
+
+#include <fcntl.h>
+#include <libgen.h>
+#include <linux/fs.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+    wld_t               *snap;
+    char                *path;
+    wld_save_callback_t  callback;
+    void                *data;
+    wld_save_result_t    result;
+} wld_save_job_t;
+
+static unsigned int  _save_backups = 0;
+static unsigned long _save_counter = 0;
+
+/*
+ *    Returns the time on the monotonic clock.
+ *
+ *    @return double    The time in seconds.
+ */
+static double wld_save_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ *    Frees a save job.
+ *
+ *    @param wld_save_job_t *job    The job to free.
+ */
+static void wld_save_job_free(wld_save_job_t *job) {
+    if (job->snap != (wld_t *)0x0)
+        wld_free(job->snap);
+
+    free(job->path);
+    free(job);
+}
+
+/*
+ *    Sets how many backup generations saves keep, as "<path>.bak1" (the
+ *    newest) to "<path>.bak<count>". 0 by default, which keeps none.
+ *
+ *    @param unsigned int count    The number of generations to keep.
+ */
+void wld_save_set_backups(unsigned int count) {
+    _save_backups = count;
+}
+
+/*
+ *    Builds the name of a file next to a world file.
+ *
+ *    @param const char    *path      The world file.
+ *    @param const char    *suffix    The suffix, with a %lu for the number.
+ *    @param unsigned long  n         The number.
+ *
+ *    @return char *    The name, NULL on failure.
+ */
+static char *wld_save_name(const char *path, const char *suffix, unsigned long n) {
+    char *name = (char *)malloc(strlen(path) + strlen(suffix) + 32);
+
+    if (name == (char *)0x0) {
+        LOGF_ERR("Failed to allocate memory for file name.\n");
+        return (char *)0x0;
+    }
+
+    strcpy(name, path);
+    sprintf(name + strlen(path), suffix, n);
+
+    return name;
+}
+
+/*
+ *    Writes a whole buffer to a file descriptor.
+ *
+ *    @param int            fd     The file descriptor.
+ *    @param const char    *buf    The buffer.
+ *    @param unsigned long  len    The length of the buffer.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int wld_save_write_all(int fd, const char *buf, unsigned long len) {
+    while (len > 0) {
+        ssize_t written = write(fd, buf, len);
+
+        if (written <= 0)
+            return 0;
+
+        buf += written;
+        len -= written;
+    }
+
+    return 1;
+}
+
+/*
+ *    Copies the rest of one file into another through a buffer.
+ *
+ *    @param int in     The file to copy from.
+ *    @param int out    The file to copy to.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int wld_save_copy(int in, int out) {
+    char    buf[0x10000];
+    ssize_t n;
+
+    while ((n = read(in, buf, sizeof(buf))) > 0) {
+        if (!wld_save_write_all(out, buf, n))
+            return 0;
+    }
+
+    return n == 0;
+}
+
+/*
+ *    Copies a file as cheaply as the filesystem allows: a reflink, then an
+ *    in-kernel copy, then a plain copy. The copy never shares an inode
+ *    with the file, since other writers may rewrite it in place.
+ *
+ *    @param const char *src    The file to copy.
+ *    @param const char *dst    The copy, which must not exist.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int wld_save_clone(const char *src, const char *dst) {
+    int in = open(src, O_RDONLY);
+
+    if (in < 0)
+        return 0;
+
+    int out = open(dst, O_WRONLY | O_CREAT | O_EXCL, 0644);
+
+    if (out < 0) {
+        close(in);
+        return 0;
+    }
+
+    unsigned int ret = ioctl(out, FICLONE, in) == 0;
+
+    if (ret == 0) {
+        ssize_t copied;
+
+        while ((copied = copy_file_range(in, (loff_t *)0x0, out, (loff_t *)0x0, 1 << 30, 0)) > 0)
+            ;
+
+        ret = copied == 0;
+    }
+
+    /* Start over with a plain copy where the kernel could not copy.  */
+    if (ret == 0 && lseek(in, 0, SEEK_SET) == 0 && lseek(out, 0, SEEK_SET) == 0 && ftruncate(out, 0) == 0)
+        ret = wld_save_copy(in, out);
+
+    close(in);
+
+    if (close(out) != 0 || ret == 0) {
+        unlink(dst);
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ *    Shifts the backup generations of a file down by one and makes the
+ *    file the newest generation.
+ *
+ *    @param const char *path    The file about to be replaced.
+ */
+static void wld_save_rotate(const char *path) {
+    if (_save_backups == 0 || access(path, F_OK) != 0)
+        return;
+
+    unsigned long i;
+    for (i = _save_backups; i > 0; --i) {
+        char *from = wld_save_name(path, ".bak%lu", i);
+        char *to   = i < _save_backups ? wld_save_name(path, ".bak%lu", i + 1) : (char *)0x0;
+
+        if (from != (char *)0x0) {
+            if (to != (char *)0x0)
+                rename(from, to);
+            else
+                unlink(from);
+        }
+
+        free(from);
+        free(to);
+    }
+
+    char *bak = wld_save_name(path, ".bak%lu", 1);
+
+    if (bak != (char *)0x0 && !wld_save_clone(path, bak))
+        VLOGF_WARN("Failed to back up %s.\n", path);
+
+    free(bak);
+}
+
+/*
+ *    Syncs the directory holding a file, so a rename into it is durable.
+ *
+ *    @param const char *path    The file.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int wld_save_sync_dir(const char *path) {
+    char *copy = strdup(path);
+
+    if (copy == (char *)0x0) {
+        LOGF_ERR("Failed to allocate memory for directory name.\n");
+        return 0;
+    }
+
+    int fd = open(dirname(copy), O_RDONLY | O_DIRECTORY);
+    free(copy);
+
+    if (fd < 0)
+        return 0;
+
+    unsigned int ret = fsync(fd) == 0;
+    close(fd);
+
+    return ret;
+}
+
+/*
+ *    Starts a save by creating its temp file, in the same directory as
+ *    the target so it can be renamed over it.
+ *
+ *    @param const char *path    The file to save to.
+ *    @param int        *fd      The temp file's descriptor, open for writing.
+ *
+ *    @return char *    The temp file's path, NULL on failure.
+ */
+char *wld_save_begin(const char *path, int *fd) {
+    if (path == (const char *)0x0) {
+        LOGF_ERR("Path is NULL.\n");
+        return (char *)0x0;
+    }
+
+    /* Saves to the same path can overlap, so each gets its own temp file.  */
+    char *tmp = wld_save_name(path, ".%lu.tmp", ((unsigned long)getpid() << 32) + __atomic_add_fetch(&_save_counter, 1, __ATOMIC_RELAXED));
+
+    if (tmp == (char *)0x0)
+        return (char *)0x0;
+
+    *fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL, 0644);
+
+    if (*fd < 0) {
+        VLOGF_ERR("Failed to open %s.\n", tmp);
+        free(tmp);
+        return (char *)0x0;
+    }
+
+    return tmp;
+}
+
+/*
+ *    Finishes a save started with wld_save_begin, once the sections are
+ *    written and synced. The temp file is renamed over the target, or
+ *    removed if the save failed.
+ *
+ *    @param wld_encoded_t *enc     The encoded sections, NULL if the file was not encoded from a world.
+ *    @param int            fd      The temp file's descriptor, which is closed.
+ *    @param char          *tmp     The temp file's path, which is freed.
+ *    @param const char    *path    The file to save to.
+ *    @param unsigned int   ok      Whether the sections were written and synced.
+ *
+ *    @return unsigned int    1 on success, 0 on failure, in which case the old file is untouched.
+ */
+unsigned int wld_save_finish(wld_encoded_t *enc, int fd, char *tmp, const char *path, unsigned int ok) {
+    unsigned int ret = ok;
+
+    /*
+     *    The sidecar goes first, stamped with the temp file's size and
+     *    mtime, which the rename keeps. If the rename never happens, it
+     *    matches no file and the next load replaces it.
+     */
+    if (ret && enc != (wld_encoded_t *)0x0 && wld_crc_enabled()) {
+        wld_crc_t   crc;
+        struct stat st;
+
+        wld_crc_compute_encoded(enc, &crc);
+
+        unsigned int stored = fstat(fd, &st) == 0;
+
+        if (stored) {
+            crc.mtime      = st.st_mtim.tv_sec;
+            crc.mtime_nsec = st.st_mtim.tv_nsec;
+            stored         = wld_crc_store(&crc, path);
+        }
+
+        if (!stored)
+            VLOGF_WARN("Failed to record the checksums of %s.\n", path);
+    }
+
+    if (close(fd) != 0)
+        ret = 0;
+
+    if (ret) {
+        wld_save_rotate(path);
+        ret = rename(tmp, path) == 0;
+    }
+
+    if (ret == 0) {
+        VLOGF_ERR("Failed to write %s.\n", path);
+        unlink(tmp);
+        free(tmp);
+        return 0;
+    }
+
+    free(tmp);
+
+    if (!wld_save_sync_dir(path))
+        VLOGF_WARN("Failed to sync the directory of %s.\n", path);
+
+    return 1;
+}
+
+/*
+ *    Writes encoded sections to a file without ever leaving it half
+ *    written. The sections go to a temp file in the same directory, which
+ *    is synced and renamed over the target before the directory itself is
+ *    synced. The old file becomes the newest backup generation.
+ *
+ *    @param wld_encoded_t *enc     The encoded sections.
+ *    @param const char    *path    The file to write to.
+ *
+ *    @return unsigned int    1 on success, 0 on failure, in which case the old file is untouched.
+ */
+unsigned int wld_save_commit(wld_encoded_t *enc, const char *path) {
+    if (enc == (wld_encoded_t *)0x0 || path == (const char *)0x0) {
+        LOGF_ERR("Encoding or path is NULL.\n");
+        return 0;
+    }
+
+    int   fd;
+    char *tmp = wld_save_begin(path, &fd);
+
+    if (tmp == (char *)0x0)
+        return 0;
+
+    unsigned int ret = 1;
+
+    int i;
+    for (i = 0; i < WLD_ENCODED_SECTIONS && ret; ++i)
+        ret = wld_save_write_all(fd, enc->sections[i], enc->sizes[i]);
+
+    /* The data has to be on disk before the rename can point at it.  */
+    if (ret)
+        ret = fsync(fd) == 0;
+
+    return wld_save_finish(enc, fd, tmp, path, ret);
+}
+
+/*
+ *    Encodes and writes a snapshot on the worker thread.
+ *
+ *    @param void *arg    The save job.
+ *
+ *    @return void *    NULL.
+ */
+static void *wld_save_worker(void *arg) {
+    wld_save_job_t *job = (wld_save_job_t *)arg;
+    wld_encoded_t   enc;
+    double          start = wld_save_now();
+
+    job->result.ok          = wld_encode(job->snap, &enc);
+    job->result.encode_time = wld_save_now() - start;
+
+    if (job->result.ok) {
+        start = wld_save_now();
+
+        job->result.ok = wld_save_commit(&enc, job->path);
+        wld_encoded_free(&enc);
+
+        job->result.write_time = wld_save_now() - start;
+    }
+
+    if (job->callback != (wld_save_callback_t)0x0)
+        job->callback(&job->result, job->data);
+
+    wld_save_job_free(job);
+
+    return (void *)0x0;
+}
+
+/*
+ *    Saves a world in the background. The world is snapshotted before
+ *    this returns and can be edited right away, as long as tiles are
+ *    written through tile_column_mut. The file is written with
+ *    wld_save_commit.
+ *
+ *    @param wld_t               *wld         The world to save.
+ *    @param const char          *path        The file to save to.
+ *    @param wld_save_callback_t  callback    Called when the save is done, may be NULL.
+ *    @param void                *data        Passed to the callback.
+ *
+ *    @return unsigned int    1 if the save was started, 0 on failure.
+ */
+unsigned int wld_save_async(wld_t *wld, const char *path, wld_save_callback_t callback, void *data) {
+    if (wld == (wld_t *)0x0 || path == (const char *)0x0) {
+        LOGF_ERR("World or path is NULL.\n");
+        return 0;
+    }
+
+    wld_save_job_t *job = (wld_save_job_t *)calloc(1, sizeof(wld_save_job_t));
+
+    if (job == (wld_save_job_t *)0x0) {
+        LOGF_ERR("Failed to allocate memory for save job.\n");
+        return 0;
+    }
+
+    double start = wld_save_now();
+
+    job->callback = callback;
+    job->data     = data;
+    job->path     = strdup(path);
+    job->snap     = wld_snapshot(wld);
+
+    if (job->path == (char *)0x0 || job->snap == (wld_t *)0x0) {
+        LOGF_ERR("Failed to snapshot world for saving.\n");
+        wld_save_job_free(job);
+        return 0;
+    }
+
+    job->result.path          = job->path;
+    job->result.snapshot_time = wld_save_now() - start;
+
+    pthread_t      thread;
+    pthread_attr_t attr;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    if (pthread_create(&thread, &attr, wld_save_worker, job) != 0) {
+        LOGF_ERR("Failed to start save thread.\n");
+        pthread_attr_destroy(&attr);
+        wld_save_job_free(job);
+        return 0;
+    }
+
+    pthread_attr_destroy(&attr);
+
+    return 1;
+}
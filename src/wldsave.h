@@ -0,0 +1,91 @@
+/*
+ *    wldsave.h    --    Header file for world saves
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Declares the functions used to save worlds safely: committing a
+ *    file so that a crash never leaves a half written world, keeping
+ *    backup generations, and saving on a worker thread so that the
+ *    thread editing the world only waits for a snapshot.
+ */
+#ifndef WLD_WLDSAVE_H
+#define WLD_WLDSAVE_H
+
+#include "wldlib.h"
+
+typedef struct {
+    const char   *path;
+    unsigned int  ok;
+    double        snapshot_time;
+    double        encode_time;
+    double        write_time;
+} wld_save_result_t;
+
+/*
+ *    Called on the worker thread once a save is done. Times are in seconds.
+ */
+typedef void (*wld_save_callback_t)(const wld_save_result_t *result, void *data);
+
+/*
+ *    Sets how many backup generations saves keep, as "<path>.bak1" (the
+ *    newest) to "<path>.bak<count>". 0 by default, which keeps none.
+ *
+ *    @param unsigned int count    The number of generations to keep.
+ */
+void wld_save_set_backups(unsigned int count);
+
+/*
+ *    Starts a save by creating its temp file, in the same directory as
+ *    the target so it can be renamed over it.
+ *
+ *    @param const char *path    The file to save to.
+ *    @param int        *fd      The temp file's descriptor, open for writing.
+ *
+ *    @return char *    The temp file's path, NULL on failure.
+ */
+char *wld_save_begin(const char *path, int *fd);
+
+/*
+ *    Finishes a save started with wld_save_begin, once the sections are
+ *    written and synced. The temp file is renamed over the target, or
+ *    removed if the save failed.
+ *
+ *    @param wld_encoded_t *enc     The encoded sections, NULL if the file was not encoded from a world.
+ *    @param int            fd      The temp file's descriptor, which is closed.
+ *    @param char          *tmp     The temp file's path, which is freed.
+ *    @param const char    *path    The file to save to.
+ *    @param unsigned int   ok      Whether the sections were written and synced.
+ *
+ *    @return unsigned int    1 on success, 0 on failure, in which case the old file is untouched.
+ */
+unsigned int wld_save_finish(wld_encoded_t *enc, int fd, char *tmp, const char *path, unsigned int ok);
+
+/*
+ *    Writes encoded sections to a file without ever leaving it half
+ *    written. The sections go to a temp file in the same directory, which
+ *    is synced and renamed over the target before the directory itself is
+ *    synced. The old file becomes the newest backup generation.
+ *
+ *    @param wld_encoded_t *enc     The encoded sections.
+ *    @param const char    *path    The file to write to.
+ *
+ *    @return unsigned int    1 on success, 0 on failure, in which case the old file is untouched.
+ */
+unsigned int wld_save_commit(wld_encoded_t *enc, const char *path);
+
+/*
+ *    Saves a world in the background. The world is snapshotted before
+ *    this returns and can be edited right away, as long as tiles are
+ *    written through tile_column_mut. The file is written with
+ *    wld_save_commit.
+ *
+ *    @param wld_t               *wld         The world to save.
+ *    @param const char          *path        The file to save to.
+ *    @param wld_save_callback_t  callback    Called when the save is done, may be NULL.
+ *    @param void                *data        Passed to the callback.
+ *
+ *    @return unsigned int    1 if the save was started, 0 on failure.
+ */
+unsigned int wld_save_async(wld_t *wld, const char *path, wld_save_callback_t callback, void *data);
+
+#endif /* WLD_WLDSAVE_H  */
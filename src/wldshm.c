@@ -0,0 +1,603 @@
+/*
+ *    wldshm.c    --    Source file for shared memory world images
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Defines shared world images. Every publish writes a whole new image
+ *    segment and only then bumps the version in the control segment, so a
+ *    reader never sees an image that is still being written. The previous
+ *    image is unlinked right away; readers still mapping it keep it alive
+ *    until they detach. There must only be one publisher per name.
+ */
+#include "wldshm.h"
+
+#include "log.h"
+#include "tilepalette.h"
+#include "wldheaderfuncs.h"
+
+#include <fcntl.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define WLD_SHM_ALIGN(x) (((x) + 7) & ~7UL)
+
+/*
+ *    Builds the name of a segment.
+ *
+ *    @param const char    *name       The name of the image.
+ *    @param unsigned long  version    The version of the image, 0 for the control segment.
+ *
+ *    @return char *    The segment name, NULL on failure.
+ */
+static char *wld_shm_segment(const char *name, unsigned long version) {
+    char *segment = (char *)malloc(strlen(name) + 24);
+
+    if (segment == (char *)0x0) {
+        LOGF_ERR("Failed to allocate memory for segment name.\n");
+        return (char *)0x0;
+    }
+
+    if (version == 0)
+        sprintf(segment, "/%s", name);
+    else
+        sprintf(segment, "/%s.%lu", name, version);
+
+    return segment;
+}
+
+/*
+ *    Removes an image segment.
+ *
+ *    @param const char    *name       The name of the image.
+ *    @param unsigned long  version    The version of the image.
+ */
+static void wld_shm_unlink(const char *name, unsigned long version) {
+    char *segment = wld_shm_segment(name, version);
+
+    if (segment == (char *)0x0)
+        return;
+
+    shm_unlink(segment);
+    free(segment);
+}
+
+/*
+ *    Returns the size of a string in the string pool.
+ *
+ *    @param const char *str    The string, may be NULL.
+ *
+ *    @return unsigned long    The size of the string with its terminator, 0 for NULL.
+ */
+static unsigned long wld_shm_string_size(const char *str) {
+    return str == (const char *)0x0 ? 0 : strlen(str) + 1;
+}
+
+/*
+ *    Copies a string into the string pool.
+ *
+ *    @param unsigned char *pool    The string pool.
+ *    @param unsigned long *pos     The end of the pool, advanced past the string.
+ *    @param const char    *str     The string, may be NULL.
+ *
+ *    @return unsigned long    The offset of the string, 0 for NULL.
+ */
+static unsigned long wld_shm_push_string(unsigned char *pool, unsigned long *pos, const char *str) {
+    unsigned long off  = *pos;
+    unsigned long size = wld_shm_string_size(str);
+
+    if (size == 0)
+        return 0;
+
+    memcpy(pool + off, str, size);
+    *pos += size;
+
+    return off;
+}
+
+/*
+ *    Lays out the image of a world.
+ *
+ *    @param wld_t           *wld       The world to lay out.
+ *    @param wld_shm_image_t *image     Filled with the layout of the image.
+ *    @param char           **header    Set to the encoded header section.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int wld_shm_layout(wld_t *wld, wld_shm_image_t *image, char **header) {
+    unsigned int  header_len = 0;
+    unsigned long strings    = 1;
+
+    *header = wld_header_get_header(wld, &header_len);
+
+    if (*header == (char *)0x0) {
+        LOGF_ERR("Failed to encode world header.\n");
+        return 0;
+    }
+
+    memset(image, 0, sizeof(*image));
+    memcpy(image->sig, "wldimage", 8);
+
+    image->layout               = WLD_SHM_LAYOUT;
+    image->width                = wld->header.width;
+    image->height               = wld->header.height;
+    image->spawn_x              = wld->header.spawn_x;
+    image->spawn_y              = wld->header.spawn_y;
+    image->ground_level         = wld->header.ground_level;
+    image->rock_level           = wld->header.rock_level;
+    image->chest_count          = wld->chest_count;
+    image->sign_count           = wld->sign_count;
+    image->npc_count            = wld->npc_count;
+    image->tile_entity_count    = wld->tile_entity_count;
+    image->pressure_plate_count = wld->pressure_plate_count;
+    image->town_element_count   = wld->town_element_count;
+
+    int i;
+    for (i = 0; i < image->chest_count; ++i)
+        strings += wld_shm_string_size(wld->chests[i].name);
+
+    for (i = 0; i < image->sign_count; ++i)
+        strings += wld_shm_string_size(wld->signs[i].text);
+
+    for (i = 0; i < image->npc_count; ++i)
+        strings += wld_shm_string_size(wld->npcs[i].name);
+
+    image->header_pos          = WLD_SHM_ALIGN(sizeof(*image));
+    image->header_len          = header_len;
+    image->tiles_pos           = WLD_SHM_ALIGN(image->header_pos + image->header_len);
+    image->chests_pos          = WLD_SHM_ALIGN(image->tiles_pos + sizeof(tile_t) * image->width * image->height);
+    image->signs_pos           = WLD_SHM_ALIGN(image->chests_pos + sizeof(wld_shm_chest_t) * image->chest_count);
+    image->npcs_pos            = WLD_SHM_ALIGN(image->signs_pos + sizeof(wld_shm_sign_t) * image->sign_count);
+    image->tile_entities_pos   = WLD_SHM_ALIGN(image->npcs_pos + sizeof(wld_shm_npc_t) * image->npc_count);
+    image->pressure_plates_pos = WLD_SHM_ALIGN(image->tile_entities_pos + sizeof(tile_entity_t) * image->tile_entity_count);
+    image->town_elements_pos   = WLD_SHM_ALIGN(image->pressure_plates_pos + sizeof(pressure_plate_t) * image->pressure_plate_count);
+    image->strings_pos         = WLD_SHM_ALIGN(image->town_elements_pos + sizeof(town_element_t) * image->town_element_count);
+    image->strings_len         = strings;
+    image->len                 = image->strings_pos + image->strings_len;
+
+    return 1;
+}
+
+/*
+ *    Writes the image of a world into a mapped segment.
+ *
+ *    @param wld_t           *wld       The world to write.
+ *    @param wld_shm_image_t *layout    The layout of the image.
+ *    @param char            *header    The encoded header section.
+ *    @param unsigned char   *base      The mapped segment.
+ */
+static void wld_shm_fill(wld_t *wld, wld_shm_image_t *layout, char *header, unsigned char *base) {
+    unsigned char *pool   = base + layout->strings_pos;
+    unsigned long  pos    = 1;
+    unsigned long  column = sizeof(tile_t) * layout->height;
+
+    memcpy(base, layout, sizeof(*layout));
+    memcpy(base + layout->header_pos, header, layout->header_len);
+
+    /* Paletted columns are expanded straight into the segment.  */
+    int x;
+    for (x = 0; x < layout->width; ++x) {
+        tile_t       *dst = (tile_t *)(base + layout->tiles_pos + column * x);
+        const tile_t *src = tile_column_get(wld, x, dst);
+
+        if (src != dst)
+            memcpy(dst, src, column);
+    }
+
+    int i;
+    for (i = 0; i < layout->chest_count; ++i) {
+        wld_shm_chest_t *chest = (wld_shm_chest_t *)(base + layout->chests_pos) + i;
+
+        chest->x    = wld->chests[i].x;
+        chest->y    = wld->chests[i].y;
+        chest->name = wld_shm_push_string(pool, &pos, wld->chests[i].name);
+        /* Chests loaded with fewer than 40 slots have the rest cleared.  */
+        short count = wld->chests[i].items != (item_t *)0x0 ? wld->chest_item_count : 0;
+
+        memset(chest->items, 0, sizeof(chest->items));
+
+        if (count > 0)
+            memcpy(chest->items, wld->chests[i].items, sizeof(item_t) * (count < 40 ? count : 40));
+    }
+
+    for (i = 0; i < layout->sign_count; ++i) {
+        wld_shm_sign_t *sign = (wld_shm_sign_t *)(base + layout->signs_pos) + i;
+
+        sign->x    = wld->signs[i].x;
+        sign->y    = wld->signs[i].y;
+        sign->text = wld_shm_push_string(pool, &pos, wld->signs[i].text);
+    }
+
+    for (i = 0; i < layout->npc_count; ++i) {
+        wld_shm_npc_t *npc = (wld_shm_npc_t *)(base + layout->npcs_pos) + i;
+
+        npc->id        = wld->npcs[i].id;
+        npc->x         = wld->npcs[i].x;
+        npc->y         = wld->npcs[i].y;
+        npc->homeless  = wld->npcs[i].homeless;
+        npc->home_x    = wld->npcs[i].home_x;
+        npc->home_y    = wld->npcs[i].home_y;
+        npc->variation = wld->npcs[i].variation;
+        npc->name      = wld_shm_push_string(pool, &pos, wld->npcs[i].name);
+    }
+
+    if (layout->tile_entity_count > 0)
+        memcpy(base + layout->tile_entities_pos, wld->tile_entities, sizeof(tile_entity_t) * layout->tile_entity_count);
+
+    if (layout->pressure_plate_count > 0)
+        memcpy(base + layout->pressure_plates_pos, wld->pressure_plates, sizeof(pressure_plate_t) * layout->pressure_plate_count);
+
+    if (layout->town_element_count > 0)
+        memcpy(base + layout->town_elements_pos, wld->town_elements, sizeof(town_element_t) * layout->town_element_count);
+}
+
+/*
+ *    Opens a publisher, creating the control segment.
+ *
+ *    @param const char *name    The name of the image, without a leading slash.
+ *
+ *    @return wld_shm_publisher_t *    The publisher, NULL on failure.
+ */
+wld_shm_publisher_t *wld_shm_publisher_open(const char *name) {
+    wld_shm_publisher_t *pub = (wld_shm_publisher_t *)malloc(sizeof(wld_shm_publisher_t));
+
+    if (pub == (wld_shm_publisher_t *)0x0) {
+        LOGF_ERR("Failed to allocate memory for publisher.\n");
+        return (wld_shm_publisher_t *)0x0;
+    }
+
+    pub->name = strdup(name);
+    char *segment = wld_shm_segment(name, 0);
+
+    if (pub->name == (char *)0x0 || segment == (char *)0x0) {
+        LOGF_ERR("Failed to allocate memory for publisher.\n");
+        free(pub->name);
+        free(segment);
+        free(pub);
+        return (wld_shm_publisher_t *)0x0;
+    }
+
+    int fd = shm_open(segment, O_CREAT | O_RDWR, 0644);
+    free(segment);
+
+    if (fd < 0 || ftruncate(fd, sizeof(wld_shm_control_t)) != 0) {
+        VLOGF_ERR("Failed to create control segment for %s.\n", name);
+        if (fd >= 0)
+            close(fd);
+        free(pub->name);
+        free(pub);
+        return (wld_shm_publisher_t *)0x0;
+    }
+
+    pub->control = (wld_shm_control_t *)mmap((void *)0x0, sizeof(wld_shm_control_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (pub->control == MAP_FAILED) {
+        VLOGF_ERR("Failed to map control segment for %s.\n", name);
+        free(pub->name);
+        free(pub);
+        return (wld_shm_publisher_t *)0x0;
+    }
+
+    /* A restarted publisher carries on from the last version.  */
+    if (memcmp(pub->control->sig, "wldshm", 7) != 0 || pub->control->layout != WLD_SHM_LAYOUT) {
+        memcpy(pub->control->sig, "wldshm", 7);
+        pub->control->layout = WLD_SHM_LAYOUT;
+        __atomic_store_n(&pub->control->version, 0, __ATOMIC_RELEASE);
+    }
+
+    return pub;
+}
+
+/*
+ *    Publishes a new image of a world. Readers of older images keep their
+ *    mapping until they detach, but can see that they are stale.
+ *
+ *    @param wld_shm_publisher_t *pub    The publisher.
+ *    @param wld_t               *wld    The world to publish.
+ *
+ *    @return unsigned long    The version of the new image, 0 on failure.
+ */
+unsigned long wld_shm_publish(wld_shm_publisher_t *pub, wld_t *wld) {
+    if (pub == (wld_shm_publisher_t *)0x0 || wld == (wld_t *)0x0) {
+        LOGF_ERR("Publisher or world is NULL.\n");
+        return 0;
+    }
+
+    wld_shm_image_t layout;
+    char           *header;
+
+    if (!wld_shm_layout(wld, &layout, &header))
+        return 0;
+
+    layout.version = __atomic_load_n(&pub->control->version, __ATOMIC_ACQUIRE) + 1;
+
+    char *segment = wld_shm_segment(pub->name, layout.version);
+
+    if (segment == (char *)0x0)
+        return 0;
+
+    /* Left over from a publisher that died before bumping the version.  */
+    shm_unlink(segment);
+
+    int fd = shm_open(segment, O_CREAT | O_EXCL | O_RDWR, 0644);
+
+    if (fd < 0 || ftruncate(fd, layout.len) != 0) {
+        VLOGF_ERR("Failed to create image segment %s.\n", segment);
+        if (fd >= 0) {
+            close(fd);
+            shm_unlink(segment);
+        }
+        free(segment);
+        return 0;
+    }
+
+    unsigned char *base = (unsigned char *)mmap((void *)0x0, layout.len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (base == MAP_FAILED) {
+        VLOGF_ERR("Failed to map image segment %s.\n", segment);
+        shm_unlink(segment);
+        free(segment);
+        return 0;
+    }
+
+    wld_shm_fill(wld, &layout, header, base);
+    munmap(base, layout.len);
+    free(segment);
+
+    __atomic_store_n(&pub->control->version, layout.version, __ATOMIC_RELEASE);
+
+    if (layout.version > 1)
+        wld_shm_unlink(pub->name, layout.version - 1);
+
+    return layout.version;
+}
+
+/*
+ *    Closes a publisher and unlinks its segments.
+ *
+ *    @param wld_shm_publisher_t *pub    The publisher to close.
+ */
+void wld_shm_publisher_close(wld_shm_publisher_t *pub) {
+    if (pub == (wld_shm_publisher_t *)0x0) {
+        LOGF_WARN("Publisher is NULL.\n");
+        return;
+    }
+
+    unsigned long version = __atomic_load_n(&pub->control->version, __ATOMIC_ACQUIRE);
+
+    if (version > 0)
+        wld_shm_unlink(pub->name, version);
+
+    munmap(pub->control, sizeof(wld_shm_control_t));
+    wld_shm_unlink(pub->name, 0);
+
+    free(pub->name);
+    free(pub);
+}
+
+/*
+ *    Maps the latest image into a view.
+ *
+ *    @param wld_shm_view_t *view    The view, with its name and control segment set.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int wld_shm_map(wld_shm_view_t *view) {
+    int tries;
+    for (tries = 0; tries < 8; ++tries) {
+        unsigned long version = __atomic_load_n(&view->control->version, __ATOMIC_ACQUIRE);
+
+        if (version == 0) {
+            VLOGF_ERR("Nothing has been published to %s.\n", view->name);
+            return 0;
+        }
+
+        char *segment = wld_shm_segment(view->name, version);
+
+        if (segment == (char *)0x0)
+            return 0;
+
+        int fd = shm_open(segment, O_RDONLY, 0);
+        free(segment);
+
+        /* Unlinked by a newer publish between reading the version and opening it.  */
+        if (fd < 0)
+            continue;
+
+        struct stat st;
+
+        if (fstat(fd, &st) != 0 || (unsigned long)st.st_size < sizeof(wld_shm_image_t)) {
+            close(fd);
+            continue;
+        }
+
+        unsigned long    len   = st.st_size;
+        wld_shm_image_t *image = (wld_shm_image_t *)mmap((void *)0x0, len, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+
+        if (image == MAP_FAILED)
+            continue;
+
+        if (memcmp(image->sig, "wldimage", 8) != 0 || image->layout != WLD_SHM_LAYOUT ||
+            image->version != version || image->len > len) {
+            munmap(image, len);
+            continue;
+        }
+
+        tile_t **tiles = (tile_t **)malloc(sizeof(tile_t *) * image->width);
+
+        if (tiles == (tile_t **)0x0) {
+            LOGF_ERR("Failed to allocate memory for tiles.\n");
+            munmap(image, len);
+            return 0;
+        }
+
+        unsigned char *base   = (unsigned char *)image;
+        unsigned long  column = sizeof(tile_t) * image->height;
+
+        int x;
+        for (x = 0; x < image->width; ++x)
+            tiles[x] = (tile_t *)(base + image->tiles_pos + column * x);
+
+        view->image           = image;
+        view->image_len       = len;
+        view->tiles           = tiles;
+        view->chests          = (wld_shm_chest_t *)(base + image->chests_pos);
+        view->signs           = (wld_shm_sign_t *)(base + image->signs_pos);
+        view->npcs            = (wld_shm_npc_t *)(base + image->npcs_pos);
+        view->tile_entities   = (tile_entity_t *)(base + image->tile_entities_pos);
+        view->pressure_plates = (pressure_plate_t *)(base + image->pressure_plates_pos);
+        view->town_elements   = (town_element_t *)(base + image->town_elements_pos);
+
+        return 1;
+    }
+
+    VLOGF_ERR("Failed to map an image of %s.\n", view->name);
+
+    return 0;
+}
+
+/*
+ *    Attaches to the latest image of a world.
+ *
+ *    @param const char *name    The name of the image, without a leading slash.
+ *
+ *    @return wld_shm_view_t *    The view of the image, NULL on failure.
+ */
+wld_shm_view_t *wld_shm_attach(const char *name) {
+    wld_shm_view_t *view = (wld_shm_view_t *)calloc(1, sizeof(wld_shm_view_t));
+
+    if (view == (wld_shm_view_t *)0x0) {
+        LOGF_ERR("Failed to allocate memory for view.\n");
+        return (wld_shm_view_t *)0x0;
+    }
+
+    view->name    = strdup(name);
+    char *segment = wld_shm_segment(name, 0);
+
+    if (view->name == (char *)0x0 || segment == (char *)0x0) {
+        LOGF_ERR("Failed to allocate memory for view.\n");
+        free(view->name);
+        free(segment);
+        free(view);
+        return (wld_shm_view_t *)0x0;
+    }
+
+    int fd = shm_open(segment, O_RDONLY, 0);
+    free(segment);
+
+    if (fd < 0) {
+        VLOGF_ERR("No image named %s.\n", name);
+        free(view->name);
+        free(view);
+        return (wld_shm_view_t *)0x0;
+    }
+
+    view->control = (wld_shm_control_t *)mmap((void *)0x0, sizeof(wld_shm_control_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (view->control == MAP_FAILED) {
+        VLOGF_ERR("Failed to map control segment for %s.\n", name);
+        free(view->name);
+        free(view);
+        return (wld_shm_view_t *)0x0;
+    }
+
+    if (!wld_shm_map(view)) {
+        munmap(view->control, sizeof(wld_shm_control_t));
+        free(view->name);
+        free(view);
+        return (wld_shm_view_t *)0x0;
+    }
+
+    return view;
+}
+
+/*
+ *    Returns whether a newer image has been published since a view was attached.
+ *
+ *    @param wld_shm_view_t *view    The view to check.
+ *
+ *    @return unsigned int    1 if the view is stale, 0 otherwise.
+ */
+unsigned int wld_shm_is_stale(wld_shm_view_t *view) {
+    if (view == (wld_shm_view_t *)0x0) {
+        LOGF_ERR("View is NULL.\n");
+        return 0;
+    }
+
+    return __atomic_load_n(&view->control->version, __ATOMIC_ACQUIRE) != view->image->version;
+}
+
+/*
+ *    Moves a view to the latest image if it is stale.
+ *
+ *    @param wld_shm_view_t *view    The view to refresh.
+ *
+ *    @return unsigned int    1 on success, 0 on failure, in which case the view is left as it was.
+ */
+unsigned int wld_shm_refresh(wld_shm_view_t *view) {
+    if (!wld_shm_is_stale(view))
+        return view != (wld_shm_view_t *)0x0;
+
+    wld_shm_view_t old = *view;
+
+    if (!wld_shm_map(view))
+        return 0;
+
+    munmap(old.image, old.image_len);
+    free(old.tiles);
+
+    return 1;
+}
+
+/*
+ *    Returns a string from an image's string pool.
+ *
+ *    @param wld_shm_view_t *view    The view of the image.
+ *    @param unsigned long   off     The offset of the string.
+ *
+ *    @return const char *    The string, NULL if the record had none or it does not end inside the image.
+ */
+const char *wld_shm_string(wld_shm_view_t *view, unsigned long off) {
+    if (view == (wld_shm_view_t *)0x0 || off == 0)
+        return (const char *)0x0;
+
+    wld_shm_image_t *image = view->image;
+
+    /* The pool and the string in it have to end inside the segment.  */
+    if (image->strings_pos > view->image_len || image->strings_len > view->image_len - image->strings_pos ||
+        off >= image->strings_len)
+        return (const char *)0x0;
+
+    const char *str = (const char *)image + image->strings_pos + off;
+
+    if (memchr(str, '\0', image->strings_len - off) == (void *)0x0)
+        return (const char *)0x0;
+
+    return str;
+}
+
+/*
+ *    Detaches from an image.
+ *
+ *    @param wld_shm_view_t *view    The view to detach.
+ */
+void wld_shm_detach(wld_shm_view_t *view) {
+    if (view == (wld_shm_view_t *)0x0) {
+        LOGF_WARN("View is NULL.\n");
+        return;
+    }
+
+    munmap(view->image, view->image_len);
+    munmap(view->control, sizeof(wld_shm_control_t));
+
+    free(view->tiles);
+    free(view->name);
+    free(view);
+}
@@ -0,0 +1,181 @@
+/*
+ *    wldshm.h    --    Header file for shared memory world images
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Declares the publisher and reader sides of shared world images. A
+ *    publisher lays a decoded world out in a POSIX shared memory segment,
+ *    and any number of reader processes map it read-only, with nothing to
+ *    parse and no copy of the tiles of their own.
+ */
+#ifndef WLD_WLDSHM_H
+#define WLD_WLDSHM_H
+
+#include "wld.h"
+
+#define WLD_SHM_LAYOUT 1
+
+/*
+ *    The control segment, "/<name>", only holds the version of the
+ *    latest image. Image segments are named "/<name>.<version>".
+ */
+typedef struct {
+    char          sig[8];
+    int           layout;
+    unsigned long version;
+} wld_shm_control_t;
+
+/*
+ *    Records are flat copies of the world's records. Strings are offsets
+ *    into the image's string pool, read with wld_shm_string.
+ */
+typedef struct {
+    int           x;
+    int           y;
+    unsigned long name;
+    item_t        items[40];
+} wld_shm_chest_t;
+
+typedef struct {
+    int           x;
+    int           y;
+    unsigned long text;
+} wld_shm_sign_t;
+
+typedef struct {
+    int           id;
+    float         x;
+    float         y;
+    unsigned char homeless;
+    int           home_x;
+    int           home_y;
+    int           variation;
+    unsigned long name;
+} wld_shm_npc_t;
+
+/*
+ *    The head of an image segment. Every *_pos is a byte offset from the
+ *    start of the segment. The header section is kept in its on-disk
+ *    encoding, and tiles are stored column by column.
+ */
+typedef struct {
+    char          sig[8];
+    int           layout;
+    unsigned long version;
+    unsigned long len;
+    int           width;
+    int           height;
+    int           spawn_x;
+    int           spawn_y;
+    double        ground_level;
+    double        rock_level;
+    unsigned long header_pos;
+    unsigned long header_len;
+    unsigned long tiles_pos;
+    int           chest_count;
+    unsigned long chests_pos;
+    int           sign_count;
+    unsigned long signs_pos;
+    int           npc_count;
+    unsigned long npcs_pos;
+    int           tile_entity_count;
+    unsigned long tile_entities_pos;
+    int           pressure_plate_count;
+    unsigned long pressure_plates_pos;
+    int           town_element_count;
+    unsigned long town_elements_pos;
+    unsigned long strings_pos;
+    unsigned long strings_len;
+} wld_shm_image_t;
+
+typedef struct {
+    char              *name;
+    wld_shm_control_t *control;
+} wld_shm_publisher_t;
+
+typedef struct {
+    char               *name;
+    wld_shm_control_t  *control;
+    wld_shm_image_t    *image;
+    unsigned long       image_len;
+    tile_t            **tiles;
+    wld_shm_chest_t    *chests;
+    wld_shm_sign_t     *signs;
+    wld_shm_npc_t      *npcs;
+    tile_entity_t      *tile_entities;
+    pressure_plate_t   *pressure_plates;
+    town_element_t     *town_elements;
+} wld_shm_view_t;
+
+/*
+ *    Opens a publisher, creating the control segment.
+ *
+ *    @param const char *name    The name of the image, without a leading slash.
+ *
+ *    @return wld_shm_publisher_t *    The publisher, NULL on failure.
+ */
+wld_shm_publisher_t *wld_shm_publisher_open(const char *name);
+
+/*
+ *    Publishes a new image of a world. Readers of older images keep their
+ *    mapping until they detach, but can see that they are stale.
+ *
+ *    @param wld_shm_publisher_t *pub    The publisher.
+ *    @param wld_t               *wld    The world to publish.
+ *
+ *    @return unsigned long    The version of the new image, 0 on failure.
+ */
+unsigned long wld_shm_publish(wld_shm_publisher_t *pub, wld_t *wld);
+
+/*
+ *    Closes a publisher and unlinks its segments.
+ *
+ *    @param wld_shm_publisher_t *pub    The publisher to close.
+ */
+void wld_shm_publisher_close(wld_shm_publisher_t *pub);
+
+/*
+ *    Attaches to the latest image of a world.
+ *
+ *    @param const char *name    The name of the image, without a leading slash.
+ *
+ *    @return wld_shm_view_t *    The view of the image, NULL on failure.
+ */
+wld_shm_view_t *wld_shm_attach(const char *name);
+
+/*
+ *    Returns whether a newer image has been published since a view was attached.
+ *
+ *    @param wld_shm_view_t *view    The view to check.
+ *
+ *    @return unsigned int    1 if the view is stale, 0 otherwise.
+ */
+unsigned int wld_shm_is_stale(wld_shm_view_t *view);
+
+/*
+ *    Moves a view to the latest image if it is stale.
+ *
+ *    @param wld_shm_view_t *view    The view to refresh.
+ *
+ *    @return unsigned int    1 on success, 0 on failure, in which case the view is left as it was.
+ */
+unsigned int wld_shm_refresh(wld_shm_view_t *view);
+
+/*
+ *    Returns a string from an image's string pool.
+ *
+ *    @param wld_shm_view_t *view    The view of the image.
+ *    @param unsigned long   off     The offset of the string.
+ *
+ *    @return const char *    The string, NULL if the record had none or it does not end inside the image.
+ */
+const char *wld_shm_string(wld_shm_view_t *view, unsigned long off);
+
+/*
+ *    Detaches from an image.
+ *
+ *    @param wld_shm_view_t *view    The view to detach.
+ */
+void wld_shm_detach(wld_shm_view_t *view);
+
+#endif /* WLD_WLDSHM_H  */
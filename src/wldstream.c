@@ -0,0 +1,567 @@
+/*
+ *    wldstream.c    --    Source file for streaming world reads
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Defines the functions used to read a world file through a window.
+ *    The window is topped up from the file before every run or record,
+ *    so the usual parsers can read straight out of it, and sections are
+ *    only ever read forwards.
+ */
+#include "wldstream.h"
+
+#include "log.h"
+#include "parseutil.h"
+#include "tilefuncs.h"
+#include "wldheaderfuncs.h"
+
+#include <malloc.h>
+#include <string.h>
+
+/*
+ *    The most a tile run or a record can take, before any chest items.
+ */
+#define WLD_STREAM_RUN    32
+#define WLD_STREAM_RECORD 0x200
+
+#define WLD_STREAM_STOP  0
+#define WLD_STREAM_OK    1
+#define WLD_STREAM_ERROR -1
+
+/*
+ *    Makes sure the window holds at least some bytes past the position,
+ *    moving what is left to the front and reading more. Past the end of
+ *    the file, the window is padded with zeroes.
+ *
+ *    @param wld_stream_t  *stream    The stream.
+ *    @param unsigned long  need      The number of bytes needed, at most the window size.
+ *
+ *    @return unsigned int    1 if any bytes are left, 0 at the end of the file.
+ */
+static unsigned int wld_stream_fill(wld_stream_t *stream, unsigned long need) {
+    /* Reading past the end used up the padding, so the file was cut short.  */
+    if (stream->pos > stream->len)
+        return 0;
+
+    if (stream->len - stream->pos >= need)
+        return 1;
+
+    memmove(stream->buf, stream->buf + stream->pos, stream->len - stream->pos);
+
+    stream->offset += stream->pos;
+    stream->len    -= stream->pos;
+    stream->pos     = 0;
+    stream->len    += compress_read(&stream->in, stream->buf + stream->len, stream->cap - stream->len);
+
+    if (stream->len < need)
+        memset(stream->buf + stream->len, 0, need - stream->len);
+
+    return stream->len > 0;
+}
+
+/*
+ *    Reads a string out of the window into a buffer.
+ *
+ *    @param wld_stream_t *stream    The stream, filled with at least 256 bytes.
+ *    @param char         *out       The buffer, at least 256 bytes long.
+ *
+ *    @return char *    The string, NULL if it is empty, like parse_string.
+ */
+static char *wld_stream_string(wld_stream_t *stream, char *out) {
+    unsigned char len = 0;
+
+    PARSE(stream->buf, stream->pos, unsigned char, len);
+
+    if (len == 0)
+        return (char *)0x0;
+
+    memcpy(out, stream->buf + stream->pos, len);
+    out[len]     = '\0';
+    stream->pos += len;
+
+    return out;
+}
+
+/*
+ *    Returns the offset in the file the stream is at.
+ *
+ *    @param const wld_stream_t *stream    The stream.
+ *
+ *    @return unsigned long    The offset.
+ */
+unsigned long wld_stream_tell(const wld_stream_t *stream) {
+    return stream->offset + stream->pos;
+}
+
+/*
+ *    Moves a stream forward to an offset in the file.
+ *
+ *    @param wld_stream_t  *stream    The stream.
+ *    @param unsigned long  offset    The offset, not before the current one.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int wld_stream_skip(wld_stream_t *stream, unsigned long offset) {
+    if (offset < wld_stream_tell(stream)) {
+        VLOGF_ERR("Cannot stream backwards to %lu.\n", offset);
+        return 0;
+    }
+
+    if (offset <= stream->offset + stream->len) {
+        stream->pos = offset - stream->offset;
+        return 1;
+    }
+
+    if (!compress_skip(&stream->in, offset - stream->offset - stream->len)) {
+        VLOGF_ERR("Failed to seek to %lu.\n", offset);
+        return 0;
+    }
+
+    stream->offset = offset;
+    stream->len    = 0;
+    stream->pos    = 0;
+
+    return 1;
+}
+
+/*
+ *    Copies the rest of a stream's file to another file.
+ *
+ *    @param wld_stream_t *stream    The stream.
+ *    @param FILE         *fp        The file to copy to.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int wld_stream_copy(wld_stream_t *stream, FILE *fp) {
+    while (stream->len > stream->pos || wld_stream_fill(stream, 1)) {
+        unsigned long len = stream->len - stream->pos;
+
+        if (fwrite(stream->buf + stream->pos, 1, len, fp) != len) {
+            LOGF_ERR("Failed to copy stream.\n");
+            return 0;
+        }
+
+        stream->pos += len;
+    }
+
+    return 1;
+}
+
+/*
+ *    Opens a world file for streaming and parses its headers. Files
+ *    compressed with gzip or zstd are decompressed as they are read.
+ *
+ *    @param const char    *path      The world file.
+ *    @param unsigned long  window    The size of the window, 0 for WLD_STREAM_WINDOW.
+ *
+ *    @return wld_stream_t *    The stream, NULL on failure.
+ */
+wld_stream_t *wld_stream_open(const char *path, unsigned long window) {
+    if (window == 0)
+        window = WLD_STREAM_WINDOW;
+    if (window < WLD_STREAM_MIN_WINDOW)
+        window = WLD_STREAM_MIN_WINDOW;
+
+    wld_stream_t *stream = (wld_stream_t *)calloc(1, sizeof(wld_stream_t));
+
+    if (stream == (wld_stream_t *)0x0) {
+        LOGF_ERR("Failed to allocate memory for stream.\n");
+        return (wld_stream_t *)0x0;
+    }
+
+    stream->cap = window;
+    stream->buf = (unsigned char *)malloc(window);
+
+    if (stream->buf == (unsigned char *)0x0 || !compress_open(&stream->in, path)) {
+        VLOGF_ERR("Failed to open %s for streaming.\n", path);
+        wld_stream_close(stream);
+        return (wld_stream_t *)0x0;
+    }
+
+    wld_stream_fill(stream, window);
+
+    /* The offsets start after the fixed part of the info header.  */
+    short         numsections = 0;
+    unsigned int  tiles       = 0;
+    unsigned long at          = 24;
+
+    if (stream->len >= 34) {
+        PARSE(stream->buf, at, short, numsections);
+        at += sizeof(int);
+        PARSE(stream->buf, at, unsigned int, tiles);
+    }
+
+    if (numsections < 2 || tiles == 0 || tiles > stream->len) {
+        VLOGF_ERR("%s has no headers that fit in a %lu byte window.\n", path, window);
+        wld_stream_close(stream);
+        return (wld_stream_t *)0x0;
+    }
+
+    /* The header parsers read from a file stream, which can borrow the window.  */
+    filestream_t file;
+
+    file.buf = stream->buf;
+    file.len = stream->len;
+    file.pos = 0;
+
+    stream->wld.file = &file;
+
+    unsigned int ret = wld_decude_parsing_type(&stream->wld);
+
+    stream->wld.file = (filestream_t *)0x0;
+
+    if (ret == 0 || stream->wld.header.width <= 0 || stream->wld.header.height <= 0) {
+        VLOGF_ERR("Failed to parse the headers of %s.\n", path);
+        wld_stream_close(stream);
+        return (wld_stream_t *)0x0;
+    }
+
+    stream->pos = tiles;
+
+    return stream;
+}
+
+/*
+ *    Streams the tile section, one run at a time.
+ *
+ *    @param wld_stream_t                 *stream    The stream, at the tile section.
+ *    @param const wld_stream_callbacks_t *cb        The callbacks.
+ *    @param void                         *ctx       Passed to the callbacks.
+ *
+ *    @return int    WLD_STREAM_OK, WLD_STREAM_STOP or WLD_STREAM_ERROR.
+ */
+static int wld_stream_tiles(wld_stream_t *stream, const wld_stream_callbacks_t *cb, void *ctx) {
+    wld_t  *wld    = &stream->wld;
+    tile_t *column = (tile_t *)0x0;
+
+    if (cb->column != 0x0) {
+        column = (tile_t *)malloc(sizeof(tile_t) * wld->header.height);
+
+        if (column == (tile_t *)0x0) {
+            LOGF_ERR("Failed to allocate memory for column.\n");
+            return WLD_STREAM_ERROR;
+        }
+    }
+
+    int ret = WLD_STREAM_OK;
+    int x;
+    int y;
+    for (x = 0; x < wld->header.width && ret == WLD_STREAM_OK; ++x) {
+        for (y = 0; y < wld->header.height;) {
+            if (!wld_stream_fill(stream, WLD_STREAM_RUN)) {
+                VLOGF_ERR("Tile section ends early, in column %d.\n", x);
+                ret = WLD_STREAM_ERROR;
+                break;
+            }
+
+            tile_t       t;
+            unsigned int count = tile_parse_run(wld, stream->buf, &stream->pos, &t);
+
+            if (count > (unsigned int)(wld->header.height - y))
+                count = wld->header.height - y;
+
+            if (cb->run != 0x0 && !cb->run(ctx, x, y, &t, count)) {
+                ret = WLD_STREAM_STOP;
+                break;
+            }
+
+            unsigned int i;
+            for (i = 0; column != (tile_t *)0x0 && i < count; ++i)
+                column[y + i] = t;
+
+            y += count;
+        }
+
+        if (ret == WLD_STREAM_OK && column != (tile_t *)0x0 && !cb->column(ctx, x, column, wld->header.height))
+            ret = WLD_STREAM_STOP;
+    }
+
+    free(column);
+
+    if (ret == WLD_STREAM_OK && wld_stream_tell(stream) != (unsigned long)wld->info.sections[2])
+        VLOGF_WARN("tile section is not the expected length, diff = %ld\n", (long)wld->info.sections[2] - (long)wld_stream_tell(stream));
+
+    return ret;
+}
+
+/*
+ *    Streams the chests.
+ *
+ *    @param wld_stream_t                 *stream    The stream, at the chest section.
+ *    @param const wld_stream_callbacks_t *cb        The callbacks.
+ *    @param void                         *ctx       Passed to the callbacks.
+ *
+ *    @return int    WLD_STREAM_OK, WLD_STREAM_STOP or WLD_STREAM_ERROR.
+ */
+static int wld_stream_chests(wld_stream_t *stream, const wld_stream_callbacks_t *cb, void *ctx) {
+    item_t  items[40];
+    char    name[256];
+    chest_t chest;
+    short   chest_count = 0;
+    short   item_count  = 0;
+
+    wld_stream_fill(stream, WLD_STREAM_RECORD);
+    PARSE(stream->buf, stream->pos, short, chest_count);
+    PARSE(stream->buf, stream->pos, short, item_count);
+
+    chest.items = items;
+
+    short i;
+    short j;
+    for (i = 0; i < chest_count; ++i) {
+        if (!wld_stream_fill(stream, WLD_STREAM_RECORD))
+            return WLD_STREAM_ERROR;
+
+        PARSE(stream->buf, stream->pos, int, chest.x);
+        PARSE(stream->buf, stream->pos, int, chest.y);
+        chest.name = wld_stream_string(stream, name);
+
+        for (j = 0; j < item_count && j < 40; ++j) {
+            short stack = 0;
+
+            wld_stream_fill(stream, 7);
+            PARSE(stream->buf, stream->pos, short, stack);
+
+            items[j].stack  = stack;
+            items[j].id     = 0;
+            items[j].prefix = 0;
+
+            if (stack == 0)
+                continue;
+
+            PARSE(stream->buf, stream->pos, int, items[j].id);
+            PARSE(stream->buf, stream->pos, unsigned char, items[j].prefix);
+        }
+
+        /* Like get_chests, items past the 40th are assumed to be full.  */
+        for (j = 0; j < item_count - 40; ++j) {
+            wld_stream_fill(stream, 7);
+            stream->pos += 7;
+        }
+
+        if (cb->chest != 0x0 && !cb->chest(ctx, &chest, item_count < 40 ? item_count : 40))
+            return WLD_STREAM_STOP;
+    }
+
+    if (wld_stream_tell(stream) != (unsigned long)stream->wld.info.sections[3])
+        LOGF_WARN("Chest section size mismatch.\n");
+
+    return WLD_STREAM_OK;
+}
+
+/*
+ *    Streams the signs.
+ *
+ *    @param wld_stream_t                 *stream    The stream, at the sign section.
+ *    @param const wld_stream_callbacks_t *cb        The callbacks.
+ *    @param void                         *ctx       Passed to the callbacks.
+ *
+ *    @return int    WLD_STREAM_OK, WLD_STREAM_STOP or WLD_STREAM_ERROR.
+ */
+static int wld_stream_signs(wld_stream_t *stream, const wld_stream_callbacks_t *cb, void *ctx) {
+    char   text[256];
+    sign_t sign;
+    short  sign_count = 0;
+
+    wld_stream_fill(stream, WLD_STREAM_RECORD);
+    PARSE(stream->buf, stream->pos, short, sign_count);
+
+    short i;
+    for (i = 0; i < sign_count; ++i) {
+        if (!wld_stream_fill(stream, WLD_STREAM_RECORD))
+            return WLD_STREAM_ERROR;
+
+        sign.text = wld_stream_string(stream, text);
+        PARSE(stream->buf, stream->pos, int, sign.x);
+        PARSE(stream->buf, stream->pos, int, sign.y);
+
+        if (cb->sign != 0x0 && !cb->sign(ctx, &sign))
+            return WLD_STREAM_STOP;
+    }
+
+    if (wld_stream_tell(stream) != (unsigned long)stream->wld.info.sections[4])
+        LOGF_WARN("Sign section size mismatch.\n");
+
+    return WLD_STREAM_OK;
+}
+
+/*
+ *    Streams the NPCs and pets.
+ *
+ *    @param wld_stream_t                 *stream    The stream, at the NPC section.
+ *    @param const wld_stream_callbacks_t *cb        The callbacks.
+ *    @param void                         *ctx       Passed to the callbacks.
+ *
+ *    @return int    WLD_STREAM_OK, WLD_STREAM_STOP or WLD_STREAM_ERROR.
+ */
+static int wld_stream_npcs(wld_stream_t *stream, const wld_stream_callbacks_t *cb, void *ctx) {
+    unsigned int  ver = stream->wld.ver;
+    char          name[256];
+    npc_t         npc;
+    unsigned char cont = 0;
+
+    if (ver < 190) {
+        LOGF_ERR("Unsupported version.\n");
+        return WLD_STREAM_ERROR;
+    }
+
+    wld_stream_fill(stream, WLD_STREAM_RECORD);
+
+    if (ver >= 268) {
+        int shimmer_count = 0;
+        PARSE(stream->buf, stream->pos, int, shimmer_count);
+
+        int i;
+        for (i = 0; i < shimmer_count; ++i) {
+            wld_stream_fill(stream, sizeof(int));
+            stream->pos += sizeof(int);
+        }
+    }
+
+    unsigned char pet;
+    for (pet = 0; pet < 2; ++pet) {
+        wld_stream_fill(stream, 1);
+        PARSE(stream->buf, stream->pos, unsigned char, cont);
+
+        while (cont) {
+            if (!wld_stream_fill(stream, WLD_STREAM_RECORD))
+                return WLD_STREAM_ERROR;
+
+            memset(&npc, 0, sizeof(npc));
+            PARSE(stream->buf, stream->pos, int, npc.id);
+
+            if (!pet) {
+                npc.name = wld_stream_string(stream, name);
+                PARSE(stream->buf, stream->pos, float, npc.x);
+                PARSE(stream->buf, stream->pos, float, npc.y);
+                PARSE(stream->buf, stream->pos, unsigned char, npc.homeless);
+                PARSE(stream->buf, stream->pos, int, npc.home_x);
+                PARSE(stream->buf, stream->pos, int, npc.home_y);
+
+                unsigned char variant;
+                PARSE(stream->buf, stream->pos, unsigned char, variant);
+
+                if (ver >= 213 && (variant & (1 << 0))) {
+                    PARSE(stream->buf, stream->pos, int, npc.variation);
+                }
+            } else {
+                PARSE(stream->buf, stream->pos, float, npc.x);
+                PARSE(stream->buf, stream->pos, float, npc.y);
+            }
+
+            if (cb->npc != 0x0 && !cb->npc(ctx, &npc, pet))
+                return WLD_STREAM_STOP;
+
+            PARSE(stream->buf, stream->pos, unsigned char, cont);
+        }
+    }
+
+    if (wld_stream_tell(stream) != (unsigned long)stream->wld.info.sections[5])
+        LOGF_WARN("NPC section size mismatch.\n");
+
+    return WLD_STREAM_OK;
+}
+
+/*
+ *    Reads the rest of a world through callbacks, from the tile section
+ *    to the NPCs.
+ *
+ *    @param wld_stream_t                 *stream    The stream.
+ *    @param const wld_stream_callbacks_t *cb        The callbacks.
+ *    @param void                         *ctx       Passed to the callbacks.
+ *
+ *    @return unsigned int    1 on success or when a callback stopped the read, 0 on failure.
+ */
+unsigned int wld_stream_read(wld_stream_t *stream, const wld_stream_callbacks_t *cb, void *ctx) {
+    wld_t *wld = &stream->wld;
+    int    ret = WLD_STREAM_OK;
+
+    if (wld->info.numsections < 6) {
+        VLOGF_ERR("World has too few sections to stream (%d).\n", wld->info.numsections);
+        return 0;
+    }
+
+    if (cb->info != 0x0 && !cb->info(ctx, &wld->info))
+        return 1;
+
+    if (cb->header != 0x0 && !cb->header(ctx, &wld->header, wld->ver))
+        return 1;
+
+    if (cb->run != 0x0 || cb->column != 0x0) {
+        if (!wld_stream_skip(stream, wld->info.sections[1]))
+            return 0;
+
+        ret = wld_stream_tiles(stream, cb, ctx);
+    }
+
+    if (ret == WLD_STREAM_OK && cb->chest != 0x0) {
+        if (!wld_stream_skip(stream, wld->info.sections[2]))
+            return 0;
+
+        ret = wld_stream_chests(stream, cb, ctx);
+    }
+
+    if (ret == WLD_STREAM_OK && cb->sign != 0x0) {
+        if (!wld_stream_skip(stream, wld->info.sections[3]))
+            return 0;
+
+        ret = wld_stream_signs(stream, cb, ctx);
+    }
+
+    if (ret == WLD_STREAM_OK && cb->npc != 0x0) {
+        if (!wld_stream_skip(stream, wld->info.sections[4]))
+            return 0;
+
+        ret = wld_stream_npcs(stream, cb, ctx);
+    }
+
+    /* A file cut short is padded with zeroes, so what was read from it cannot be trusted.  */
+    if (stream->in.failed) {
+        LOGF_ERR("World file is truncated or corrupt.\n");
+        return 0;
+    }
+
+    return ret != WLD_STREAM_ERROR;
+}
+
+/*
+ *    Closes a stream.
+ *
+ *    @param wld_stream_t *stream    The stream.
+ */
+void wld_stream_close(wld_stream_t *stream) {
+    if (stream == (wld_stream_t *)0x0)
+        return;
+
+    if (stream->in.fp != (FILE *)0x0)
+        compress_close(&stream->in);
+
+    wld_info_header_free(stream->wld.info);
+    wld_header_free(stream->wld.header);
+
+    free(stream->buf);
+    free(stream);
+}
+
+/*
+ *    Reads a world file through callbacks in one call.
+ *
+ *    @param const char                   *path      The world file.
+ *    @param const wld_stream_callbacks_t *cb        The callbacks.
+ *    @param void                         *ctx       Passed to the callbacks.
+ *    @param unsigned long                 window    The size of the window, 0 for WLD_STREAM_WINDOW.
+ *
+ *    @return unsigned int    1 on success or when a callback stopped the read, 0 on failure.
+ */
+unsigned int wld_stream(const char *path, const wld_stream_callbacks_t *cb, void *ctx, unsigned long window) {
+    wld_stream_t *stream = wld_stream_open(path, window);
+
+    if (stream == (wld_stream_t *)0x0)
+        return 0;
+
+    unsigned int ret = wld_stream_read(stream, cb, ctx);
+
+    wld_stream_close(stream);
+
+    return ret;
+}
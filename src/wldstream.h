@@ -0,0 +1,135 @@
+/*
+ *    wldstream.h    --    Header file for streaming world reads
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Declares the functions used to read a world file front to back
+ *    through a fixed size window, handing what is decoded to callbacks
+ *    instead of building a world's arrays. Only the window and, when
+ *    columns are asked for, one column are held, so huge worlds can be
+ *    read with little memory.
+ */
+#ifndef WLD_WLDSTREAM_H
+#define WLD_WLDSTREAM_H
+
+#include <stdio.h>
+
+#include "compress.h"
+#include "wld.h"
+
+/*
+ *    The default size of the window, and the smallest one allowed. The
+ *    info header and header must fit in the window.
+ */
+#define WLD_STREAM_WINDOW     0x100000
+#define WLD_STREAM_MIN_WINDOW 0x10000
+
+/*
+ *    Called with what has been decoded. Any callback may be NULL, and
+ *    sections nobody asks for are skipped without decoding. Returning 0
+ *    stops the read.
+ *
+ *    info      The info header, with the section offsets.
+ *    header    The header. Strings and arrays are only valid during the call.
+ *    run       A run of count identical tiles in column x, from row y.
+ *    column    A whole column, valid only during the call.
+ *    chest     A chest. The name and items are only valid during the call.
+ *    sign      A sign. The text is only valid during the call.
+ *    npc       An NPC, or a pet when pet is set. Pets have no name or home.
+ */
+typedef struct {
+    unsigned int (*info)(void *ctx, const wld_info_header_t *info);
+    unsigned int (*header)(void *ctx, const wld_header_t *header, unsigned int ver);
+    unsigned int (*run)(void *ctx, int x, int y, const tile_t *tile, unsigned int count);
+    unsigned int (*column)(void *ctx, int x, const tile_t *tiles, int height);
+    unsigned int (*chest)(void *ctx, const chest_t *chest, short item_count);
+    unsigned int (*sign)(void *ctx, const sign_t *sign);
+    unsigned int (*npc)(void *ctx, const npc_t *npc, unsigned char pet);
+} wld_stream_callbacks_t;
+
+/*
+ *    A world file being read through a window. The info header and header
+ *    are parsed on open and kept in wld, whose other fields are unused.
+ */
+typedef struct {
+    compress_reader_t  in;
+    unsigned char     *buf;
+    unsigned long      cap;
+    unsigned long      len;
+    unsigned long      pos;
+    unsigned long      offset;
+    wld_t              wld;
+} wld_stream_t;
+
+/*
+ *    Opens a world file for streaming and parses its headers. Files
+ *    compressed with gzip or zstd are decompressed as they are read.
+ *
+ *    @param const char    *path      The world file.
+ *    @param unsigned long  window    The size of the window, 0 for WLD_STREAM_WINDOW.
+ *
+ *    @return wld_stream_t *    The stream, NULL on failure.
+ */
+wld_stream_t *wld_stream_open(const char *path, unsigned long window);
+
+/*
+ *    Returns the offset in the file the stream is at.
+ *
+ *    @param const wld_stream_t *stream    The stream.
+ *
+ *    @return unsigned long    The offset.
+ */
+unsigned long wld_stream_tell(const wld_stream_t *stream);
+
+/*
+ *    Moves a stream forward to an offset in the file.
+ *
+ *    @param wld_stream_t  *stream    The stream.
+ *    @param unsigned long  offset    The offset, not before the current one.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int wld_stream_skip(wld_stream_t *stream, unsigned long offset);
+
+/*
+ *    Copies the rest of a stream's file to another file.
+ *
+ *    @param wld_stream_t *stream    The stream.
+ *    @param FILE         *fp        The file to copy to.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int wld_stream_copy(wld_stream_t *stream, FILE *fp);
+
+/*
+ *    Reads the rest of a world through callbacks, from the tile section
+ *    to the NPCs.
+ *
+ *    @param wld_stream_t                 *stream    The stream.
+ *    @param const wld_stream_callbacks_t *cb        The callbacks.
+ *    @param void                         *ctx       Passed to the callbacks.
+ *
+ *    @return unsigned int    1 on success or when a callback stopped the read, 0 on failure.
+ */
+unsigned int wld_stream_read(wld_stream_t *stream, const wld_stream_callbacks_t *cb, void *ctx);
+
+/*
+ *    Closes a stream.
+ *
+ *    @param wld_stream_t *stream    The stream.
+ */
+void wld_stream_close(wld_stream_t *stream);
+
+/*
+ *    Reads a world file through callbacks in one call.
+ *
+ *    @param const char                   *path      The world file.
+ *    @param const wld_stream_callbacks_t *cb        The callbacks.
+ *    @param void                         *ctx       Passed to the callbacks.
+ *    @param unsigned long                 window    The size of the window, 0 for WLD_STREAM_WINDOW.
+ *
+ *    @return unsigned int    1 on success or when a callback stopped the read, 0 on failure.
+ */
+unsigned int wld_stream(const char *path, const wld_stream_callbacks_t *cb, void *ctx, unsigned long window);
+
+#endif /* WLD_WLDSTREAM_H  */
@@ -0,0 +1,368 @@
+/*
+ *    wldtranscode.c    --    Source file for streaming world transcodes
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Defines world transcodes as three threads passing columns around a
+ *    ring of slots: one reads columns through a stream, one transforms
+ *    and encodes them, and the calling thread writes them out. A slot is
+ *    only reused once its column has been written.
+ */
+#include "wldtranscode.h"
+
+#include "log.h"
+#include "tilefuncs.h"
+#include "wldsave.h"
+#include "wldstream.h"
+
+#include <malloc.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct {
+    tile_t       *tiles;
+    char         *enc;
+    unsigned int  len;
+} wld_transcode_slot_t;
+
+typedef struct {
+    wld_stream_t         *stream;
+    wld_transcode_fn_t    fn;
+    void                 *ctx;
+    wld_transcode_slot_t  slots[WLD_TRANSCODE_SLOTS];
+    pthread_mutex_t       lock;
+    pthread_cond_t        cond;
+    int                   read;
+    int                   coded;
+    int                   written;
+    unsigned int          failed;
+} wld_transcode_t;
+
+/*
+ *    Waits until a counter of the transcode passes a column, or the
+ *    transcode fails. The lock must be held.
+ *
+ *    @param wld_transcode_t *job        The transcode.
+ *    @param int             *counter    The counter.
+ *    @param int              x          The column.
+ *
+ *    @return unsigned int    1 once the counter is past the column, 0 if the transcode failed.
+ */
+static unsigned int wld_transcode_wait(wld_transcode_t *job, int *counter, int x) {
+    while (*counter <= x && !job->failed)
+        pthread_cond_wait(&job->cond, &job->lock);
+
+    return !job->failed;
+}
+
+/*
+ *    Moves a counter of the transcode on to the next column and wakes
+ *    the other threads.
+ *
+ *    @param wld_transcode_t *job        The transcode.
+ *    @param int             *counter    The counter.
+ *    @param unsigned int     ok         0 to fail the transcode instead.
+ */
+static void wld_transcode_post(wld_transcode_t *job, int *counter, unsigned int ok) {
+    pthread_mutex_lock(&job->lock);
+
+    if (ok)
+        ++*counter;
+    else
+        job->failed = 1;
+
+    pthread_cond_broadcast(&job->cond);
+    pthread_mutex_unlock(&job->lock);
+}
+
+/*
+ *    Copies a decoded column into its slot once the slot is free.
+ *
+ *    @param void         *ctx       The transcode.
+ *    @param int           x         The column.
+ *    @param const tile_t *tiles     The column's tiles.
+ *    @param int           height    The height of the column.
+ *
+ *    @return unsigned int    1 to keep reading, 0 if the transcode failed.
+ */
+static unsigned int wld_transcode_column(void *ctx, int x, const tile_t *tiles, int height) {
+    wld_transcode_t *job = (wld_transcode_t *)ctx;
+
+    pthread_mutex_lock(&job->lock);
+    unsigned int ok = wld_transcode_wait(job, &job->written, x - WLD_TRANSCODE_SLOTS);
+    pthread_mutex_unlock(&job->lock);
+
+    if (!ok)
+        return 0;
+
+    memcpy(job->slots[x % WLD_TRANSCODE_SLOTS].tiles, tiles, sizeof(tile_t) * height);
+    wld_transcode_post(job, &job->read, 1);
+
+    return 1;
+}
+
+/*
+ *    Reads the tile section on its own thread.
+ *
+ *    @param void *arg    The transcode.
+ *
+ *    @return void *    NULL.
+ */
+static void *wld_transcode_reader(void *arg) {
+    wld_transcode_t        *job = (wld_transcode_t *)arg;
+    wld_stream_callbacks_t  cb;
+
+    memset(&cb, 0, sizeof(cb));
+    cb.column = wld_transcode_column;
+
+    unsigned int ok = wld_stream_read(job->stream, &cb, job);
+
+    pthread_mutex_lock(&job->lock);
+
+    if (!ok || job->read < job->stream->wld.header.width)
+        job->failed = 1;
+
+    pthread_cond_broadcast(&job->cond);
+    pthread_mutex_unlock(&job->lock);
+
+    return (void *)0x0;
+}
+
+/*
+ *    Transforms and encodes columns on their own thread.
+ *
+ *    @param void *arg    The transcode.
+ *
+ *    @return void *    NULL.
+ */
+static void *wld_transcode_coder(void *arg) {
+    wld_transcode_t *job = (wld_transcode_t *)arg;
+    wld_t           *wld = &job->stream->wld;
+
+    int x;
+    for (x = 0; x < wld->header.width; ++x) {
+        pthread_mutex_lock(&job->lock);
+        unsigned int ok = wld_transcode_wait(job, &job->read, x);
+        pthread_mutex_unlock(&job->lock);
+
+        if (!ok)
+            break;
+
+        wld_transcode_slot_t *slot = &job->slots[x % WLD_TRANSCODE_SLOTS];
+
+        ok = job->fn(job->ctx, x, slot->tiles, wld->header.height);
+
+        if (ok) {
+            slot->len = tile_encode_column(wld, slot->tiles, slot->enc);
+            ok        = slot->len > 0;
+        }
+
+        wld_transcode_post(job, &job->coded, ok);
+
+        if (!ok)
+            break;
+    }
+
+    return (void *)0x0;
+}
+
+/*
+ *    Writes the encoded columns as they are ready, on the calling thread.
+ *
+ *    @param wld_transcode_t *job    The transcode.
+ *    @param FILE            *fp     The output.
+ *
+ *    @return unsigned long    The length of the tile section, 0 on failure.
+ */
+static unsigned long wld_transcode_write(wld_transcode_t *job, FILE *fp) {
+    unsigned long len = 0;
+
+    int x;
+    for (x = 0; x < job->stream->wld.header.width; ++x) {
+        pthread_mutex_lock(&job->lock);
+        unsigned int ok = wld_transcode_wait(job, &job->coded, x);
+        pthread_mutex_unlock(&job->lock);
+
+        if (!ok)
+            return 0;
+
+        wld_transcode_slot_t *slot = &job->slots[x % WLD_TRANSCODE_SLOTS];
+
+        ok   = fwrite(slot->enc, 1, slot->len, fp) == slot->len;
+        len += slot->len;
+
+        wld_transcode_post(job, &job->written, ok);
+
+        if (!ok) {
+            LOGF_ERR("Failed to write column.\n");
+            return 0;
+        }
+    }
+
+    return len;
+}
+
+/*
+ *    Rewrites the tile section of an opened stream to a file, then copies
+ *    the rest and fixes up the section offsets.
+ *
+ *    @param wld_transcode_t *job    The transcode, with its stream open.
+ *    @param FILE            *fp     The output.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int wld_transcode_run(wld_transcode_t *job, FILE *fp) {
+    wld_t *wld   = &job->stream->wld;
+    long   tiles = wld->info.sections[1];
+
+    /* The stream still holds the headers, which are copied as they are.  */
+    if (fwrite(job->stream->buf, 1, tiles, fp) != (unsigned long)tiles)
+        return 0;
+
+    pthread_t reader;
+    pthread_t coder;
+
+    if (pthread_create(&reader, (pthread_attr_t *)0x0, wld_transcode_reader, job) != 0) {
+        LOGF_ERR("Failed to start transcode reader.\n");
+        return 0;
+    }
+
+    if (pthread_create(&coder, (pthread_attr_t *)0x0, wld_transcode_coder, job) != 0) {
+        LOGF_ERR("Failed to start transcode coder.\n");
+        wld_transcode_post(job, &job->read, 0);
+        pthread_join(reader, (void **)0x0);
+        return 0;
+    }
+
+    unsigned long len = wld_transcode_write(job, fp);
+
+    if (len == 0)
+        wld_transcode_post(job, &job->written, 0);
+
+    pthread_join(reader, (void **)0x0);
+    pthread_join(coder, (void **)0x0);
+
+    if (len == 0 || job->failed)
+        return 0;
+
+    if (!wld_stream_skip(job->stream, wld->info.sections[2]) || !wld_stream_copy(job->stream, fp))
+        return 0;
+
+    /* Every section after the tiles moves by however much they changed.  */
+    long  delta = (long)len - (wld->info.sections[2] - tiles);
+    short i;
+    for (i = 2; i < wld->info.numsections; ++i) {
+        if (wld->info.sections[i] + delta > 0xFFFFFFFF) {
+            LOGF_ERR("Transcoded world is too large.\n");
+            return 0;
+        }
+
+        wld->info.sections[i] += delta;
+    }
+
+    if (fseek(fp, 26 + 2 * sizeof(int), SEEK_SET) != 0)
+        return 0;
+
+    /* Offsets are 32 bits on disk.  */
+    for (i = 2; i < wld->info.numsections; ++i) {
+        unsigned int offset = wld->info.sections[i];
+
+        if (fwrite(&offset, sizeof(offset), 1, fp) != 1)
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ *    Rewrites the tiles of a world file through a transform. Everything
+ *    but the tile section is copied as is, and the section offsets are
+ *    fixed up at the end. The output is committed like a save, through
+ *    wld_save_begin and wld_save_finish, so it may be the input.
+ *
+ *    @param const char         *in     The world file to read.
+ *    @param const char         *out    The world file to write.
+ *    @param wld_transcode_fn_t  fn     The transform.
+ *    @param void               *ctx    Passed to the transform.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int wld_transcode(const char *in, const char *out, wld_transcode_fn_t fn, void *ctx) {
+    if (in == (const char *)0x0 || out == (const char *)0x0 || fn == (wld_transcode_fn_t)0x0) {
+        LOGF_ERR("Path or transform is NULL.\n");
+        return 0;
+    }
+
+    wld_transcode_t job;
+
+    memset(&job, 0, sizeof(job));
+
+    job.fn     = fn;
+    job.ctx    = ctx;
+    job.stream = wld_stream_open(in, 0);
+
+    if (job.stream == (wld_stream_t *)0x0)
+        return 0;
+
+    if (job.stream->wld.info.numsections < 3) {
+        VLOGF_ERR("%s has too few sections to transcode.\n", in);
+        wld_stream_close(job.stream);
+        return 0;
+    }
+
+    int          height = job.stream->wld.header.height;
+    unsigned int ret    = 1;
+
+    int i;
+    for (i = 0; i < WLD_TRANSCODE_SLOTS; ++i) {
+        job.slots[i].tiles = (tile_t *)malloc(sizeof(tile_t) * height);
+        job.slots[i].enc   = (char *)malloc(TILE_COLUMN_MAX(height));
+
+        if (job.slots[i].tiles == (tile_t *)0x0 || job.slots[i].enc == (char *)0x0)
+            ret = 0;
+    }
+
+    int   fd  = -1;
+    char *tmp = ret ? wld_save_begin(out, &fd) : (char *)0x0;
+    FILE *fp  = (FILE *)0x0;
+
+    /* The stream gets its own descriptor, since wld_save_finish closes fd.  */
+    if (tmp != (char *)0x0)
+        fp = fdopen(dup(fd), "wb");
+
+    if (fp == (FILE *)0x0) {
+        VLOGF_ERR("Failed to start transcoding %s.\n", in);
+        ret = 0;
+    } else {
+        pthread_mutex_init(&job.lock, (pthread_mutexattr_t *)0x0);
+        pthread_cond_init(&job.cond, (pthread_condattr_t *)0x0);
+
+        ret = wld_transcode_run(&job, fp);
+
+        pthread_cond_destroy(&job.cond);
+        pthread_mutex_destroy(&job.lock);
+
+        if (fclose(fp) != 0)
+            ret = 0;
+
+        /* The world has to be on disk before the rename can point at it.  */
+        ret = ret && fsync(fd) == 0;
+    }
+
+    if (tmp != (char *)0x0 && !wld_save_finish((wld_encoded_t *)0x0, fd, tmp, out, ret))
+        ret = 0;
+
+    if (!ret)
+        VLOGF_ERR("Failed to transcode %s to %s.\n", in, out);
+
+    for (i = 0; i < WLD_TRANSCODE_SLOTS; ++i) {
+        free(job.slots[i].tiles);
+        free(job.slots[i].enc);
+    }
+
+    wld_stream_close(job.stream);
+
+    return ret;
+}
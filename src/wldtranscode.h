@@ -0,0 +1,44 @@
+/*
+ *    wldtranscode.h    --    Header file for streaming world transcodes
+ *
+ *    Authored by Karl "p0lyh3dron" Kreuze on October 18, 2026
+ *
+ *    Declares the function used to rewrite the tiles of a world file in
+ *    one pass, without loading it. Columns are decoded, handed to a
+ *    transform, encoded and written as they go, so batch edits over many
+ *    worlds hold a few columns at a time instead of whole worlds.
+ */
+#ifndef WLD_WLDTRANSCODE_H
+#define WLD_WLDTRANSCODE_H
+
+#include "wld.h"
+
+/*
+ *    The number of columns in flight between the reading, transforming
+ *    and writing threads.
+ */
+#define WLD_TRANSCODE_SLOTS 4
+
+/*
+ *    Called on the transform thread with every column of the world, in
+ *    order, which may be changed in place. Returning 0 aborts the
+ *    transcode and leaves the output untouched.
+ */
+typedef unsigned int (*wld_transcode_fn_t)(void *ctx, int x, tile_t *tiles, int height);
+
+/*
+ *    Rewrites the tiles of a world file through a transform. Everything
+ *    but the tile section is copied as is, and the section offsets are
+ *    fixed up at the end. The output is written next to its path and
+ *    renamed over it, so it may be the input.
+ *
+ *    @param const char         *in     The world file to read.
+ *    @param const char         *out    The world file to write.
+ *    @param wld_transcode_fn_t  fn     The transform.
+ *    @param void               *ctx    Passed to the transform.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+unsigned int wld_transcode(const char *in, const char *out, wld_transcode_fn_t fn, void *ctx);
+
+#endif /* WLD_WLDTRANSCODE_H  */
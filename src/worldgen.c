@@ -7,118 +7,134 @@
  */
 #include "worldgen.h"
 
+#include "hash.h"
 #include "log.h"
+#include "noise.h"
 #include "rand.h"
+#include "threadpool.h"
+#include "tilerunner.h"
+#include "tilestore.h"
 
-genvars_t _genvars;
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Columns of the surface line evaluated at once, and the widths of its hills and layers.  */
+#define GEN_TERRAIN_CHUNK  256
+#define GEN_TERRAIN_HILLS  300.0f
+#define GEN_TERRAIN_LAYERS 150.0f
+#define GEN_TERRAIN_OFFSET 100.0f
 
 /*
- *    Generates a world.
+ *    Parses a seed the way the game does. Numbers are used as they are,
+ *    anything else is hashed.
  *
- *    @param wld_t        *wld      The world to generate.
- *    @param unsigned int  seed     The seed to use for generation.
- *    @param char         *name     The name of the world.
- *    @param int           width    The width of the world.
- *    @param int           height   The height of the world.
- * 
- *    @return int    0 on success, -1 on failure.
+ *    @param const char *seed    The seed.
+ *
+ *    @return int    The numeric seed.
  */
-int wld_gen_world(wld_t *wld, unsigned int seed, char *name, int width, int height) {
-    if (wld == (wld_t *)0x0) {
-        LOGF_ERR("World is NULL!");
-        return -1;
-    }
+int wld_gen_parse_seed(const char *seed) {
+    if (atoi(seed) != 0)
+        return atoi(seed);
 
-    if (seed == (char *)0x0) {
-        LOGF_ERR("Seed is NULL!");
-        return -1;
-    }
+    return rand_crc32((char *)seed, strlen(seed));
+}
+
+/*
+ *    Source code def: ResetGenerator and the start of the Reset pass.
+ *    Decides everything about a world that is picked before the first
+ *    tile is placed. The special seeds are matched against the header's
+ *    seed string.
+ *
+ *    @param gen_t        *gen       The generation.
+ *    @param wld_header_t *header    The header to fill.
+ *    @param int           seed      The numeric seed.
+ *    @param int           width     The width of the world.
+ *    @param int           height    The height of the world.
+ */
+static void gen_reset(gen_t *gen, wld_header_t *header, int seed, int width, int height) {
+    rng_seed(&gen->rng, seed);
 
-    if (name == (char *)0x0) {
-        LOGF_ERR("Name is NULL!");
-        return -1;
-    }
-    
     if (seed == 5162020) {
-        wld->header.drunk = 1;
-        seed = next_max(999999999);
+        header->drunk = 1;
+        seed = rng_next_max(&gen->rng, 999999999);
     }
 
-    if (strcmp(wld->header.seed, "not the bees") == 0 || strcmp(wld->header.seed, "not the bees!") == 0) {
-        wld->header.bees = 1;
-        seed = next_max(999999999);
+    if (strcmp(header->seed, "not the bees") == 0 || strcmp(header->seed, "not the bees!") == 0) {
+        header->bees = 1;
+        seed = rng_next_max(&gen->rng, 999999999);
     }
 
-    if (strcmp(wld->header.seed, "notraps") == 0 || strcmp(wld->header.seed, "no traps") == 0) {
-        wld->header.no_traps = 1;
-        seed = next_max(999999999);
+    if (strcmp(header->seed, "notraps") == 0 || strcmp(header->seed, "no traps") == 0) {
+        header->no_traps = 1;
+        seed = rng_next_max(&gen->rng, 999999999);
     }
 
-    if (strcmp(wld->header.seed, "for the worthy") == 0) {
-        wld->header.ftw = 1;
-        seed = next_max(999999999);
+    if (strcmp(header->seed, "for the worthy") == 0) {
+        header->ftw = 1;
+        seed = rng_next_max(&gen->rng, 999999999);
     }
 
-    if (strcmp(wld->header.seed, "celebrationmk10") == 0 || seed == 5162011 || seed == 5162021) {
-        wld->header.tenth = 1;
-        seed = next_max(999999999);
+    if (strcmp(header->seed, "celebrationmk10") == 0 || seed == 5162011 || seed == 5162021) {
+        header->tenth = 1;
+        seed = rng_next_max(&gen->rng, 999999999);
     }
 
-    if (strcmp(wld->header.seed, "constant") == 0 || 
-        strcmp(wld->header.seed, "theconstant") == 0 ||
-        strcmp(wld->header.seed, "the constant") == 0 ||
-        strcmp(wld->header.seed, "eye4aneye") == 0 ||
-        strcmp(wld->header.seed, "eyeforaneye") == 0) {
-        wld->header.dont_starve = 1;
-        seed = next_max(999999999);
+    if (strcmp(header->seed, "constant") == 0 || 
+        strcmp(header->seed, "theconstant") == 0 ||
+        strcmp(header->seed, "the constant") == 0 ||
+        strcmp(header->seed, "eye4aneye") == 0 ||
+        strcmp(header->seed, "eyeforaneye") == 0) {
+        header->dont_starve = 1;
+        seed = rng_next_max(&gen->rng, 999999999);
     }
 
-    if (strcmp(wld->header.seed, "don't dig up") == 0 ||
-        strcmp(wld->header.seed, "dont dig up") == 0 ||
-        strcmp(wld->header.seed, "dontdigup") == 0) {
-        wld->header.remix = 1;
-        seed = next_max(999999999);
+    if (strcmp(header->seed, "don't dig up") == 0 ||
+        strcmp(header->seed, "dont dig up") == 0 ||
+        strcmp(header->seed, "dontdigup") == 0) {
+        header->remix = 1;
+        seed = rng_next_max(&gen->rng, 999999999);
     }
 
-    if (strcmp(wld->header.seed, "get fixed boi") == 0 ||
-        strcmp(wld->header.seed, "getfixedboi") == 0) {
-        wld->header.zenith = 1;
-        wld->header.remix = 1;
-        wld->header.dont_starve = 1;
-        wld->header.tenth = 1;
-        wld->header.ftw = 1;
-        wld->header.no_traps = 1;
-        wld->header.bees = 1;
-        wld->header.drunk = 1;
-        seed = next_max(999999999);
+    if (strcmp(header->seed, "get fixed boi") == 0 ||
+        strcmp(header->seed, "getfixedboi") == 0) {
+        header->zenith = 1;
+        header->remix = 1;
+        header->dont_starve = 1;
+        header->tenth = 1;
+        header->ftw = 1;
+        header->no_traps = 1;
+        header->bees = 1;
+        header->drunk = 1;
+        seed = rng_next_max(&gen->rng, 999999999);
     }
 
-    wld->header.spawn_x = width / 2;
-    wld->header.spawn_y = height / 2;
+    header->spawn_x = width / 2;
+    header->spawn_y = height / 2;
 
-    set_seed(seed);
+    rng_seed(&gen->rng, seed);
 
-    LOGF_NOTE("Generation: Resetting world...");
-    if (next_max(2) == 0)
-        _genvars.crimson_left = 0;
+    if (rng_next_max(&gen->rng, 2) == 0)
+        gen->vars.crimson_left = 0;
     else
-        _genvars.crimson_left = 1;
+        gen->vars.crimson_left = 1;
 
-    wld->header.num_clouds = next_minmax(10, 200);
-    wld->header.wind_speed = 0.f;
+    header->num_clouds = rng_next_minmax(&gen->rng, 10, 200);
+    header->wind_speed = 0.f;
     
-    while (wld->header.wind_speed == 0.f)
-        wld->header.wind_speed = (float)next_minmax(-400, 401) * 0.001f;
+    while (header->wind_speed == 0.f)
+        header->wind_speed = (float)rng_next_minmax(&gen->rng, -400, 401) * 0.001f;
 
     int hell_items[5]      = {274, 220, 112, 218, 3019};
     int hell_items_rand[5] = {0, 0, 0, 0, 0};
     /* Put the unholy trident in place of fire flower.  */
-    if (wld->header.remix == 1) 
+    if (header->remix == 1) 
         hell_items[2] = 683;
 
     int count = 5;
     while (--count > 0) {
-        int index = next_max(count);
+        int index = rng_next_max(&gen->rng, count);
         hell_items_rand[4 - count] = hell_items[index];
 
         unsigned int i;
@@ -126,80 +142,769 @@ int wld_gen_world(wld_t *wld, unsigned int seed, char *name, int width, int heig
             hell_items[i] = hell_items[i + 1];
     }
 
-    wld->header.slime_rain_time = -next_minmax(86400 * 2, 86400 * 3);
-    wld->header.cloud_bg        = -next_minmax(8640, 86400);
+    header->slime_rain_time = -rng_next_minmax(&gen->rng, 86400 * 2, 86400 * 3);
+    header->cloud_bg        = -rng_next_minmax(&gen->rng, 8640, 86400);
 
-    if (next_max(2) == 0) {
-        _genvars.copper       = 166;
-        _genvars.copper_bar   = 703;
-        wld->header.copper_id = 166;
+    if (rng_next_max(&gen->rng, 2) == 0) {
+        gen->vars.copper       = 166;
+        gen->vars.copper_bar   = 703;
+        header->copper_id = 166;
     } else {
-        _genvars.copper       = 7;
-        _genvars.copper_bar   = 20;
-        wld->header.copper_id = 7;
+        gen->vars.copper       = 7;
+        gen->vars.copper_bar   = 20;
+        header->copper_id = 7;
     }
 
-    if ((!wld->header.dont_starve || wld->header.drunk) && next_max(2) == 0) {
-        _genvars.iron       = 167;
-        _genvars.iron_bar   = 704;
-        wld->header.iron_id = 167;
+    if ((!header->dont_starve || header->drunk) && rng_next_max(&gen->rng, 2) == 0) {
+        gen->vars.iron       = 167;
+        gen->vars.iron_bar   = 704;
+        header->iron_id = 167;
     } else {
-        _genvars.iron       = 6;
-        _genvars.iron_bar   = 22;
-        wld->header.iron_id = 6;
+        gen->vars.iron       = 6;
+        gen->vars.iron_bar   = 22;
+        header->iron_id = 6;
     }
 
-    if (next_max(2) == 0) {
-        _genvars.silver       = 168;
-        _genvars.silver_bar   = 705;
-        wld->header.silver_id = 168;
+    if (rng_next_max(&gen->rng, 2) == 0) {
+        gen->vars.silver       = 168;
+        gen->vars.silver_bar   = 705;
+        header->silver_id = 168;
     } else {
-        _genvars.silver       = 9;
-        _genvars.silver_bar   = 21;
-        wld->header.silver_id = 9;
+        gen->vars.silver       = 9;
+        gen->vars.silver_bar   = 21;
+        header->silver_id = 9;
     }
 
-    if ((!wld->header.dont_starve || wld->header.drunk) && next_max(2) == 0) {
-        _genvars.gold       = 169;
-        _genvars.gold_bar   = 706;
-        wld->header.gold_id = 169;
+    if ((!header->dont_starve || header->drunk) && rng_next_max(&gen->rng, 2) == 0) {
+        gen->vars.gold       = 169;
+        gen->vars.gold_bar   = 706;
+        header->gold_id = 169;
     } else {
-        _genvars.gold       = 8;
-        _genvars.gold_bar   = 19;
-        wld->header.gold_id = 8;
+        gen->vars.gold       = 8;
+        gen->vars.gold_bar   = 19;
+        header->gold_id = 8;
     }
 
-    wld->header.crimson = next_max(2) == 0;
-    wld->header.id      = next_max(2147483647);
+    header->crimson = rng_next_max(&gen->rng, 2) == 0;
+    header->id      = rng_next_max(&gen->rng, 2147483647);
 
     if (width <= 4200) {
-        wld->header.tree_x[0] = next_minmax(width * .25, width * .75);
-        wld->header.tree_styles[0] = next_max(6);
-        wld->header.tree_styles[1] = next_max(6);
+        header->tree_x[0] = rng_next_minmax(&gen->rng, width * .25, width * .75);
+        header->tree_styles[0] = rng_next_max(&gen->rng, 6);
+        header->tree_styles[1] = rng_next_max(&gen->rng, 6);
 
-        while (wld->header.tree_styles[1] == wld->header.tree_styles[0])
-            wld->header.tree_styles[1] = next_max(6);
+        while (header->tree_styles[1] == header->tree_styles[0])
+            header->tree_styles[1] = rng_next_max(&gen->rng, 6);
 
-        wld->header.tree_x[1] = width;
-        wld->header.tree_x[2] = width;
+        header->tree_x[1] = width;
+        header->tree_x[2] = width;
 
         unsigned long i;
         for (i = 0; i < 2; i++) {
-            if (wld->header.tree_styles[i] == 0 && next_max(3) != 0) {
-                wld->header.tree_styles[i] = 4;
+            if (header->tree_styles[i] == 0 && rng_next_max(&gen->rng, 3) != 0) {
+                header->tree_styles[i] = 4;
             }
         }
     }
     /* ADD DIFF WORLD SIZES LATER  */
     if (width <= 4200) {
-        wld->header.cave_back_x[0] = next_minmax(width * .25, width * .75);
-        wld->header.cave_back_x[1] = width;
-        wld->header.cave_back_x[2] = width;
-        wld->header.cave_back_style[0] = next_max(8);
-        wld->header.cave_back_style[1] = next_max(8);
+        header->cave_back_x[0] = rng_next_minmax(&gen->rng, width * .25, width * .75);
+        header->cave_back_x[1] = width;
+        header->cave_back_x[2] = width;
+        header->cave_back_style[0] = rng_next_max(&gen->rng, 8);
+        header->cave_back_style[1] = rng_next_max(&gen->rng, 8);
         
-        while (wld->header.cave_back_style[1] == wld->header.cave_back_style[0])
-            wld->header.cave_back_style[1] = next_max(8);
+        while (header->cave_back_style[1] == header->cave_back_style[0])
+            header->cave_back_style[1] = rng_next_max(&gen->rng, 8);
     }
     /* PICK UP RaandomizeBackGrounds  */
-}
\ No newline at end of file
+}
+
+/*
+ *    Returns the time on the monotonic clock.
+ *
+ *    @return double    The time in seconds.
+ */
+static double gen_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ *    Places a tile, counting it as touched.
+ *
+ *    @param gen_t *gen     The generation.
+ *    @param int    x       The x coordinate.
+ *    @param int    y       The y coordinate.
+ *    @param short  tile    The tile, -1 to clear it.
+ */
+void gen_set_tile(gen_t *gen, int x, int y, short tile) {
+    gen->tiles[x][y].tile = tile;
+    gen->touched++;
+}
+
+/*
+ *    Picks a random number in a range that may be empty.
+ *
+ *    @param rng_t *rng    The stream.
+ *    @param int    min    The inclusive minimum.
+ *    @param int    max    The exclusive maximum.
+ *
+ *    @return int    A random number in the range, min if it is empty.
+ */
+static int gen_range(rng_t *rng, int min, int max) {
+    if (max <= min)
+        return min;
+
+    return rng_next_minmax(rng, min, max);
+}
+
+/*
+ *    Derives the seed of a stream in fast generation, so that every strip
+ *    of every pass gets its own.
+ *
+ *    @param int          seed      The seed of the world.
+ *    @param unsigned int pass      The pass.
+ *    @param unsigned int call      Which stream of the pass, 0 for the strip's own.
+ *    @param int          strip     The strip.
+ *
+ *    @return int    The seed of the stream.
+ */
+static int gen_strip_seed(int seed, unsigned int pass, unsigned int call, int strip) {
+    int key[4] = {seed, (int)pass, (int)call, strip};
+
+    return (int)(hash_fnv1a(key, sizeof(key)) & 0x7fffffff);
+}
+
+/*
+ *    Returns the columns a pass owns, the whole world or one strip.
+ *
+ *    @param gen_t *gen    The generation.
+ *    @param int   *x0     The first column.
+ *    @param int   *x1     The column after the last.
+ */
+static void gen_owned(gen_t *gen, int *x0, int *x1) {
+    if (gen->strip < 0) {
+        *x0 = 0;
+        *x1 = gen->width;
+        return;
+    }
+
+    *x0 = gen->strip * GEN_STRIP_WIDTH;
+    *x1 = *x0 + GEN_STRIP_WIDTH < gen->width ? *x0 + GEN_STRIP_WIDTH : gen->width;
+}
+
+/*
+ *    Runs a number of tile runners scaled by the area of the world, each
+ *    starting somewhere in a band of rows.
+ *
+ *    @param gen_t  *gen         The generation.
+ *    @param double  density     The number of runners per tile.
+ *    @param int     top         The first row of the band.
+ *    @param int     bottom      The row after the band.
+ *    @param int     strength    The range of brush sizes, as {min, max}.
+ *    @param int     steps       The range of steps, as {min, max}.
+ *    @param short   type        The tile to place, -1 to clear tiles.
+ */
+static void gen_scatter(gen_t *gen, double density, int top, int bottom, const int strength[2], const int steps[2], short type) {
+    if (gen->strip < 0) {
+        int count = (int)((double)gen->width * gen->height * density);
+
+        int i;
+        for (i = 0; i < count; ++i) {
+            int x = rng_next_minmax(&gen->rng, 0, gen->width);
+            int y = gen_range(&gen->rng, top, bottom);
+
+            gen_tile_runner(gen, x, y, gen_range(&gen->rng, strength[0], strength[1]), gen_range(&gen->rng, steps[0], steps[1]), type, 0, 0.0, 0.0);
+        }
+
+        return;
+    }
+
+    /*
+     *    Each strip places its runners from its own stream, and every
+     *    runner has a stream of its own, so the neighbours' runners that
+     *    start in the halo can be placed again exactly.
+     */
+    gen->scatters++;
+
+    int strip;
+    for (strip = gen->strip - 1; strip <= gen->strip + 1; ++strip) {
+        int x0 = strip * GEN_STRIP_WIDTH;
+        int x1 = x0 + GEN_STRIP_WIDTH < gen->width ? x0 + GEN_STRIP_WIDTH : gen->width;
+
+        if (strip < 0 || x0 >= gen->width)
+            continue;
+
+        rng_t stream;
+        int   count = (int)((double)(x1 - x0) * gen->height * density);
+
+        rng_seed(&stream, gen_strip_seed(gen->seed, gen->pass, gen->scatters, strip));
+
+        int i;
+        for (i = 0; i < count; ++i) {
+            int x    = rng_next_minmax(&stream, x0, x1);
+            int y    = gen_range(&stream, top, bottom);
+            int size = gen_range(&stream, strength[0], strength[1]);
+            int len  = gen_range(&stream, steps[0], steps[1]);
+            int seed = rng_next(&stream);
+
+            if (x < gen->left || x >= gen->right)
+                continue;
+
+            rng_seed(&gen->rng, seed);
+            gen_tile_runner(gen, x, y, size, len, type, 0, 0.0, 0.0);
+        }
+    }
+}
+
+/*
+ *    Source code def: the Reset pass.
+ *
+ *    @param gen_t *gen    The generation.
+ */
+static void gen_pass_reset(gen_t *gen) {
+    gen_reset(gen, &gen->wld->header, gen->seed, gen->width, gen->height);
+}
+
+/*
+ *    Source code def: the Terrain pass. The game walks the surface line
+ *    across the world in runs of flat ground and hills; here the surface
+ *    and rock lines are fractal noise seeded from the world's stream,
+ *    which is smoother and evaluated a row at a time. Dirt is filled
+ *    between the lines and stone below.
+ *
+ *    @param gen_t *gen    The generation.
+ */
+static void gen_pass_terrain(gen_t *gen) {
+    double  surface = gen->height * 0.235 * rng_next_minmax(&gen->rng, 95, 105) * 0.01;
+    double  rock    = gen->height * 0.1 * rng_next_minmax(&gen->rng, 90, 110) * 0.01;
+    noise_t noise;
+    float   hills[GEN_TERRAIN_CHUNK];
+    float   layers[GEN_TERRAIN_CHUNK];
+
+    noise_seed(&noise, rng_next(&gen->rng));
+
+    gen->surface_low  = gen->height;
+    gen->surface_high = 0;
+    gen->rock_low     = gen->height;
+    gen->rock_high    = 0;
+
+    int start;
+    int x;
+    int y;
+    for (start = 0; start < gen->width; start += GEN_TERRAIN_CHUNK) {
+        int count = gen->width - start < GEN_TERRAIN_CHUNK ? gen->width - start : GEN_TERRAIN_CHUNK;
+
+        noise_fbm_row(&noise, start / GEN_TERRAIN_HILLS, 1.0f / GEN_TERRAIN_HILLS, 5, hills, count);
+        noise_fbm_row(&noise, GEN_TERRAIN_OFFSET + start / GEN_TERRAIN_LAYERS, 1.0f / GEN_TERRAIN_LAYERS, 3, layers, count);
+
+        for (x = start; x < start + count; ++x) {
+            double top    = surface + gen->height * 0.065 * hills[x - start];
+            double bottom = top + rock + gen->height * 0.04 * layers[x - start];
+
+            if (top < gen->height * 0.17)
+                top = gen->height * 0.17;
+            if (top > gen->height * 0.3)
+                top = gen->height * 0.3;
+            if (bottom < top + gen->height * 0.05)
+                bottom = top + gen->height * 0.05;
+            if (bottom > gen->height * 0.45)
+                bottom = gen->height * 0.45;
+
+            gen->surface[x] = (int)top;
+            gen->rock[x]    = (int)bottom;
+
+            if (gen->surface[x] < gen->surface_low)
+                gen->surface_low = gen->surface[x];
+            if (gen->surface[x] > gen->surface_high)
+                gen->surface_high = gen->surface[x];
+            if (gen->rock[x] < gen->rock_low)
+                gen->rock_low = gen->rock[x];
+            if (gen->rock[x] > gen->rock_high)
+                gen->rock_high = gen->rock[x];
+
+            for (y = gen->surface[x]; y < gen->height; ++y)
+                gen_set_tile(gen, x, y, y < gen->rock[x] ? 0 : 1);
+        }
+    }
+
+    gen->wld->header.ground_level = gen->surface_high + 25;
+    gen->wld->header.rock_level   = gen->rock_high;
+
+    if (gen->wld->header.rock_level > gen->height - 250)
+        gen->wld->header.rock_level = gen->height - 250;
+    if (gen->wld->header.rock_level < gen->wld->header.ground_level + 6)
+        gen->wld->header.rock_level = gen->wld->header.ground_level + 6;
+}
+
+/*
+ *    Source code def: the Tunnels pass. Digs a few staggered tunnels down
+ *    from the surface.
+ *
+ *    @param gen_t *gen    The generation.
+ */
+static void gen_pass_tunnels(gen_t *gen) {
+    int count = (int)(gen->width * 0.0015);
+
+    int i;
+    for (i = 0; i < count; ++i) {
+        int    x    = rng_next_minmax(&gen->rng, 0, gen->width);
+        int    y    = gen->surface[x];
+        int    len  = rng_next_minmax(&gen->rng, 10, 20);
+        double dir  = rng_next_max(&gen->rng, 2) == 0 ? -1.0 : 1.0;
+
+        int j;
+        for (j = 0; j < len && x > 0 && x < gen->width - 1; ++j) {
+            gen_tile_runner(gen, x, y, rng_next_minmax(&gen->rng, 3, 6), rng_next_minmax(&gen->rng, 10, 30), -1, 0, dir * rng_next_minmax(&gen->rng, 5, 11) * 0.1, 1.0);
+
+            x += (int)dir * rng_next_minmax(&gen->rng, 3, 7);
+            y += rng_next_minmax(&gen->rng, 2, 6);
+        }
+    }
+}
+
+/*
+ *    Source code def: the Dirt Wall Backgrounds pass. Puts dirt walls
+ *    behind the dirt layer, starting a little below the surface.
+ *
+ *    @param gen_t *gen    The generation.
+ */
+static void gen_pass_dirt_walls(gen_t *gen) {
+    int x0;
+    int x1;
+
+    gen_owned(gen, &x0, &x1);
+
+    int x;
+    int y;
+    for (x = x0 > 1 ? x0 : 1; x < x1 && x < gen->width - 1; ++x) {
+        for (y = gen->surface[x] + rng_next_minmax(&gen->rng, 2, 6); y < gen->rock[x]; ++y) {
+            gen->tiles[x][y].wall = 2;
+            gen->touched++;
+        }
+    }
+}
+
+/*
+ *    Source code def: the Rocks In Dirt pass. Scatters stone through the
+ *    hills and the dirt layer.
+ *
+ *    @param gen_t *gen    The generation.
+ */
+static void gen_pass_rocks_in_dirt(gen_t *gen) {
+    const int hills[2][2] = {{4, 15}, {5, 40}};
+    const int top[2][2]   = {{4, 10}, {5, 30}};
+    const int dirt[2][2]  = {{2, 7}, {2, 23}};
+
+    gen_scatter(gen, 0.00015, 0, gen->surface_low + 1, hills[0], hills[1], 1);
+    gen_scatter(gen, 0.0002, gen->surface_low, gen->surface_high + 1, top[0], top[1], 1);
+    gen_scatter(gen, 0.0045, gen->surface_high, gen->rock_high + 1, dirt[0], dirt[1], 1);
+}
+
+/*
+ *    Source code def: the Dirt In Rocks pass. Scatters dirt through the
+ *    rock layer.
+ *
+ *    @param gen_t *gen    The generation.
+ */
+static void gen_pass_dirt_in_rocks(gen_t *gen) {
+    const int size[2][2] = {{2, 6}, {2, 40}};
+
+    gen_scatter(gen, 0.005, gen->rock_low, gen->height, size[0], size[1], 0);
+}
+
+/*
+ *    Source code def: the Small Holes pass.
+ *
+ *    @param gen_t *gen    The generation.
+ */
+static void gen_pass_small_holes(gen_t *gen) {
+    const int size[2][2] = {{2, 5}, {2, 20}};
+
+    gen_scatter(gen, 0.0015, gen->surface_high, gen->height, size[0], size[1], -1);
+}
+
+/*
+ *    Source code def: the Dirt Layer Caves pass.
+ *
+ *    @param gen_t *gen    The generation.
+ */
+static void gen_pass_dirt_caves(gen_t *gen) {
+    const int size[2][2] = {{5, 15}, {30, 200}};
+
+    gen_scatter(gen, 0.00003, gen->surface_low, gen->rock_high, size[0], size[1], -1);
+}
+
+/*
+ *    Source code def: the Rock Layer Caves pass.
+ *
+ *    @param gen_t *gen    The generation.
+ */
+static void gen_pass_rock_caves(gen_t *gen) {
+    const int size[2][2] = {{6, 20}, {50, 300}};
+
+    gen_scatter(gen, 0.00013, gen->rock_high, gen->height, size[0], size[1], -1);
+}
+
+/*
+ *    Source code def: the Shinies pass. Places the ores picked by the
+ *    Reset pass, copper near the surface and gold deepest.
+ *
+ *    @param gen_t *gen    The generation.
+ */
+static void gen_pass_shinies(gen_t *gen) {
+    const int small[2][2] = {{3, 6}, {2, 6}};
+    const int big[2][2]   = {{4, 9}, {4, 8}};
+    const int deep[2][2]  = {{5, 10}, {5, 10}};
+
+    gen_scatter(gen, 0.00006, gen->surface_low, gen->surface_high, small[0], small[1], gen->vars.copper);
+    gen_scatter(gen, 0.00008, gen->surface_high, gen->rock_high, small[0], small[1], gen->vars.copper);
+    gen_scatter(gen, 0.0002, gen->rock_low, gen->height, big[0], big[1], gen->vars.copper);
+
+    gen_scatter(gen, 0.00003, gen->surface_low, gen->surface_high, small[0], small[1], gen->vars.iron);
+    gen_scatter(gen, 0.00008, gen->surface_high, gen->rock_high, small[0], small[1], gen->vars.iron);
+    gen_scatter(gen, 0.0002, gen->rock_low, gen->height, big[0], big[1], gen->vars.iron);
+
+    gen_scatter(gen, 0.000026, gen->surface_high, gen->rock_high, small[0], small[1], gen->vars.silver);
+    gen_scatter(gen, 0.00015, gen->rock_low, gen->height, big[0], big[1], gen->vars.silver);
+    gen_scatter(gen, 0.00017, gen->rock_low, gen->height, deep[0], deep[1], gen->vars.silver);
+
+    gen_scatter(gen, 0.00012, gen->rock_low, gen->height, big[0], big[1], gen->vars.gold);
+    gen_scatter(gen, 0.00012, gen->rock_high, gen->height, deep[0], deep[1], gen->vars.gold);
+}
+
+static gen_pass_t _gen_passes[GEN_MAX_PASSES] = {
+    {"Reset",                 1.0,   gen_pass_reset,         0},
+    {"Terrain",               450.0, gen_pass_terrain,       0},
+    {"Tunnels",               6.0,   gen_pass_tunnels,       0},
+    {"Dirt Wall Backgrounds", 90.0,  gen_pass_dirt_walls,    1},
+    {"Rocks In Dirt",         90.0,  gen_pass_rocks_in_dirt, 1},
+    {"Dirt In Rocks",         90.0,  gen_pass_dirt_in_rocks, 1},
+    {"Small Holes",           60.0,  gen_pass_small_holes,   1},
+    {"Dirt Layer Caves",      15.0,  gen_pass_dirt_caves,    1},
+    {"Rock Layer Caves",      30.0,  gen_pass_rock_caves,    1},
+    {"Shinies",               80.0,  gen_pass_shinies,       1},
+};
+
+static unsigned int _gen_pass_count   = 10;
+static unsigned int _gen_fast         = 0;
+static unsigned int _gen_fast_threads = 0;
+
+typedef struct {
+    gen_t         *gen;
+    int            parity;
+    unsigned int   failed;
+    unsigned long  touched[THREADPOOL_MAX_THREADS];
+} gen_strips_t;
+
+/*
+ *    Enables or disables fast generation. Disabled by default.
+ *
+ *    @param unsigned int enabled    1 to generate in strips, 0 to generate like the game.
+ *    @param unsigned int threads    The number of threads to use, 0 for one per CPU.
+ */
+void wld_gen_set_fast(unsigned int enabled, unsigned int threads) {
+    _gen_fast         = enabled != 0;
+    _gen_fast_threads = threads;
+}
+
+/*
+ *    Runs the current pass over every other strip. A strip writes its own
+ *    columns in place, and copies of the halo columns on either side,
+ *    which belong to strips that are not running.
+ *
+ *    @param unsigned long  begin     The first strip of the grain, counting every other strip.
+ *    @param unsigned long  end       The strip after the grain.
+ *    @param unsigned int   worker    The worker running the grain.
+ *    @param void          *ctx       The strips.
+ */
+static void gen_strip_run(unsigned long begin, unsigned long end, unsigned int worker, void *ctx) {
+    gen_strips_t *strips = (gen_strips_t *)ctx;
+
+    unsigned long i;
+    for (i = begin; i < end; ++i) {
+        gen_t strip = *strips->gen;
+
+        strip.strip    = (int)i * 2 + strips->parity;
+        strip.scatters = 0;
+        strip.touched  = 0;
+
+        int x0;
+        int x1;
+
+        gen_owned(&strip, &x0, &x1);
+
+        strip.left  = x0 - GEN_STRIP_HALO > 0 ? x0 - GEN_STRIP_HALO : 0;
+        strip.right = x1 + GEN_STRIP_HALO < strip.width ? x1 + GEN_STRIP_HALO : strip.width;
+
+        tile_t **tiles = (tile_t **)calloc(strip.width, sizeof(tile_t *));
+        tile_t  *halo  = (tile_t *)malloc((unsigned long)(strip.right - strip.left - (x1 - x0)) * strip.height * sizeof(tile_t));
+
+        if (tiles == (tile_t **)0x0 || halo == (tile_t *)0x0) {
+            __atomic_store_n(&strips->failed, 1, __ATOMIC_RELAXED);
+            free(tiles);
+            free(halo);
+            continue;
+        }
+
+        tile_t *next = halo;
+
+        int x;
+        for (x = strip.left; x < strip.right; ++x) {
+            if (x >= x0 && x < x1) {
+                tiles[x] = strip.wld->tiles[x];
+                continue;
+            }
+
+            memcpy(next, strip.wld->tiles[x], strip.height * sizeof(tile_t));
+            tiles[x] = next;
+            next    += strip.height;
+        }
+
+        strip.tiles = tiles;
+        rng_seed(&strip.rng, gen_strip_seed(strip.seed, strip.pass, 0, strip.strip));
+
+        _gen_passes[strip.pass].fn(&strip);
+
+        strips->touched[worker] += strip.touched;
+
+        free(tiles);
+        free(halo);
+    }
+}
+
+/*
+ *    Runs a pass a strip at a time on the thread pool, first the even
+ *    strips and then the odd ones. Neighbouring strips never run at once,
+ *    so the halos a strip reads are the same however many threads there
+ *    are.
+ *
+ *    @param gen_t *gen    The generation.
+ *
+ *    @return unsigned int    1 on success, 0 on failure.
+ */
+static unsigned int gen_run_strips(gen_t *gen) {
+    gen_strips_t strips;
+    int          count = (gen->width + GEN_STRIP_WIDTH - 1) / GEN_STRIP_WIDTH;
+
+    memset(&strips, 0, sizeof(strips));
+
+    strips.gen = gen;
+
+    for (strips.parity = 0; strips.parity < 2; ++strips.parity) {
+        if (!threadpool_for(0, (count - strips.parity + 1) / 2, 1, gen_strip_run, &strips, _gen_fast_threads))
+            return 0;
+    }
+
+    unsigned int i;
+    for (i = 0; i < THREADPOOL_MAX_THREADS; ++i)
+        gen->touched += strips.touched[i];
+
+    return !strips.failed;
+}
+
+/*
+ *    Appends a pass to the registry, to run after the built in passes. Not
+ *    thread safe, passes should be added before any world is generated.
+ *
+ *    @param const char    *name      The name of the pass, which is not copied.
+ *    @param double         weight    The share of the progress the pass takes.
+ *    @param gen_pass_fn_t  fn        The pass.
+ *
+ *    @return unsigned int    1 on success, 0 if the registry is full.
+ */
+unsigned int wld_gen_add_pass(const char *name, double weight, gen_pass_fn_t fn) {
+    if (_gen_pass_count >= GEN_MAX_PASSES) {
+        VLOGF_ERR("Too many generation passes to add %s.\n", name);
+        return 0;
+    }
+
+    _gen_passes[_gen_pass_count].name   = name;
+    _gen_passes[_gen_pass_count].weight = weight;
+    _gen_passes[_gen_pass_count].fn     = fn;
+    _gen_passes[_gen_pass_count].strips = 0;
+    _gen_pass_count++;
+
+    return 1;
+}
+
+/*
+ *    Returns the number of registered passes.
+ *
+ *    @return unsigned int    The number of passes.
+ */
+unsigned int wld_gen_pass_count(void) {
+    return _gen_pass_count;
+}
+
+/*
+ *    Returns a registered pass.
+ *
+ *    @param unsigned int i    The index of the pass.
+ *
+ *    @return const gen_pass_t *    The pass, NULL if out of range.
+ */
+const gen_pass_t *wld_gen_get_pass(unsigned int i) {
+    if (i >= _gen_pass_count)
+        return (const gen_pass_t *)0x0;
+
+    return &_gen_passes[i];
+}
+
+/*
+ *    Runs only the generation passes that decide the header of a world,
+ *    without allocating any tiles. The header is cleared first and keeps
+ *    a pointer to the seed string, which is not copied.
+ *
+ *    @param wld_header_t *header    The header to fill.
+ *    @param const char   *seed      The seed of the world.
+ *    @param int           width     The width of the world.
+ *    @param int           height    The height of the world.
+ *
+ *    @return int    0 on success, -1 on failure.
+ */
+int wld_gen_header(wld_header_t *header, const char *seed, int width, int height) {
+    if (header == (wld_header_t *)0x0) {
+        LOGF_ERR("Header is NULL!");
+        return -1;
+    }
+
+    if (seed == (const char *)0x0) {
+        LOGF_ERR("Seed is NULL!");
+        return -1;
+    }
+
+    gen_t gen;
+
+    memset(header, 0, sizeof(*header));
+
+    header->seed   = (char *)seed;
+    header->width  = width;
+    header->height = height;
+
+    gen_reset(&gen, header, wld_gen_parse_seed(seed), width, height);
+
+    return 0;
+}
+
+/*
+ *    Generates a world by running every registered pass in order over its
+ *    tiles, which must already be allocated and empty. A paletted world is
+ *    expanded, and every column is made writable through tile_column_mut
+ *    first, so snapshots keep their tiles and every column is marked.
+ *
+ *    @param wld_t        *wld      The world to generate.
+ *    @param unsigned int  seed     The seed to use for generation.
+ *    @param char         *name     The name of the world.
+ *    @param int           width    The width of the world.
+ *    @param int           height   The height of the world.
+ *    @param gen_stats_t  *stats    Filled with the time and tiles touched of each pass, may be NULL.
+ * 
+ *    @return int    0 on success, -1 on failure.
+ */
+int wld_gen_world(wld_t *wld, unsigned int seed, char *name, int width, int height, gen_stats_t *stats) {
+    if (wld == (wld_t *)0x0) {
+        LOGF_ERR("World is NULL!");
+        return -1;
+    }
+
+    if (name == (char *)0x0) {
+        LOGF_ERR("Name is NULL!");
+        return -1;
+    }
+
+    if ((wld->tiles == (tile_t **)0x0 && wld->palette == (tile_palette_t *)0x0) || width != wld->header.width ||
+        height != wld->header.height) {
+        LOGF_ERR("World has no tiles of that size.\n");
+        return -1;
+    }
+
+    /* Passes write wld->tiles directly, so every column is taken over up front.  */
+    int x;
+    for (x = 0; x < width; ++x) {
+        if (tile_column_mut(wld, x) == (tile_t *)0x0) {
+            VLOGF_ERR("Failed to make column %d writable.\n", x);
+            return -1;
+        }
+    }
+
+    /* Each generation has its own stream, so worlds can be generated concurrently.  */
+    gen_t gen;
+
+    memset(&gen, 0, sizeof(gen));
+
+    gen.wld     = wld;
+    gen.tiles   = wld->tiles;
+    gen.seed    = seed;
+    gen.width   = width;
+    gen.height  = height;
+    gen.left    = 0;
+    gen.right   = width;
+    gen.strip   = -1;
+    gen.surface = (int *)malloc(width * sizeof(int));
+    gen.rock    = (int *)malloc(width * sizeof(int));
+
+    if (gen.surface == (int *)0x0 || gen.rock == (int *)0x0) {
+        LOGF_ERR("Failed to allocate memory for generation.\n");
+        free(gen.surface);
+        free(gen.rock);
+        return -1;
+    }
+
+    /* Until the Terrain pass runs, the whole world is surface.  */
+    memset(gen.surface, 0, width * sizeof(int));
+    memset(gen.rock, 0, width * sizeof(int));
+
+    if (stats != (gen_stats_t *)0x0)
+        memset(stats, 0, sizeof(*stats));
+
+    double total = 0.0;
+    double done  = 0.0;
+    double start = gen_now();
+
+    unsigned int i;
+    for (i = 0; i < _gen_pass_count; ++i)
+        total += _gen_passes[i].weight;
+
+    for (i = 0; i < _gen_pass_count; ++i) {
+        double begin = gen_now();
+
+        VLOGF_NOTE("Generation: %s (%.0f%%)...\n", _gen_passes[i].name, total > 0.0 ? 100.0 * done / total : 0.0);
+
+        gen.pass    = i;
+        gen.touched = 0;
+
+        if (_gen_fast && _gen_passes[i].strips) {
+            if (!gen_run_strips(&gen)) {
+                VLOGF_ERR("Failed to run %s in strips.\n", _gen_passes[i].name);
+                free(gen.surface);
+                free(gen.rock);
+                return -1;
+            }
+        } else {
+            _gen_passes[i].fn(&gen);
+        }
+
+        done += _gen_passes[i].weight;
+
+        if (stats != (gen_stats_t *)0x0) {
+            stats->passes[i].name   = _gen_passes[i].name;
+            stats->passes[i].weight = _gen_passes[i].weight;
+            stats->passes[i].time   = gen_now() - begin;
+            stats->passes[i].tiles  = gen.touched;
+            stats->count++;
+        }
+    }
+
+    if (stats != (gen_stats_t *)0x0)
+        stats->time = gen_now() - start;
+
+    free(gen.surface);
+    free(gen.rock);
+
+    return 0;
+}
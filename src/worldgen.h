@@ -8,6 +8,7 @@
 #ifndef WLD_WORLDGEN_H
 #define WLD_WORLDGEN_H
 
+#include "rand.h"
 #include "wld.h"
 
 typedef struct {
@@ -23,16 +24,161 @@ typedef struct {
 } genvars_t;
 
 /*
- *    Generates a world.
+ *    The state of one world generation. The surface and rock lines hold
+ *    the first row of each layer for every column, and are filled by the
+ *    Terrain pass. Passes write tiles through the tiles array, where only
+ *    the columns from left to right can be used; in fast generation those
+ *    are one strip and its halos, and strip is its index, -1 otherwise.
+ */
+typedef struct {
+    rng_t          rng;
+    genvars_t      vars;
+    wld_t         *wld;
+    tile_t       **tiles;
+    int            seed;
+    int            width;
+    int            height;
+    int            left;
+    int            right;
+    int            strip;
+    unsigned int   pass;
+    unsigned int   scatters;
+    int           *surface;
+    int           *rock;
+    int            surface_low;
+    int            surface_high;
+    int            rock_low;
+    int            rock_high;
+    unsigned long  touched;
+} gen_t;
+
+#define GEN_MAX_PASSES 32
+
+/*
+ *    Fast generation splits passes into strips of columns with their own
+ *    random number streams, so they can run in parallel. A strip also
+ *    regenerates what its neighbours place within the halo of its edges,
+ *    so features cross strips. Worlds only depend on the seed, not on the
+ *    number of threads, but differ from the ones made without it.
+ */
+#define GEN_STRIP_WIDTH 256
+#define GEN_STRIP_HALO  64
+
+/*
+ *    A generation pass. Passes add every tile they write to gen->touched.
+ */
+typedef void (*gen_pass_fn_t)(gen_t *gen);
+
+typedef struct {
+    const char    *name;
+    double         weight;
+    gen_pass_fn_t  fn;
+    unsigned char  strips;
+} gen_pass_t;
+
+/*
+ *    The cost of one pass. In fast generation, the tiles touched include
+ *    the ones regenerated in halos.
+ */
+typedef struct {
+    const char    *name;
+    double         weight;
+    double         time;
+    unsigned long  tiles;
+} gen_pass_stats_t;
+
+typedef struct {
+    unsigned int      count;
+    double            time;
+    gen_pass_stats_t  passes[GEN_MAX_PASSES];
+} gen_stats_t;
+
+/*
+ *    Enables or disables fast generation. Disabled by default.
+ *
+ *    @param unsigned int enabled    1 to generate in strips, 0 to generate like the game.
+ *    @param unsigned int threads    The number of threads to use, 0 for one per CPU.
+ */
+void wld_gen_set_fast(unsigned int enabled, unsigned int threads);
+
+/*
+ *    Appends a pass to the registry, to run after the built in passes. Not
+ *    thread safe, passes should be added before any world is generated.
+ *    Added passes always run over the whole world at once.
+ *
+ *    @param const char    *name      The name of the pass, which is not copied.
+ *    @param double         weight    The share of the progress the pass takes.
+ *    @param gen_pass_fn_t  fn        The pass.
+ *
+ *    @return unsigned int    1 on success, 0 if the registry is full.
+ */
+unsigned int wld_gen_add_pass(const char *name, double weight, gen_pass_fn_t fn);
+
+/*
+ *    Returns the number of registered passes.
+ *
+ *    @return unsigned int    The number of passes.
+ */
+unsigned int wld_gen_pass_count(void);
+
+/*
+ *    Returns a registered pass.
+ *
+ *    @param unsigned int i    The index of the pass.
+ *
+ *    @return const gen_pass_t *    The pass, NULL if out of range.
+ */
+const gen_pass_t *wld_gen_get_pass(unsigned int i);
+
+/*
+ *    Places a tile, counting it as touched.
+ *
+ *    @param gen_t *gen     The generation.
+ *    @param int    x       The x coordinate.
+ *    @param int    y       The y coordinate.
+ *    @param short  tile    The tile, -1 to clear it.
+ */
+void gen_set_tile(gen_t *gen, int x, int y, short tile);
+
+/*
+ *    Parses a seed the way the game does. Numbers are used as they are,
+ *    anything else is hashed.
+ *
+ *    @param const char *seed    The seed.
+ *
+ *    @return int    The numeric seed.
+ */
+int wld_gen_parse_seed(const char *seed);
+
+/*
+ *    Runs only the generation passes that decide the header of a world,
+ *    without allocating any tiles. The header is cleared first and keeps
+ *    a pointer to the seed string, which is not copied.
+ *
+ *    @param wld_header_t *header    The header to fill.
+ *    @param const char   *seed      The seed of the world.
+ *    @param int           width     The width of the world.
+ *    @param int           height    The height of the world.
+ *
+ *    @return int    0 on success, -1 on failure.
+ */
+int wld_gen_header(wld_header_t *header, const char *seed, int width, int height);
+
+/*
+ *    Generates a world by running every registered pass in order over its
+ *    tiles, which must already be allocated and empty. A paletted world is
+ *    expanded, and every column is made writable through tile_column_mut
+ *    first, so snapshots keep their tiles and every column is marked.
  *
  *    @param wld_t        *wld      The world to generate.
  *    @param unsigned int  seed     The seed to use for generation.
  *    @param char         *name     The name of the world.
  *    @param int           width    The width of the world.
  *    @param int           height   The height of the world.
+ *    @param gen_stats_t  *stats    Filled with the time and tiles touched of each pass, may be NULL.
  * 
  *    @return int    0 on success, -1 on failure.
  */
-int wld_gen_world(wld_t *wld, unsigned int seed, char *name, int width, int height);
+int wld_gen_world(wld_t *wld, unsigned int seed, char *name, int width, int height, gen_stats_t *stats);
 
 #endif /* WLD_WORLDGEN_H  */
\ No newline at end of file